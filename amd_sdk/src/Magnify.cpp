@@ -126,19 +126,10 @@ void Magnify::OnResizedSwapChain( const DXGI_SURFACE_DESC* pBackBufferSurfaceDes
 //--------------------------------------------------------------------------------------
 void Magnify::Capture( POINT& Point )
 {
-    RECT Rect;
-    ::GetWindowRect( DXUTGetHWND(), &Rect );
-
-    int nWidthDiff = 0;
-    int nHeightDiff = 0;
-
-    if (DXUTIsWindowed())
-    {
-        nWidthDiff = (int)(((Rect.right - Rect.left) - m_nBackBufferWidth) * (1.0f / 2.0f));
-        nHeightDiff = (int)(((Rect.bottom - Rect.top) - m_nBackBufferHeight) * (4.0f / 5.0f));
-    }
+    int nPositionX, nPositionY;
+    GetClientPosition( Point, nPositionX, nPositionY );
 
-    SetPosition( Point.x - (Rect.left + nWidthDiff), Point.y - (Rect.top + nHeightDiff) );
+    SetPosition( nPositionX, nPositionY );
 
     D3D10_BOX SourceRegion;
     SourceRegion.left = m_nPositionX - m_nHalfPixelRegion;
@@ -150,6 +141,22 @@ void Magnify::Capture( POINT& Point )
 }
 
 
+//--------------------------------------------------------------------------------------
+// Returns the region Capture() would magnify, without changing the capture position
+//--------------------------------------------------------------------------------------
+void Magnify::GetCaptureRegion( POINT& Point, RECT& Region )
+{
+    int nPositionX, nPositionY;
+    GetClientPosition( Point, nPositionX, nPositionY );
+    ClampPosition( nPositionX, nPositionY );
+
+    Region.left = nPositionX - m_nHalfPixelRegion;
+    Region.right = nPositionX + m_nHalfPixelRegion;
+    Region.top = nPositionY - m_nHalfPixelRegion;
+    Region.bottom = nPositionY + m_nHalfPixelRegion;
+}
+
+
 //--------------------------------------------------------------------------------------
 // User defines the resource for capturing from
 //--------------------------------------------------------------------------------------
@@ -392,19 +399,50 @@ void Magnify::RenderMagnifiedRegion()
 //--------------------------------------------------------------------------------------
 void Magnify::SetPosition( int nPositionX, int nPositionY )
 {
+    ClampPosition( nPositionX, nPositionY );
+
     m_nPositionX = nPositionX;
     m_nPositionY = nPositionY;
+}
 
+
+//--------------------------------------------------------------------------------------
+// Private method that converts a cursor position to back buffer coordinates
+//--------------------------------------------------------------------------------------
+void Magnify::GetClientPosition( POINT& Point, int& nPositionX, int& nPositionY )
+{
+    RECT Rect;
+    ::GetWindowRect( DXUTGetHWND(), &Rect );
+
+    int nWidthDiff = 0;
+    int nHeightDiff = 0;
+
+    if (DXUTIsWindowed())
+    {
+        nWidthDiff = (int)(((Rect.right - Rect.left) - m_nBackBufferWidth) * (1.0f / 2.0f));
+        nHeightDiff = (int)(((Rect.bottom - Rect.top) - m_nBackBufferHeight) * (4.0f / 5.0f));
+    }
+
+    nPositionX = Point.x - (Rect.left + nWidthDiff);
+    nPositionY = Point.y - (Rect.top + nHeightDiff);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private method that keeps the magnified region inside the source resource
+//--------------------------------------------------------------------------------------
+void Magnify::ClampPosition( int& nPositionX, int& nPositionY )
+{
     int nMinX = m_nPixelRegion;
     int nMaxX = m_nSourceResourceWidth - m_nPixelRegion;
     int nMinY = m_nPixelRegion;
     int nMaxY = m_nSourceResourceHeight - m_nPixelRegion;
 
-    m_nPositionX = (m_nPositionX < nMinX) ? (nMinX) : (m_nPositionX);
-    m_nPositionX = (m_nPositionX > nMaxX) ? (nMaxX) : (m_nPositionX);
+    nPositionX = (nPositionX < nMinX) ? (nMinX) : (nPositionX);
+    nPositionX = (nPositionX > nMaxX) ? (nMaxX) : (nPositionX);
 
-    m_nPositionY = (m_nPositionY < nMinY) ? (nMinY) : (m_nPositionY);
-    m_nPositionY = (m_nPositionY > nMaxY) ? (nMaxY) : (m_nPositionY);
+    nPositionY = (nPositionY < nMinY) ? (nMinY) : (nPositionY);
+    nPositionY = (nPositionY > nMaxY) ? (nMaxY) : (nPositionY);
 }
 
 
@@ -57,6 +57,9 @@ public:
     // Captures a region, at the current cursor position, for magnification
     void Capture( POINT& Point );
 
+    // Returns the source region that Capture() would use for a cursor position
+    void GetCaptureRegion( POINT& Point, RECT& Region );
+
     // Render the magnified region, at the capture location
     void RenderBackground();
     void RenderMagnifiedRegion();
@@ -65,6 +68,8 @@ private:
 
     // Private methods
     void SetPosition( int nPositionX, int nPositionY );
+    void GetClientPosition( POINT& Point, int& nPositionX, int& nPositionY );
+    void ClampPosition( int& nPositionX, int& nPositionY );
     void CreateInternalResources();
 
 private:
@@ -258,6 +258,36 @@ bool MagnifyTool::IsEnabled()
 }
 
 
+//--------------------------------------------------------------------------------------
+// Same conditions as Render(), for applications that only process the magnified region
+//--------------------------------------------------------------------------------------
+bool MagnifyTool::GetCaptureRegion( RECT& Region )
+{
+    if (!m_pMagnifyUI->GetCheckBox( IDC_MAGNIFY_CHECKBOX_ENABLE )->GetEnabled() ||
+        !m_pMagnifyUI->GetCheckBox( IDC_MAGNIFY_CHECKBOX_ENABLE )->GetChecked())
+    {
+        return false;
+    }
+
+    POINT pt;
+    if (m_bStickyShowing)
+    {
+        pt = m_StickyPoint;
+    }
+    else if (DXUTIsMouseButtonDown( VK_RBUTTON ))
+    {
+        ::GetCursorPos( &pt );
+    }
+    else
+    {
+        return false;
+    }
+
+    m_Magnify.GetCaptureRegion( pt, Region );
+    return true;
+}
+
+
 //--------------------------------------------------------------------------------------
 // Private method for UI control
 //--------------------------------------------------------------------------------------
@@ -69,6 +69,9 @@ namespace AMD
         void OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, void* pUserContext );
         bool IsEnabled();
 
+        // The source region the magnifier shows this frame, returns false if it isn't showing
+        bool GetCaptureRegion( RECT& Region );
+
         // Render
         void Render();
 
@@ -0,0 +1,3276 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_Benchmark.cpp
+//
+// Quality against cost of the CPU MLAA settings. Synthetic vector scenes are rendered
+// with one sample per pixel and with 16 (4x4) samples per pixel as the reference. The
+// aliased image is anti-aliased for every threshold of the sample's HUD slider and every
+// edge count size, then timed and compared with the reference. The configurations that
+// no other configuration beats on time, PSNR and SSIM at once form the Pareto frontier,
+// which is written as CSV.
+//
+// Every heap allocation is counted. After the first run of a configuration, which can
+// allocate the scratch of the engine, the timed runs must not allocate at all.
+//
+// Subcommands measure other parts of the CPU implementation on the same scenes, each
+// checks its output against the plain engine and fails if they differ.
+//
+// Usage: MLAA11_Benchmark [-o file.csv] [-size N] [-reps N] [-all]
+//                         [-min-psnr dB] [-min-ssim value]
+//        MLAA11_Benchmark queue-depth [-size N] [-frames N] [-depth N] [-threads N]
+//        MLAA11_Benchmark resize-storm [-resizes N]
+//        MLAA11_Benchmark region [-size N] [-reps N]
+//        MLAA11_Benchmark views [-views N] [-view-size N] [-reps N] [-threads N]
+//        MLAA11_Benchmark half-res [-size N] [-reps N]
+//        MLAA11_Benchmark quality-map [-size N] [-reps N]
+//        MLAA11_Benchmark long-search [-size N] [-reps N]
+//        MLAA11_Benchmark vertical-search [-size N] [-reps N]
+//        MLAA11_Benchmark quad-kernel [-size N] [-reps N]
+//        MLAA11_Benchmark blend-math [-size N] [-reps N]
+//        MLAA11_Benchmark planar [-width N] [-height N] [-frames N] [-depth N] [-threads N]
+//        MLAA11_Benchmark effect [-size N] [-reps N]
+//        MLAA11_Benchmark governor
+//        MLAA11_Benchmark hdr [-size N] [-reps N]
+//        MLAA11_Benchmark msaa [-size N] [-reps N]
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_CPU.h"
+#include "MLAA_CPUQueue.h"
+#include "MLAA_Effect.h"
+#include "MLAA_Governor.h"
+#include "MLAA_SurfacePool.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+//--------------------------------------------------------------------------------------
+// Heap allocation counter. Every replaceable allocation function is replaced, so
+// allocations of any form and from any thread are counted
+//--------------------------------------------------------------------------------------
+static std::atomic<uint64_t> g_nHeapAllocations( 0 );
+
+// gcc inlines the replacements into the standard containers and then reports free() on
+// memory from operator new as a mismatch
+#if defined(__GNUC__)
+#define DEALLOCATION __attribute__((noinline))
+#else
+#define DEALLOCATION
+#endif
+
+void* operator new( size_t nBytes )
+{
+    g_nHeapAllocations++;
+    void* p = malloc( nBytes > 0 ? nBytes : 1 );
+    if ( p == NULL )
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[]( size_t nBytes )
+{
+    return operator new( nBytes );
+}
+
+DEALLOCATION void operator delete( void* p ) throw()
+{
+    free( p );
+}
+
+DEALLOCATION void operator delete[]( void* p ) throw()
+{
+    free( p );
+}
+
+DEALLOCATION void operator delete( void* p, size_t ) throw()
+{
+    operator delete( p );
+}
+
+DEALLOCATION void operator delete[]( void* p, size_t ) throw()
+{
+    operator delete[]( p );
+}
+
+#if defined(__cpp_aligned_new)
+void* operator new( size_t nBytes, std::align_val_t Alignment )
+{
+    g_nHeapAllocations++;
+    size_t nAlignment = (size_t)Alignment;
+    nBytes = ( ( nBytes > 0 ? nBytes : 1 ) + nAlignment - 1 ) & ~( nAlignment - 1 );
+#if defined(_WIN32)
+    void* p = _aligned_malloc( nBytes, nAlignment );
+#else
+    void* p = aligned_alloc( nAlignment, nBytes );
+#endif
+    if ( p == NULL )
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[]( size_t nBytes, std::align_val_t Alignment )
+{
+    return operator new( nBytes, Alignment );
+}
+
+DEALLOCATION void operator delete( void* p, std::align_val_t ) throw()
+{
+#if defined(_WIN32)
+    _aligned_free( p );
+#else
+    free( p );
+#endif
+}
+
+DEALLOCATION void operator delete[]( void* p, std::align_val_t Alignment ) throw()
+{
+    operator delete( p, Alignment );
+}
+
+DEALLOCATION void operator delete( void* p, size_t, std::align_val_t Alignment ) throw()
+{
+    operator delete( p, Alignment );
+}
+
+DEALLOCATION void operator delete[]( void* p, size_t, std::align_val_t Alignment ) throw()
+{
+    operator delete( p, Alignment );
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Sweep, the range of gEdgeDetectionThreshold in MLAA11.cpp. The sample passes
+// 1 / gEdgeDetectionThreshold to the passes
+//--------------------------------------------------------------------------------------
+static const int    kMinThresholdSlider     = 1;
+static const int    kMaxThresholdSlider     = 64;
+
+// MAX_EDGE_COUNT_BITS of the shader permutations, the CPU engine has an edge search for each
+static const int    kEdgeCountBits[]        = { MLAA::kNumCountBits, MLAA::kLongNumCountBits };
+
+static const int    kReferenceSamples       = 4;    // Per side, 16 per pixel
+
+//--------------------------------------------------------------------------------------
+// Scenes are flat shaded shapes drawn back to front
+//--------------------------------------------------------------------------------------
+enum SHAPE_TYPE
+{
+    SHAPE_POLYGON,                  // Convex, counter-clockwise
+    SHAPE_DISC
+};
+
+struct Shape
+{
+    SHAPE_TYPE  Type;
+    float       X[4];               // Polygon corners, or the center of a disc in X[0], Y[0]
+    float       Y[4];
+    int         nCorners;
+    float       Radius;
+    uint8_t     Color[3];
+};
+
+struct Scene
+{
+    const char*         pName;
+    uint8_t             Background[3];
+    std::vector<Shape>  Shapes;
+};
+
+struct Random
+{
+    uint32_t    State;
+
+    float Next()
+    {
+        State = State * 1664525u + 1013904223u;
+        return (float)(State >> 8) / (float)(1 << 24);
+    }
+    float Next( float Min, float Max ) { return Min + (Max - Min) * Next(); }
+};
+
+static void RandomColor( Random& Rand, uint8_t Color[3] )
+{
+    for ( int i = 0; i < 3; i++ )
+        Color[i] = (uint8_t)( Rand.Next() * 255.0f );
+}
+
+// Rectangle of Length by Width centered on (x, y) and rotated by Angle
+static Shape MakeBox( float x, float y, float Length, float Width, float Angle )
+{
+    float dx = cosf( Angle ), dy = sinf( Angle );
+    float hl = 0.5f * Length, hw = 0.5f * Width;
+    Shape Box = {};
+    Box.Type = SHAPE_POLYGON;
+    Box.nCorners = 4;
+    Box.X[0] = x - dx * hl + dy * hw;   Box.Y[0] = y - dy * hl - dx * hw;
+    Box.X[1] = x + dx * hl + dy * hw;   Box.Y[1] = y + dy * hl - dx * hw;
+    Box.X[2] = x + dx * hl - dy * hw;   Box.Y[2] = y + dy * hl + dx * hw;
+    Box.X[3] = x - dx * hl - dy * hw;   Box.Y[3] = y - dy * hl + dx * hw;
+    return Box;
+}
+
+static Shape MakeTriangle( float x, float y, float Radius, float Angle )
+{
+    Shape Triangle = {};
+    Triangle.Type = SHAPE_POLYGON;
+    Triangle.nCorners = 3;
+    for ( int i = 0; i < 3; i++ )
+    {
+        float a = Angle + (float)i * 2.0943951f;
+        Triangle.X[i] = x + Radius * cosf( a );
+        Triangle.Y[i] = y + Radius * sinf( a );
+    }
+    return Triangle;
+}
+
+static Shape MakeDisc( float x, float y, float Radius )
+{
+    Shape Disc = {};
+    Disc.Type = SHAPE_DISC;
+    Disc.X[0] = x;
+    Disc.Y[0] = y;
+    Disc.Radius = Radius;
+    return Disc;
+}
+
+//--------------------------------------------------------------------------------------
+// The scenes cover the cases MLAA handles differently: polygons with edges at any angle,
+// thin lines, long nearly horizontal and vertical edges, and curves
+//--------------------------------------------------------------------------------------
+static void BuildScenes( int Size, std::vector<Scene>& Scenes )
+{
+    const float s = (float)Size;
+    const float Pi = 3.14159265f;
+    Random Rand = { 12345 };
+    Scenes.resize( 4 );
+
+    Scene& Polygons = Scenes[0];
+    Polygons.pName = "polygons";
+    RandomColor( Rand, Polygons.Background );
+    for ( int i = 0; i < 48; i++ )
+    {
+        float x = Rand.Next( 0.0f, s ), y = Rand.Next( 0.0f, s ), Angle = Rand.Next( 0.0f, 2.0f * Pi );
+        Shape Polygon = ( i & 1 ) ? MakeTriangle( x, y, Rand.Next( 0.05f, 0.2f ) * s, Angle ) :
+                                    MakeBox( x, y, Rand.Next( 0.05f, 0.3f ) * s, Rand.Next( 0.03f, 0.2f ) * s, Angle );
+        RandomColor( Rand, Polygon.Color );
+        Polygons.Shapes.push_back( Polygon );
+    }
+
+    Scene& Lines = Scenes[1];
+    Lines.pName = "lines";
+    RandomColor( Rand, Lines.Background );
+    for ( int i = 0; i < 64; i++ )
+    {
+        Shape Line = MakeBox( Rand.Next( 0.0f, s ), Rand.Next( 0.0f, s ), Rand.Next( 0.1f, 0.6f ) * s,
+                              Rand.Next( 0.7f, 3.0f ), Rand.Next( 0.0f, Pi ) );
+        RandomColor( Rand, Line.Color );
+        Lines.Shapes.push_back( Line );
+    }
+
+    // Wedges of a wheel slightly rotated from the axes, the edges next to them are the
+    // long stair steps that the edge count size limits
+    Scene& Wheel = Scenes[2];
+    Wheel.pName = "wheel";
+    Wheel.Background[0] = Wheel.Background[1] = Wheel.Background[2] = 32;
+    const int nSpokes = 36;
+    for ( int i = 0; i < nSpokes; i++ )
+    {
+        float a0 = 0.01f + (float)i * 2.0f * Pi / (float)nSpokes;
+        float a1 = a0 + Pi / (float)nSpokes;
+        float r = 0.7f * s;
+        Shape Wedge = {};
+        Wedge.Type = SHAPE_POLYGON;
+        Wedge.nCorners = 3;
+        Wedge.X[0] = 0.5f * s;                      Wedge.Y[0] = 0.5f * s;
+        Wedge.X[1] = 0.5f * s + r * cosf( a0 );     Wedge.Y[1] = 0.5f * s + r * sinf( a0 );
+        Wedge.X[2] = 0.5f * s + r * cosf( a1 );     Wedge.Y[2] = 0.5f * s + r * sinf( a1 );
+        Wedge.Color[0] = Wedge.Color[1] = Wedge.Color[2] = 224;
+        Wheel.Shapes.push_back( Wedge );
+    }
+
+    Scene& Discs = Scenes[3];
+    Discs.pName = "discs";
+    RandomColor( Rand, Discs.Background );
+    for ( int i = 0; i < 40; i++ )
+    {
+        Shape Disc = MakeDisc( Rand.Next( 0.0f, s ), Rand.Next( 0.0f, s ), Rand.Next( 0.01f, 0.15f ) * s );
+        RandomColor( Rand, Disc.Color );
+        Discs.Shapes.push_back( Disc );
+    }
+}
+
+static bool Covers( const Shape& S, float x, float y )
+{
+    if ( S.Type == SHAPE_DISC )
+    {
+        float dx = x - S.X[0], dy = y - S.Y[0];
+        return dx * dx + dy * dy <= S.Radius * S.Radius;
+    }
+
+    // Inside all the edges, whichever the winding
+    int nPositive = 0, nNegative = 0;
+    for ( int i = 0; i < S.nCorners; i++ )
+    {
+        int j = ( i + 1 ) % S.nCorners;
+        float Cross = ( S.X[j] - S.X[i] ) * ( y - S.Y[i] ) - ( S.Y[j] - S.Y[i] ) * ( x - S.X[i] );
+        nPositive += ( Cross > 0.0f );
+        nNegative += ( Cross < 0.0f );
+    }
+    return nPositive == 0 || nNegative == 0;
+}
+
+static void GetBounds( const Shape& S, float& MinX, float& MinY, float& MaxX, float& MaxY )
+{
+    if ( S.Type == SHAPE_DISC )
+    {
+        MinX = S.X[0] - S.Radius;   MaxX = S.X[0] + S.Radius;
+        MinY = S.Y[0] - S.Radius;   MaxY = S.Y[0] + S.Radius;
+        return;
+    }
+    MinX = MaxX = S.X[0];
+    MinY = MaxY = S.Y[0];
+    for ( int i = 1; i < S.nCorners; i++ )
+    {
+        MinX = std::min( MinX, S.X[i] );    MaxX = std::max( MaxX, S.X[i] );
+        MinY = std::min( MinY, S.Y[i] );    MaxY = std::max( MaxY, S.Y[i] );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Renders a scene with Samples x Samples samples per pixel on a regular grid, one sample
+// is the pixel center. The samples are averaged in the squared space MLAA blends in, and
+// luma is written to alpha with the weights of RenderScenePS
+//--------------------------------------------------------------------------------------
+static void RenderScene( const Scene& S, int Size, int Samples, std::vector<uint8_t>& Image )
+{
+    const int SampleSize = Size * Samples;
+    std::vector<uint8_t> SampleColors( (size_t)SampleSize * SampleSize * 3 );
+    for ( size_t i = 0; i < SampleColors.size(); i += 3 )
+        memcpy( &SampleColors[i], S.Background, 3 );
+
+    const float Step = 1.0f / (float)Samples;
+    for ( size_t n = 0; n < S.Shapes.size(); n++ )
+    {
+        const Shape& Sh = S.Shapes[n];
+        float MinX, MinY, MaxX, MaxY;
+        GetBounds( Sh, MinX, MinY, MaxX, MaxY );
+        int x0 = std::max( 0, (int)floorf( MinX * Samples ) ), x1 = std::min( SampleSize - 1, (int)ceilf( MaxX * Samples ) );
+        int y0 = std::max( 0, (int)floorf( MinY * Samples ) ), y1 = std::min( SampleSize - 1, (int)ceilf( MaxY * Samples ) );
+        for ( int y = y0; y <= y1; y++ )
+        {
+            for ( int x = x0; x <= x1; x++ )
+            {
+                if ( Covers( Sh, ( (float)x + 0.5f ) * Step, ( (float)y + 0.5f ) * Step ) )
+                    memcpy( &SampleColors[( (size_t)y * SampleSize + x ) * 3], Sh.Color, 3 );
+            }
+        }
+    }
+
+    Image.resize( (size_t)Size * Size * 4 );
+    for ( int y = 0; y < Size; y++ )
+    {
+        for ( int x = 0; x < Size; x++ )
+        {
+            float Sum[3] = { 0.0f, 0.0f, 0.0f };
+            for ( int sy = 0; sy < Samples; sy++ )
+            {
+                const uint8_t* pSample = &SampleColors[( (size_t)( y * Samples + sy ) * SampleSize + x * Samples ) * 3];
+                for ( int sx = 0; sx < Samples * 3; sx++ )
+                    Sum[sx % 3] += (float)pSample[sx] * (float)pSample[sx];
+            }
+            uint8_t* pPixel = &Image[( (size_t)y * Size + x ) * 4];
+            for ( int i = 0; i < 3; i++ )
+                pPixel[i] = (uint8_t)( sqrtf( Sum[i] / (float)( Samples * Samples ) ) + 0.5f );
+            pPixel[3] = (uint8_t)( 0.30f * pPixel[0] + 0.59f * pPixel[1] + 0.11f * pPixel[2] + 0.5f );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Sum of squared differences of the color channels, for PSNR
+//--------------------------------------------------------------------------------------
+static double SquaredError( const std::vector<uint8_t>& Image, const std::vector<uint8_t>& Reference )
+{
+    double Sum = 0.0;
+    for ( size_t i = 0; i < Image.size(); i += 4 )
+    {
+        for ( int c = 0; c < 3; c++ )
+        {
+            double d = (double)Image[i + c] - (double)Reference[i + c];
+            Sum += d * d;
+        }
+    }
+    return Sum;
+}
+
+static double ToPSNR( double SquaredErrorSum, double nValues )
+{
+    double MSE = SquaredErrorSum / nValues;
+    return MSE > 0.0 ? 10.0 * log10( 255.0 * 255.0 / MSE ) : 99.0;
+}
+
+// Separable 11 tap gaussian with sigma 1.5, clamped at the borders
+static void GaussianBlur( const std::vector<float>& Src, int Size, std::vector<float>& Dst )
+{
+    static const int kRadius = 5;
+    float Weights[2 * kRadius + 1];
+    float Total = 0.0f;
+    for ( int i = -kRadius; i <= kRadius; i++ )
+    {
+        Weights[i + kRadius] = expf( -(float)( i * i ) / ( 2.0f * 1.5f * 1.5f ) );
+        Total += Weights[i + kRadius];
+    }
+
+    std::vector<float> Rows( Src.size() );
+    Dst.resize( Src.size() );
+    for ( int y = 0; y < Size; y++ )
+    {
+        for ( int x = 0; x < Size; x++ )
+        {
+            float Sum = 0.0f;
+            for ( int i = -kRadius; i <= kRadius; i++ )
+                Sum += Weights[i + kRadius] * Src[(size_t)y * Size + std::min( Size - 1, std::max( 0, x + i ) )];
+            Rows[(size_t)y * Size + x] = Sum / Total;
+        }
+    }
+    for ( int y = 0; y < Size; y++ )
+    {
+        for ( int x = 0; x < Size; x++ )
+        {
+            float Sum = 0.0f;
+            for ( int i = -kRadius; i <= kRadius; i++ )
+                Sum += Weights[i + kRadius] * Rows[(size_t)std::min( Size - 1, std::max( 0, y + i ) ) * Size + x];
+            Dst[(size_t)y * Size + x] = Sum / Total;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Mean SSIM of the luma of the color channels
+//--------------------------------------------------------------------------------------
+static double SSIM( const std::vector<uint8_t>& Image, const std::vector<uint8_t>& Reference, int Size )
+{
+    const size_t nPixels = (size_t)Size * Size;
+    std::vector<float> a( nPixels ), b( nPixels ), aa( nPixels ), bb( nPixels ), ab( nPixels );
+    for ( size_t i = 0; i < nPixels; i++ )
+    {
+        const uint8_t* p = &Image[i * 4];
+        const uint8_t* q = &Reference[i * 4];
+        a[i] = 0.30f * p[0] + 0.59f * p[1] + 0.11f * p[2];
+        b[i] = 0.30f * q[0] + 0.59f * q[1] + 0.11f * q[2];
+        aa[i] = a[i] * a[i];
+        bb[i] = b[i] * b[i];
+        ab[i] = a[i] * b[i];
+    }
+
+    std::vector<float> MeanA, MeanB, MeanAA, MeanBB, MeanAB;
+    GaussianBlur( a, Size, MeanA );
+    GaussianBlur( b, Size, MeanB );
+    GaussianBlur( aa, Size, MeanAA );
+    GaussianBlur( bb, Size, MeanBB );
+    GaussianBlur( ab, Size, MeanAB );
+
+    const double C1 = ( 0.01 * 255.0 ) * ( 0.01 * 255.0 );
+    const double C2 = ( 0.03 * 255.0 ) * ( 0.03 * 255.0 );
+    double Sum = 0.0;
+    for ( size_t i = 0; i < nPixels; i++ )
+    {
+        double ma = MeanA[i], mb = MeanB[i];
+        double va = MeanAA[i] - ma * ma, vb = MeanBB[i] - mb * mb, cov = MeanAB[i] - ma * mb;
+        Sum += ( ( 2.0 * ma * mb + C1 ) * ( 2.0 * cov + C2 ) ) / ( ( ma * ma + mb * mb + C1 ) * ( va + vb + C2 ) );
+    }
+    return Sum / (double)nPixels;
+}
+
+//--------------------------------------------------------------------------------------
+// One point of the sweep, averaged over the scenes. EdgeCountBits 0 is the aliased image
+//--------------------------------------------------------------------------------------
+struct Result
+{
+    int         EdgeCountBits;
+    int         ThresholdSlider;
+    double      NsPerPixel;
+    double      PSNR;
+    double      SSIM;
+    bool        bPareto;
+};
+
+static bool Dominates( const Result& a, const Result& b )
+{
+    bool bNoWorse = a.NsPerPixel <= b.NsPerPixel && a.PSNR >= b.PSNR && a.SSIM >= b.SSIM;
+    bool bBetter = a.NsPerPixel < b.NsPerPixel || a.PSNR > b.PSNR || a.SSIM > b.SSIM;
+    return bNoWorse && bBetter;
+}
+
+static bool FasterFirst( const Result& a, const Result& b )
+{
+    return a.NsPerPixel < b.NsPerPixel;
+}
+
+static void PrintUsage()
+{
+    printf( "Usage: MLAA11_Benchmark [-o file.csv] [-size N] [-reps N] [-all] [-min-psnr dB] [-min-ssim value]\n"
+            "  -o         CSV output, default MLAA11_Pareto.csv\n"
+            "  -size      Width and height of the scenes, default 512\n"
+            "  -reps      Runs per configuration, the fastest is kept, default 5\n"
+            "  -all       Also write the configurations off the Pareto frontier\n"
+            "  -min-psnr  Quality bar, prints the cheapest configuration that meets it\n"
+            "  -min-ssim  Quality bar, prints the cheapest configuration that meets it\n"
+            "\n"
+            "       MLAA11_Benchmark queue-depth [-size N] [-frames N] [-depth N] [-threads N]\n"
+            "  Latency and throughput of CPUQueue with 1 to -depth frames in flight, default 4,\n"
+            "  over -frames frames of -size pixels, defaults 64 and 1024, on -threads workers\n"
+            "\n"
+            "       MLAA11_Benchmark resize-storm [-resizes N]\n"
+            "  Allocations and time of -resizes window resizes, default 1000, with the render\n"
+            "  target pool against recreating the targets, on a mock allocator\n"
+            "\n"
+            "       MLAA11_Benchmark region [-size N] [-reps N]\n"
+            "  Apply with regions of interest against the full frame on scenes of -size pixels,\n"
+            "  default 2048, and the time of a region against its area\n"
+            "\n"
+            "       MLAA11_Benchmark views [-views N] [-view-size N] [-reps N] [-threads N]\n"
+            "  ApplyViews and CPUQueue::SubmitViews on -threads workers against a call per view, on\n"
+            "  an atlas of -views views of -view-size pixels, defaults 1000 and 128\n"
+            "\n"
+            "       MLAA11_Benchmark half-res [-size N] [-reps N]\n"
+            "  Time and PSNR of half against full resolution detection on scenes of -size pixels,\n"
+            "  default 2048\n"
+            "\n"
+            "       MLAA11_Benchmark quality-map [-size N] [-reps N]\n"
+            "  Time of each quality level of the quality map on scenes of -size pixels, default 2048\n"
+            "\n"
+            "       MLAA11_Benchmark long-search [-size N] [-reps N]\n"
+            "  Time and PSNR of the 4 bit, long and naive long edge searches on scenes and noise of\n"
+            "  -size pixels, default 2048\n"
+            "\n"
+            "       MLAA11_Benchmark vertical-search [-size N] [-reps N]\n"
+            "  Time of the line length pass with the transposed and the direct vertical search on\n"
+            "  scenes and noise of -size pixels, default 1024, 2048 and 4096\n"
+            "\n"
+            "       MLAA11_Benchmark quad-kernel [-size N] [-reps N]\n"
+            "  Time and luma loads of the pixel and quad detection kernels on scenes and noise of\n"
+            "  -size pixels, default 2048, at least 160\n"
+            "\n"
+            "       MLAA11_Benchmark blend-math [-size N] [-reps N]\n"
+            "  Time of the blend pass and determinism of its float math on scenes and noise of\n"
+            "  -size pixels, default 2048\n"
+            "\n"
+            "       MLAA11_Benchmark planar [-width N] [-height N] [-frames N] [-depth N] [-threads N]\n"
+            "  Time of NV12 frames of -width by -height, default 3840x2160, one at a time and through\n"
+            "  a CPUQueue -depth deep, default 4, with -threads workers, default one per core\n"
+            "\n"
+            "       MLAA11_Benchmark effect [-size N] [-reps N]\n"
+            "  MLAA::Effect on a CPUBackend against the engine for each setting, a region and views,\n"
+            "  on scenes of -size pixels, default 512, and its time against CPUEngine::Apply\n"
+            "\n"
+            "       MLAA11_Benchmark governor\n"
+            "  BudgetGovernor on a synthetic frame cost with 10%% noise, through a spike and loads\n"
+            "  that fit the first and a middle step, at measurement latencies 0 and 3\n"
+            "\n"
+            "       MLAA11_Benchmark hdr [-size N] [-reps N]\n"
+            "  Edges of RGBA16F and RGBA32F images at several exposures against those of the LDR\n"
+            "  image, and the time of DetectEdgesHDR against DetectEdges, at -size pixels, default 2048\n"
+            "\n"
+            "       MLAA11_Benchmark msaa [-size N] [-reps N]\n"
+            "  Edges and output of ApplyMSAA against Apply on the resolve, on scenes of -size pixels\n"
+            "  with 4 samples per pixel, default 1024\n" );
+}
+
+//--------------------------------------------------------------------------------------
+// Helpers of the subcommands: the scenes at one sample per pixel, comparison of a
+// rectangle of two images of Width pixels or of two edge views, and the fastest of nReps
+// runs
+//--------------------------------------------------------------------------------------
+static void RenderInputs( int Size, std::vector< std::vector<uint8_t> >& Images )
+{
+    std::vector<Scene> Scenes;
+    BuildScenes( Size, Scenes );
+    Images.resize( Scenes.size() );
+    for ( size_t s = 0; s < Scenes.size(); s++ )
+        RenderScene( Scenes[s], Size, 1, Images[s] );
+}
+
+static bool SameRect( const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, int Width, const MLAA::Rect& Region )
+{
+    for ( int y = Region.Top; y < Region.Bottom; y++ )
+    {
+        size_t Offset = ( (size_t)y * Width + Region.Left ) * 4;
+        if ( memcmp( &a[Offset], &b[Offset], ( Region.Right - Region.Left ) * 4 ) )
+            return false;
+    }
+    return true;
+}
+
+static bool SameEdges( const MLAA::EdgeView& a, const MLAA::EdgeView& b )
+{
+    if ( a.Width != b.Width || a.Height != b.Height || a.CountBytes != b.CountBytes )
+        return false;
+    size_t nPixels = (size_t)a.Width * a.Height;
+    return !memcmp( a.pEdgeMask, b.pEdgeMask, nPixels ) && !memcmp( a.pCounts, b.pCounts, nPixels * 2 * a.CountBytes );
+}
+
+template <typename Function>
+static double BestTimeMs( int nReps, Function Run )
+{
+    double BestMs = 0.0;
+    for ( int r = 0; r < nReps; r++ )
+    {
+        double StartTime = MLAA::GetTimeMs();
+        Run();
+        double Ms = MLAA::GetTimeMs() - StartTime;
+        BestMs = ( r == 0 || Ms < BestMs ) ? Ms : BestMs;
+    }
+    return BestMs;
+}
+
+//--------------------------------------------------------------------------------------
+// queue-depth: CPUQueue keeps up to the depth frames in flight, submitted as fast as it
+// takes them. Deeper queues overlap the blend pass of a frame with the edge passes of the
+// next for throughput, at the cost of latency. Every output is checked against
+// CPUEngine::Apply. At depth 1 each frame is also submitted from the callback of the
+// previous one, which needs the slot of a frame released before its callback runs
+//--------------------------------------------------------------------------------------
+static int RunQueueDepth( int argc, char* argv[] )
+{
+    int Size = 1024, nFrames = 64, nMaxDepth = 4, nThreads = 0;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-frames" ) && bHasValue )      nFrames = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-depth" ) && bHasValue )       nMaxDepth = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-threads" ) && bHasValue )     nThreads = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nFrames < 1 || nMaxDepth < 1 || nThreads < 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector< std::vector<uint8_t> > Inputs;
+    std::vector<uint8_t> Reference( nBytes );
+    RenderInputs( Size, Inputs );
+    std::vector<uint8_t>& Input = Inputs[0];
+    MLAA::Surface Src = { &Input[0], Size, Size, Size * 4 };
+    MLAA::Surface RefDst = { &Reference[0], Size, Size, Size * 4 };
+    MLAA::CPUEngine Engine;
+    Engine.Apply( Src, RefDst );
+
+    printf( "%d frames of %dx%d\n\n%5s %10s %10s %10s %10s\n", nFrames, Size, Size, "Depth", "Frames/s",
+            "Mean ms", "99th ms", "Speedup" );
+    double fOneFrame = 0.0;
+    for ( int nDepth = 1; nDepth <= nMaxDepth; nDepth++ )
+    {
+        MLAA::CPUQueue Queue( nDepth, nThreads );
+        std::vector< std::vector<uint8_t> > Outputs( nDepth, std::vector<uint8_t>( nBytes ) );
+        std::vector< std::future<MLAA::FrameResult> > Futures( nDepth );
+        std::vector<double> Latencies;
+        bool bMatch = true;
+
+        // The first round sizes the intermediates of every slot and is not timed
+        for ( int Round = 0; Round < 2; Round++ )
+        {
+            int nRoundFrames = ( Round == 0 ) ? nDepth : nFrames;
+            double StartTime = MLAA::GetTimeMs();
+            for ( int f = 0; f < nRoundFrames + nDepth; f++ )
+            {
+                int nSlot = f % nDepth;
+                if ( f >= nDepth )
+                {
+                    MLAA::FrameResult Result = Futures[nSlot].get();
+                    bMatch = bMatch && ( Outputs[nSlot] == Reference );
+                    if ( Round > 0 )
+                        Latencies.push_back( Result.LatencyMs );
+                }
+                if ( f < nRoundFrames )
+                {
+                    MLAA::Surface Dst = { &Outputs[nSlot][0], Size, Size, Size * 4 };
+                    Futures[nSlot] = Queue.Submit( Src, Dst );
+                }
+            }
+            if ( Round == 0 )
+                continue;
+
+            double fFramesPerSecond = nFrames * 1000.0 / ( MLAA::GetTimeMs() - StartTime );
+            if ( nDepth == 1 )
+                fOneFrame = fFramesPerSecond;
+            std::sort( Latencies.begin(), Latencies.end() );
+            double fMean = 0.0;
+            for ( size_t i = 0; i < Latencies.size(); i++ )
+                fMean += Latencies[i] / (double)Latencies.size();
+            printf( "%5d %10.1f %10.2f %10.2f %9.2fx\n", nDepth, fFramesPerSecond, fMean,
+                    Latencies[Latencies.size() * 99 / 100], fFramesPerSecond / fOneFrame );
+        }
+        if ( !bMatch )
+        {
+            printf( "An output with %d frames in flight differs from CPUEngine::Apply\n", nDepth );
+            return 1;
+        }
+    }
+
+    // Each callback submits the next frame. A frame whose slot is still held while its
+    // callback runs would wait forever for a free slot
+    MLAA::CPUQueue Chain( 1, nThreads );
+    std::vector<uint8_t> Output( nBytes );
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    std::atomic<int> nChained( 0 );
+    const int kChainLength = 8;
+    MLAA::CPUQueue::Callback SubmitNext = [&]( const MLAA::FrameResult& )
+    {
+        if ( ++nChained < kChainLength )
+            Chain.Submit( Src, Dst, SubmitNext );
+    };
+    Chain.Submit( Src, Dst, SubmitNext );
+
+    double StartTime = MLAA::GetTimeMs();
+    while ( nChained < kChainLength && MLAA::GetTimeMs() - StartTime < 10000.0 )
+        std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+    if ( nChained < kChainLength )
+    {
+        printf( "Submitting from a callback with one frame in flight is stuck after %d frames\n", (int)nChained );
+        exit( 1 );
+    }
+    Chain.Flush();
+    if ( Output != Reference )
+    {
+        printf( "The frames submitted from callbacks differ from CPUEngine::Apply\n" );
+        return 1;
+    }
+    printf( "\nEvery output matches CPUEngine::Apply, %d frames chained through callbacks at depth 1\n", kChainLength );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Allocator of the resize storm. Surfaces are heap blocks of SampleCount * Format bytes
+// per pixel, cleared like a driver clears new render targets, so the cost of an
+// allocation grows with its size. Frees of surfaces it did not hand out are counted
+//--------------------------------------------------------------------------------------
+class MockAllocator : public MLAA::ISurfaceAllocator
+{
+public:
+
+    MockAllocator() : m_nAllocations( 0 ), m_nBadFrees( 0 ) {}
+
+    virtual void* Allocate( const MLAA::SurfaceDesc& Desc )
+    {
+        size_t nBytes = (size_t)Desc.Width * Desc.Height * Desc.SampleCount * Desc.Format;
+        void* pSurface = malloc( nBytes );
+        if ( pSurface == NULL )
+            return NULL;
+        memset( pSurface, 0, nBytes );
+        m_Live.push_back( pSurface );
+        m_nAllocations++;
+        return pSurface;
+    }
+
+    virtual void Free( void* pSurface )
+    {
+        std::vector<void*>::iterator It = std::find( m_Live.begin(), m_Live.end(), pSurface );
+        if ( It == m_Live.end() )
+        {
+            m_nBadFrees++;
+            return;
+        }
+        m_Live.erase( It );
+        free( pSurface );
+    }
+
+    int     GetAllocationCount() const  { return m_nAllocations; }
+    int     GetLiveCount() const        { return (int)m_Live.size(); }
+    int     GetBadFreeCount() const     { return m_nBadFrees; }
+
+private:
+
+    std::vector<void*>  m_Live;
+    int                 m_nAllocations;
+    int                 m_nBadFrees;
+};
+
+//--------------------------------------------------------------------------------------
+// The render targets of the sample after a resize: the scene color at any size of at
+// least the window, then the resolved color, depth, MSAA stencil, edge mask, edge count
+// and staging copy at exactly the size of the scene color
+//--------------------------------------------------------------------------------------
+static const int kStormTargets = 7;
+
+static MLAA::SurfaceDesc StormTarget( int nTarget, int Width, int Height )
+{
+    //                                              Bytes   Samples Bind    Usage
+    static const unsigned int kTargets[kStormTargets][4] = { { 4,      4,      3,      0 },    // Scene color
+                                                            { 4,      1,      3,      0 },    // Resolved color
+                                                            { 4,      4,      4,      0 },    // Depth
+                                                            { 4,      1,      4,      0 },    // MLAA stencil
+                                                            { 1,      1,      3,      0 },    // Edge mask
+                                                            { 1,      1,      3,      0 },    // Edge count
+                                                            { 4,      1,      0,      1 } };  // Staging
+    MLAA::SurfaceDesc Desc;
+    Desc.Width = Width;
+    Desc.Height = Height;
+    Desc.Format = kTargets[nTarget][0];
+    Desc.ViewFormat = (unsigned int)nTarget;
+    Desc.SampleCount = (int)kTargets[nTarget][1];
+    Desc.BindFlags = kTargets[nTarget][2];
+    Desc.Usage = kTargets[nTarget][3];
+    return Desc;
+}
+
+// Acquires the targets for a window size the way CreateMLAARenderTargets does, returns
+// false if a surface is missing or smaller than the window
+static bool AcquireStormTargets( MLAA::SurfacePool& Pool, int Width, int Height )
+{
+    Pool.ReleaseAll();
+    int AllocatedWidth = 0, AllocatedHeight = 0;
+    if ( Pool.Acquire( StormTarget( 0, Width, Height ), &AllocatedWidth, &AllocatedHeight ) == NULL ||
+         AllocatedWidth < Width || AllocatedHeight < Height )
+        return false;
+    for ( int t = 1; t < kStormTargets; t++ )
+    {
+        if ( Pool.Acquire( StormTarget( t, AllocatedWidth, AllocatedHeight ), NULL, NULL, true ) == NULL )
+            return false;
+    }
+    Pool.Trim();
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Policy of SurfacePool against a mock allocator, returns the first broken rule or NULL
+//--------------------------------------------------------------------------------------
+static const char* CheckSurfacePool()
+{
+    MockAllocator Allocator;
+    {
+        MLAA::SurfacePool Pool( &Allocator );
+        Pool.SetGrowthPolicy( 64, 12 );
+        Pool.SetShrinkPolicy( 200, 8 );
+
+        int Width = 0, Height = 0;
+        void* pFirst = Pool.Acquire( StormTarget( 0, 1000, 500 ), &Width, &Height );
+        if ( pFirst == NULL || Width != 1152 || Height != 576 )
+            return "A new surface gets the growth headroom, rounded up to the granularity";
+        if ( Pool.Acquire( StormTarget( 0, 1000, 500 ) ) == pFirst )
+            return "An acquired surface is handed out twice";
+        if ( Pool.Acquire( StormTarget( 1, 1000, 500 ), NULL, NULL, true ) == NULL || Allocator.GetAllocationCount() != 3 )
+            return "Surfaces of another key are allocated separately";
+
+        Pool.ReleaseAll();
+        if ( Pool.Acquire( StormTarget( 0, 1100, 550 ) ) != pFirst )
+            return "A released surface is reused for a larger request within its headroom";
+        Pool.ReleaseAll();
+        if ( Pool.Acquire( StormTarget( 0, 1100, 550 ), &Width, &Height, true ) == pFirst || Width != 1100 || Height != 550 )
+            return "An exact size request only takes a surface of that size";
+
+        // Two surfaces of the key are free, the smaller one fits
+        Pool.ReleaseAll();
+        if ( Pool.Acquire( StormTarget( 0, 1000, 500 ) ) == pFirst )
+            return "The smallest surface that fits is reused";
+
+        // Trim frees every surface that is not acquired
+        Pool.ReleaseAll();
+        Pool.Trim();
+        if ( Pool.GetSurfaceCount() != 0 || Allocator.GetLiveCount() != 0 )
+            return "Trim frees every surface that is not acquired";
+
+        // A surface of more than twice the requested area is reused for the shrink delay,
+        // a request it fits well in between starts the count again
+        void* pLarge = Pool.Acquire( StormTarget( 0, 1000, 500 ) );
+        int nAllocations = Allocator.GetAllocationCount();
+        int nFrees = Pool.GetFreeCount();
+        for ( int i = 0; i < 13; i++ )
+        {
+            Pool.ReleaseAll();
+            bool bFitsWell = ( i == 4 );
+            if ( Pool.Acquire( StormTarget( 0, bFitsWell ? 1000 : 500, bFitsWell ? 500 : 250 ) ) != pLarge )
+                return "An oversized surface is reused until it has been too large for the shrink delay";
+        }
+        Pool.ReleaseAll();
+        if ( Pool.Acquire( StormTarget( 0, 500, 250 ), &Width, &Height ) == NULL || Width != 576 ||
+             Allocator.GetAllocationCount() != nAllocations + 1 || Pool.GetFreeCount() != nFrees + 1 )
+            return "An oversized surface is replaced once the shrink delay has passed";
+        Pool.Acquire( StormTarget( 2, 500, 250 ) );
+    }
+    if ( Allocator.GetLiveCount() != 0 || Allocator.GetBadFreeCount() != 0 )
+        return "The pool frees each of its surfaces once, acquired ones included, when it is destroyed";
+    return NULL;
+}
+
+//--------------------------------------------------------------------------------------
+// resize-storm: a window dragged around its size, as a random walk of small steps with
+// an occasional maximize and restore. Each resize acquires the render targets of the
+// sample from SurfacePool, or recreates them as the sample did before the pool. The
+// allocator is a mock, so the storm runs without a device
+//--------------------------------------------------------------------------------------
+static int RunResizeStorm( int argc, char* argv[] )
+{
+    int nResizes = 1000;
+    for ( int i = 1; i < argc; i++ )
+    {
+        if ( !strcmp( argv[i], "-resizes" ) && i + 1 < argc )
+            nResizes = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( nResizes < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const char* pBroken = CheckSurfacePool();
+    if ( pBroken != NULL )
+    {
+        printf( "SurfacePool with a mock allocator: %s\n", pBroken );
+        return 1;
+    }
+    printf( "SurfacePool policy checks passed\n" );
+
+    std::vector<int> Widths( nResizes ), Heights( nResizes );
+    Random Rand = { 29 };
+    int Width = 1280, Height = 720;
+    for ( int r = 0; r < nResizes; r++ )
+    {
+        if ( r % 250 == 125 )
+        {
+            Width = 2560;
+            Height = 1440;
+        }
+        else if ( r % 250 == 126 )
+        {
+            Width = 1280;
+            Height = 720;
+        }
+        else
+        {
+            Width = std::min( std::max( Width + (int)Rand.Next( -16.0f, 17.0f ), 640 ), 2560 );
+            Height = std::min( std::max( Height + (int)Rand.Next( -16.0f, 17.0f ), 360 ), 1440 );
+        }
+        Widths[r] = Width;
+        Heights[r] = Height;
+    }
+
+    // The recreating sample freed the targets of the previous size before creating the new ones
+    MockAllocator Recreated;
+    std::vector<void*> Targets( kStormTargets, (void*)NULL );
+    double StartTime = MLAA::GetTimeMs();
+    for ( int r = 0; r < nResizes; r++ )
+    {
+        for ( int t = 0; t < kStormTargets; t++ )
+        {
+            if ( Targets[t] != NULL )
+                Recreated.Free( Targets[t] );
+            Targets[t] = Recreated.Allocate( StormTarget( t, Widths[r], Heights[r] ) );
+        }
+    }
+    double RecreateMs = MLAA::GetTimeMs() - StartTime;
+    for ( int t = 0; t < kStormTargets; t++ )
+        Recreated.Free( Targets[t] );
+
+    MockAllocator Pooled;
+    int nPoolSurfaces = 0;
+    double PoolMs = 0.0;
+    {
+        MLAA::SurfacePool Pool( &Pooled );
+        StartTime = MLAA::GetTimeMs();
+        for ( int r = 0; r < nResizes; r++ )
+        {
+            if ( !AcquireStormTargets( Pool, Widths[r], Heights[r] ) )
+            {
+                printf( "Resize %d to %dx%d did not get its render targets from the pool\n", r, Widths[r], Heights[r] );
+                return 1;
+            }
+        }
+        PoolMs = MLAA::GetTimeMs() - StartTime;
+        nPoolSurfaces = Pool.GetSurfaceCount();
+    }
+
+    printf( "%d resizes, %d render targets each\n\n%-10s %12s %12s %14s\n", nResizes, kStormTargets, "",
+            "Allocations", "Total ms", "ms per resize" );
+    printf( "%-10s %12d %12.1f %14.3f\n", "Recreate", Recreated.GetAllocationCount(), RecreateMs, RecreateMs / nResizes );
+    printf( "%-10s %12d %12.1f %14.3f\n\n", "Pool", Pooled.GetAllocationCount(), PoolMs, PoolMs / nResizes );
+
+    // Maximizing, restoring and the walk leaving the headroom reallocate, most steps must not
+    const int kMinAllocationRatio = 50;
+    if ( nResizes >= 100 && Pooled.GetAllocationCount() * kMinAllocationRatio > Recreated.GetAllocationCount() )
+    {
+        printf( "The pool made %d allocations, more than 1 in %d of recreating the render targets\n",
+                Pooled.GetAllocationCount(), kMinAllocationRatio );
+        return 1;
+    }
+    if ( Pooled.GetLiveCount() != 0 || Pooled.GetBadFreeCount() != 0 || Recreated.GetBadFreeCount() != 0 )
+    {
+        printf( "Surfaces were leaked or freed twice\n" );
+        return 1;
+    }
+    if ( nResizes >= 100 && PoolMs >= RecreateMs )
+    {
+        printf( "The pool is no faster than recreating the render targets\n" );
+        return 1;
+    }
+    printf( "The pool held %d surfaces after the last resize and made %.1fx fewer allocations\n",
+            nPoolSurfaces, (double)Recreated.GetAllocationCount() / Pooled.GetAllocationCount() );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Engine settings the equivalence checks run under
+//--------------------------------------------------------------------------------------
+struct EngineSettings
+{
+    const char*                 pName;
+    MLAA::EDGE_SEARCH           EdgeSearch;
+    MLAA::DETECTION_RESOLUTION  Resolution;
+};
+
+static const EngineSettings kEngineSettings[] =
+{
+    { "Short edges",            MLAA::EDGE_SEARCH_SHORT,    MLAA::DETECTION_FULL },
+    { "Long edges",             MLAA::EDGE_SEARCH_LONG,     MLAA::DETECTION_FULL },
+    { "Half res detection",     MLAA::EDGE_SEARCH_SHORT,    MLAA::DETECTION_HALF },
+};
+
+static void ApplySettings( MLAA::CPUEngine& Engine, const EngineSettings& Settings )
+{
+    Engine.SetEdgeSearch( Settings.EdgeSearch );
+    Engine.SetDetectionResolution( Settings.Resolution );
+}
+
+//--------------------------------------------------------------------------------------
+// region: Apply with a region of interest against a full frame Apply. Inside the region
+// the pixels must match, outside it Dst must be left alone. The regions include the
+// 128x128 of the magnifier at the center and in the corners, a viewport quarter, thin
+// strips along the borders and random rectangles. The time of a region is reported
+// against the full frame and the share of the image it processes with its halo
+//--------------------------------------------------------------------------------------
+static int RunRegion( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 256 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<MLAA::Rect> Regions;
+    const int m = Size / 2 - 64;
+    const MLAA::Rect kFixedRegions[] =
+    {
+        { m, m, m + 128, m + 128 },                             // Magnifier
+        { 0, 0, 128, 128 },
+        { Size - 128, Size - 128, Size, Size },
+        { Size / 4, Size / 4, Size * 3 / 4, Size * 3 / 4 },     // Viewport
+        { 0, 0, Size, 1 },
+        { Size - 1, 0, Size, Size },
+        { 0, 0, Size, Size },
+    };
+    Regions.assign( kFixedRegions, kFixedRegions + sizeof( kFixedRegions ) / sizeof( kFixedRegions[0] ) );
+    Random Rand = { 30 };
+    for ( int i = 0; i < 16; i++ )
+    {
+        MLAA::Rect Region;
+        Region.Left = (int)Rand.Next( 0.0f, (float)Size - 1.0f );
+        Region.Top = (int)Rand.Next( 0.0f, (float)Size - 1.0f );
+        Region.Right = std::min( Region.Left + 1 + (int)Rand.Next( 0.0f, 300.0f ), Size );
+        Region.Bottom = std::min( Region.Top + 1 + (int)Rand.Next( 0.0f, 300.0f ), Size );
+        Regions.push_back( Region );
+    }
+
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> Reference( nBytes ), Output( nBytes ), Untouched( nBytes, 0xCD );
+    MLAA::CPUEngine Engine;
+
+    for ( size_t c = 0; c < sizeof( kEngineSettings ) / sizeof( kEngineSettings[0] ); c++ )
+    {
+        ApplySettings( Engine, kEngineSettings[c] );
+        for ( size_t s = 0; s < Inputs.size(); s++ )
+        {
+            MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+            MLAA::Surface RefDst = { &Reference[0], Size, Size, Size * 4 };
+            MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+            Engine.Apply( Src, RefDst );
+
+            for ( size_t r = 0; r < Regions.size(); r++ )
+            {
+                const MLAA::Rect& Region = Regions[r];
+                Output = Untouched;
+                Engine.Apply( Src, Dst, Region );
+
+                MLAA::Rect Above = { 0, 0, Size, Region.Top }, Below = { 0, Region.Bottom, Size, Size };
+                MLAA::Rect Left = { 0, Region.Top, Region.Left, Region.Bottom }, Right = { Region.Right, Region.Top, Size, Region.Bottom };
+                if ( !SameRect( Output, Reference, Size, Region ) ||
+                     !SameRect( Output, Untouched, Size, Above ) || !SameRect( Output, Untouched, Size, Below ) ||
+                     !SameRect( Output, Untouched, Size, Left ) || !SameRect( Output, Untouched, Size, Right ) )
+                {
+                    printf( "%s, scene %d: region %d,%d-%d,%d differs from the full frame\n", kEngineSettings[c].pName,
+                            (int)s, Region.Left, Region.Top, Region.Right, Region.Bottom );
+                    return 1;
+                }
+            }
+        }
+    }
+    printf( "%d regions of %d scenes of %dx%d match the full frame with %d engine settings\n\n", (int)Regions.size(),
+            (int)Inputs.size(), Size, Size, (int)( sizeof( kEngineSettings ) / sizeof( kEngineSettings[0] ) ) );
+
+    // Time against the share of the image processed, short edges at full resolution
+    ApplySettings( Engine, kEngineSettings[0] );
+    MLAA::Surface Src = { &Inputs[0][0], Size, Size, Size * 4 };
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    const int Halo = Engine.GetRegionHalo();
+    double FullMs = BestTimeMs( nReps, [&]() { Engine.Apply( Src, Dst ); } );
+    printf( "%-24s %10s %10s %10s\n", "Region", "ms", "Time", "Area" );
+    for ( size_t r = 0; r < 4; r++ )
+    {
+        const MLAA::Rect& Region = Regions[r];
+        double Area = (double)( std::min( Region.Right + Halo, Size ) - std::max( Region.Left - Halo, 0 ) ) *
+                      (double)( std::min( Region.Bottom + Halo, Size ) - std::max( Region.Top - Halo, 0 ) );
+        Engine.Apply( Src, Dst, Region );
+        double Ms = BestTimeMs( nReps, [&]() { Engine.Apply( Src, Dst, Region ); } );
+        char Name[64];
+        sprintf( Name, "%d,%d-%d,%d", Region.Left, Region.Top, Region.Right, Region.Bottom );
+        printf( "%-24s %10.3f %9.2f%% %9.2f%%\n", Name, Ms, 100.0 * Ms / FullMs, 100.0 * Area / ( (double)Size * Size ) );
+    }
+    printf( "%-24s %10.3f %9.2f%% %9.2f%%\n", "Full frame", FullMs, 100.0, 100.0 );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// views: an atlas of thumbnails anti-aliased with one ApplyViews call and as one job of
+// CPUQueue, against a call per view: ApplyView on the atlas, or Apply on the view copied
+// out to an image of its own and back, as a renderer that draws each thumbnail to a
+// target of its own would. The views alternate between two thresholds and every output
+// must match
+//--------------------------------------------------------------------------------------
+static int RunViews( int argc, char* argv[] )
+{
+    int nViews = 1000, ViewSize = 128, nReps = 5, nThreads = 0;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-views" ) && bHasValue )            nViews = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-view-size" ) && bHasValue )   ViewSize = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-threads" ) && bHasValue )     nThreads = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( nViews < 1 || ViewSize < 16 || nReps < 1 || nThreads < 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // A square atlas of views, filled from the scenes rendered at the atlas size
+    int nColumns = 1;
+    while ( nColumns * nColumns < nViews )
+        nColumns++;
+    const int Size = nColumns * ViewSize;
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+
+    std::vector<MLAA::View> Views( nViews );
+    std::vector<uint8_t> Atlas( (size_t)Size * Size * 4 );
+    for ( int v = 0; v < nViews; v++ )
+    {
+        MLAA::Rect Region = { ( v % nColumns ) * ViewSize, ( v / nColumns ) * ViewSize, 0, 0 };
+        Region.Right = Region.Left + ViewSize;
+        Region.Bottom = Region.Top + ViewSize;
+        Views[v].Region = Region;
+        Views[v].fThreshold = ( v & 1 ) ? 0.05f : MLAA::kDefaultThreshold;
+
+        const std::vector<uint8_t>& Scene = Inputs[v % Inputs.size()];
+        for ( int y = Region.Top; y < Region.Bottom; y++ )
+        {
+            size_t Offset = ( (size_t)y * Size + Region.Left ) * 4;
+            memcpy( &Atlas[Offset], &Scene[Offset], ViewSize * 4 );
+        }
+    }
+
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> Batched( nBytes ), Queued( nBytes ), PerView( nBytes ), Copied( nBytes );
+    std::vector<uint8_t> ViewSrc( (size_t)ViewSize * ViewSize * 4 ), ViewDst( ViewSrc.size() );
+    MLAA::Surface Src = { &Atlas[0], Size, Size, Size * 4 };
+    MLAA::Surface BatchedDst = { &Batched[0], Size, Size, Size * 4 };
+    MLAA::Surface QueuedDst = { &Queued[0], Size, Size, Size * 4 };
+    MLAA::Surface PerViewDst = { &PerView[0], Size, Size, Size * 4 };
+    MLAA::Surface ViewSrcSurface = { &ViewSrc[0], ViewSize, ViewSize, ViewSize * 4 };
+    MLAA::Surface ViewDstSurface = { &ViewDst[0], ViewSize, ViewSize, ViewSize * 4 };
+    MLAA::CPUEngine Engine;
+    MLAA::CPUQueue Queue( 1, nThreads );
+
+    double BatchedMs = BestTimeMs( nReps, [&]() { Engine.ApplyViews( Src, BatchedDst, &Views[0], nViews ); } );
+    double QueuedMs = BestTimeMs( nReps, [&]() { Queue.SubmitViews( Src, QueuedDst, &Views[0], nViews ).wait(); } );
+    double PerViewMs = BestTimeMs( nReps, [&]()
+    {
+        for ( int v = 0; v < nViews; v++ )
+            Engine.ApplyView( Src, PerViewDst, Views[v] );
+    } );
+    double CopiedMs = BestTimeMs( nReps, [&]()
+    {
+        for ( int v = 0; v < nViews; v++ )
+        {
+            const MLAA::Rect& Region = Views[v].Region;
+            for ( int y = 0; y < ViewSize; y++ )
+                memcpy( &ViewSrc[(size_t)y * ViewSize * 4], &Atlas[( (size_t)( Region.Top + y ) * Size + Region.Left ) * 4], ViewSize * 4 );
+            Engine.SetThreshold( Views[v].fThreshold );
+            Engine.Apply( ViewSrcSurface, ViewDstSurface );
+            for ( int y = 0; y < ViewSize; y++ )
+                memcpy( &Copied[( (size_t)( Region.Top + y ) * Size + Region.Left ) * 4], &ViewDst[(size_t)y * ViewSize * 4], ViewSize * 4 );
+        }
+    } );
+
+    for ( int v = 0; v < nViews; v++ )
+    {
+        const MLAA::Rect& Region = Views[v].Region;
+        if ( !SameRect( Batched, Queued, Size, Region ) || !SameRect( Batched, PerView, Size, Region ) ||
+             !SameRect( Batched, Copied, Size, Region ) )
+        {
+            printf( "View %d differs between the batches and a call per view\n", v );
+            return 1;
+        }
+    }
+
+    char QueueName[64];
+    sprintf( QueueName, "SubmitViews, %d workers", Queue.GetThreadCount() );
+    printf( "%d views of %dx%d in a %dx%d atlas, every view matches\n\n%-28s %10s %12s %10s\n", nViews, ViewSize,
+            ViewSize, Size, Size, "", "ms", "us per view", "Speedup" );
+    printf( "%-28s %10.2f %12.2f %9.2fx\n", "ApplyViews", BatchedMs, 1000.0 * BatchedMs / nViews, CopiedMs / BatchedMs );
+    printf( "%-28s %10.2f %12.2f %9.2fx\n", QueueName, QueuedMs, 1000.0 * QueuedMs / nViews, CopiedMs / QueuedMs );
+    printf( "%-28s %10.2f %12.2f %9.2fx\n", "ApplyView per view", PerViewMs, 1000.0 * PerViewMs / nViews, CopiedMs / PerViewMs );
+    printf( "%-28s %10.2f %12.2f %9.2fx\n", "Apply per copied view", CopiedMs, 1000.0 * CopiedMs / nViews, 1.0 );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// half-res: half resolution detection against full resolution, on the scenes at one
+// sample per pixel with the supersampled scenes as ground truth. Equivalence is checked
+// on the scenes reduced to 2x2 blocks, where both resolutions see the same edges and
+// must give the same edge mask, counts and output, and between the engine and CPUQueue.
+// Half resolution detection must also score above no MLAA.
+//--------------------------------------------------------------------------------------
+static int RunHalfRes( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<Scene> Scenes;
+    BuildScenes( Size, Scenes );
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> Aliased, Reference, Blocks( nBytes ), FullOutput( nBytes ), HalfOutput( nBytes ), QueueOutput( nBytes );
+    MLAA::Surface FullDst = { &FullOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface HalfDst = { &HalfOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface QueueDst = { &QueueOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface BlocksSrc = { &Blocks[0], Size, Size, Size * 4 };
+    MLAA::CPUEngine FullEngine, HalfEngine;
+    HalfEngine.SetDetectionResolution( MLAA::DETECTION_HALF );
+    MLAA::CPUQueue Queue( 1 );
+    Queue.SetDetectionResolution( MLAA::DETECTION_HALF );
+
+    double PassMs[2][MLAA::PASS_COUNT] = { { 0.0 } };
+    double ErrorSum[3] = { 0.0 };
+    for ( size_t s = 0; s < Scenes.size(); s++ )
+    {
+        RenderScene( Scenes[s], Size, 1, Aliased );
+        RenderScene( Scenes[s], Size, kReferenceSamples, Reference );
+        MLAA::Surface Src = { &Aliased[0], Size, Size, Size * 4 };
+
+        // Fastest run of each pass
+        double SceneMs[2][MLAA::PASS_COUNT];
+        for ( int r = 0; r < nReps; r++ )
+        {
+            FullEngine.Apply( Src, FullDst );
+            HalfEngine.Apply( Src, HalfDst );
+            for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+            {
+                double FullMs = FullEngine.GetPassTime( (MLAA::PASS)p ), HalfMs = HalfEngine.GetPassTime( (MLAA::PASS)p );
+                SceneMs[0][p] = ( r == 0 || FullMs < SceneMs[0][p] ) ? FullMs : SceneMs[0][p];
+                SceneMs[1][p] = ( r == 0 || HalfMs < SceneMs[1][p] ) ? HalfMs : SceneMs[1][p];
+            }
+        }
+        for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+        {
+            PassMs[0][p] += SceneMs[0][p];
+            PassMs[1][p] += SceneMs[1][p];
+        }
+        ErrorSum[0] += SquaredError( Aliased, Reference );
+        ErrorSum[1] += SquaredError( FullOutput, Reference );
+        ErrorSum[2] += SquaredError( HalfOutput, Reference );
+
+        Queue.Submit( Src, QueueDst ).get();
+        if ( QueueOutput != HalfOutput )
+        {
+            printf( "Scene %d: CPUQueue differs from the engine with half resolution detection\n", (int)s );
+            return 1;
+        }
+
+        // Every pixel takes the color of the top left pixel of its 2x2 block
+        for ( int y = 0; y < Size; y++ )
+        {
+            for ( int x = 0; x < Size; x++ )
+                memcpy( &Blocks[( (size_t)y * Size + x ) * 4], &Aliased[( (size_t)( y & ~1 ) * Size + ( x & ~1 ) ) * 4], 4 );
+        }
+        FullEngine.Apply( BlocksSrc, FullDst );
+        HalfEngine.Apply( BlocksSrc, HalfDst );
+        if ( !SameEdges( FullEngine.GetEdgeView(), HalfEngine.GetEdgeView() ) || FullOutput != HalfOutput )
+        {
+            printf( "Scene %d in 2x2 blocks: half resolution detection differs from full resolution\n", (int)s );
+            return 1;
+        }
+    }
+
+    const double nValues = (double)Size * Size * 3 * Scenes.size();
+    printf( "%d scenes of %dx%d, PSNR against %dx supersampling\n\n%-12s %10s %10s %10s %10s %10s\n", (int)Scenes.size(),
+            Size, Size, kReferenceSamples * kReferenceSamples, "", "Detect ms", "Length ms", "Blend ms", "Total ms", "PSNR" );
+    printf( "%-12s %10s %10s %10s %10s %7.2f dB\n", "No MLAA", "", "", "", "", ToPSNR( ErrorSum[0], nValues ) );
+    static const char* kNames[2] = { "Full res", "Half res" };
+    for ( int k = 0; k < 2; k++ )
+    {
+        printf( "%-12s %10.2f %10.2f %10.2f %10.2f %7.2f dB\n", kNames[k], PassMs[k][MLAA::PASS_DETECT_EDGES],
+                PassMs[k][MLAA::PASS_COMPUTE_LINE_LENGTH], PassMs[k][MLAA::PASS_BLEND_COLOR],
+                PassMs[k][0] + PassMs[k][1] + PassMs[k][2], ToPSNR( ErrorSum[k + 1], nValues ) );
+    }
+    if ( ErrorSum[2] >= ErrorSum[0] )
+    {
+        printf( "\nHalf resolution detection scores below no MLAA\n" );
+        return 1;
+    }
+    printf( "\nOn the scenes in 2x2 blocks both resolutions give the same edges and output, CPUQueue matches the engine\n" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Counts of an edge view cut to kShortEdgeLength the way a search that stops there finds
+// them: a side that reaches the length loses its stop bit
+//--------------------------------------------------------------------------------------
+static unsigned int ShortenSide( unsigned int Side, unsigned int StopBit )
+{
+    return ( ( Side & ~StopBit ) < MLAA::kShortEdgeLength ) ? Side : MLAA::kShortEdgeLength;
+}
+
+static void ShortenCounts( const MLAA::EdgeView& Edges, std::vector<uint16_t>& Counts )
+{
+    const unsigned int CountBits = Edges.CountBytes * 4;
+    const unsigned int SideMask = ( 1u << CountBits ) - 1;
+    const unsigned int StopBit = Edges.MaxEdgeLength + 1;
+    Counts.resize( (size_t)Edges.Width * Edges.Height * 2 );
+    for ( int y = 0; y < Edges.Height; y++ )
+    {
+        for ( int x = 0; x < Edges.Width; x++ )
+        {
+            for ( int d = 0; d < 2; d++ )
+            {
+                unsigned int Count = Edges.GetCount( x, y, (MLAA::EDGE_DIRECTION)d );
+                Counts[( (size_t)y * Edges.Width + x ) * 2 + d] = (uint16_t)( ( ShortenSide( Count >> CountBits, StopBit ) << CountBits ) |
+                                                                             ShortenSide( Count & SideMask, StopBit ) );
+            }
+        }
+    }
+}
+
+static bool SameCounts( const MLAA::EdgeView& Edges, const std::vector<uint16_t>& Counts )
+{
+    for ( int y = 0; y < Edges.Height; y++ )
+    {
+        for ( int x = 0; x < Edges.Width; x++ )
+        {
+            if ( Edges.GetCount( x, y, MLAA::EDGE_HORIZONTAL ) != Counts[( (size_t)y * Edges.Width + x ) * 2] ||
+                 Edges.GetCount( x, y, MLAA::EDGE_VERTICAL ) != Counts[( (size_t)y * Edges.Width + x ) * 2 + 1] )
+                return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// quality-map: time of each pass with every tile at one quality level and with a radial
+// map, against no map. Short edge tiles stop the edge search after kShortEdgeLength
+// pixels, their counts must be those of a full search cut to that length. The map at
+// full quality must give the output without a map, the searches that clamp their counts
+// afterwards the output of those that stop early, and CPUQueue that of the engine
+//--------------------------------------------------------------------------------------
+static const int kBenchmarkTileSize = 32;
+
+static int RunQualityMap( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The maps: none, every tile at one level, then radial around the center
+    static const char* kMapNames[] = { "No map", "All skip", "All short", "All full", "Radial" };
+    const int nMaps = sizeof( kMapNames ) / sizeof( kMapNames[0] );
+    std::vector< std::vector<uint8_t> > Levels( nMaps );
+    std::vector<MLAA::QualityMap> Maps( nMaps );
+    MLAA::BuildFoveatedQualityMap( Size, Size, kBenchmarkTileSize, Size * 0.5f, Size * 0.5f, Size * 0.25f, Size * 0.5f,
+                                   Levels[nMaps - 1], Maps[nMaps - 1] );
+    for ( int m = 1; m < nMaps - 1; m++ )
+    {
+        Maps[m] = Maps[nMaps - 1];
+        Levels[m].assign( Levels[nMaps - 1].size(), (uint8_t)( m - 1 ) );
+        Maps[m].pLevels = &Levels[m][0];
+    }
+
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> NoMapOutput( nBytes ), Output( nBytes ), ClampedOutput( nBytes );
+    std::vector<uint16_t> ShortCounts;
+    MLAA::Surface NoMapDst = { &NoMapOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    MLAA::Surface ClampedDst = { &ClampedOutput[0], Size, Size, Size * 4 };
+    MLAA::CPUEngine NoMapEngine, Engine, ClampedEngine;
+    MLAA::CPUQueue Queue( 1 );
+
+    // The clamped engine walks vertical edges directly with short counts and pixel by pixel
+    // with long ones, neither can stop early
+    for ( int Long = 0; Long < 2; Long++ )
+    {
+        NoMapEngine.SetEdgeSearch( Long ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+        Engine.SetEdgeSearch( Long ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+        Queue.SetEdgeSearch( Long ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+        ClampedEngine.SetEdgeSearch( Long ? MLAA::EDGE_SEARCH_LONG_NAIVE : MLAA::EDGE_SEARCH_SHORT );
+        ClampedEngine.SetVerticalSearch( MLAA::VERTICAL_SEARCH_DIRECT );
+
+        for ( size_t s = 0; s < Inputs.size(); s++ )
+        {
+            MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+            NoMapEngine.Apply( Src, NoMapDst );
+            ShortenCounts( NoMapEngine.GetEdgeView(), ShortCounts );
+
+            for ( int m = 1; m < nMaps; m++ )
+            {
+                Engine.SetQualityMap( &Maps[m] );
+                ClampedEngine.SetQualityMap( &Maps[m] );
+                Engine.Apply( Src, Dst );
+                ClampedEngine.Apply( Src, ClampedDst );
+                const char* pBroken = NULL;
+                if ( m == 2 && !SameCounts( Engine.GetEdgeView(), ShortCounts ) )
+                    pBroken = "the counts of short edge tiles differ from full counts cut to kShortEdgeLength";
+                else if ( m == 3 && Output != NoMapOutput )
+                    pBroken = "the output with every tile at full quality differs from the output without a map";
+                else if ( Output != ClampedOutput )
+                    pBroken = "the searches that stop early differ from those clamped afterwards";
+                if ( pBroken == NULL && m == nMaps - 1 )
+                {
+                    Queue.SetQualityMap( &Maps[m] );
+                    Queue.Submit( Src, ClampedDst ).get();
+                    if ( Output != ClampedOutput )
+                        pBroken = "CPUQueue differs from the engine";
+                }
+                if ( pBroken )
+                {
+                    printf( "%s, %s edges, scene %d: %s\n", kMapNames[m], Long ? "long" : "short", (int)s, pBroken );
+                    return 1;
+                }
+            }
+        }
+    }
+    Engine.SetEdgeSearch( MLAA::EDGE_SEARCH_SHORT );
+
+    printf( "%d scenes of %dx%d, tiles of %d pixels\n\n%-12s %10s %10s %10s %10s\n", (int)Inputs.size(), Size, Size,
+            kBenchmarkTileSize, "", "Detect ms", "Length ms", "Blend ms", "Total ms" );
+    for ( int m = 0; m < nMaps; m++ )
+    {
+        Engine.SetQualityMap( m > 0 ? &Maps[m] : NULL );
+        double PassMs[MLAA::PASS_COUNT] = { 0.0 };
+        for ( size_t s = 0; s < Inputs.size(); s++ )
+        {
+            MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+            double SceneMs[MLAA::PASS_COUNT];
+            for ( int r = 0; r < nReps; r++ )
+            {
+                Engine.Apply( Src, Dst );
+                for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+                {
+                    double Ms = Engine.GetPassTime( (MLAA::PASS)p );
+                    SceneMs[p] = ( r == 0 || Ms < SceneMs[p] ) ? Ms : SceneMs[p];
+                }
+            }
+            for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+                PassMs[p] += SceneMs[p];
+        }
+        printf( "%-12s %10.2f %10.2f %10.2f %10.2f\n", kMapNames[m], PassMs[0], PassMs[1], PassMs[2], PassMs[0] + PassMs[1] + PassMs[2] );
+    }
+    printf( "\nShort edge counts match a cut full search, a full map the output without a map, and the clamped\n"
+            "searches and CPUQueue the engine\n" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// The block walk of MLAA11.hlsl's HIERARCHICAL_SEARCH on the edge mask of an engine. A
+// byte of Rows holds the horizontal edges of 8 pixels of a row, one of Columns the
+// vertical edges of 8 pixels of a column, pixels past the image repeating the last one
+//--------------------------------------------------------------------------------------
+static const int kEdgeBlockSize = 8;
+
+static void BuildEdgeBlocks( const MLAA::EdgeView& Edges, std::vector<uint8_t>& Rows, std::vector<uint8_t>& Columns )
+{
+    const int nBlocksX = ( Edges.Width + kEdgeBlockSize - 1 ) / kEdgeBlockSize;
+    const int nBlocksY = ( Edges.Height + kEdgeBlockSize - 1 ) / kEdgeBlockSize;
+    Rows.assign( (size_t)nBlocksX * Edges.Height, 0 );
+    Columns.assign( (size_t)nBlocksY * Edges.Width, 0 );
+    for ( int y = 0; y < Edges.Height; y++ )
+    {
+        for ( int x = 0; x < Edges.Width; x++ )
+        {
+            const unsigned int Mask = Edges.GetEdges( x, y );
+            for ( int i = 0; i < kEdgeBlockSize; i++ )
+            {
+                // The repeated last pixel fills the rest of the last block
+                if ( ( Mask & MLAA::kUpperMask ) && ( x % kEdgeBlockSize == i || ( x == Edges.Width - 1 && i > x % kEdgeBlockSize ) ) )
+                    Rows[(size_t)y * nBlocksX + x / kEdgeBlockSize] |= (uint8_t)( 1 << i );
+                if ( ( Mask & MLAA::kRightMask ) && ( y % kEdgeBlockSize == i || ( y == Edges.Height - 1 && i > y % kEdgeBlockSize ) ) )
+                    Columns[(size_t)( y / kEdgeBlockSize ) * Edges.Width + x] |= (uint8_t)( 1 << i );
+            }
+        }
+    }
+}
+
+// firstbitlow and firstbithigh of a non zero byte
+static unsigned int LowestBit( unsigned int Bits )
+{
+    unsigned int Bit = 0;
+    while ( !( Bits & ( 1u << Bit ) ) )
+        Bit++;
+    return Bit;
+}
+
+static unsigned int HighestBit( unsigned int Bits )
+{
+    unsigned int Bit = 7;
+    while ( !( Bits & ( 1u << Bit ) ) )
+        Bit--;
+    return Bit;
+}
+
+// LoadEdgeBlock: pLine is the first block of a line and Stride the step between blocks
+static unsigned int LoadEdgeBlock( const uint8_t* pLine, size_t Stride, int Block, int Length )
+{
+    const int LastBlock = ( Length - 1 ) / kEdgeBlockSize;
+    if ( Block < 0 )
+        return ( pLine[0] & 1 ) ? 0xFF : 0;
+    if ( Block > LastBlock )
+        return ( ( pLine[Stride * LastBlock] >> ( ( Length - 1 ) % kEdgeBlockSize ) ) & 1 ) ? 0xFF : 0;
+    return pLine[Stride * Block];
+}
+
+static unsigned int BlockPositiveRun( const uint8_t* pLine, size_t Stride, int Pos, int Length, unsigned int MaxLength )
+{
+    const int Block = Pos / kEdgeBlockSize, Bit = Pos % kEdgeBlockSize;
+    const int nMaxBlocks = (int)MaxLength / kEdgeBlockSize + 1;
+    unsigned int Gaps = ( ~LoadEdgeBlock( pLine, Stride, Block, Length ) & 0xFF ) >> ( Bit + 1 );
+    unsigned int Run = kEdgeBlockSize - 1 - Bit;
+    if ( Gaps )
+        Run = LowestBit( Gaps );
+    else
+    {
+        for ( int i = 1; i <= nMaxBlocks && Run < MaxLength; i++ )
+        {
+            Gaps = ~LoadEdgeBlock( pLine, Stride, Block + i, Length ) & 0xFF;
+            if ( Gaps )
+            {
+                Run += LowestBit( Gaps );
+                break;
+            }
+            Run += kEdgeBlockSize;
+        }
+    }
+    return ( Run < MaxLength ) ? ( Run | ( MaxLength + 1 ) ) : MaxLength;
+}
+
+static unsigned int BlockNegativeRun( const uint8_t* pLine, size_t Stride, int Pos, int Length, unsigned int MaxLength )
+{
+    const int Block = Pos / kEdgeBlockSize, Bit = Pos % kEdgeBlockSize;
+    const int nMaxBlocks = (int)MaxLength / kEdgeBlockSize + 1;
+    unsigned int Gaps = ~LoadEdgeBlock( pLine, Stride, Block, Length ) & ( ( 1u << Bit ) - 1 );
+    unsigned int Run = Bit;
+    if ( Gaps )
+        Run = Bit - 1 - HighestBit( Gaps );
+    else
+    {
+        for ( int i = 1; i <= nMaxBlocks && Run < MaxLength; i++ )
+        {
+            Gaps = ~LoadEdgeBlock( pLine, Stride, Block - i, Length ) & 0xFF;
+            if ( Gaps )
+            {
+                Run += kEdgeBlockSize - 1 - HighestBit( Gaps );
+                break;
+            }
+            Run += kEdgeBlockSize;
+        }
+    }
+    return ( Run < MaxLength ) ? ( Run | ( MaxLength + 1 ) ) : MaxLength;
+}
+
+// Whether the counts of the engine are those of the shader's block walk. The shader clamps
+// runs at kMaxEdgeLength as the engine does, vertical negative counts look down
+static bool MatchesBlockWalk( const MLAA::EdgeView& Edges )
+{
+    std::vector<uint8_t> Rows, Columns;
+    BuildEdgeBlocks( Edges, Rows, Columns );
+    const int nBlocksX = ( Edges.Width + kEdgeBlockSize - 1 ) / kEdgeBlockSize;
+    const unsigned int CountBits = Edges.CountBytes * 4;
+    for ( int y = 0; y < Edges.Height; y++ )
+    {
+        for ( int x = 0; x < Edges.Width; x++ )
+        {
+            const unsigned int Mask = Edges.GetEdges( x, y );
+            unsigned int Counts[2] = { 0, 0 };
+            if ( Mask & MLAA::kUpperMask )
+            {
+                const uint8_t* pRow = &Rows[(size_t)y * nBlocksX];
+                Counts[0] = ( BlockNegativeRun( pRow, 1, x, Edges.Width, Edges.MaxEdgeLength ) << CountBits ) |
+                            BlockPositiveRun( pRow, 1, x, Edges.Width, Edges.MaxEdgeLength );
+            }
+            if ( Mask & MLAA::kRightMask )
+            {
+                const uint8_t* pColumn = &Columns[x];
+                Counts[1] = ( BlockPositiveRun( pColumn, Edges.Width, y, Edges.Height, Edges.MaxEdgeLength ) << CountBits ) |
+                            BlockNegativeRun( pColumn, Edges.Width, y, Edges.Height, Edges.MaxEdgeLength );
+            }
+            if ( Edges.GetCount( x, y, MLAA::EDGE_HORIZONTAL ) != Counts[0] || Edges.GetCount( x, y, MLAA::EDGE_VERTICAL ) != Counts[1] )
+                return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// long-search: pass times and PSNR of the 4 bit counts, the long counts that step over
+// whole words of edge and the long counts walked a pixel at a time, on the scenes and on
+// noise full of short edges. The word search must give the counts and output of the
+// pixel walk, and the counts of the shader's block walk
+//--------------------------------------------------------------------------------------
+static int RunLongSearch( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 3;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static const MLAA::EDGE_SEARCH kSearches[3] = { MLAA::EDGE_SEARCH_SHORT, MLAA::EDGE_SEARCH_LONG, MLAA::EDGE_SEARCH_LONG_NAIVE };
+    static const char* kSearchNames[3] = { "4 bit", "Long words", "Long naive" };
+
+    // The scenes then the noise, black or white pixels
+    std::vector<Scene> Scenes;
+    BuildScenes( Size, Scenes );
+    std::vector< std::vector<uint8_t> > Inputs( Scenes.size() + 1 ), References( Scenes.size() );
+    for ( size_t s = 0; s < Scenes.size(); s++ )
+    {
+        RenderScene( Scenes[s], Size, 1, Inputs[s] );
+        RenderScene( Scenes[s], Size, kReferenceSamples, References[s] );
+    }
+    Random Rand = { 34 };
+    std::vector<uint8_t>& Noise = Inputs.back();
+    Noise.resize( (size_t)Size * Size * 4 );
+    for ( size_t i = 0; i < Noise.size(); i += 4 )
+        memset( &Noise[i], ( Rand.Next() < 0.5f ) ? 0 : 255, 4 );
+
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> Outputs[3];
+    MLAA::CPUEngine Engines[3];
+    MLAA::Surface Dsts[3];
+    for ( int k = 0; k < 3; k++ )
+    {
+        Outputs[k].resize( nBytes );
+        MLAA::Surface Dst = { &Outputs[k][0], Size, Size, Size * 4 };
+        Dsts[k] = Dst;
+        Engines[k].SetEdgeSearch( kSearches[k] );
+    }
+    MLAA::CPUQueue Queue( 1 );
+    Queue.SetEdgeSearch( MLAA::EDGE_SEARCH_LONG );
+    std::vector<uint8_t> QueueOutput( nBytes );
+    MLAA::Surface QueueDst = { &QueueOutput[0], Size, Size, Size * 4 };
+
+    // Pass times of the scenes then of the noise
+    double PassMs[2][3][MLAA::PASS_COUNT] = { { { 0.0 } } };
+    double ErrorSum[4] = { 0.0 };
+    for ( size_t s = 0; s < Inputs.size(); s++ )
+    {
+        const bool bNoise = ( s == Scenes.size() );
+        MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+        for ( int k = 0; k < 3; k++ )
+        {
+            double SceneMs[MLAA::PASS_COUNT];
+            for ( int r = 0; r < nReps; r++ )
+            {
+                Engines[k].Apply( Src, Dsts[k] );
+                for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+                {
+                    double Ms = Engines[k].GetPassTime( (MLAA::PASS)p );
+                    SceneMs[p] = ( r == 0 || Ms < SceneMs[p] ) ? Ms : SceneMs[p];
+                }
+            }
+            for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+                PassMs[bNoise][k][p] += SceneMs[p];
+            if ( !bNoise )
+                ErrorSum[k + 1] += SquaredError( Outputs[k], References[s] );
+        }
+        if ( !bNoise )
+            ErrorSum[0] += SquaredError( Inputs[s], References[s] );
+
+        const char* pBroken = NULL;
+        if ( !SameEdges( Engines[1].GetEdgeView(), Engines[2].GetEdgeView() ) || Outputs[1] != Outputs[2] )
+            pBroken = "the word search differs from the pixel walk";
+        else if ( !MatchesBlockWalk( Engines[1].GetEdgeView() ) )
+            pBroken = "the word search differs from the shader's block walk";
+        else if ( !MatchesBlockWalk( Engines[0].GetEdgeView() ) )
+            pBroken = "the 4 bit counts differ from the shader's block walk";
+        else
+        {
+            Queue.Submit( Src, QueueDst ).get();
+            if ( QueueOutput != Outputs[1] )
+                pBroken = "CPUQueue differs from the engine";
+        }
+        if ( pBroken )
+        {
+            printf( "%s: %s\n", bNoise ? "Noise" : "Scene", pBroken );
+            return 1;
+        }
+    }
+
+    const double nValues = (double)Size * Size * 3 * Scenes.size();
+    printf( "%d scenes and noise of %dx%d, PSNR against %dx supersampling\n", (int)Scenes.size(), Size, Size,
+            kReferenceSamples * kReferenceSamples );
+    for ( int n = 0; n < 2; n++ )
+    {
+        printf( "\n%-12s %10s %10s %10s %10s %10s\n", n ? "Noise" : "Scenes", "Detect ms", "Length ms", "Blend ms", "Total ms", n ? "" : "PSNR" );
+        if ( n == 0 )
+            printf( "%-12s %10s %10s %10s %10s %7.2f dB\n", "No MLAA", "", "", "", "", ToPSNR( ErrorSum[0], nValues ) );
+        for ( int k = 0; k < 3; k++ )
+        {
+            const double* pMs = PassMs[n][k];
+            printf( "%-12s %10.2f %10.2f %10.2f %10.2f", kSearchNames[k], pMs[0], pMs[1], pMs[2], pMs[0] + pMs[1] + pMs[2] );
+            if ( n == 0 )
+                printf( " %7.2f dB", ToPSNR( ErrorSum[k + 1], nValues ) );
+            printf( "\n" );
+        }
+    }
+    printf( "\nThe word search gives the counts and output of the pixel walk, both counts those of the shader's\n"
+            "block walk, CPUQueue matches the engine\n" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// vertical-search: time of the second pass with the vertical counts of the transposed
+// blocks and of the direct walk down the columns, on the scenes and on noise full of
+// short edges, at -size or at 1024, 2048 and 4096. Both must give the same counts and
+// output, and CPUQueue the output of the engine
+//--------------------------------------------------------------------------------------
+static int RunVerticalSearch( int argc, char* argv[] )
+{
+    int Size = 0, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( ( Size != 0 && Size < 16 ) || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static const int kSizes[3] = { 1024, 2048, 4096 };
+    static const MLAA::VERTICAL_SEARCH kModes[2] = { MLAA::VERTICAL_SEARCH_TRANSPOSED, MLAA::VERTICAL_SEARCH_DIRECT };
+    const int nSizes = Size ? 1 : 3;
+
+    printf( "Line length pass, the scenes and noise\n\n%-6s %14s %14s %14s %14s\n", "Size", "Scenes, trans", "Scenes, direct",
+            "Noise, trans", "Noise, direct" );
+    double TotalMs[2][2] = { { 0.0 } };
+    for ( int z = 0; z < nSizes; z++ )
+    {
+        const int ImageSize = Size ? Size : kSizes[z];
+
+        // The scenes then the noise, black or white pixels
+        std::vector< std::vector<uint8_t> > Inputs;
+        RenderInputs( ImageSize, Inputs );
+        Inputs.push_back( std::vector<uint8_t>( (size_t)ImageSize * ImageSize * 4 ) );
+        Random Rand = { 26 };
+        std::vector<uint8_t>& Noise = Inputs.back();
+        for ( size_t i = 0; i < Noise.size(); i += 4 )
+            memset( &Noise[i], ( Rand.Next() < 0.5f ) ? 0 : 255, 4 );
+
+        const size_t nBytes = (size_t)ImageSize * ImageSize * 4;
+        std::vector<uint8_t> Outputs[2] = { std::vector<uint8_t>( nBytes ), std::vector<uint8_t>( nBytes ) };
+        std::vector<uint8_t> QueueOutput( nBytes );
+        MLAA::CPUEngine Engines[2];
+        MLAA::CPUQueue Queue( 1 );
+        Queue.SetVerticalSearch( MLAA::VERTICAL_SEARCH_DIRECT );
+
+        double LengthMs[2][2] = { { 0.0 } };
+        for ( size_t s = 0; s < Inputs.size(); s++ )
+        {
+            const int bNoise = ( s == Inputs.size() - 1 );
+            MLAA::Surface Src = { &Inputs[s][0], ImageSize, ImageSize, ImageSize * 4 };
+            for ( int m = 0; m < 2; m++ )
+            {
+                MLAA::Surface Dst = { &Outputs[m][0], ImageSize, ImageSize, ImageSize * 4 };
+                MLAA::CPUEngine& Engine = Engines[m];
+                Engine.SetVerticalSearch( kModes[m] );
+                Engine.DetectEdges( Src );
+                LengthMs[bNoise][m] += BestTimeMs( nReps, [&]() { Engine.ComputeLineLength(); } );
+                Engine.BlendColor( Src, Dst );
+            }
+
+            MLAA::Surface QueueDst = { &QueueOutput[0], ImageSize, ImageSize, ImageSize * 4 };
+            Queue.Submit( Src, QueueDst ).get();
+            const char* pBroken = NULL;
+            if ( !SameEdges( Engines[0].GetEdgeView(), Engines[1].GetEdgeView() ) || Outputs[0] != Outputs[1] )
+                pBroken = "the direct walk differs from the transposed search";
+            else if ( QueueOutput != Outputs[1] )
+                pBroken = "CPUQueue differs from the engine";
+            if ( pBroken )
+            {
+                printf( "%dx%d %s %d: %s\n", ImageSize, ImageSize, bNoise ? "noise" : "scene", (int)s, pBroken );
+                return 1;
+            }
+        }
+
+        printf( "%-6d %11.2f ms %11.2f ms %11.2f ms %11.2f ms\n", ImageSize, LengthMs[0][0], LengthMs[0][1], LengthMs[1][0], LengthMs[1][1] );
+        for ( int n = 0; n < 2; n++ )
+        {
+            TotalMs[n][0] += LengthMs[n][0];
+            TotalMs[n][1] += LengthMs[n][1];
+        }
+    }
+
+    printf( "\nBoth searches give the same counts and output, CPUQueue matches the engine. The %s search is\n"
+            "faster over the scenes, the %s search over the noise\n", TotalMs[0][0] < TotalMs[0][1] ? "transposed" : "direct",
+            TotalMs[1][0] < TotalMs[1][1] ? "transposed" : "direct" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// The texels MLAA11.hlsl's USE_GATHER paths read for each pixel of an image of Width by
+// Height at the top left of a pooled target of TargetWidth by TargetHeight, against the
+// clamped loads of MLAA_SeperatingLines_PS. Texels past the image hold values no pixel
+// of the image has, so reading one without the border fix ups shows
+//--------------------------------------------------------------------------------------
+struct TexelGrid
+{
+    std::vector<int>    Values;
+    int                 Width;
+    int                 Height;
+
+    // Point sampled texel, clamped at the borders of the target as the sampler does
+    int Load( int x, int y ) const
+    {
+        x = ( x < 0 ) ? 0 : ( x >= Width ) ? Width - 1 : x;
+        y = ( y < 0 ) ? 0 : ( y >= Height ) ? Height - 1 : y;
+        return Values[(size_t)y * Width + x];
+    }
+
+    // GatherAlpha at the corner between texels x - 1 and x, y - 1 and y: lower left, lower
+    // right, upper right, upper left
+    void Gather( int x, int y, int Texels[4] ) const
+    {
+        Texels[0] = Load( x - 1, y );
+        Texels[1] = Load( x, y );
+        Texels[2] = Load( x, y - 1 );
+        Texels[3] = Load( x - 1, y - 1 );
+    }
+};
+
+static bool MatchesGatherMapping( int Width, int Height, int TargetWidth, int TargetHeight )
+{
+    TexelGrid Grid = { std::vector<int>( (size_t)TargetWidth * TargetHeight ), TargetWidth, TargetHeight };
+    for ( int y = 0; y < TargetHeight; y++ )
+    {
+        for ( int x = 0; x < TargetWidth; x++ )
+            Grid.Values[(size_t)y * TargetWidth + x] = ( x < Width && y < Height ) ? y * Width + x : -1 - y * TargetWidth - x;
+    }
+
+    // Center, up and right of every pixel from the per pixel loads, clamped to the image
+    std::vector<int> Loads( (size_t)Width * Height * 3 ), Gathers( Loads.size(), -1 ), Quads( Loads.size(), -1 );
+    for ( int y = 0; y < Height; y++ )
+    {
+        for ( int x = 0; x < Width; x++ )
+        {
+            int* pLoads = &Loads[( (size_t)y * Width + x ) * 3];
+            pLoads[0] = Grid.Load( x, y );
+            pLoads[1] = Grid.Load( x, y > 0 ? y - 1 : 0 );
+            pLoads[2] = Grid.Load( x + 1 < Width ? x + 1 : x, y );
+
+            // SeperatingLines with USE_GATHER
+            int Texels[4];
+            Grid.Gather( x + 1, y, Texels );
+            int* pGathers = &Gathers[( (size_t)y * Width + x ) * 3];
+            pGathers[0] = Texels[0];
+            pGathers[1] = ( y == 0 ) ? Texels[0] : Texels[3];
+            pGathers[2] = ( x == Width - 1 ) ? Texels[0] : Texels[1];
+        }
+    }
+
+    // MLAA_SeperatingLinesQuad_PS over a viewport of half the image, rounded up
+    for ( int qy = 0; qy < Height; qy += 2 )
+    {
+        for ( int qx = 0; qx < Width; qx += 2 )
+        {
+            int UpperQuad[4], RightQuad[4];
+            Grid.Gather( qx + 1, qy, UpperQuad );
+            Grid.Gather( qx + 2, qy + 1, RightQuad );
+            const int LowerLeft = Grid.Load( qx, qy + 1 < Height ? qy + 1 : Height - 1 );
+
+            const int Center[4] = { UpperQuad[0], UpperQuad[1], LowerLeft, RightQuad[0] };
+            const int Up[4] = { UpperQuad[3], UpperQuad[2], UpperQuad[0], RightQuad[3] };
+            const int Right[4] = { UpperQuad[1], RightQuad[2], RightQuad[0], RightQuad[1] };
+            for ( int i = 0; i < 4; i++ )
+            {
+                const int x = qx + ( i & 1 ), y = qy + ( i >> 1 );
+                if ( x < Width && y < Height )
+                {
+                    int* pQuads = &Quads[( (size_t)y * Width + x ) * 3];
+                    pQuads[0] = Center[i];
+                    pQuads[1] = ( y == 0 ) ? Center[i] : Up[i];
+                    pQuads[2] = ( x == Width - 1 ) ? Center[i] : Right[i];
+                }
+            }
+        }
+    }
+    return Gathers == Loads && Quads == Loads;
+}
+
+//--------------------------------------------------------------------------------------
+// quad-kernel: time of the detection pass with the pixel and the quad kernels on the
+// scenes and on noise, with the luma loads of each. The quad kernel must give the edges
+// and output of the pixel kernel on every crop of the scenes and the noise in a set of
+// odd and even sizes, at several thresholds and both detection resolutions, and the
+// gather paths of the shader must read the texels of its per pixel loads
+//--------------------------------------------------------------------------------------
+static int RunQuadKernel( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 160 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The scenes then noise with every channel random
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    Inputs.push_back( std::vector<uint8_t>( (size_t)Size * Size * 4 ) );
+    Random Rand = { 35 };
+    for ( size_t i = 0; i < Inputs.back().size(); i++ )
+        Inputs.back()[i] = (uint8_t)( Rand.Next() * 255.0f );
+
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> PixelOutput( nBytes ), QuadOutput( nBytes );
+    MLAA::CPUEngine PixelEngine, QuadEngine;
+    QuadEngine.SetDetectionKernel( MLAA::DETECTION_KERNEL_QUAD );
+
+    static const int kWidths[] = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 63, 64, 65, 66, 67, 130, 157 };
+    static const int kHeights[] = { 1, 2, 3, 4, 5, 9, 64, 65, 131 };
+    static const float kThresholds[] = { 1.0f / 32.0f, 1.0f / 16.0f, MLAA::kDefaultThreshold, 1.0f / 8.0f, 1.0f / 4.0f };
+    for ( size_t s = 0; s < Inputs.size(); s++ )
+    {
+        for ( int t = 0; t < (int)( sizeof( kThresholds ) / sizeof( kThresholds[0] ) ); t++ )
+        {
+            PixelEngine.SetThreshold( kThresholds[t] );
+            QuadEngine.SetThreshold( kThresholds[t] );
+            for ( int r = 0; r < 2; r++ )
+            {
+                PixelEngine.SetDetectionResolution( r ? MLAA::DETECTION_HALF : MLAA::DETECTION_FULL );
+                QuadEngine.SetDetectionResolution( r ? MLAA::DETECTION_HALF : MLAA::DETECTION_FULL );
+                for ( int w = 0; w < (int)( sizeof( kWidths ) / sizeof( kWidths[0] ) ); w++ )
+                {
+                    for ( int h = 0; h < (int)( sizeof( kHeights ) / sizeof( kHeights[0] ) ); h++ )
+                    {
+                        // Crops of the input, the outputs packed at the size of the crop
+                        const int Width = kWidths[w], Height = kHeights[h];
+                        MLAA::Surface Src = { &Inputs[s][0], Width, Height, Size * 4 };
+                        MLAA::Surface PixelDst = { &PixelOutput[0], Width, Height, Width * 4 };
+                        MLAA::Surface QuadDst = { &QuadOutput[0], Width, Height, Width * 4 };
+                        PixelEngine.Apply( Src, PixelDst );
+                        QuadEngine.Apply( Src, QuadDst );
+                        if ( !SameEdges( PixelEngine.GetEdgeView(), QuadEngine.GetEdgeView() ) ||
+                             memcmp( &PixelOutput[0], &QuadOutput[0], (size_t)Width * Height * 4 ) )
+                        {
+                            printf( "%s, %dx%d, threshold %.4f, %s resolution: the quad kernel differs from the pixel kernel\n",
+                                    s < Inputs.size() - 1 ? "Scene" : "Noise", Width, Height, kThresholds[t], r ? "half" : "full" );
+                            return 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    PixelEngine.SetThreshold( MLAA::kDefaultThreshold );
+    QuadEngine.SetThreshold( MLAA::kDefaultThreshold );
+    PixelEngine.SetDetectionResolution( MLAA::DETECTION_FULL );
+    QuadEngine.SetDetectionResolution( MLAA::DETECTION_FULL );
+
+    for ( int w = 0; w < (int)( sizeof( kWidths ) / sizeof( kWidths[0] ) ); w++ )
+    {
+        for ( int h = 0; h < (int)( sizeof( kHeights ) / sizeof( kHeights[0] ) ); h++ )
+        {
+            if ( !MatchesGatherMapping( kWidths[w], kHeights[h], kWidths[w], kHeights[h] ) ||
+                 !MatchesGatherMapping( kWidths[w], kHeights[h], kWidths[w] + 3, kHeights[h] + 2 ) )
+            {
+                printf( "%dx%d: the gather paths of the shader read other texels than its per pixel loads\n", kWidths[w], kHeights[h] );
+                return 1;
+            }
+        }
+    }
+
+    // Full frames, timed, and through CPUQueue
+    MLAA::CPUQueue Queue( 1 );
+    Queue.SetDetectionKernel( MLAA::DETECTION_KERNEL_QUAD );
+    MLAA::Surface PixelDst = { &PixelOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface QuadDst = { &QuadOutput[0], Size, Size, Size * 4 };
+    double DetectMs[2][2] = { { 0.0 } };
+    for ( size_t s = 0; s < Inputs.size(); s++ )
+    {
+        const int bNoise = ( s == Inputs.size() - 1 );
+        MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+        DetectMs[bNoise][0] += BestTimeMs( nReps, [&]() { PixelEngine.DetectEdges( Src ); } );
+        DetectMs[bNoise][1] += BestTimeMs( nReps, [&]() { QuadEngine.DetectEdges( Src ); } );
+
+        PixelEngine.Apply( Src, PixelDst );
+        Queue.Submit( Src, QuadDst ).get();
+        if ( PixelOutput != QuadOutput )
+        {
+            printf( "%s %d: CPUQueue with the quad kernel differs from the pixel kernel\n", bNoise ? "Noise" : "Scene", (int)s );
+            return 1;
+        }
+    }
+
+    // Luma loads: DetectEdgesRow loads center, up and right for each pixel. A quad row pair
+    // loads 4 lanes of the up row and of both rows, plus the pixel right of each row, and
+    // the columns past the lanes and an odd last row go a pixel at a time
+    const double nPixels = (double)Size * Size;
+    const double nLaneWidth = (double)( ( ( Size - 1 ) / 4 ) * 4 );
+    const double nQuadLoads = ( Size / 2 ) * ( nLaneWidth / 4 * 14.0 + ( Size - nLaneWidth ) * 6.0 ) + ( Size & 1 ) * Size * 3.0;
+
+    printf( "%d scenes and noise of %dx%d, detection pass at the default threshold\n\n", (int)Inputs.size() - 1, Size, Size );
+    printf( "%-8s %10s %10s %16s\n", "", "Scenes ms", "Noise ms", "Loads per pixel" );
+    printf( "%-8s %10.2f %10.2f %16.3f\n", "Pixel", DetectMs[0][0], DetectMs[1][0], 3.0 );
+    printf( "%-8s %10.2f %10.2f %16.3f\n", "Quad", DetectMs[0][1], DetectMs[1][1], nQuadLoads / nPixels );
+    printf( "\nThe quad kernel gives the edges and output of the pixel kernel on %d crops at %d thresholds and\n"
+            "both resolutions, the gather paths of the shader read the texels of its loads, CPUQueue matches\n",
+            (int)( sizeof( kWidths ) / sizeof( kWidths[0] ) * sizeof( kHeights ) / sizeof( kHeights[0] ) ),
+            (int)( sizeof( kThresholds ) / sizeof( kThresholds[0] ) ) );
+    return 0;
+}
+
+// FNV-1a hash of an image, to compare outputs between builds
+static uint64_t HashImage( const std::vector<uint8_t>& Image )
+{
+    uint64_t Hash = 14695981039346656037ULL;
+    for ( size_t i = 0; i < Image.size(); i++ )
+        Hash = ( Hash ^ Image[i] ) * 1099511628211ULL;
+    return Hash;
+}
+
+//--------------------------------------------------------------------------------------
+// blend-math: time of the blend pass on the scenes and on noise, short and long edges.
+// The output must be the same for every thread count of CPUQueue and when the frame is
+// split into regions. The hash of the outputs is printed to compare builds with other
+// float settings
+//--------------------------------------------------------------------------------------
+static int RunBlendMath( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The scenes then noise with every channel random
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    Inputs.push_back( std::vector<uint8_t>( (size_t)Size * Size * 4 ) );
+    Random Rand = { 40 };
+    for ( size_t i = 0; i < Inputs.back().size(); i++ )
+        Inputs.back()[i] = (uint8_t)( Rand.Next() * 255.0f );
+
+    const size_t nBytes = (size_t)Size * Size * 4;
+    std::vector<uint8_t> Output( nBytes ), CheckOutput( nBytes );
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    MLAA::Surface CheckDst = { &CheckOutput[0], Size, Size, Size * 4 };
+    MLAA::CPUEngine Engine;
+    MLAA::CPUQueue Queue( 1, 4 );
+
+    double BlendMs[2][2] = { { 0.0 } };
+    uint64_t Hash = 14695981039346656037ULL;
+    for ( int Long = 0; Long < 2; Long++ )
+    {
+        const MLAA::EDGE_SEARCH Search = Long ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT;
+        Engine.SetEdgeSearch( Search );
+        Queue.SetEdgeSearch( Search );
+        for ( size_t s = 0; s < Inputs.size(); s++ )
+        {
+            const int bNoise = ( s == Inputs.size() - 1 );
+            MLAA::Surface Src = { &Inputs[s][0], Size, Size, Size * 4 };
+            Engine.DetectEdges( Src );
+            Engine.ComputeLineLength();
+            BlendMs[Long][bNoise] += BestTimeMs( nReps, [&]() { Engine.BlendColor( Src, Dst ); } );
+            Hash = ( Hash ^ HashImage( Output ) ) * 1099511628211ULL;
+
+            // The same output from 4 threads, then from 4 bands of rows
+            const char* pBroken = NULL;
+            Queue.Submit( Src, CheckDst ).get();
+            if ( CheckOutput != Output )
+                pBroken = "CPUQueue with 4 threads differs from the engine";
+            for ( int b = 0; b < 4 && !pBroken; b++ )
+            {
+                MLAA::Rect Band = { 0, Size * b / 4, Size, Size * ( b + 1 ) / 4 };
+                Engine.Apply( Src, CheckDst, Band );
+                if ( !SameRect( CheckOutput, Output, Size, Band ) )
+                    pBroken = "a band of rows differs from the full frame";
+            }
+            if ( pBroken )
+            {
+                printf( "%s %d, %s edges: %s\n", bNoise ? "Noise" : "Scene", (int)s, Long ? "long" : "short", pBroken );
+                return 1;
+            }
+        }
+    }
+
+    printf( "%d scenes and noise of %dx%d, blend pass\n\n%-14s %14s\n", (int)Inputs.size() - 1, Size, Size, "", "Blend" );
+    for ( int n = 0; n < 2; n++ )
+    {
+        for ( int Long = 0; Long < 2; Long++ )
+        {
+            char Name[32];
+            sprintf( Name, "%s, %s", n ? "Noise" : "Scenes", Long ? "long" : "short" );
+            printf( "%-14s %11.2f ms\n", Name, BlendMs[Long][n] );
+        }
+    }
+    printf( "\nThe output is the same from 4 threads and in bands. Hash of the outputs: %016llx\n", (unsigned long long)Hash );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// A planar frame and its storage. NV12 keeps the interleaved UV samples in U
+//--------------------------------------------------------------------------------------
+struct PlanarFrame
+{
+    std::vector<uint8_t>    Y;
+    std::vector<uint8_t>    U;
+    std::vector<uint8_t>    V;
+    MLAA::PlanarImage       Image;
+};
+
+static void AllocatePlanar( MLAA::PLANAR_FORMAT Format, int Width, int Height, PlanarFrame& Frame )
+{
+    const int nChromaWidth = ( Width + 1 ) / 2, nChromaHeight = ( Height + 1 ) / 2;
+    const int UVPitch = ( Format == MLAA::PLANAR_FORMAT_NV12 ) ? nChromaWidth * 2 : nChromaWidth;
+    Frame.Y.assign( (size_t)Width * Height, 0 );
+    Frame.U.assign( (size_t)UVPitch * nChromaHeight, 0 );
+    Frame.V.assign( ( Format == MLAA::PLANAR_FORMAT_NV12 ) ? 0 : (size_t)UVPitch * nChromaHeight, 0 );
+    MLAA::PlanarImage Image = { Format, Width, Height, &Frame.Y[0], Width, &Frame.U[0], Frame.V.empty() ? NULL : &Frame.V[0], UVPitch };
+    Frame.Image = Image;
+}
+
+// Chroma sample c of the pixel at x, y of a chroma plane
+static uint8_t& ChromaSample( PlanarFrame& Frame, int x, int y, int c )
+{
+    const MLAA::PlanarImage& Image = Frame.Image;
+    if ( Image.Format == MLAA::PLANAR_FORMAT_NV12 )
+        return Image.pU[(size_t)y * Image.UVPitch + x * 2 + c];
+    return ( c ? Image.pV : Image.pU )[(size_t)y * Image.UVPitch + x];
+}
+
+// Y from the luma in alpha of the top left Width by Height pixels of an RGBA image, chroma
+// the BT.601 color difference of 2x2 blocks kept within 1 to 255 so that it can be negated
+static void ToPlanar( const std::vector<uint8_t>& RGBA, int Pitch, PlanarFrame& Frame )
+{
+    const int Width = Frame.Image.Width, Height = Frame.Image.Height;
+    for ( int y = 0; y < Height; y++ )
+    {
+        for ( int x = 0; x < Width; x++ )
+            Frame.Y[(size_t)y * Width + x] = RGBA[(size_t)y * Pitch + x * 4 + 3];
+    }
+    for ( int y = 0; y < ( Height + 1 ) / 2; y++ )
+    {
+        for ( int x = 0; x < ( Width + 1 ) / 2; x++ )
+        {
+            float Sum[3] = { 0.0f, 0.0f, 0.0f };
+            for ( int i = 0; i < 4; i++ )
+            {
+                const int sx = ( 2 * x + ( i & 1 ) < Width ) ? 2 * x + ( i & 1 ) : 2 * x;
+                const int sy = ( 2 * y + ( i >> 1 ) < Height ) ? 2 * y + ( i >> 1 ) : 2 * y;
+                for ( int c = 0; c < 3; c++ )
+                    Sum[c] += RGBA[(size_t)sy * Pitch + sx * 4 + c] * 0.25f;
+            }
+            const float Chroma[2] = { -0.169f * Sum[0] - 0.331f * Sum[1] + 0.5f * Sum[2], 0.5f * Sum[0] - 0.419f * Sum[1] - 0.081f * Sum[2] };
+            for ( int c = 0; c < 2; c++ )
+            {
+                const int Value = 128 + (int)floorf( Chroma[c] + 0.5f );
+                ChromaSample( Frame, x, y, c ) = (uint8_t)( Value < 1 ? 1 : ( Value > 255 ? 255 : Value ) );
+            }
+        }
+    }
+}
+
+// Whether the chroma of b is that of a, or with bNegated its negation around 128
+static bool SameChroma( PlanarFrame& a, PlanarFrame& b, bool bNegated )
+{
+    for ( int y = 0; y < ( a.Image.Height + 1 ) / 2; y++ )
+    {
+        for ( int x = 0; x < ( a.Image.Width + 1 ) / 2; x++ )
+        {
+            for ( int c = 0; c < 2; c++ )
+            {
+                const int Expected = bNegated ? 256 - ChromaSample( a, x, y, c ) : ChromaSample( a, x, y, c );
+                if ( ChromaSample( b, x, y, c ) != Expected )
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// planar: time of ApplyPlanar on frames of the scenes, and the frame rate CPUQueue keeps
+// with frames in flight, against the 16.7 ms of 60 frames per second. Chroma is offset
+// binary: a frame of constant chroma must come out with its chroma unchanged, and a frame
+// with its chroma negated around 128 with the output chroma negated. NV12 and I420 must
+// give the same output, and CPUQueue that of the engine
+//--------------------------------------------------------------------------------------
+static int RunPlanar( int argc, char* argv[] )
+{
+    int Width = 3840, Height = 2160, nFrames = 60, nDepth = 4, nThreads = 0;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-width" ) && bHasValue )            Width = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-height" ) && bHasValue )      Height = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-frames" ) && bHasValue )      nFrames = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-depth" ) && bHasValue )       nDepth = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-threads" ) && bHasValue )     nThreads = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Width < 16 || Height < 16 || nFrames < 1 || nDepth < 1 || nThreads < 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The scenes are square, frames are cut from their top left corner
+    const int Size = ( Width > Height ) ? Width : Height;
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    std::vector<PlanarFrame> Frames( Inputs.size() );
+    for ( size_t s = 0; s < Inputs.size(); s++ )
+    {
+        AllocatePlanar( MLAA::PLANAR_FORMAT_NV12, Width, Height, Frames[s] );
+        ToPlanar( Inputs[s], Size * 4, Frames[s] );
+    }
+    std::vector< std::vector<uint8_t> >().swap( Inputs );
+
+    // Every check runs on the first scene, on the full frame and on an odd crop of it
+    static const MLAA::PLANAR_FORMAT kFormats[2] = { MLAA::PLANAR_FORMAT_NV12, MLAA::PLANAR_FORMAT_I420 };
+    MLAA::CPUEngine Engine;
+    MLAA::CPUQueue Queue( 1 );
+    for ( int Crop = 0; Crop < 2; Crop++ )
+    {
+        const int CheckWidth = Crop ? 301 : Width, CheckHeight = Crop ? 199 : Height;
+        std::vector<uint8_t> Source;
+        PlanarFrame Frame, Constant, Negated, Output[2], NegatedOutput, ConstantOutput, QueueOutput;
+        for ( int f = 0; f < 2; f++ )
+        {
+            PlanarFrame* pFrames[7] = { &Frame, &Constant, &Negated, &Output[f], &NegatedOutput, &ConstantOutput, &QueueOutput };
+            for ( int i = 0; i < 7; i++ )
+                AllocatePlanar( kFormats[f], CheckWidth, CheckHeight, *pFrames[i] );
+            for ( int y = 0; y < CheckHeight; y++ )
+                memcpy( &Frame.Y[(size_t)y * CheckWidth], &Frames[0].Y[(size_t)y * Width], CheckWidth );
+            Constant.Y = Negated.Y = Frame.Y;
+            Frame.Image.pY = &Frame.Y[0];
+            Constant.Image.pY = &Constant.Y[0];
+            Negated.Image.pY = &Negated.Y[0];
+            for ( int y = 0; y < ( CheckHeight + 1 ) / 2; y++ )
+            {
+                for ( int x = 0; x < ( CheckWidth + 1 ) / 2; x++ )
+                {
+                    for ( int c = 0; c < 2; c++ )
+                    {
+                        ChromaSample( Frame, x, y, c ) = ChromaSample( Frames[0], x, y, c );
+                        ChromaSample( Negated, x, y, c ) = (uint8_t)( 256 - ChromaSample( Frames[0], x, y, c ) );
+                        ChromaSample( Constant, x, y, c ) = c ? 200 : 90;
+                    }
+                }
+            }
+
+            Engine.ApplyPlanar( Frame.Image, Output[f].Image, true );
+            Engine.ApplyPlanar( Negated.Image, NegatedOutput.Image, true );
+            Engine.ApplyPlanar( Constant.Image, ConstantOutput.Image, true );
+            Queue.SubmitPlanar( Frame.Image, QueueOutput.Image, true ).get();
+
+            const char* pBroken = NULL;
+            if ( !SameChroma( Constant, ConstantOutput, false ) )
+                pBroken = "constant chroma changed";
+            else if ( !SameChroma( Output[f], NegatedOutput, true ) || NegatedOutput.Y != Output[f].Y )
+                pBroken = "negated chroma does not give the negated output";
+            else if ( f == 1 && ( !SameChroma( Output[0], Output[1], false ) || Output[0].Y != Output[1].Y ) )
+                pBroken = "I420 differs from NV12";
+            else if ( !SameChroma( Output[f], QueueOutput, false ) || QueueOutput.Y != Output[f].Y )
+                pBroken = "CPUQueue differs from the engine";
+            if ( pBroken )
+            {
+                printf( "%dx%d %s: %s\n", CheckWidth, CheckHeight, f ? "I420" : "NV12", pBroken );
+                return 1;
+            }
+        }
+    }
+
+    // One frame at a time on the calling thread, fastest of each scene
+    PlanarFrame Output;
+    AllocatePlanar( MLAA::PLANAR_FORMAT_NV12, Width, Height, Output );
+    printf( "%d scenes as NV12 frames of %dx%d, 60 frames per second is %.1f ms a frame\n\n%-26s %10s %10s\n",
+            (int)Frames.size(), Width, Height, 1000.0 / 60.0, "", "ms/frame", "frames/s" );
+    for ( int c = 0; c < 2; c++ )
+    {
+        double TotalMs = 0.0;
+        for ( size_t s = 0; s < Frames.size(); s++ )
+            TotalMs += BestTimeMs( 3, [&]() { Engine.ApplyPlanar( Frames[s].Image, Output.Image, c != 0 ); } );
+        const double FrameMs = TotalMs / Frames.size();
+        printf( "%-26s %10.2f %10.1f\n", c ? "ApplyPlanar, chroma" : "ApplyPlanar, Y only", FrameMs, 1000.0 / FrameMs );
+    }
+
+    // Frames in flight, each slot with its own output
+    MLAA::CPUQueue FrameQueue( nDepth, nThreads );
+    std::vector<PlanarFrame> Outputs( nDepth );
+    std::vector< std::future<MLAA::FrameResult> > Futures( nDepth );
+    for ( int d = 0; d < nDepth; d++ )
+        AllocatePlanar( MLAA::PLANAR_FORMAT_NV12, Width, Height, Outputs[d] );
+    double fFramesPerSecond = 0.0;
+    for ( int Round = 0; Round < 2; Round++ )
+    {
+        // The first round sizes the intermediates of every slot and is not timed
+        const int nRoundFrames = Round ? nFrames : nDepth;
+        double StartTime = MLAA::GetTimeMs();
+        for ( int f = 0; f < nRoundFrames + nDepth; f++ )
+        {
+            const int nSlot = f % nDepth;
+            if ( f >= nDepth )
+                Futures[nSlot].get();
+            if ( f < nRoundFrames )
+                Futures[nSlot] = FrameQueue.SubmitPlanar( Frames[f % Frames.size()].Image, Outputs[nSlot].Image, true );
+        }
+        fFramesPerSecond = nFrames * 1000.0 / ( MLAA::GetTimeMs() - StartTime );
+    }
+    char Name[64];
+    sprintf( Name, "CPUQueue, %d deep, %d threads", nDepth, FrameQueue.GetThreadCount() );
+    printf( "%-26s %10.2f %10.1f\n", Name, 1000.0 / fFramesPerSecond, fFramesPerSecond );
+    printf( "\n60 frames per second %s on this machine. Constant chroma passes through unchanged, negated\n"
+            "chroma gives the negated output, NV12 and I420 match and CPUQueue matches the engine\n",
+            fFramesPerSecond >= 60.0 ? "is kept" : "is not kept" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// effect: MLAA::Effect on a CPUBackend against the CPUEngine calls its settings stand
+// for: whole frames under each setting, with a quality map, in a region of interest and
+// on atlas views. Frames of two sizes go through the same effect, so the intermediates
+// follow the size, and the last run follows ReleaseIntermediates. Dst and the edges must
+// match, outside a region or the views Dst must be left alone. The time of the effect is
+// reported against CPUEngine::Apply
+//--------------------------------------------------------------------------------------
+struct EffectCase
+{
+    const char*                 pName;
+    MLAA::EDGE_SEARCH           EdgeSearch;
+    MLAA::DETECTION_RESOLUTION  Resolution;
+    MLAA::DETECTION_KERNEL      Kernel;
+    bool                        bQualityMap;
+    bool                        bRegion;
+    bool                        bViews;
+};
+
+static const EffectCase kEffectCases[] =
+{
+    { "Short edges",            MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, false, false },
+    { "Long edges",             MLAA::EDGE_SEARCH_LONG,         MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, false, false },
+    { "Naive long edges",       MLAA::EDGE_SEARCH_LONG_NAIVE,   MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, false, false },
+    { "Half res detection",     MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_HALF, MLAA::DETECTION_KERNEL_PIXEL, false, false, false },
+    { "Quad kernel",            MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_QUAD,  false, false, false },
+    { "Quality map",            MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, true,  false, false },
+    { "Region",                 MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, true,  false },
+    { "Long edges in a region", MLAA::EDGE_SEARCH_LONG,         MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, true,  false },
+    { "Views",                  MLAA::EDGE_SEARCH_SHORT,        MLAA::DETECTION_FULL, MLAA::DETECTION_KERNEL_PIXEL, false, false, true },
+};
+
+static int RunEffect( int argc, char* argv[] )
+{
+    int Size = 512, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 64 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const int nCases = sizeof( kEffectCases ) / sizeof( kEffectCases[0] );
+    const float fThreshold = 0.05f;
+    MLAA::CPUBackend Backend;
+    MLAA::Effect Effect( &Backend );
+    MLAA::CPUEngine Engine;
+
+    // The second size is odd, the last round releases the intermediates first
+    const int kSizes[3] = { Size, Size - 37, Size - 37 };
+    int nChecks = 0;
+    for ( int Round = 0; Round < 3; Round++ )
+    {
+        const int N = kSizes[Round];
+        if ( Round == 2 )
+            Effect.ReleaseIntermediates();
+
+        std::vector< std::vector<uint8_t> > Inputs;
+        RenderInputs( N, Inputs );
+        std::vector<uint8_t> Levels;
+        MLAA::QualityMap Map;
+        MLAA::BuildFoveatedQualityMap( N, N, kBenchmarkTileSize, N * 0.5f, N * 0.5f, N * 0.25f, N * 0.5f, Levels, Map );
+        MLAA::Rect Region = { N / 4, N / 3, N * 3 / 4, N / 2 };
+
+        // Views over the four quadrants but a strip along the right, alternating thresholds
+        MLAA::View Views[4];
+        for ( int v = 0; v < 4; v++ )
+        {
+            MLAA::Rect ViewRegion = { ( v & 1 ) ? N / 2 : 0, ( v & 2 ) ? N / 2 : 0, ( v & 1 ) ? N - 5 : N / 2, ( v & 2 ) ? N : N / 2 };
+            Views[v].Region = ViewRegion;
+            Views[v].fThreshold = ( v & 1 ) ? 2.0f * fThreshold : fThreshold;
+        }
+
+        const size_t nBytes = (size_t)N * N * 4;
+        std::vector<uint8_t> Reference( nBytes ), Output( nBytes ), Untouched( nBytes, 0xCD );
+        for ( int c = ( Round == 2 ) ? nCases - 1 : 0; c < nCases; c++ )
+        {
+            const EffectCase& Case = kEffectCases[c];
+            Engine.SetThreshold( fThreshold );
+            Engine.SetEdgeSearch( Case.EdgeSearch );
+            Engine.SetDetectionResolution( Case.Resolution );
+            Engine.SetDetectionKernel( Case.Kernel );
+            Engine.SetQualityMap( Case.bQualityMap ? &Map : NULL );
+
+            Effect.SetThreshold( fThreshold );
+            Effect.SetEdgeSearch( Case.EdgeSearch );
+            Effect.SetDetectionResolution( Case.Resolution );
+            Effect.SetDetectionKernel( Case.Kernel );
+            Effect.SetQualityMap( Case.bQualityMap ? &Map : NULL );
+            Effect.SetRegion( Case.bRegion ? &Region : NULL );
+            Effect.SetViews( Case.bViews ? Views : NULL, Case.bViews ? 4 : 0 );
+
+            for ( size_t s = 0; s < Inputs.size(); s++ )
+            {
+                MLAA::Surface Src = { &Inputs[s][0], N, N, N * 4 };
+                MLAA::Surface RefDst = { &Reference[0], N, N, N * 4 };
+                Reference = Untouched;
+                if ( Case.bViews )
+                    Engine.ApplyViews( Src, RefDst, Views, 4 );
+                else if ( Case.bRegion )
+                    Engine.Apply( Src, RefDst, Region );
+                else
+                    Engine.Apply( Src, RefDst );
+
+                MLAA::EffectSurface Input = { &Inputs[s][0], N, N, N * 4 };
+                MLAA::EffectSurface EffectOutput = { &Output[0], N, N, N * 4 };
+                Output = Untouched;
+                if ( !Effect.Apply( Input, EffectOutput ) )
+                {
+                    printf( "%s, %dx%d, scene %d: Effect::Apply failed\n", Case.pName, N, N, (int)s );
+                    return 1;
+                }
+                if ( Output != Reference || !SameEdges( Backend.GetEngine().GetEdgeView(), Engine.GetEdgeView() ) )
+                {
+                    printf( "%s, %dx%d, scene %d: the effect differs from the engine\n", Case.pName, N, N, (int)s );
+                    return 1;
+                }
+                nChecks++;
+            }
+        }
+    }
+    printf( "%d frames of %d settings at %dx%d and %dx%d match the engine, also after ReleaseIntermediates\n\n",
+            nChecks, nCases, kSizes[0], kSizes[0], kSizes[1], kSizes[1] );
+
+    // The cost of the effect over the engine, short edges on the first scene
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    std::vector<uint8_t> Output( (size_t)Size * Size * 4 );
+    MLAA::Surface Src = { &Inputs[0][0], Size, Size, Size * 4 };
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    MLAA::EffectSurface Input = { &Inputs[0][0], Size, Size, Size * 4 };
+    MLAA::EffectSurface EffectOutput = { &Output[0], Size, Size, Size * 4 };
+    Engine.SetEdgeSearch( MLAA::EDGE_SEARCH_SHORT );
+    Engine.SetDetectionResolution( MLAA::DETECTION_FULL );
+    Engine.SetDetectionKernel( MLAA::DETECTION_KERNEL_PIXEL );
+    Engine.SetQualityMap( NULL );
+    Effect.SetEdgeSearch( MLAA::EDGE_SEARCH_SHORT );
+    Effect.SetDetectionResolution( MLAA::DETECTION_FULL );
+    Effect.SetDetectionKernel( MLAA::DETECTION_KERNEL_PIXEL );
+    Effect.SetQualityMap( NULL );
+    Effect.SetRegion( NULL );
+    Effect.SetViews( NULL, 0 );
+    Engine.Apply( Src, Dst );
+    Effect.Apply( Input, EffectOutput );
+    double EngineMs = BestTimeMs( nReps, [&]() { Engine.Apply( Src, Dst ); } );
+    double EffectMs = BestTimeMs( nReps, [&]() { Effect.Apply( Input, EffectOutput ); } );
+    printf( "%-24s %10s\n", "", "ms" );
+    printf( "%-24s %10.3f\n", "CPUEngine::Apply", EngineMs );
+    printf( "%-24s %10.3f\n", "Effect on CPUBackend", EffectMs );
+    printf( "Passes of the last run\n" );
+    for ( int p = 0; p < MLAA::PASS_COUNT; p++ )
+    {
+        static const char* kPassNames[MLAA::PASS_COUNT] = { "  Detect edges", "  Line length", "  Blend color" };
+        printf( "%-24s %10.3f\n", kPassNames[p], Effect.GetPassTime( (MLAA::PASS)p ) );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// governor: BudgetGovernor fed a synthetic cost model instead of the clock. A frame costs
+// the load of its phase times the cost of its step relative to the first, times noise.
+// The relative costs differ from the ladder's starting values, so the governor has to
+// learn them. The time of a frame reaches Update() after the measurement latency, zero
+// for a CPU clock and 3 for GPU timestamps
+//--------------------------------------------------------------------------------------
+struct GovernorPhase
+{
+    const char*     pName;
+    int             nFrames;
+    double          fLoadMs;            // Cost of the first step
+    bool            bSettles;           // false for a spike, too short to settle
+    bool            bFirstStep;         // Leaves the headroom to step up to the first step
+};
+
+static const GovernorPhase kGovernorPhases[] =
+{
+    { "Light",  1200,  6.0, true,  true  },
+    { "Spike",    30, 30.0, false, false },
+    { "Light",  1200,  6.0, true,  true  },
+    { "Medium", 1200, 13.0, true,  false },
+    { "Light",  1200,  6.0, true,  true  },
+};
+
+static const double kGovernorBudgetMs       = 10.0;
+static const double kGovernorNoise          = 0.1;      // Of the cost, at most
+static const double kGovernorStepCost[]     = { 1.00, 0.86, 0.74, 0.66, 0.55, 0.50, 0.46, 0.42, 0.00 };
+static const int    kGovernorSettleFrames   = 600;      // Of a phase, before its step must hold
+static const int    kGovernorLatencies[]    = { 0, 3 };
+
+static int RunGovernor( int argc, char* argv[] )
+{
+    (void)argv;
+    if ( argc > 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    static_assert( sizeof( kGovernorStepCost ) / sizeof( kGovernorStepCost[0] ) == 9, "A cost for every step of the ladder" );
+    const int nPhases = (int)( sizeof( kGovernorPhases ) / sizeof( kGovernorPhases[0] ) );
+    printf( "Budget of %.1f ms, %.0f%% noise\n\n%-8s %-8s %8s %10s %12s %10s %12s\n", kGovernorBudgetMs, kGovernorNoise * 100.0,
+            "Latency", "Phase", "Load ms", "Steps", "Final step", "Changes", "Over budget" );
+
+    for ( size_t l = 0; l < sizeof( kGovernorLatencies ) / sizeof( kGovernorLatencies[0] ); l++ )
+    {
+        const int nLatency = kGovernorLatencies[l];
+        MLAA::BudgetGovernor Governor;
+        Governor.SetMeasurementLatency( nLatency );
+        Governor.SetAllowSkip( true );
+        Governor.SetBudget( kGovernorBudgetMs );
+
+        Random Rand = { 42 };
+        std::vector<double> Times;
+        for ( int p = 0; p < nPhases; p++ )
+        {
+            const GovernorPhase& Phase = kGovernorPhases[p];
+            int MinStep = Governor.GetStep(), MaxStep = MinStep, LastStep = MinStep;
+            int nChanges = 0, nSettledChanges = 0, nReversals = 0, nOverBudget = 0;
+            bool bRose = false;
+            for ( int f = 0; f < Phase.nFrames; f++ )
+            {
+                const int Step = Governor.GetStep();
+                if ( Step != LastStep )
+                {
+                    // A step down after a step up undoes it
+                    if ( Step > LastStep && bRose )
+                        nReversals++;
+                    bRose = ( Step < LastStep );
+                    nChanges++;
+                    if ( f >= kGovernorSettleFrames )
+                        nSettledChanges++;
+                }
+                LastStep = Step;
+                MinStep = std::min( MinStep, Step );
+                MaxStep = std::max( MaxStep, Step );
+
+                double fScale = 1.0 + kGovernorNoise * ( 2.0 * Rand.Next() - 1.0 );
+                Times.push_back( Phase.fLoadMs * kGovernorStepCost[Step] * fScale );
+                if ( Times.back() > kGovernorBudgetMs )
+                    nOverBudget++;
+
+                size_t nFrame = Times.size() - 1;
+                Governor.Update( nFrame >= (size_t)nLatency ? Times[nFrame - nLatency] : 0.0 );
+            }
+
+            char Steps[16];
+            sprintf( Steps, "%d-%d", MinStep, MaxStep );
+            printf( "%-8d %-8s %8.1f %10s %12d %10d %12d\n", nLatency, Phase.pName, Phase.fLoadMs, Steps, LastStep, nChanges, nOverBudget );
+
+            // A spike is left within the latency and a frame. Once settled the step holds,
+            // at the first step when the load fits
+            const char* pBroken = NULL;
+            if ( !Phase.bSettles && nOverBudget > nLatency + 1 )
+                pBroken = "the spike is followed too late";
+            else if ( Phase.bSettles && ( nSettledChanges > 0 || nReversals > 0 ) )
+                pBroken = "the step oscillates";
+            else if ( Phase.bFirstStep && LastStep != 0 )
+                pBroken = "the first step is not recovered";
+            if ( pBroken )
+            {
+                printf( "Latency %d, phase %d: %s\n", nLatency, p, pBroken );
+                return 1;
+            }
+        }
+    }
+
+    printf( "\nSpikes are followed within the latency, no step up is undone, the steps hold once settled\n"
+            "and the light loads get back to the first step\n" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// hdr: DetectEdgesHDR on RGBA16F and RGBA32F images against DetectEdges on an LDR image
+// of the same structure. The luma of the scenes and of noise is cut to 16 levels, stored
+// as 16 times the level in the LDR image and as 2 to the power of the level in the HDR
+// images. Log luma is then exact and a level apart is an edge for both, and scaling the
+// HDR image and its black level by a power of two, the exposure, must change nothing.
+// Edges and counts must match at every exposure in both formats. The first pass is timed
+// against DetectEdges
+//--------------------------------------------------------------------------------------
+static const int kHDRExposures[] = { -4, 0, 4, 8 };    // Stops, the levels stay normal halves
+
+static int RunHDR( int argc, char* argv[] )
+{
+    int Size = 2048, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // The scenes then noise, the luma cut to 16 levels
+    std::vector< std::vector<uint8_t> > Inputs;
+    RenderInputs( Size, Inputs );
+    Inputs.push_back( std::vector<uint8_t>( (size_t)Size * Size * 4 ) );
+    Random Rand = { 45 };
+    for ( size_t i = 0; i < Inputs.back().size(); i++ )
+        Inputs.back()[i] = (uint8_t)( Rand.Next() * 255.0f );
+
+    const size_t nPixels = (size_t)Size * Size;
+    std::vector<uint16_t> HalfImage( nPixels * 4 );
+    std::vector<float> FloatImage( nPixels * 4 );
+    MLAA::HDRSurface HDRSrcs[2] =
+    {
+        { MLAA::HDR_FORMAT_RGBA16F, (uint8_t*)&HalfImage[0], Size, Size, Size * 8 },
+        { MLAA::HDR_FORMAT_RGBA32F, (uint8_t*)&FloatImage[0], Size, Size, Size * 16 },
+    };
+    static const char* kFormatNames[2] = { "RGBA16F", "RGBA32F" };
+
+    MLAA::CPUEngine LDREngine, HDREngine;
+    LDREngine.SetThreshold( 8.0f / 255.0f );
+    HDREngine.SetHDRThreshold( 0.5f );
+
+    double DetectMs[3] = { 0.0 };
+    for ( size_t s = 0; s < Inputs.size(); s++ )
+    {
+        const int bNoise = ( s == Inputs.size() - 1 );
+        std::vector<uint8_t>& Image = Inputs[s];
+        for ( size_t i = 0; i < nPixels; i++ )
+            Image[i * 4 + 3] &= 0xF0;
+
+        MLAA::Surface Src = { &Image[0], Size, Size, Size * 4 };
+        DetectMs[0] += BestTimeMs( nReps, [&]() { LDREngine.DetectEdges( Src ); } );
+        LDREngine.ComputeLineLength();
+
+        for ( size_t e = 0; e < sizeof( kHDRExposures ) / sizeof( kHDRExposures[0] ); e++ )
+        {
+            // Gray pixels of luma 2^(level - 8) scaled by the exposure, the black level at
+            // the lowest level
+            const int Stops = kHDRExposures[e];
+            for ( size_t i = 0; i < nPixels; i++ )
+            {
+                const int Exponent = ( Image[i * 4 + 3] >> 4 ) - 8 + Stops;
+                const uint16_t Half = (uint16_t)( ( Exponent + 15 ) << 10 );
+                const uint32_t FloatBits = (uint32_t)( Exponent + 127 ) << 23;
+                float Luma;
+                memcpy( &Luma, &FloatBits, 4 );
+                for ( int c = 0; c < 4; c++ )
+                {
+                    HalfImage[i * 4 + c] = Half;
+                    FloatImage[i * 4 + c] = Luma;
+                }
+            }
+            HDREngine.SetHDRBlackLevel( ldexpf( 1.0f, Stops - 8 ) );
+
+            for ( int f = 0; f < 2; f++ )
+            {
+                if ( Stops == 0 )
+                    DetectMs[1 + f] += BestTimeMs( nReps, [&]() { HDREngine.DetectEdgesHDR( HDRSrcs[f] ); } );
+                else
+                    HDREngine.DetectEdgesHDR( HDRSrcs[f] );
+                HDREngine.ComputeLineLength();
+
+                if ( !SameEdges( HDREngine.GetEdgeView(), LDREngine.GetEdgeView() ) )
+                {
+                    printf( "%s %d, %s at %+d stops: the edges differ from the LDR image\n", bNoise ? "Noise" : "Scene", (int)s,
+                            kFormatNames[f], Stops );
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf( "%d scenes and noise of %dx%d, luma in 16 levels, exposures of %+d to %+d stops\n\n%-18s %10s\n", (int)Inputs.size() - 1,
+            Size, Size, kHDRExposures[0], kHDRExposures[sizeof( kHDRExposures ) / sizeof( kHDRExposures[0] ) - 1], "", "Detect ms" );
+    printf( "%-18s %10.2f\n", "LDR DetectEdges", DetectMs[0] );
+    for ( int f = 0; f < 2; f++ )
+    {
+        char Name[32];
+        sprintf( Name, "HDR %s", kFormatNames[f] );
+        printf( "%-18s %10.2f\n", Name, DetectMs[1 + f] );
+    }
+    printf( "\nThe edges and counts of both formats match the LDR image at every exposure\n" );
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// msaa: ApplyMSAA on the scenes rendered with 4 samples per pixel. Like multisampling, a
+// shape is shaded once per pixel, so the samples of a pixel only differ where shapes meet,
+// and the shapes are shaded with a checker of 8 pixel squares whose edges lie between
+// fully covered pixels. The edges must be those DetectEdges finds on the resolve, less
+// the ones with no partially covered pixel on either side.
+//
+// Shape boundaries that fall between two rows or columns of samples also have fully
+// covered pixels on both sides, so for the output the scenes at one sample per pixel are
+// spread instead: each pixel gets a sample of the neighbour that differs most in luma.
+// Every edge of the resolve then has a partially covered side and the output must be
+// that of Apply on the resolve. The time of ApplyMSAA is reported against Apply on the
+// resolve
+//--------------------------------------------------------------------------------------
+static const int kMSAASamples = 4;     // The 2x2 grid of RenderScene
+
+static void RenderMSAAScene( const Scene& S, int Size, std::vector<uint8_t>& Samples )
+{
+    // Index of the shape each sample shows, 0 for the background, painted in order
+    const int SampleSize = Size * 2;
+    std::vector<uint8_t> Shapes( (size_t)SampleSize * SampleSize, 0 );
+    for ( size_t n = 0; n < S.Shapes.size(); n++ )
+    {
+        const Shape& Sh = S.Shapes[n];
+        float MinX, MinY, MaxX, MaxY;
+        GetBounds( Sh, MinX, MinY, MaxX, MaxY );
+        int x0 = std::max( 0, (int)floorf( MinX * 2.0f ) ), x1 = std::min( SampleSize - 1, (int)ceilf( MaxX * 2.0f ) );
+        int y0 = std::max( 0, (int)floorf( MinY * 2.0f ) ), y1 = std::min( SampleSize - 1, (int)ceilf( MaxY * 2.0f ) );
+        for ( int y = y0; y <= y1; y++ )
+        {
+            for ( int x = x0; x <= x1; x++ )
+            {
+                if ( Covers( Sh, ( (float)x + 0.5f ) * 0.5f, ( (float)y + 0.5f ) * 0.5f ) )
+                    Shapes[(size_t)y * SampleSize + x] = (uint8_t)( n + 1 );
+            }
+        }
+    }
+
+    Samples.resize( (size_t)Size * Size * kMSAASamples * 4 );
+    for ( int y = 0; y < Size; y++ )
+    {
+        for ( int x = 0; x < Size; x++ )
+        {
+            const float Shade = ( ( ( x >> 3 ) ^ ( y >> 3 ) ) & 1 ) ? 0.6f : 1.0f;
+            for ( int s = 0; s < kMSAASamples; s++ )
+            {
+                const int n = Shapes[(size_t)( y * 2 + ( s >> 1 ) ) * SampleSize + x * 2 + ( s & 1 )];
+                const uint8_t* pColor = n ? S.Shapes[n - 1].Color : S.Background;
+                uint8_t* pSample = &Samples[( ( (size_t)y * Size + x ) * kMSAASamples + s ) * 4];
+                for ( int i = 0; i < 3; i++ )
+                    pSample[i] = (uint8_t)( (float)pColor[i] * Shade + 0.5f );
+                pSample[3] = (uint8_t)( 0.30f * pSample[0] + 0.59f * pSample[1] + 0.11f * pSample[2] + 0.5f );
+            }
+        }
+    }
+}
+
+static void SpreadToNeighbours( const std::vector<uint8_t>& Image, int Size, std::vector<uint8_t>& Samples )
+{
+    Samples.resize( (size_t)Size * Size * kMSAASamples * 4 );
+    for ( int y = 0; y < Size; y++ )
+    {
+        for ( int x = 0; x < Size; x++ )
+        {
+            const uint8_t* pPixel = &Image[( (size_t)y * Size + x ) * 4];
+            const uint8_t* pFarthest = pPixel;
+            const int Neighbours[4][2] = { { x - 1, y }, { x + 1, y }, { x, y - 1 }, { x, y + 1 } };
+            for ( int n = 0; n < 4; n++ )
+            {
+                if ( Neighbours[n][0] < 0 || Neighbours[n][0] >= Size || Neighbours[n][1] < 0 || Neighbours[n][1] >= Size )
+                    continue;
+                const uint8_t* pNeighbour = &Image[( (size_t)Neighbours[n][1] * Size + Neighbours[n][0] ) * 4];
+                if ( abs( (int)pNeighbour[3] - (int)pPixel[3] ) > abs( (int)pFarthest[3] - (int)pPixel[3] ) )
+                    pFarthest = pNeighbour;
+            }
+
+            uint8_t* pSamples = &Samples[( (size_t)y * Size + x ) * kMSAASamples * 4];
+            for ( int s = 0; s < kMSAASamples; s++ )
+                memcpy( &pSamples[s * 4], s == kMSAASamples - 1 ? pFarthest : pPixel, 4 );
+        }
+    }
+}
+
+static int RunMSAA( int argc, char* argv[] )
+{
+    int Size = 1024, nReps = 5;
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )             Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    // Luma difference of the engine's default threshold, a pixel whose samples differ by
+    // as much from its first one is partially covered
+    int ThresholdLevel = 256;
+    for ( int d = 255; d >= 0 && (float)d / 255.0f > MLAA::kDefaultThreshold; d-- )
+        ThresholdLevel = d;
+
+    std::vector<Scene> Scenes;
+    BuildScenes( Size, Scenes );
+    const size_t nPixels = (size_t)Size * Size;
+    std::vector<uint8_t> Image, Samples, Resolved( nPixels * 4 ), MSAAOutput( nPixels * 4 ), Output( nPixels * 4 );
+    std::vector<uint8_t> Partial( nPixels ), Expected( nPixels );
+    MLAA::Surface ResolvedSurface = { &Resolved[0], Size, Size, Size * 4 };
+    MLAA::Surface MSAADst = { &MSAAOutput[0], Size, Size, Size * 4 };
+    MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+    MLAA::CPUEngine MSAAEngine, Engine;
+
+    double MSAAMs = 0.0, ResolvedMs = 0.0;
+    size_t nKept = 0, nDropped = 0;
+    for ( size_t s = 0; s < Scenes.size(); s++ )
+    {
+        for ( int Spread = 0; Spread < 2; Spread++ )
+        {
+            if ( Spread )
+            {
+                RenderScene( Scenes[s], Size, 1, Image );
+                SpreadToNeighbours( Image, Size, Samples );
+            }
+            else
+            {
+                RenderMSAAScene( Scenes[s], Size, Samples );
+            }
+            MLAA::MSAASurface Src = { &Samples[0], Size, Size, Size * kMSAASamples * 4, kMSAASamples };
+            MSAAEngine.ApplyMSAA( Src, ResolvedSurface, MSAADst );
+            Engine.Apply( ResolvedSurface, Dst );
+            if ( !Spread )
+            {
+                MSAAMs += BestTimeMs( nReps, [&]() { MSAAEngine.ApplyMSAA( Src, ResolvedSurface, MSAADst ); } );
+                ResolvedMs += BestTimeMs( nReps, [&]() { Engine.Apply( ResolvedSurface, Dst ); } );
+            }
+
+            for ( size_t i = 0; i < nPixels; i++ )
+            {
+                const uint8_t* pPixel = &Samples[i * kMSAASamples * 4];
+                int Difference = 0;
+                for ( int n = 1; n < kMSAASamples; n++ )
+                    Difference = std::max( Difference, abs( (int)pPixel[n * 4 + 3] - (int)pPixel[3] ) );
+                Partial[i] = ( Difference >= ThresholdLevel );
+            }
+
+            // The edges of the resolve that have a partially covered pixel on a side
+            const uint8_t* pEdges = Engine.GetEdgeMask();
+            for ( int y = 0; y < Size; y++ )
+            {
+                for ( int x = 0; x < Size; x++ )
+                {
+                    const size_t i = (size_t)y * Size + x;
+                    const size_t Up = ( y > 0 ) ? i - Size : i, Right = ( x + 1 < Size ) ? i + 1 : i;
+                    unsigned int Mask = pEdges[i];
+                    if ( !( Partial[i] | Partial[Up] ) )
+                        Mask &= ~MLAA::kUpperMask;
+                    if ( !( Partial[i] | Partial[Right] ) )
+                        Mask &= ~MLAA::kRightMask;
+                    Expected[i] = (uint8_t)Mask;
+                    if ( !Spread )
+                    {
+                        nKept += ( ( Mask & MLAA::kUpperMask ) != 0 ) + ( ( Mask & MLAA::kRightMask ) != 0 );
+                        nDropped += ( ( ( pEdges[i] ^ Mask ) & MLAA::kUpperMask ) != 0 ) + ( ( ( pEdges[i] ^ Mask ) & MLAA::kRightMask ) != 0 );
+                    }
+                }
+            }
+
+            const char* pBroken = NULL;
+            if ( memcmp( MSAAEngine.GetEdgeMask(), &Expected[0], nPixels ) )
+                pBroken = "the edges are not those of the resolve with partial coverage";
+            else if ( Spread && memcmp( pEdges, &Expected[0], nPixels ) )
+                pBroken = "an edge of the resolve has no partially covered side";
+            else if ( Spread && MSAAOutput != Output )
+                pBroken = "the output differs from Apply on the resolve";
+            if ( pBroken )
+            {
+                printf( "Scene %s, %s: %s\n", Scenes[s].pName, Spread ? "spread" : "multisampled", pBroken );
+                return 1;
+            }
+        }
+    }
+    if ( !nDropped )
+    {
+        printf( "The multisampled scenes have no edge between fully covered pixels\n" );
+        return 1;
+    }
+
+    printf( "%d scenes of %dx%d with %d samples per pixel\n\n", (int)Scenes.size(), Size, Size, kMSAASamples );
+    printf( "%-28s %10s\n", "", "ms" );
+    printf( "%-28s %10.2f\n", "ApplyMSAA", MSAAMs );
+    printf( "%-28s %10.2f\n", "Apply on the resolve", ResolvedMs );
+    printf( "\nOf the edges of the resolves %llu are kept and the %llu between fully covered pixels dropped.\n"
+            "Where every edge has a partially covered side the output is that of Apply on the resolve\n",
+            (unsigned long long)nKept, (unsigned long long)nDropped );
+    return 0;
+}
+
+static int RunPareto( int argc, char* argv[] )
+{
+    const char* pOutput = "MLAA11_Pareto.csv";
+    int Size = 512;
+    int nReps = 5;
+    bool bAll = false;
+    double MinPSNR = 0.0, MinSSIM = 0.0;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-o" ) && bHasValue )                pOutput = argv[++i];
+        else if ( !strcmp( argv[i], "-size" ) && bHasValue )        Size = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )        nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-min-psnr" ) && bHasValue )    MinPSNR = atof( argv[++i] );
+        else if ( !strcmp( argv[i], "-min-ssim" ) && bHasValue )    MinSSIM = atof( argv[++i] );
+        else if ( !strcmp( argv[i], "-all" ) )                      bAll = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Size < 16 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<Scene> Scenes;
+    BuildScenes( Size, Scenes );
+    const size_t nScenes = Scenes.size();
+    std::vector< std::vector<uint8_t> > Aliased( nScenes ), Reference( nScenes );
+    for ( size_t s = 0; s < nScenes; s++ )
+    {
+        RenderScene( Scenes[s], Size, 1, Aliased[s] );
+        RenderScene( Scenes[s], Size, kReferenceSamples, Reference[s] );
+    }
+
+    const double nPixels = (double)Size * (double)Size * (double)nScenes;
+    std::vector<uint8_t> Output( (size_t)Size * Size * 4 );
+    std::vector<Result> Results;
+
+    Result Off = { 0, 0, 0.0, 0.0, 0.0, false };
+    double OffError = 0.0;
+    for ( size_t s = 0; s < nScenes; s++ )
+    {
+        OffError += SquaredError( Aliased[s], Reference[s] );
+        Off.SSIM += SSIM( Aliased[s], Reference[s], Size ) / (double)nScenes;
+    }
+    Off.PSNR = ToPSNR( OffError, nPixels * 3.0 );
+    Results.push_back( Off );
+
+    MLAA::CPUEngine Engine;
+    uint64_t nSteadyStateAllocations = 0;
+    for ( size_t b = 0; b < sizeof( kEdgeCountBits ) / sizeof( kEdgeCountBits[0] ); b++ )
+    {
+        Engine.SetEdgeSearch( kEdgeCountBits[b] == (int)MLAA::kNumCountBits ? MLAA::EDGE_SEARCH_SHORT : MLAA::EDGE_SEARCH_LONG );
+        for ( int t = kMinThresholdSlider; t <= kMaxThresholdSlider; t++ )
+        {
+            Engine.SetThreshold( 1.0f / (float)t );
+
+            Result R = { kEdgeCountBits[b], t, 0.0, 0.0, 0.0, false };
+            double Error = 0.0, TimeMs = 0.0;
+            for ( size_t s = 0; s < nScenes; s++ )
+            {
+                MLAA::Surface Src = { &Aliased[s][0], Size, Size, Size * 4 };
+                MLAA::Surface Dst = { &Output[0], Size, Size, Size * 4 };
+                double BestMs = 0.0;
+                for ( int r = 0; r < nReps; r++ )
+                {
+                    uint64_t nAllocations = g_nHeapAllocations;
+                    double StartTime = MLAA::GetTimeMs();
+                    Engine.Apply( Src, Dst );
+                    double Ms = MLAA::GetTimeMs() - StartTime;
+                    BestMs = ( r == 0 ) ? Ms : std::min( BestMs, Ms );
+                    if ( r > 0 )
+                        nSteadyStateAllocations += g_nHeapAllocations - nAllocations;
+                }
+                TimeMs += BestMs;
+                Error += SquaredError( Output, Reference[s] );
+                R.SSIM += SSIM( Output, Reference[s], Size ) / (double)nScenes;
+            }
+            R.NsPerPixel = TimeMs * 1000000.0 / nPixels;
+            R.PSNR = ToPSNR( Error, nPixels * 3.0 );
+            Results.push_back( R );
+        }
+        printf( "%d bit edge counts done\n", kEdgeCountBits[b] );
+    }
+
+    for ( size_t i = 0; i < Results.size(); i++ )
+    {
+        Results[i].bPareto = true;
+        for ( size_t j = 0; j < Results.size() && Results[i].bPareto; j++ )
+            Results[i].bPareto = !Dominates( Results[j], Results[i] );
+    }
+    std::stable_sort( Results.begin(), Results.end(), FasterFirst );
+
+    FILE* pFile = fopen( pOutput, "w" );
+    if ( pFile == NULL )
+    {
+        printf( "Could not open %s\n", pOutput );
+        return 1;
+    }
+    fprintf( pFile, "edge_count_bits,threshold_slider,threshold,ns_per_pixel,psnr_db,ssim,pareto\n" );
+    for ( size_t i = 0; i < Results.size(); i++ )
+    {
+        const Result& R = Results[i];
+        if ( !bAll && !R.bPareto )
+            continue;
+        fprintf( pFile, "%d,%d,%.6f,%.3f,%.3f,%.5f,%d\n", R.EdgeCountBits, R.ThresholdSlider,
+                 R.ThresholdSlider ? 1.0 / R.ThresholdSlider : 0.0, R.NsPerPixel, R.PSNR, R.SSIM, R.bPareto ? 1 : 0 );
+    }
+    fclose( pFile );
+    printf( "%d scenes of %dx%d, reference %dx supersampled, wrote %s\n", (int)nScenes, Size, Size,
+            kReferenceSamples * kReferenceSamples, pOutput );
+    printf( "Scratch: %.1f MB held, %.1f MB high water, %llu heap allocations, %llu in timed runs\n",
+            Engine.GetScratchBytes() / 1048576.0, Engine.GetScratchHighWater() / 1048576.0,
+            (unsigned long long)Engine.GetScratchAllocations(), (unsigned long long)nSteadyStateAllocations );
+    if ( nSteadyStateAllocations != 0 )
+    {
+        printf( "The timed runs allocated heap memory\n" );
+        return 1;
+    }
+
+    // Results are sorted by cost, the first one that meets the bar is the cheapest
+    if ( MinPSNR > 0.0 || MinSSIM > 0.0 )
+    {
+        for ( size_t i = 0; i < Results.size(); i++ )
+        {
+            const Result& R = Results[i];
+            if ( R.PSNR >= MinPSNR && R.SSIM >= MinSSIM )
+            {
+                printf( "Cheapest: MAX_EDGE_COUNT_BITS %d, threshold slider %d, %.3f ns/pixel, %.3f dB, SSIM %.5f\n",
+                        R.EdgeCountBits, R.ThresholdSlider, R.NsPerPixel, R.PSNR, R.SSIM );
+                return 0;
+            }
+        }
+        printf( "No configuration meets the quality bar\n" );
+    }
+    return 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Subcommands take their own options, without one the Pareto sweep runs
+//--------------------------------------------------------------------------------------
+struct Command
+{
+    const char*     pName;
+    int             (*pRun)( int argc, char* argv[] );
+};
+
+static const Command kCommands[] =
+{
+    { "queue-depth",     RunQueueDepth },
+    { "resize-storm",    RunResizeStorm },
+    { "region",          RunRegion },
+    { "views",           RunViews },
+    { "half-res",        RunHalfRes },
+    { "quality-map",     RunQualityMap },
+    { "long-search",     RunLongSearch },
+    { "vertical-search", RunVerticalSearch },
+    { "quad-kernel",     RunQuadKernel },
+    { "blend-math",      RunBlendMath },
+    { "planar",          RunPlanar },
+    { "effect",          RunEffect },
+    { "governor",        RunGovernor },
+    { "hdr",             RunHDR },
+    { "msaa",            RunMSAA },
+};
+
+int main( int argc, char* argv[] )
+{
+    for ( size_t i = 0; argc > 1 && i < sizeof( kCommands ) / sizeof( kCommands[0] ); i++ )
+    {
+        if ( !strcmp( argv[1], kCommands[i].pName ) )
+            return kCommands[i].pRun( argc - 1, argv + 1 );
+    }
+    return RunPareto( argc, argv );
+}
@@ -0,0 +1,253 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_Chain.cpp
+//
+// Measures the detection work a second filter saves by reading the edges of MLAA through
+// CPUEngine::GetEdgeView instead of finding them again. The chain is MLAA followed by a
+// sharpen that doesn't sharpen across the lines MLAA smoothed. Run on its own the sharpen
+// needs the first two passes of an engine of its own on the input, in the chain it reads
+// the intermediates of the MLAA engine in place. Both chains must give the same image.
+//
+// Usage: MLAA11_Chain [-size WxH] [-reps N] [-long]
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_CPU.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Edges that belong to a line at least this long stop the sharpen, shorter ones are
+// texture and are sharpened through
+static const unsigned int kMinLineLength       = 3;
+
+// Strength of the sharpen in 1/16ths of the difference of a pixel with its neighbours
+static const int          kSharpenAmount       = 6;
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_Chain [-size WxH] [-reps N] [-long]\n"
+             "  -size      Image size, default 3840x2160\n"
+             "  -reps      Timed runs of each chain, the fastest is reported, default 5\n"
+             "  -long      Long edge searches\n" );
+}
+
+//--------------------------------------------------------------------------------------
+// Overlapping discs and slanted stripes in flat colors, with the luma in alpha, and
+// some noise for the sharpen to work on
+//--------------------------------------------------------------------------------------
+static void FillImage( const MLAA::Surface& Image )
+{
+    uint32_t Seed = 1;
+    for ( int y = 0; y < Image.Height; y++ )
+    {
+        uint8_t* pRow = Image.pData + (size_t)y * Image.Pitch;
+        for ( int x = 0; x < Image.Width; x++ )
+        {
+            int dx = ( x % 701 ) - 350;
+            int dy = ( y % 577 ) - 288;
+            bool bDisc = dx * dx + dy * dy < 250 * 250;
+            bool bStripe = ( ( x * 5 + y * 3 ) / 97 ) & 1;
+
+            Seed = Seed * 1664525u + 1013904223u;
+            int Noise = (int)( Seed >> 29 );
+
+            uint8_t Color[3] = { (uint8_t)( ( bDisc ? 230 : 40 ) + Noise ), (uint8_t)( ( bStripe ? 200 : 70 ) + Noise ),
+                                 (uint8_t)( ( ( bDisc != bStripe ) ? 180 : 20 ) + Noise ) };
+            pRow[x * 4 + 0] = Color[0];
+            pRow[x * 4 + 1] = Color[1];
+            pRow[x * 4 + 2] = Color[2];
+            pRow[x * 4 + 3] = (uint8_t)( ( Color[0] * 77 + Color[1] * 150 + Color[2] * 29 ) >> 8 );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// The second filter. Each neighbour across an edge of a line is replaced by the pixel
+// itself, so the anti-aliased lines get no halo. Edges cover the whole image
+//--------------------------------------------------------------------------------------
+static inline bool IsLine( const MLAA::EdgeView& Edges, int x, int y, MLAA::EDGE_DIRECTION Direction )
+{
+    static const unsigned int DirectionMask[2] = { MLAA::kUpperMask, MLAA::kRightMask };
+    if ( !( Edges.GetEdges( x, y ) & DirectionMask[Direction] ) )
+        return false;
+
+    MLAA::EdgeSpan Span = Edges.GetSpan( x, y, Direction );
+    return Span.NegLength + Span.PosLength + 1 >= kMinLineLength;
+}
+
+static void SharpenOffLines( const MLAA::Surface& Src, const MLAA::Surface& Dst, const MLAA::EdgeView& Edges )
+{
+    for ( int y = 0; y < Src.Height; y++ )
+    {
+        const uint8_t* pRow = Src.pData + (size_t)y * Src.Pitch;
+        const uint8_t* pUp = ( y > 0 ) ? pRow - Src.Pitch : pRow;
+        const uint8_t* pDown = ( y + 1 < Src.Height ) ? pRow + Src.Pitch : pRow;
+        uint8_t* pDst = Dst.pData + (size_t)y * Dst.Pitch;
+
+        for ( int x = 0; x < Src.Width; x++ )
+        {
+            const uint8_t* pCenter = pRow + x * 4;
+            const uint8_t* pNeighbours[4] =
+            {
+                IsLine( Edges, x, y, MLAA::EDGE_HORIZONTAL ) ? pCenter : pUp + x * 4,
+                ( y + 1 < Src.Height && IsLine( Edges, x, y + 1, MLAA::EDGE_HORIZONTAL ) ) ? pCenter : pDown + x * 4,
+                ( x > 0 && !IsLine( Edges, x - 1, y, MLAA::EDGE_VERTICAL ) ) ? pCenter - 4 : pCenter,
+                ( x + 1 < Src.Width && !IsLine( Edges, x, y, MLAA::EDGE_VERTICAL ) ) ? pCenter + 4 : pCenter
+            };
+
+            for ( int c = 0; c < 4; c++ )
+            {
+                int Center = pCenter[c];
+                int Sum = pNeighbours[0][c] + pNeighbours[1][c] + pNeighbours[2][c] + pNeighbours[3][c];
+                int Value = Center + ( ( 4 * Center - Sum ) * kSharpenAmount ) / 16;
+                pDst[x * 4 + c] = (uint8_t)( Value < 0 ? 0 : ( Value > 255 ? 255 : Value ) );
+            }
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Times of one run of a chain, in milliseconds
+//--------------------------------------------------------------------------------------
+struct ChainTime
+{
+    double      fMLAA;
+    double      fDetection;         // Edges found again by the second filter
+    double      fSharpen;
+    double      fTotal;
+};
+
+static void KeepFastest( const ChainTime& Time, ChainTime& Best )
+{
+    if ( Time.fTotal < Best.fTotal )
+        Best = Time;
+}
+
+int main( int argc, char* argv[] )
+{
+    int Width = 3840, Height = 2160, nReps = 5;
+    bool bLong = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )
+        {
+            const char* pSize = argv[++i];
+            const char* pHeight = strchr( pSize, 'x' );
+            Width = atoi( pSize );
+            Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        }
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )           nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-long" ) )                        bLong = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Width <= 0 || Height <= 0 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t nBytes = (size_t)Width * Height * 4;
+    std::vector<uint8_t> Input( nBytes ), Smoothed( nBytes ), Output( nBytes ), Reference( nBytes );
+    MLAA::Surface InputSurface = { &Input[0], Width, Height, Width * 4 };
+    MLAA::Surface SmoothedSurface = { &Smoothed[0], Width, Height, Width * 4 };
+    MLAA::Surface OutputSurface = { &Output[0], Width, Height, Width * 4 };
+    MLAA::Surface ReferenceSurface = { &Reference[0], Width, Height, Width * 4 };
+    FillImage( InputSurface );
+
+    const MLAA::EDGE_SEARCH Search = bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT;
+    MLAA::CPUEngine Engine, FilterEngine;
+    Engine.SetEdgeSearch( Search );
+    FilterEngine.SetEdgeSearch( Search );
+
+    // The first run of each chain sizes the scratch of the engines and is not timed
+    ChainTime Separate = { 0.0, 0.0, 0.0, 1e30 }, Shared = { 0.0, 0.0, 0.0, 1e30 };
+    for ( int Rep = 0; Rep <= nReps; Rep++ )
+    {
+        // The sharpen finds the edges on its own
+        ChainTime Time;
+        double StartTime = MLAA::GetTimeMs();
+        Engine.Apply( InputSurface, SmoothedSurface );
+        double MLAATime = MLAA::GetTimeMs();
+        FilterEngine.DetectEdges( InputSurface );
+        FilterEngine.ComputeLineLength();
+        double DetectionTime = MLAA::GetTimeMs();
+        SharpenOffLines( SmoothedSurface, ReferenceSurface, FilterEngine.GetEdgeView() );
+        double EndTime = MLAA::GetTimeMs();
+
+        Time.fMLAA = MLAATime - StartTime;
+        Time.fDetection = DetectionTime - MLAATime;
+        Time.fSharpen = EndTime - DetectionTime;
+        Time.fTotal = EndTime - StartTime;
+        if ( Rep > 0 )
+            KeepFastest( Time, Separate );
+
+        // The sharpen reads the edges of the MLAA engine
+        StartTime = MLAA::GetTimeMs();
+        Engine.Apply( InputSurface, SmoothedSurface );
+        MLAATime = MLAA::GetTimeMs();
+        MLAA::EdgeView Edges = Engine.GetEdgeView();
+        SharpenOffLines( SmoothedSurface, OutputSurface, Edges );
+        EndTime = MLAA::GetTimeMs();
+
+        Time.fMLAA = MLAATime - StartTime;
+        Time.fDetection = 0.0;
+        Time.fSharpen = EndTime - MLAATime;
+        Time.fTotal = EndTime - StartTime;
+        if ( Rep > 0 )
+            KeepFastest( Time, Shared );
+
+        if ( Edges.pEdgeMask != Engine.GetEdgeMask() )
+        {
+            fprintf( stderr, "The edge view is a copy of the intermediates\n" );
+            return 1;
+        }
+        if ( Output != Reference )
+        {
+            fprintf( stderr, "The chain that shares the edges differs from the one that detects them again\n" );
+            return 1;
+        }
+    }
+
+    const MLAA::EdgeView Edges = Engine.GetEdgeView();
+    printf( "%dx%d, %s edge search, %d byte counts, fastest of %d runs\n", Width, Height, bLong ? "long" : "short",
+            Edges.CountBytes, nReps );
+    printf( "\n%-16s %10s %10s %10s %10s\n", "Chain", "MLAA ms", "Detect ms", "Sharpen ms", "Total ms" );
+    printf( "%-16s %10.2f %10.2f %10.2f %10.2f\n", "Detect again", Separate.fMLAA, Separate.fDetection, Separate.fSharpen, Separate.fTotal );
+    printf( "%-16s %10.2f %10.2f %10.2f %10.2f\n", "Shared edges", Shared.fMLAA, Shared.fDetection, Shared.fSharpen, Shared.fTotal );
+    printf( "\nSharing the edges saves %.2f ms, %.1f%% of the chain, and %.1f MB of intermediates\n",
+            Separate.fTotal - Shared.fTotal, 100.0 * ( Separate.fTotal - Shared.fTotal ) / Separate.fTotal,
+            (double)FilterEngine.GetScratchBytes() / ( 1024.0 * 1024.0 ) );
+    printf( "Both chains give the same image\n" );
+    return 0;
+}
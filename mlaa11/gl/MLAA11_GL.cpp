@@ -0,0 +1,280 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_GL.cpp
+//
+// Runs MLAA::Effect on the OpenGL backend in a surfaceless EGL context, e.g. Mesa
+// llvmpipe without a display, and checks the edge mask, the edge counts and the output
+// against CPUEngine::Apply. They must match bit for bit, for both detection kernels and
+// for a second size whose rows are not a multiple of 4 bytes. Then reports the fastest
+// of the timed runs with the three pass breakdown of the GL_TIME_ELAPSED queries.
+// Linux only.
+//
+// Usage: MLAA11_GL [-size WxH] [-reps N] [-shaders File]
+//--------------------------------------------------------------------------------------
+
+#define GL_GLEXT_PROTOTYPES
+#include "MLAA_CPU.h"
+#include "MLAA_GL.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_GL [-size WxH] [-reps N] [-shaders File]\n"
+             "  -size      Image size, at least 64x64, default 1280x720\n"
+             "  -reps      Timed runs, the fastest is reported, default 5\n"
+             "  -shaders   MLAA11.glsl, default ../src/Shaders/MLAA11.glsl from the bin directory\n" );
+}
+
+//--------------------------------------------------------------------------------------
+// Overlapping discs and slanted stripes in flat colors, with the luma in alpha, and
+// some noise so the edges vary in length
+//--------------------------------------------------------------------------------------
+static void FillImage( const MLAA::Surface& Image )
+{
+    uint32_t Seed = 1;
+    for ( int y = 0; y < Image.Height; y++ )
+    {
+        uint8_t* pRow = Image.pData + (size_t)y * Image.Pitch;
+        for ( int x = 0; x < Image.Width; x++ )
+        {
+            int dx = ( x % 301 ) - 150;
+            int dy = ( y % 257 ) - 128;
+            bool bDisc = dx * dx + dy * dy < 110 * 110;
+            bool bStripe = ( ( x * 5 + y * 3 ) / 41 ) & 1;
+
+            Seed = Seed * 1664525u + 1013904223u;
+            int Noise = (int)( Seed >> 27 );
+
+            uint8_t Color[3] = { (uint8_t)( ( bDisc ? 220 : 40 ) + Noise ), (uint8_t)( ( bStripe ? 200 : 70 ) + Noise ),
+                                 (uint8_t)( ( ( bDisc != bStripe ) ? 180 : 20 ) + Noise ) };
+            pRow[x * 4 + 0] = Color[0];
+            pRow[x * 4 + 1] = Color[1];
+            pRow[x * 4 + 2] = Color[2];
+            pRow[x * 4 + 3] = (uint8_t)( ( Color[0] * 77 + Color[1] * 150 + Color[2] * 29 ) >> 8 );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Reads a level 0 texture back, rows tightly packed
+//--------------------------------------------------------------------------------------
+static void ReadTexture( GLuint Texture, GLenum Format, GLenum Type, std::vector<uint8_t>& Data )
+{
+    glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+    glBindTexture( GL_TEXTURE_2D, Texture );
+    glGetTexImage( GL_TEXTURE_2D, 0, Format, Type, &Data[0] );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+static bool Compare( const char* pName, const std::vector<uint8_t>& Data, const uint8_t* pReference, int Width, int Height, int PixelBytes )
+{
+    for ( size_t i = 0; i < Data.size(); i++ )
+    {
+        if ( Data[i] != pReference[i] )
+        {
+            size_t Pixel = i / PixelBytes;
+            fprintf( stderr, "%dx%d: the %s differs from CPUEngine at %d,%d: %u instead of %u\n", Width, Height, pName,
+                     (int)( Pixel % Width ), (int)( Pixel / Width ), Data[i], pReference[i] );
+            return false;
+        }
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Input and output textures of one size, the input filled with the fixture
+//--------------------------------------------------------------------------------------
+struct Frame
+{
+    int                     Width;
+    int                     Height;
+    std::vector<uint8_t>    Input;
+    GLuint                  Textures[2];
+
+    MLAA::EffectSurface GetInput() const { return MLAA::GLBackend::MakeSurface( Textures[0], Width, Height ); }
+    MLAA::EffectSurface GetOutput() const { return MLAA::GLBackend::MakeSurface( Textures[1], Width, Height ); }
+};
+
+static void CreateFrame( Frame& F, int Width, int Height )
+{
+    F.Width = Width;
+    F.Height = Height;
+    F.Input.resize( (size_t)Width * Height * 4 );
+    MLAA::Surface Input = { &F.Input[0], Width, Height, Width * 4 };
+    FillImage( Input );
+
+    glGenTextures( 2, F.Textures );
+    for ( int i = 0; i < 2; i++ )
+    {
+        glBindTexture( GL_TEXTURE_2D, F.Textures[i] );
+        glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8, Width, Height );
+    }
+    glBindTexture( GL_TEXTURE_2D, F.Textures[0] );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexSubImage2D( GL_TEXTURE_2D, 0, 0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, &F.Input[0] );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+}
+
+static void ReleaseFrame( Frame& F )
+{
+    glDeleteTextures( 2, F.Textures );
+    F.Textures[0] = F.Textures[1] = 0;
+}
+
+//--------------------------------------------------------------------------------------
+// One frame through the effect and through the engine with the same settings
+//--------------------------------------------------------------------------------------
+static bool CheckFrame( MLAA::Effect& Effect, MLAA::GLBackend& Backend, const Frame& F, MLAA::DETECTION_KERNEL Kernel )
+{
+    Effect.SetDetectionKernel( Kernel );
+    if ( !Effect.Apply( F.GetInput(), F.GetOutput() ) )
+    {
+        fprintf( stderr, "%dx%d: the OpenGL backend failed the frame\n", F.Width, F.Height );
+        return false;
+    }
+
+    const size_t nPixels = (size_t)F.Width * F.Height;
+    std::vector<uint8_t> Output( nPixels * 4 ), EdgeMask( nPixels ), EdgeCount( nPixels * 2 );
+    ReadTexture( (GLuint)(uintptr_t)F.GetOutput().pHandle, GL_RGBA, GL_UNSIGNED_BYTE, Output );
+    ReadTexture( Backend.GetEdgeMask(), GL_RED_INTEGER, GL_UNSIGNED_BYTE, EdgeMask );
+    ReadTexture( Backend.GetEdgeCount(), GL_RG_INTEGER, GL_UNSIGNED_BYTE, EdgeCount );
+    if ( glGetError() != GL_NO_ERROR )
+    {
+        fprintf( stderr, "%dx%d: OpenGL error\n", F.Width, F.Height );
+        return false;
+    }
+
+    std::vector<uint8_t> Input( F.Input ), Reference( nPixels * 4 );
+    MLAA::Surface Src = { &Input[0], F.Width, F.Height, F.Width * 4 };
+    MLAA::Surface Dst = { &Reference[0], F.Width, F.Height, F.Width * 4 };
+    MLAA::CPUEngine Engine;
+    Engine.SetThreshold( Effect.GetThreshold() );
+    Engine.SetDetectionKernel( Kernel );
+    Engine.Apply( Src, Dst );
+
+    return Compare( "edge mask", EdgeMask, Engine.GetEdgeMask(), F.Width, F.Height, 1 ) &&
+           Compare( "edge count", EdgeCount, Engine.GetEdgeCount(), F.Width, F.Height, 2 ) &&
+           Compare( "output", Output, &Reference[0], F.Width, F.Height, 4 );
+}
+
+int main( int argc, char* argv[] )
+{
+    int Width = 1280, Height = 720, nReps = 5;
+    const char* pShaderFile = "../src/Shaders/MLAA11.glsl";
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )
+        {
+            const char* pSize = argv[++i];
+            const char* pHeight = strchr( pSize, 'x' );
+            Width = atoi( pSize );
+            Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        }
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )           nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-shaders" ) && bHasValue )        pShaderFile = argv[++i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Width < 64 || Height < 64 || nReps < 1 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    MLAA::GLContext Context;
+    if ( !Context.Create() )
+    {
+        fprintf( stderr, "No OpenGL 3.3 core context on the surfaceless EGL platform\n" );
+        return 1;
+    }
+
+    MLAA::GLBackend Backend;
+    if ( !Backend.CreateShaders( pShaderFile ) )
+    {
+        fprintf( stderr, "%s\n", Backend.GetShaderLog().c_str() );
+        return 1;
+    }
+    MLAA::Effect Effect( &Backend );
+
+    // The second size has rows of an odd number of pixels
+    Frame Frames[2];
+    CreateFrame( Frames[0], Width, Height );
+    CreateFrame( Frames[1], Width - 37, Height - 23 );
+
+    bool bMatch = true;
+    for ( int i = 0; i < 2 && bMatch; i++ )
+    {
+        bMatch = CheckFrame( Effect, Backend, Frames[i], MLAA::DETECTION_KERNEL_PIXEL ) &&
+                 CheckFrame( Effect, Backend, Frames[i], MLAA::DETECTION_KERNEL_QUAD );
+    }
+
+    // Each run waits for the queries, so the pass times are those of that run
+    double PassTime[MLAA::PASS_COUNT] = { 0.0, 0.0, 0.0 };
+    double BestTime = 1e30;
+    Effect.SetDetectionKernel( MLAA::DETECTION_KERNEL_PIXEL );
+    for ( int Rep = 0; Rep <= nReps && bMatch; Rep++ )
+    {
+        double StartTime = MLAA::GetTimeMs();
+        Effect.Apply( Frames[0].GetInput(), Frames[0].GetOutput() );
+        glFinish();
+        double Time = MLAA::GetTimeMs() - StartTime;
+
+        // The first run creates the intermediates of the size and is not timed
+        if ( Rep > 0 && Time < BestTime )
+        {
+            BestTime = Time;
+            for ( int Pass = 0; Pass < MLAA::PASS_COUNT; Pass++ )
+                PassTime[Pass] = Effect.GetPassTime( (MLAA::PASS)Pass );
+        }
+    }
+
+    const char* pRenderer = (const char*)glGetString( GL_RENDERER );
+    Effect.ReleaseIntermediates();
+    for ( int i = 0; i < 2; i++ )
+        ReleaseFrame( Frames[i] );
+    Backend.ReleaseShaders();
+    if ( !bMatch )
+        return 1;
+
+    printf( "%s, %dx%d, fastest of %d runs\n", pRenderer, Width, Height, nReps );
+    printf( "\n%-22s %10s\n", "Pass", "ms" );
+    printf( "%-22s %10.3f\n", "Detect edges", PassTime[MLAA::PASS_DETECT_EDGES] );
+    printf( "%-22s %10.3f\n", "Compute line length", PassTime[MLAA::PASS_COMPUTE_LINE_LENGTH] );
+    printf( "%-22s %10.3f\n", "Blend color", PassTime[MLAA::PASS_BLEND_COLOR] );
+    printf( "%-22s %10.3f\n", "Frame", BestTime );
+    printf( "\nThe edges and output match CPUEngine::Apply at %dx%d and %dx%d with both detection kernels\n",
+            Frames[0].Width, Frames[0].Height, Frames[1].Width, Frames[1].Height );
+    return 0;
+}
@@ -0,0 +1,186 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_NUMA.cpp
+//
+// Measures MLAA on a very large image with and without NUMA node locality. The same
+// NUMAEngine runs twice: with pinned threads and bands allocated on their nodes, then
+// with unpinned threads and the whole image allocated by the main thread, the layout of
+// one giant frame on one node. The outputs of the two runs must match, and with -verify
+// also match a single CPUEngine on the whole image.
+//
+// Usage: MLAA11_NUMA [-size WxH] [-reps N] [-threads N] [-long] [-verify]
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_NUMA.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_NUMA [-size WxH] [-reps N] [-threads N] [-long] [-verify]\n"
+             "  -size      Image size, default 16384x16384\n"
+             "  -reps      Timed runs per mode, the fastest is reported, default 5\n"
+             "  -threads   Threads per node, default one per processor\n"
+             "  -long      Long edge searches, with a halo of kLongRegionHalo rows\n"
+             "  -verify    Also compare with a single engine on the whole image\n" );
+}
+
+//--------------------------------------------------------------------------------------
+// Overlapping discs and slanted stripes in flat colors, with the luma in alpha
+//--------------------------------------------------------------------------------------
+static void FillImage( const MLAA::Surface& Image )
+{
+    for ( int y = 0; y < Image.Height; y++ )
+    {
+        uint8_t* pRow = Image.pData + (size_t)y * Image.Pitch;
+        for ( int x = 0; x < Image.Width; x++ )
+        {
+            int dx = ( x % 701 ) - 350;
+            int dy = ( y % 577 ) - 288;
+            bool bDisc = dx * dx + dy * dy < 250 * 250;
+            bool bStripe = ( ( x * 5 + y * 3 ) / 97 ) & 1;
+
+            uint8_t Color[3] = { (uint8_t)( bDisc ? 230 : 40 ), (uint8_t)( bStripe ? 200 : 70 ), (uint8_t)( ( bDisc != bStripe ) ? 180 : 20 ) };
+            pRow[x * 4 + 0] = Color[0];
+            pRow[x * 4 + 1] = Color[1];
+            pRow[x * 4 + 2] = Color[2];
+            pRow[x * 4 + 3] = (uint8_t)( ( Color[0] * 77 + Color[1] * 150 + Color[2] * 29 ) >> 8 );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Runs one mode, returns the fastest time and leaves the output in Output
+//--------------------------------------------------------------------------------------
+static double RunMode( bool bNodeLocal, int nThreadsPerNode, bool bLong, int nReps, const MLAA::Surface& Input,
+                       const MLAA::Surface& Output )
+{
+    MLAA::NUMAEngine Engine( bNodeLocal, nThreadsPerNode );
+    Engine.SetEdgeSearch( bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+
+    MLAA::NUMAFrame Src, Dst;
+    Engine.CreateFrame( Input.Width, Input.Height, Src );
+    Engine.CreateFrame( Input.Width, Input.Height, Dst );
+    Src.CopyFrom( Input );
+
+    // The first run allocates the intermediates of the threads
+    Engine.Apply( Src, Dst );
+
+    double fBest = 0.0, fHalo = 0.0;
+    for ( int r = 0; r < nReps; r++ )
+    {
+        double StartTime = MLAA::GetTimeMs();
+        Engine.Apply( Src, Dst );
+        double fTime = MLAA::GetTimeMs() - StartTime;
+        if ( r == 0 || fTime < fBest )
+        {
+            fBest = fTime;
+            fHalo = Engine.GetHaloTime();
+        }
+    }
+    Dst.CopyTo( Output );
+
+    const double fMPixels = (double)Input.Width * Input.Height / 1.0e6;
+    printf( "%-12s %5d %7d %10.2f %9.3f %10.1f\n", bNodeLocal ? "node local" : "single node", Engine.GetNodeCount(),
+            Engine.GetThreadCount(), fBest, fHalo, fMPixels / ( fBest / 1000.0 ) );
+    return fBest;
+}
+
+int main( int argc, char* argv[] )
+{
+    int Width = 16384, Height = 16384;
+    int nReps = 5, nThreadsPerNode = 0;
+    bool bLong = false, bVerify = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )
+        {
+            const char* pSize = argv[++i];
+            const char* pHeight = strchr( pSize, 'x' );
+            Width = atoi( pSize );
+            Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        }
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )           nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-threads" ) && bHasValue )        nThreadsPerNode = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-long" ) )                        bLong = true;
+        else if ( !strcmp( argv[i], "-verify" ) )                      bVerify = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Width <= 0 || Height <= 0 || nReps < 1 || nThreadsPerNode < 0 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t nBytes = (size_t)Width * Height * 4;
+    std::vector<uint8_t> Input( nBytes ), LocalOutput( nBytes ), SingleNodeOutput( nBytes );
+    MLAA::Surface InputSurface = { &Input[0], Width, Height, Width * 4 };
+    MLAA::Surface LocalSurface = { &LocalOutput[0], Width, Height, Width * 4 };
+    MLAA::Surface SingleNodeSurface = { &SingleNodeOutput[0], Width, Height, Width * 4 };
+    FillImage( InputSurface );
+
+    std::vector<MLAA::NUMANodeInfo> Nodes;
+    MLAA::GetNUMANodes( Nodes );
+    printf( "%dx%d, %s edge search\n", Width, Height, bLong ? "long" : "short" );
+    for ( size_t n = 0; n < Nodes.size(); n++ )
+        printf( "Node %d: %d processors\n", Nodes[n].Node, Nodes[n].nProcessors );
+    printf( "\n%-12s %5s %7s %10s %9s %10s\n", "Mode", "Nodes", "Threads", "Apply ms", "Halo ms", "MPixels/s" );
+
+    double fLocal = RunMode( true, nThreadsPerNode, bLong, nReps, InputSurface, LocalSurface );
+    double fSingleNode = RunMode( false, nThreadsPerNode, bLong, nReps, InputSurface, SingleNodeSurface );
+    printf( "\nNode locality speedup: %.2fx\n", fSingleNode / fLocal );
+
+    if ( LocalOutput != SingleNodeOutput )
+    {
+        fprintf( stderr, "The outputs of the two modes differ\n" );
+        return 1;
+    }
+
+    if ( bVerify )
+    {
+        std::vector<uint8_t> Reference( nBytes );
+        MLAA::Surface ReferenceSurface = { &Reference[0], Width, Height, Width * 4 };
+        MLAA::CPUEngine Engine;
+        Engine.SetEdgeSearch( bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+        Engine.Apply( InputSurface, ReferenceSurface );
+
+        if ( LocalOutput != Reference )
+        {
+            fprintf( stderr, "The output differs from a single engine on the whole image\n" );
+            return 1;
+        }
+        printf( "Matches a single engine on the whole image\n" );
+    }
+    return 0;
+}
@@ -65,3 +65,204 @@ project (_AMD_SAMPLE_NAME)
       flags { "LinkTimeOptimization", "Symbols", "FatalWarnings", "Unicode", "WinMain" }
       targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
       optimize "On"
+
+-- Quality against cost of the CPU MLAA settings, writes a CSV Pareto frontier
+project (_AMD_SAMPLE_NAME .. "_Benchmark")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_Benchmark" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/Benchmark"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../benchmark/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp",
+           "../src/MLAA_CPUQueue.h", "../src/MLAA_CPUQueue.cpp", "../src/MLAA_SurfacePool.h", "../src/MLAA_SurfacePool.cpp",
+           "../src/MLAA_Effect.h", "../src/MLAA_Effect.cpp", "../src/MLAA_Governor.h", "../src/MLAA_Governor.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- Streams Y4M or raw video through the CPU MLAA engine
+project (_AMD_SAMPLE_NAME .. "_Sequence")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_Sequence" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/Sequence"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../sequence/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp", "../src/MLAA_Sequence.h", "../src/MLAA_Sequence.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- MLAA on very large images with and without NUMA node locality
+project (_AMD_SAMPLE_NAME .. "_NUMA")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_NUMA" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/NUMA"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../numa/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp", "../src/MLAA_NUMA.h", "../src/MLAA_NUMA.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- MLAA on images split into tiles across worker processes
+project (_AMD_SAMPLE_NAME .. "_Tiled")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_Tiled" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/Tiled"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../tiled/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp", "../src/MLAA_Tiled.h", "../src/MLAA_Tiled.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- MLAA as a shared memory service for client processes
+project (_AMD_SAMPLE_NAME .. "_Service")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_Service" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/Service"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../service/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp", "../src/MLAA_Service.h", "../src/MLAA_Service.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- MLAA followed by a filter that reuses its edges
+project (_AMD_SAMPLE_NAME .. "_Chain")
+   kind "ConsoleApp"
+   language "C++"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_Chain" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/Chain"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   -- Specify WindowsTargetPlatformVersion here for VS2015
+   windowstarget (_AMD_WIN_SDK_VERSION)
+
+   files { "../chain/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp" }
+   includedirs { "../src" }
+
+   filter "configurations:Debug"
+      defines { "WIN32", "_DEBUG", "DEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "WIN32", "NDEBUG", "_CONSOLE", "_CRT_SECURE_NO_WARNINGS" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+
+-- The OpenGL backend on a surfaceless EGL context checked against the CPU engine. Linux
+-- only, e.g. premake5 gmake, and not part of the Visual Studio solutions
+if not string.startswith( _ACTION, "vs" ) then
+project (_AMD_SAMPLE_NAME .. "_GL")
+   kind "ConsoleApp"
+   language "C++"
+   system "Linux"
+   location "../build"
+   filename (_AMD_SAMPLE_NAME .. "_GL" .. _AMD_VS_SUFFIX)
+   targetdir "../bin"
+   objdir "../build/%{_AMD_SAMPLE_DIR_LAYOUT}/GL"
+   warnings "Extra"
+   floatingpoint "Fast"
+
+   files { "../gl/**.cpp", "../src/MLAA_CPU.h", "../src/MLAA_CPU.cpp", "../src/MLAA_Scratch.h", "../src/MLAA_Scratch.cpp",
+           "../src/MLAA_Effect.h", "../src/MLAA_Effect.cpp", "../src/MLAA_GL.h", "../src/MLAA_GL.cpp" }
+   includedirs { "../src" }
+   links { "EGL", "OpenGL", "pthread" }
+
+   filter "configurations:Debug"
+      defines { "_DEBUG", "DEBUG" }
+      flags { "Symbols", "FatalWarnings" }
+      targetsuffix ("_Debug" .. _AMD_VS_SUFFIX)
+
+   filter "configurations:Release"
+      defines { "NDEBUG" }
+      flags { "LinkTimeOptimization", "Symbols", "FatalWarnings" }
+      targetsuffix ("_Release" .. _AMD_VS_SUFFIX)
+      optimize "On"
+end
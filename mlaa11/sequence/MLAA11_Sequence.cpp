@@ -0,0 +1,152 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_Sequence.cpp
+//
+// Anti-aliases a video sequence with the CPU MLAA engine. Frames are streamed from a Y4M
+// or raw planar file through MLAA_Sequence's pipeline, so a long offline render sequence
+// is one invocation that reuses its buffers from frame to frame. The output has the format
+// of the input. A path of "-" reads stdin or writes stdout, for use in a pipe.
+//
+// Usage: MLAA11_Sequence -i input -o output [-raw WxH i420|nv12] [-threshold value]
+//                        [-chroma] [-long] [-frames N]
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Sequence.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_Sequence -i input -o output [-raw WxH i420|nv12] [-threshold value]\n"
+             "                       [-chroma] [-long] [-frames N]\n"
+             "  -i, -o      Y4M files unless -raw is given, - for stdin or stdout\n"
+             "  -raw        Raw planar 4:2:0 frames of the given size and layout\n"
+             "  -threshold  Luma difference that counts as an edge, default 0.0833\n"
+             "  -chroma     Also anti-alias the chroma planes\n"
+             "  -long       Long edge searches\n"
+             "  -frames     Frames in the pipeline, at least 3, default 4\n" );
+}
+
+int main( int argc, char* argv[] )
+{
+    const char* pInput = NULL;
+    const char* pOutput = NULL;
+    const char* pRawSize = NULL;
+    const char* pRawFormat = NULL;
+    float fThreshold = 1.0f / 12.0f;
+    bool bChroma = false, bLong = false;
+    int nFrames = 4;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-i" ) && bHasValue )                    pInput = argv[++i];
+        else if ( !strcmp( argv[i], "-o" ) && bHasValue )               pOutput = argv[++i];
+        else if ( !strcmp( argv[i], "-raw" ) && i + 2 < argc )          { pRawSize = argv[++i]; pRawFormat = argv[++i]; }
+        else if ( !strcmp( argv[i], "-threshold" ) && bHasValue )       fThreshold = (float)atof( argv[++i] );
+        else if ( !strcmp( argv[i], "-frames" ) && bHasValue )          nFrames = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-chroma" ) )                       bChroma = true;
+        else if ( !strcmp( argv[i], "-long" ) )                         bLong = true;
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( !pInput || !pOutput )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    MLAA::SequenceFileReader Reader;
+    MLAA::SequenceFileWriter Writer;
+
+    if ( pRawSize )
+    {
+        MLAA::SequenceInfo Info;
+        const char* pHeight = strchr( pRawSize, 'x' );
+        Info.Width = atoi( pRawSize );
+        Info.Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        Info.Format = !strcmp( pRawFormat, "nv12" ) ? MLAA::PLANAR_FORMAT_NV12 : MLAA::PLANAR_FORMAT_I420;
+        if ( Info.Width <= 0 || Info.Height <= 0 || ( strcmp( pRawFormat, "nv12" ) && strcmp( pRawFormat, "i420" ) ) )
+        {
+            PrintUsage();
+            return 1;
+        }
+        if ( !Reader.OpenRaw( pInput, Info ) )
+        {
+            fprintf( stderr, "Cannot open %s\n", pInput );
+            return 1;
+        }
+        if ( !Writer.OpenRaw( pOutput ) )
+        {
+            fprintf( stderr, "Cannot open %s\n", pOutput );
+            return 1;
+        }
+    }
+    else
+    {
+        if ( !Reader.OpenY4M( pInput ) )
+        {
+            fprintf( stderr, "Cannot open %s or it is not 4:2:0 Y4M\n", pInput );
+            return 1;
+        }
+        if ( !Writer.OpenY4M( pOutput, Reader.GetInfo() ) )
+        {
+            fprintf( stderr, "Cannot open %s\n", pOutput );
+            return 1;
+        }
+    }
+
+    MLAA::SequencePipeline Pipeline;
+    Pipeline.SetFrameCount( nFrames );
+    Pipeline.SetBlendChroma( bChroma );
+    Pipeline.GetEngine().SetThreshold( fThreshold );
+    Pipeline.GetEngine().SetEdgeSearch( bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+
+    bool bSucceeded = Pipeline.Run( Reader, Writer );
+    bSucceeded = Writer.Close() && bSucceeded;
+    Reader.Close();
+
+    const MLAA::SequenceStats& Stats = Pipeline.GetStats();
+    const double nFramesDone = Stats.nFrames ? (double)Stats.nFrames : 1.0;
+    fprintf( stderr, "%llu frames %dx%d in %.1f ms, %.2f ms per frame\n", (unsigned long long)Stats.nFrames,
+             Reader.GetInfo().Width, Reader.GetInfo().Height, Stats.WallTimeMs, Stats.WallTimeMs / nFramesDone );
+    fprintf( stderr, "Busy per frame: read %.2f ms, MLAA %.2f ms (%.2f + %.2f + %.2f), write %.2f ms\n",
+             Stats.ReadTimeMs / nFramesDone, Stats.ProcessTimeMs / nFramesDone,
+             Stats.PassTime[MLAA::PASS_DETECT_EDGES] / nFramesDone, Stats.PassTime[MLAA::PASS_COMPUTE_LINE_LENGTH] / nFramesDone,
+             Stats.PassTime[MLAA::PASS_BLEND_COLOR] / nFramesDone, Stats.WriteTimeMs / nFramesDone );
+
+    if ( !bSucceeded )
+    {
+        fprintf( stderr, "Stopped after a read or write error\n" );
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,377 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_Service.cpp
+//
+// Measures the shared memory MLAA service. By default the tool runs a service and starts
+// client processes that connect to it. Each client measures the round trip of single
+// frames, from submission to completion, then the throughput with every slot of its
+// channel in flight, and checks the frames against a CPUEngine of its own.
+//
+// Usage: MLAA11_Service [-size WxH] [-clients N] [-slots N] [-threads N] [-frames N] [-long]
+//        MLAA11_Service -daemon name [-size WxH] [-clients N] [-slots N] [-threads N] [-long]
+//        MLAA11_Service -client name [-size WxH] [-frames N] [-long]
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Service.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_Service [-size WxH] [-clients N] [-slots N] [-threads N] [-frames N] [-long]\n"
+             "       MLAA11_Service -daemon name [-size WxH] [-clients N] [-slots N] [-threads N] [-long]\n"
+             "       MLAA11_Service -client name [-size WxH] [-frames N] [-long]\n"
+             "  -size      Frame size, and largest frame of a service, default 1920x1080\n"
+             "  -clients   Client processes, and channels of a service, default 2\n"
+             "  -slots     Frames in flight per client, a power of two, default 4\n"
+             "  -threads   Engine threads of the service, default one per processor\n"
+             "  -frames    Frames per client and measurement, default 200\n"
+             "  -long      Long edge searches\n"
+             "  -daemon    Only runs a service with that name, until Enter is pressed\n"
+             "  -client    Only runs a client of the service with that name\n" );
+}
+
+struct Options
+{
+    int         Width;
+    int         Height;
+    int         nClients;
+    int         nSlots;
+    int         nThreads;
+    int         nFrames;
+    bool        bLong;
+};
+
+//--------------------------------------------------------------------------------------
+// Overlapping discs and slanted stripes in flat colors, with the luma in alpha
+//--------------------------------------------------------------------------------------
+static void FillImage( const MLAA::Surface& Image )
+{
+    for ( int y = 0; y < Image.Height; y++ )
+    {
+        uint8_t* pRow = Image.pData + (size_t)y * Image.Pitch;
+        for ( int x = 0; x < Image.Width; x++ )
+        {
+            int dx = ( x % 701 ) - 350;
+            int dy = ( y % 577 ) - 288;
+            bool bDisc = dx * dx + dy * dy < 250 * 250;
+            bool bStripe = ( ( x * 5 + y * 3 ) / 97 ) & 1;
+
+            uint8_t Color[3] = { (uint8_t)( bDisc ? 230 : 40 ), (uint8_t)( bStripe ? 200 : 70 ), (uint8_t)( ( bDisc != bStripe ) ? 180 : 20 ) };
+            pRow[x * 4 + 0] = Color[0];
+            pRow[x * 4 + 1] = Color[1];
+            pRow[x * 4 + 2] = Color[2];
+            pRow[x * 4 + 3] = (uint8_t)( ( Color[0] * 77 + Color[1] * 150 + Color[2] * 29 ) >> 8 );
+        }
+    }
+}
+
+static MLAA::EDGE_SEARCH GetEdgeSearch( const Options& Opt )
+{
+    return Opt.bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT;
+}
+
+//--------------------------------------------------------------------------------------
+// Client: round trips of single frames, then throughput with every slot in flight
+//--------------------------------------------------------------------------------------
+static int RunClient( const char* pName, const Options& Opt )
+{
+    MLAA::ServiceClient Client;
+    if ( !Client.Connect( pName ) )
+    {
+        fprintf( stderr, "Can't connect to service %s, or it has no free channel\n", pName );
+        return 1;
+    }
+    if ( Opt.Width > Client.GetMaxWidth() || Opt.Height > Client.GetMaxHeight() )
+    {
+        fprintf( stderr, "Frames of service %s are at most %dx%d\n", pName, Client.GetMaxWidth(), Client.GetMaxHeight() );
+        return 1;
+    }
+
+    const size_t nBytes = (size_t)Opt.Width * Opt.Height * 4;
+    std::vector<uint8_t> Input( nBytes ), Reference( nBytes );
+    MLAA::Surface InputSurface = { &Input[0], Opt.Width, Opt.Height, Opt.Width * 4 };
+    MLAA::Surface ReferenceSurface = { &Reference[0], Opt.Width, Opt.Height, Opt.Width * 4 };
+    FillImage( InputSurface );
+
+    MLAA::CPUEngine Engine;
+    Engine.SetEdgeSearch( GetEdgeSearch( Opt ) );
+    Engine.Apply( InputSurface, ReferenceSurface );
+
+    const float fThreshold = 1.0f / 12.0f;
+    bool bMatches = true;
+    std::vector<double> RoundTrips;
+    for ( int i = 0; i < Opt.nFrames; i++ )
+    {
+        MLAA::Surface Frame;
+        if ( !Client.BeginFrame( Opt.Width, Opt.Height, Frame ) )
+            return 1;
+        memcpy( Frame.pData, &Input[0], nBytes );
+
+        double StartTime = MLAA::GetTimeMs();
+        uint32_t Ticket = Client.SubmitFrame( fThreshold );
+        if ( !Client.WaitFrame( Ticket ) )
+        {
+            fprintf( stderr, "Service %s stopped\n", pName );
+            return 1;
+        }
+        RoundTrips.push_back( MLAA::GetTimeMs() - StartTime );
+        bMatches = bMatches && !memcmp( Client.GetFrame( Ticket ).pData, &Reference[0], nBytes );
+    }
+    std::sort( RoundTrips.begin(), RoundTrips.end() );
+
+    // Tickets are consecutive, the oldest frame in flight is the first plus the frames done.
+    // A slot is only begun again once the frame in it has been checked
+    double StartTime = MLAA::GetTimeMs();
+    uint32_t FirstTicket = 0;
+    int nSubmitted = 0, nDone = 0;
+    while ( nDone < Opt.nFrames )
+    {
+        MLAA::Surface Frame;
+        while ( nSubmitted < Opt.nFrames && nSubmitted - nDone < Client.GetSlotCount() &&
+                Client.BeginFrame( Opt.Width, Opt.Height, Frame ) )
+        {
+            memcpy( Frame.pData, &Input[0], nBytes );
+            uint32_t Ticket = Client.SubmitFrame( fThreshold );
+            if ( nSubmitted++ == 0 )
+                FirstTicket = Ticket;
+        }
+
+        uint32_t Ticket = FirstTicket + nDone;
+        if ( !Client.WaitFrame( Ticket ) )
+        {
+            fprintf( stderr, "Service %s stopped\n", pName );
+            return 1;
+        }
+        bMatches = bMatches && !memcmp( Client.GetFrame( Ticket ).pData, &Reference[0], nBytes );
+        nDone++;
+    }
+    double fTime = MLAA::GetTimeMs() - StartTime;
+
+    const size_t nLast = RoundTrips.size() - 1;
+    printf( "%10.3f %10.3f %10.3f %10.1f   %s\n", RoundTrips[0], RoundTrips[nLast / 2], RoundTrips[nLast * 99 / 100],
+            Opt.nFrames * 1000.0 / fTime, bMatches ? "matches" : "DIFFERS" );
+    fflush( stdout );
+    return bMatches ? 0 : 1;
+}
+
+static bool CreateService( MLAA::Service& Service, const char* pName, const Options& Opt )
+{
+    MLAA::ServiceDesc Desc = { Opt.nClients, Opt.nSlots, Opt.Width, Opt.Height, Opt.nThreads };
+    Service.SetEdgeSearch( GetEdgeSearch( Opt ) );
+    if ( !Service.Create( pName, Desc ) )
+    {
+        fprintf( stderr, "Can't create service %s\n", pName );
+        return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Client processes. A copy of the executable on Windows, a fork elsewhere
+//--------------------------------------------------------------------------------------
+#if defined(_WIN32)
+typedef HANDLE Process;
+
+static bool StartClient( const char* pName, const Options& Opt, Process& Client )
+{
+    char Path[MAX_PATH], CommandLine[MAX_PATH + 256];
+    if ( !GetModuleFileNameA( NULL, Path, MAX_PATH ) )
+        return false;
+    sprintf( CommandLine, "\"%s\" -client %s -size %dx%d -frames %d%s", Path, pName, Opt.Width, Opt.Height, Opt.nFrames,
+             Opt.bLong ? " -long" : "" );
+
+    STARTUPINFOA StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    memset( &StartupInfo, 0, sizeof(StartupInfo) );
+    StartupInfo.cb = sizeof(StartupInfo);
+    if ( !CreateProcessA( Path, CommandLine, NULL, NULL, FALSE, 0, NULL, NULL, &StartupInfo, &ProcessInfo ) )
+        return false;
+
+    CloseHandle( ProcessInfo.hThread );
+    Client = ProcessInfo.hProcess;
+    return true;
+}
+
+static bool WaitClient( Process Client )
+{
+    DWORD ExitCode = 1;
+    WaitForSingleObject( Client, INFINITE );
+    GetExitCodeProcess( Client, &ExitCode );
+    CloseHandle( Client );
+    return ExitCode == 0;
+}
+
+static int GetProcessNumber()
+{
+    return (int)GetCurrentProcessId();
+}
+#else
+typedef pid_t Process;
+
+static bool StartClient( const char* pName, const Options& Opt, Process& Client )
+{
+    fflush( stdout );
+    Client = fork();
+    if ( Client == 0 )
+        _exit( RunClient( pName, Opt ) );
+    return Client > 0;
+}
+
+static bool WaitClient( Process Client )
+{
+    int Status = 0;
+    return waitpid( Client, &Status, 0 ) == Client && WIFEXITED( Status ) && WEXITSTATUS( Status ) == 0;
+}
+
+static int GetProcessNumber()
+{
+    return (int)getpid();
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Service and clients in one run
+//--------------------------------------------------------------------------------------
+static int RunBenchmark( const Options& Opt )
+{
+    const size_t nBytes = (size_t)Opt.Width * Opt.Height * 4;
+    std::vector<uint8_t> Input( nBytes ), Output( nBytes );
+    MLAA::Surface InputSurface = { &Input[0], Opt.Width, Opt.Height, Opt.Width * 4 };
+    MLAA::Surface OutputSurface = { &Output[0], Opt.Width, Opt.Height, Opt.Width * 4 };
+    FillImage( InputSurface );
+
+    // The same frames in the process, for what the service adds
+    MLAA::CPUEngine Engine;
+    Engine.SetEdgeSearch( GetEdgeSearch( Opt ) );
+    std::vector<double> Times;
+    for ( int i = 0; i < 10; i++ )
+    {
+        double StartTime = MLAA::GetTimeMs();
+        Engine.Apply( InputSurface, OutputSurface );
+        Times.push_back( MLAA::GetTimeMs() - StartTime );
+    }
+    std::sort( Times.begin(), Times.end() );
+
+    char Name[64];
+    sprintf( Name, "MLAA11_Service_%d", GetProcessNumber() );
+    MLAA::Service Service;
+    if ( !CreateService( Service, Name, Opt ) )
+        return 1;
+
+    printf( "%dx%d, %s edge search, %d clients, %d slots, %d service threads\n", Opt.Width, Opt.Height,
+            Opt.bLong ? "long" : "short", Opt.nClients, Opt.nSlots, Service.GetThreadCount() );
+    printf( "In process Apply: %.3f ms median\n\n", Times[Times.size() / 2] );
+    printf( "%32s %10s\n", "Round trip ms", "Throughput" );
+    printf( "%10s %10s %10s %10s\n", "min", "median", "99th", "frames/s" );
+
+    double StartTime = MLAA::GetTimeMs();
+    std::vector<Process> Clients;
+    bool bOk = true;
+    for ( int i = 0; i < Opt.nClients && bOk; i++ )
+    {
+        Process Client;
+        bOk = StartClient( Name, Opt, Client );
+        if ( bOk )
+            Clients.push_back( Client );
+    }
+    for ( size_t i = 0; i < Clients.size(); i++ )
+        bOk = WaitClient( Clients[i] ) && bOk;
+    double fTime = MLAA::GetTimeMs() - StartTime;
+
+    printf( "\n%llu frames in %.1f ms, %.1f frames/s over all clients\n", (unsigned long long)Service.GetFrameCount(), fTime,
+            Service.GetFrameCount() * 1000.0 / fTime );
+    if ( !bOk )
+    {
+        fprintf( stderr, "A client failed\n" );
+        return 1;
+    }
+    return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+    Options Opt = { 1920, 1080, 2, 4, 0, 200, false };
+    const char* pDaemon = NULL;
+    const char* pClient = NULL;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )
+        {
+            const char* pSize = argv[++i];
+            const char* pHeight = strchr( pSize, 'x' );
+            Opt.Width = atoi( pSize );
+            Opt.Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        }
+        else if ( !strcmp( argv[i], "-clients" ) && bHasValue )        Opt.nClients = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-slots" ) && bHasValue )          Opt.nSlots = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-threads" ) && bHasValue )        Opt.nThreads = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-frames" ) && bHasValue )         Opt.nFrames = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-long" ) )                        Opt.bLong = true;
+        else if ( !strcmp( argv[i], "-daemon" ) && bHasValue )         pDaemon = argv[++i];
+        else if ( !strcmp( argv[i], "-client" ) && bHasValue )         pClient = argv[++i];
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Opt.Width <= 0 || Opt.Height <= 0 || Opt.nClients < 1 || Opt.nSlots < 1 || ( Opt.nSlots & ( Opt.nSlots - 1 ) ) ||
+         Opt.nThreads < 0 || Opt.nFrames < 1 || ( pDaemon && pClient ) )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    if ( pClient )
+        return RunClient( pClient, Opt );
+
+    if ( pDaemon )
+    {
+        MLAA::Service Service;
+        if ( !CreateService( Service, pDaemon, Opt ) )
+            return 1;
+        printf( "Service %s: %d channels of %d slots, frames up to %dx%d, %d threads. Press Enter to stop\n", pDaemon,
+                Opt.nClients, Opt.nSlots, Opt.Width, Opt.Height, Service.GetThreadCount() );
+        getchar();
+        printf( "%llu frames\n", (unsigned long long)Service.GetFrameCount() );
+        return 0;
+    }
+
+    return RunBenchmark( Opt );
+}
@@ -41,6 +41,11 @@
 
 // Project includes
 #include "resource.h"
+#include "MLAA_CPU.h"
+#include "MLAA_CPUQueue.h"
+#include "MLAA_Effect.h"
+#include "MLAA_Governor.h"
+#include "MLAA_SurfacePool.h"
 
 #pragma warning( disable : 4100 ) // disable unreference formal parameter warnings for /W4 builds
 
@@ -48,6 +53,16 @@ using namespace DirectX;
 
 #define OFFSCREENFORMAT		DXGI_FORMAT_R8G8B8A8_UNORM	
 
+// The HUD offers the fused tile compute shader only when this is set. It has not been
+// measured faster than the separate compute passes on any hardware yet
+#define SHOW_FUSED_TILE_CS	0
+
+// The HUD offers half resolution edge detection only when this is set. The CPU engine
+// detects edges again at full resolution near the ones found at half resolution, but the
+// HALF_RES_EDGES shader permutations still put every edge on the 2x2 grid, which scores
+// below no MLAA at all
+#define SHOW_HALF_RES_EDGES	0
+
 //--------------------------------------------------------------------------------------
 // Global variables
 //--------------------------------------------------------------------------------------
@@ -61,6 +76,17 @@ bool						g_bUseFiltering = false;
 float						gEdgeDetectionThreshold = 12.0f;
 bool						g_bShowEdges = false;
 bool						g_bUseStencilBuffer = true;
+bool						g_bUseCPUMLAA = false;
+bool						g_bCPUTransposedSearch = true;
+int							g_nCPUFramesInFlight = 1;
+bool						g_bMSAAAwareMLAA = false;
+bool						g_bMLAAMagnifiedRegion = false;	// Only anti-alias the region shown by the magnify tool
+int							g_nAtlasMode = 0;				// ATLAS_MODE, splits the frame into views processed as separate images
+bool						g_bHalfResEdges = false;		// Detect edges at half resolution, see SHOW_HALF_RES_EDGES
+bool						g_bFoveatedMLAA = false;		// Per tile quality falling off away from the center of the screen
+int							g_nEdgeSearch = MLAA::EDGE_SEARCH_SHORT;	// MLAA::EDGE_SEARCH, long edges use 8 bit counts
+int							g_nEdgeFetch = 0;				// EDGE_FETCH, how edge detection reads the luma
+int							g_nPassShader = 0;				// PASS_SHADER, pixel or compute shaders for the GPU passes
 float						g_Width = 1920.0f;
 float						g_Height = 1080.0f;
 int							g_MSAACount = 1;
@@ -76,36 +102,345 @@ ID3D11SamplerState*         g_pSamLinear		= NULL;
 ID3D11SamplerState*         g_pSceneColorSam	= NULL;
 ID3D11BlendState*			g_pBS				= NULL;    
 ID3D11BlendState*			g_pNoBlendingBS		= NULL;    
+ID3D11RasterizerState*		g_pScissorRS		= NULL;		// Limits the MLAA passes to a region of interest
 
 ID3D11InputLayout*          g_pScreenQuadLayout	= NULL;
 ID3D11VertexShader*         g_pScreenQuadVS		= NULL;
 ID3D11Buffer*				g_pScreenQuadVB		= NULL;
 ID3D11PixelShader*          g_pSeparateEdgePS	= NULL;
 ID3D11PixelShader*          g_pSeparateEdgePSStencilPS = NULL;
+ID3D11PixelShader*          g_pSeparateEdgeMSAAPS = NULL;
 ID3D11PixelShader*          g_pComputeEdgePS	= NULL;
 ID3D11PixelShader*          g_pBlendColorPS		= NULL;
 ID3D11PixelShader*          g_pShowEdgesPS		= NULL;
 ID3D11PixelShader*          g_pClearPS			= NULL;
 
+// HALF_RES_EDGES permutations, the first two passes draw to the top left quarter of the targets
+ID3D11PixelShader*          g_pSeparateEdgeHalfResPS		= NULL;
+ID3D11PixelShader*          g_pSeparateEdgeHalfResStencilPS	= NULL;
+ID3D11PixelShader*          g_pComputeEdgeHalfResPS			= NULL;
+ID3D11PixelShader*          g_pBlendColorHalfResPS			= NULL;
+ID3D11PixelShader*          g_pShowEdgesHalfResPS			= NULL;
+
+// USE_GATHER permutations of the first pass, the quad shader writes the edge mask through a UAV
+ID3D11PixelShader*          g_pSeparateEdgeGatherPS			= NULL;
+ID3D11PixelShader*          g_pSeparateEdgeGatherStencilPS	= NULL;
+ID3D11PixelShader*          g_pSeparateEdgeQuadPS			= NULL;
+
+// USE_QUALITY_MAP permutations, foveated MLAA reads the quality of each tile from a texture of the backend
+ID3D11PixelShader*          g_pComputeEdgeFoveatedPS		= NULL;
+ID3D11PixelShader*          g_pBlendColorFoveatedPS			= NULL;
+
+// MAX_EDGE_COUNT_BITS 8 permutations for long edges, the hierarchical search reads the 
+// block summaries drawn by g_pEdgeBlocksHPS and g_pEdgeBlocksVPS
+ID3D11PixelShader*          g_pComputeEdgeLongPS			= NULL;
+ID3D11PixelShader*          g_pComputeEdgeHierarchicalPS	= NULL;
+ID3D11PixelShader*          g_pBlendColorLongPS				= NULL;
+ID3D11PixelShader*          g_pShowEdgesLongPS				= NULL;
+ID3D11PixelShader*          g_pEdgeBlocksHPS				= NULL;
+ID3D11PixelShader*          g_pEdgeBlocksVPS				= NULL;
+
+// Atlas views, one instance per view
+ID3D11InputLayout*          g_pAtlasViewLayout	= NULL;
+ID3D11VertexShader*         g_pAtlasViewVS		= NULL;
+ID3D11PixelShader*          g_pSeparateEdgeAtlasPS	= NULL;
+ID3D11PixelShader*          g_pComputeEdgeAtlasPS	= NULL;
+ID3D11PixelShader*          g_pBlendColorAtlasPS	= NULL;
+ID3D11PixelShader*          g_pShowEdgesAtlasPS		= NULL;
+
+// COMPUTE_PASSES, the three passes as compute shaders writing their output through a UAV
+ID3D11ComputeShader*        g_pSeparateEdgeCS		= NULL;
+ID3D11ComputeShader*        g_pComputeEdgeCS		= NULL;
+ID3D11ComputeShader*        g_pBlendColorCS			= NULL;
+ID3D11ComputeShader*        g_pShowEdgesCS			= NULL;
+ID3D11ComputeShader*        g_pTileCS				= NULL;			// All three passes in one dispatch of 16x16 tiles
+ID3D11ComputeShader*        g_pShowEdgesTileCS		= NULL;
+ID3D11PixelShader*          g_pCopyPS				= NULL;			// Draws g_ComputeOutput to the back buffer
+
+// Output of the compute passes. The sRGB back buffer takes no UAV, so they write this UNORM
+// surface and it is drawn through the sRGB view, which encodes it as the pixel passes are.
+// Acquired the first time the compute passes run at a size
+ID3D11Texture2D*			g_ComputeOutput			= NULL;
+ID3D11ShaderResourceView*	g_ComputeOutputSRV		= NULL;
+ID3D11UnorderedAccessView*	g_ComputeOutputUAV		= NULL;
+
 ID3D11Texture2D*			g_SceneColor			= NULL; 
 ID3D11RenderTargetView*		g_SceneColorRTV			= NULL; 
 ID3D11ShaderResourceView*	g_SceneColorSRV			= NULL; 
 ID3D11Texture2D*			g_ResolvedSceneColor	= NULL; 
 ID3D11ShaderResourceView*	g_ResolvedSceneColorSRV = NULL; 
+ID3D11RenderTargetView*		g_ResolvedSceneColorRTV = NULL; 
+
+// Options of the D3D11 backend for the current frame, the EffectSettings::pBackendOptions
+// of its Effect. RenderMLAA resolves them and the settings against each other, the backend
+// only picks shaders and targets from them
+struct D3D11PassOptions
+{
+	ID3D11DeviceContext*		pContext;			// Context the passes are recorded on
+	bool						bMSAAAware;
+	bool						bUseStencil;
+	bool						bGather;
+	bool						bShowEdges;
+	bool						bCompute;			// Dispatch the COMPUTE_PASSES shaders, the output is a UAV
+	bool						bComputeTile;		// With bCompute, one dispatch of MLAA_Tile_CS in the blend pass
+	bool						bDrawViewsSeparately;	// One draw per atlas view and pass instead of one instanced draw
+	ID3D11ShaderResourceView*	pSceneColorMSSRV;	// Multisampled scene color read by MSAA aware edge detection
+	ID3D11RenderTargetView*		pResolvedRTV;		// Resolved scene color written by MSAA aware edge detection
+	ID3D11DepthStencilView*		pStencilView;		// Single sampled stencil marked by the first pass with bUseStencil
+	ID3D11DepthStencilState*	pStencilState;
+};
+
+// An intermediate target of the MLAA passes, the UAV is only created for the edge mask
+struct D3D11EffectTarget
+{
+	ID3D11Texture2D*			pTexture;
+	ID3D11RenderTargetView*		pRTV;
+	ID3D11ShaderResourceView*	pSRV;
+	ID3D11UnorderedAccessView*	pUAV;
+};
+
+// The GPU passes of MLAA::Effect. Surface handles are a shader resource view for the input
+// and a render target view for the output, or an unordered access view for compute passes.
+// The settings need D3D11PassOptions. The intermediates come from g_TargetPool and the
+// shaders are device resources of the sample. The constants, the atlas views and the
+// quality map are uploaded to buffers of the backend in the first pass of each frame
+class D3D11EffectBackend : public MLAA::IEffectBackend
+{
+public:
+
+	D3D11EffectBackend();
+
+	// Buffers of the constants, views and quality map, they grow as needed. The device is
+	// not referenced and must outlive them
+	HRESULT CreateDeviceObjects(ID3D11Device* pDevice);
+	void ReleaseDeviceObjects();
+
+	virtual bool CreateIntermediates(const MLAA::EffectSurface& Input);
+	virtual void ReleaseIntermediates();
+
+	virtual bool DetectEdges(const MLAA::EffectSurface& Input, const MLAA::EffectSettings& Settings);
+	virtual void ComputeLineLength(const MLAA::EffectSurface& Input, const MLAA::EffectSettings& Settings);
+	virtual void BlendColor(const MLAA::EffectSurface& Input, const MLAA::EffectSurface& Output, const MLAA::EffectSettings& Settings);
+
+	virtual double GetPassTime(MLAA::PASS Pass) const;
 
-ID3D11Texture2D*			g_EdgeMask		= NULL; 
-ID3D11RenderTargetView*		g_EdgeMaskRTV	= NULL; 
-ID3D11ShaderResourceView*	g_EdgeMaskSRV	= NULL; 
+private:
 
-ID3D11Texture2D*			g_EdgeCount		= NULL; 
-ID3D11RenderTargetView*		g_EdgeCountRTV	= NULL; 
-ID3D11ShaderResourceView*	g_EdgeCountSRV	= NULL; 
+	// The backend options with the flags the settings select
+	struct PassOptions : D3D11PassOptions
+	{
+		const MLAA::Rect*		pRegion;			// Scissor region, NULL for the whole frame
+		int						nViews;
+		bool					bAtlas;
+		bool					bHalfRes;
+		bool					bGatherQuads;
+		bool					bFoveated;
+		bool					bLongEdges;
+		bool					bHierarchical;
+	};
+	static PassOptions GetPassOptions(const MLAA::EffectSettings& Settings);
+
+	HRESULT UploadViews(ID3D11DeviceContext* pContext, const MLAA::View* pViews, int nViews);
+	HRESULT UploadQualityMap(ID3D11DeviceContext* pContext, const MLAA::QualityMap& Map);
+	void SetGeometry(const PassOptions& o, bool bAtlas);
+	void DrawPass(const PassOptions& o, bool bAtlas);
+	void SetFullViewport(ID3D11DeviceContext* pContext);
+	void Dispatch(ID3D11DeviceContext* pContext, ID3D11ComputeShader* pShader, int nGroupSize = 8);
+
+	ID3D11Device*				m_pDevice;
+	ID3D11Buffer*				m_pConstants;		// CB_MLAA
+	ID3D11Buffer*				m_pViewVB;			// One MLAA::View per instance, read by AtlasViewVS
+	int							m_nViewCapacity;
+	ID3D11Texture2D*			m_pQualityMapTexture;	// One R8_UINT texel per tile
+	ID3D11ShaderResourceView*	m_pQualityMapSRV;
+
+	int							m_nWidth;
+	int							m_nHeight;
+
+	D3D11EffectTarget			m_EdgeMask;
+	D3D11EffectTarget			m_EdgeCount;
+	D3D11EffectTarget			m_LongEdgeCount;	// 8 bits per side counts of the long edge search
+	D3D11EffectTarget			m_EdgeBlocksH;		// Horizontal edge bits of 8 pixels of a row per texel
+	D3D11EffectTarget			m_EdgeBlocksV;		// Vertical edge bits of 8 pixels of a column per texel
+};
+
+D3D11EffectBackend			g_D3D11Backend;
+MLAA::Effect				g_MLAAEffect(&g_D3D11Backend);
 
 ID3D11DepthStencilState*	g_SceneDepthStencilState = NULL;
 ID3D11DepthStencilState*	g_DepthStencilState = NULL;
 ID3D11DepthStencilState*	g_ScreenQuadDepthStencilState = NULL;
 ID3D11Texture2D*			g_DepthStencil		= NULL; 
 ID3D11DepthStencilView*		g_DepthStencilView = NULL;
+ID3D11Texture2D*			g_MLAADepthStencil	= NULL;		// Single sampled stencil for the MLAA passes when the scene uses MSAA
+ID3D11DepthStencilView*		g_MLAADepthStencilView = NULL;
+
+// CPU MLAA resources
+MLAA::CPUEngine				g_CPUMLAA;
+ID3D11Texture2D*			g_CPUSceneColor		= NULL;		// Staging copy of the scene color read by the CPU
+std::vector<uint8_t>		g_CPUResultColor;
+MLAA::FrameResult			g_CPULastResult;				// Timings of the last frame shown by the CPU path
+
+// Pipelined CPU MLAA, used when more than one frame is in flight. The result shown each 
+// frame is the one submitted g_nCPUFramesInFlight frames earlier.
+struct CPUFrame
+{
+	std::vector<uint8_t>				Source;
+	std::vector<uint8_t>				Result;
+	std::future<MLAA::FrameResult>		Done;
+};
+static const int			MAX_CPU_FRAMES_IN_FLIGHT = 4;
+MLAA::CPUQueue*				g_pCPUQueue = NULL;
+CPUFrame					g_CPUFrames[MAX_CPU_FRAMES_IN_FLIGHT];
+int							g_nCPUFrameHead = 0;
+
+// The frame can be split into a grid of views, each anti-aliased as an image of its own.
+// This stands in for the thumbnails and split screen views of an atlas.
+enum ATLAS_MODE
+{
+	ATLAS_MODE_OFF,
+	ATLAS_MODE_BATCHED,			// All views in one draw per pass, or one CPU job
+	ATLAS_MODE_PER_VIEW,		// One draw per view and pass, or one CPU call per view
+};
+static const int			ATLAS_VIEW_SIZE = 128;
+std::vector<MLAA::View>		g_AtlasViews;
+
+// The views are uploaded as is into the instance buffer read by AtlasViewVS
+static_assert( sizeof(MLAA::View) == 5 * sizeof(int), "MLAA::View doesn't match AtlasView_INPUT" );
+
+// Luma reads of the first pass. The CPU runs the quad kernel for EDGE_FETCH_GATHER_QUADS
+// and the per pixel one otherwise.
+enum EDGE_FETCH
+{
+	EDGE_FETCH_LOAD,			// Three loads per pixel
+	EDGE_FETCH_GATHER,			// One gather per pixel
+	EDGE_FETCH_GATHER_QUADS,	// Two gathers and a load per 2x2 quad
+};
+
+// Shader stage of the GPU passes. The compute passes only run on the whole frame at full 
+// resolution, other settings fall back to the pixel passes.
+enum PASS_SHADER
+{
+	PASS_SHADER_PIXEL,			// Three full screen draws
+	PASS_SHADER_COMPUTE,		// Three dispatches of 8x8 groups
+	PASS_SHADER_COMPUTE_TILE,	// One dispatch of 16x16 tiles, edges and counts stay in groupshared memory
+};
+
+// Foveated MLAA: full quality around the center of the screen, short edges only further out
+// and nothing in the periphery. The radii are fractions of the screen height.
+static const int			QUALITY_TILE_SIZE = 32;
+static const float			FOVEA_INNER_RADIUS = 0.25f;
+static const float			FOVEA_OUTER_RADIUS = 0.5f;
+std::vector<uint8_t>		g_QualityLevels;
+MLAA::QualityMap			g_QualityMap;
+int							g_nQualityTiles[MLAA::QUALITY_LEVEL_COUNT] = { 0 };
+
+//--------------------------------------------------------------------------------------
+// Render target pool backend: a pooled surface is a texture plus the views its bind 
+// flags allow
+//--------------------------------------------------------------------------------------
+struct PooledTexture
+{
+	ID3D11Texture2D*			pTexture;
+	ID3D11RenderTargetView*		pRTV;
+	ID3D11ShaderResourceView*	pSRV;
+	ID3D11DepthStencilView*		pDSV;
+	ID3D11UnorderedAccessView*	pUAV;
+};
+
+class D3D11SurfaceAllocator : public MLAA::ISurfaceAllocator
+{
+public:
+
+	D3D11SurfaceAllocator() : m_pDevice(NULL) {}
+
+	void SetDevice(ID3D11Device* pDevice) { m_pDevice = pDevice; }
+
+	virtual void* Allocate(const MLAA::SurfaceDesc& Desc)
+	{
+		PooledTexture* pPooled = new PooledTexture;
+		memset(pPooled, 0, sizeof(PooledTexture));
+
+		D3D11_TEXTURE2D_DESC td;
+		memset(&td, 0, sizeof(td));
+		td.ArraySize = 1;
+		td.Format = (DXGI_FORMAT)Desc.Format;
+		td.Width = Desc.Width;
+		td.Height = Desc.Height;
+		td.CPUAccessFlags = (Desc.Usage == D3D11_USAGE_STAGING) ? D3D11_CPU_ACCESS_READ : 0;
+		td.MipLevels = 1;
+		td.MiscFlags = 0;
+		td.SampleDesc.Count = Desc.SampleCount;
+		td.SampleDesc.Quality = 0;
+		td.Usage = (D3D11_USAGE)Desc.Usage;
+		td.BindFlags = Desc.BindFlags;
+
+		HRESULT hr = m_pDevice->CreateTexture2D(&td, NULL, &pPooled->pTexture);
+		if (SUCCEEDED(hr) && (Desc.BindFlags & D3D11_BIND_RENDER_TARGET))
+		{
+			D3D11_RENDER_TARGET_VIEW_DESC rtvd;
+			memset(&rtvd, 0, sizeof(rtvd));
+			rtvd.Format = (DXGI_FORMAT)Desc.ViewFormat;
+			rtvd.ViewDimension = (Desc.SampleCount > 1) ? D3D11_RTV_DIMENSION_TEXTURE2DMS : D3D11_RTV_DIMENSION_TEXTURE2D;
+			rtvd.Texture2D.MipSlice = 0;
+			hr = m_pDevice->CreateRenderTargetView(pPooled->pTexture, &rtvd, &pPooled->pRTV);
+		}
+		if (SUCCEEDED(hr) && (Desc.BindFlags & D3D11_BIND_SHADER_RESOURCE))
+		{
+			D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
+			memset(&srvd, 0, sizeof(srvd));
+			srvd.Format = (DXGI_FORMAT)Desc.ViewFormat;
+			srvd.ViewDimension = (Desc.SampleCount > 1) ? D3D11_SRV_DIMENSION_TEXTURE2DMS : D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvd.Texture2D.MostDetailedMip = 0;
+			srvd.Texture2D.MipLevels = 1;
+			hr = m_pDevice->CreateShaderResourceView(pPooled->pTexture, &srvd, &pPooled->pSRV);
+		}
+		if (SUCCEEDED(hr) && (Desc.BindFlags & D3D11_BIND_DEPTH_STENCIL))
+		{
+			D3D11_DEPTH_STENCIL_VIEW_DESC dsvd;
+			memset(&dsvd, 0, sizeof(dsvd));
+			dsvd.Format = (DXGI_FORMAT)Desc.ViewFormat;
+			dsvd.Flags = 0;
+			dsvd.ViewDimension = (Desc.SampleCount > 1) ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
+			dsvd.Texture2D.MipSlice = 0;
+			hr = m_pDevice->CreateDepthStencilView(pPooled->pTexture, &dsvd, &pPooled->pDSV);
+		}
+		if (SUCCEEDED(hr) && (Desc.BindFlags & D3D11_BIND_UNORDERED_ACCESS))
+		{
+			D3D11_UNORDERED_ACCESS_VIEW_DESC uavd;
+			memset(&uavd, 0, sizeof(uavd));
+			uavd.Format = (DXGI_FORMAT)Desc.ViewFormat;
+			uavd.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+			uavd.Texture2D.MipSlice = 0;
+			hr = m_pDevice->CreateUnorderedAccessView(pPooled->pTexture, &uavd, &pPooled->pUAV);
+		}
+
+		if (FAILED(hr))
+		{
+			Free(pPooled);
+			return NULL;
+		}
+		return pPooled;
+	}
+
+	virtual void Free(void* pSurface)
+	{
+		PooledTexture* pPooled = (PooledTexture*)pSurface;
+		SAFE_RELEASE(pPooled->pTexture);
+		SAFE_RELEASE(pPooled->pRTV);
+		SAFE_RELEASE(pPooled->pSRV);
+		SAFE_RELEASE(pPooled->pDSV);
+		SAFE_RELEASE(pPooled->pUAV);
+		delete pPooled;
+	}
+
+private:
+
+	ID3D11Device*	m_pDevice;
+};
+
+D3D11SurfaceAllocator		g_TargetAllocator;
+MLAA::SurfacePool			g_TargetPool(&g_TargetAllocator);
 
 //--------------------------------------------------------------------------------------
 // AMD helper classes defined here
@@ -123,6 +458,27 @@ float						gPass1Time = 0.0f;
 float						gPass2Time = 0.0f;
 float						gPass3Time = 0.0f;
 float						gTotalTime = 0.0f;
+float						gCPULatency = 0.0f;
+
+//--------------------------------------------------------------------------------------
+// Frame budget governor. The passes of a frame use the HUD settings made cheaper by the 
+// current step of the governor
+//--------------------------------------------------------------------------------------
+static const int			GPU_TIMER_LATENCY = 3;			// Frames before the GPU timestamps of a frame are read back
+bool						g_bBudgetGovernor = false;
+float						g_fMLAABudget = 2.0f;			// Milliseconds for the three passes
+MLAA::BudgetGovernor		g_Governor;
+
+struct MLAAFrameSettings
+{
+	float					fThreshold;
+	int						nEdgeSearch;					// MLAA::EDGE_SEARCH
+	bool					bHalfResEdges;
+	bool					bShortEdges;					// Edge searches stop after MLAA::kShortEdgeLength pixels
+	bool					bSkip;							// The scene is shown without MLAA
+};
+
+MLAAFrameSettings			g_FrameSettings;
 
 //--------------------------------------------------------------------------------------
 // Constant buffers
@@ -146,13 +502,13 @@ struct CB_MLAA
 {
 	// (x, y)	-> Render target size
 	// (z)		-> Edge detection threshold
+	// (w)		-> Quality map tile size
     XMVECTOR m_Param; 
 };
 #pragma pack(pop)
 
 ID3D11Buffer*				g_pcbVSPerObject11	= NULL;
 ID3D11Buffer*               g_pcbVSPerFrame11	= NULL;
-ID3D11Buffer*               g_pcbMLAA11			= NULL;
 
 //--------------------------------------------------------------------------------------
 // UI control IDs
@@ -167,6 +523,27 @@ enum
     IDC_THRESHOLD,
     IDC_THRESHOLD_STATIC,
     IDC_SHOWEDGE,
+    IDC_CPU_MLAA,
+    IDC_CPU_TRANSPOSED_SEARCH,
+    IDC_CPU_FRAMES_IN_FLIGHT_STATIC,
+    IDC_CPU_FRAMES_IN_FLIGHT,
+    IDC_SCENE_MSAA_STATIC,
+    IDC_SCENE_MSAA,
+    IDC_MSAA_AWARE,
+    IDC_HALF_RES_EDGES,
+    IDC_FOVEATED_MLAA,
+    IDC_BUDGET_GOVERNOR,
+    IDC_MLAA_BUDGET_STATIC,
+    IDC_MLAA_BUDGET,
+    IDC_EDGE_FETCH_STATIC,
+    IDC_EDGE_FETCH,
+    IDC_EDGE_SEARCH_STATIC,
+    IDC_EDGE_SEARCH,
+    IDC_PASS_SHADER_STATIC,
+    IDC_PASS_SHADER,
+    IDC_MLAA_MAGNIFIED_REGION,
+    IDC_ATLAS_MODE_STATIC,
+    IDC_ATLAS_MODE,
     IDC_NUM_CONTROL_IDS
 };
 
@@ -192,6 +569,7 @@ void CALLBACK OnD3D11FrameRender( ID3D11Device* pd3dDevice, ID3D11DeviceContext*
 
 void InitApp();
 void RenderText();
+void ReleaseCPUQueue();
 
 //--------------------------------------------------------------------------------------
 // Entry point to the program. Initializes everything and goes into a message processing 
@@ -271,6 +649,79 @@ void InitApp()
 	g_HUD.m_GUI.AddStatic( IDC_THRESHOLD_STATIC, szTemp, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
 	g_HUD.m_GUI.AddSlider( IDC_THRESHOLD, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 1, 64, (int)gEdgeDetectionThreshold);
 	g_HUD.m_GUI.AddCheckBox( IDC_SHOWEDGE, L"Show MLAA Edges", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bShowEdges );	    
+	g_HUD.m_GUI.AddCheckBox( IDC_CPU_MLAA, L"Run MLAA on CPU (C)", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bUseCPUMLAA, 'C' );
+	g_HUD.m_GUI.AddCheckBox( IDC_CPU_TRANSPOSED_SEARCH, L"CPU Transposed V Search", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bCPUTransposedSearch );
+	g_HUD.m_GUI.GetCheckBox( IDC_CPU_TRANSPOSED_SEARCH )->SetEnabled( g_bUseCPUMLAA );
+	swprintf_s( szTemp, L"CPU Frames In Flight:%d", g_nCPUFramesInFlight);	
+	g_HUD.m_GUI.AddStatic( IDC_CPU_FRAMES_IN_FLIGHT_STATIC, szTemp, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddSlider( IDC_CPU_FRAMES_IN_FLIGHT, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 1, MAX_CPU_FRAMES_IN_FLIGHT, g_nCPUFramesInFlight);
+	g_HUD.m_GUI.GetSlider( IDC_CPU_FRAMES_IN_FLIGHT )->SetEnabled( g_bUseCPUMLAA );
+
+	// MSAA of the offscreen scene target, the back buffer itself is never multisampled
+	CDXUTComboBox* pCombo = NULL;
+	g_HUD.m_GUI.AddStatic( IDC_SCENE_MSAA_STATIC, L"Scene MSAA:", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddComboBox( IDC_SCENE_MSAA, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 0, false, &pCombo );
+	if (pCombo)
+	{
+		pCombo->AddItem( L"1x", (void*)(size_t)1 );
+		pCombo->AddItem( L"2x", (void*)(size_t)2 );
+		pCombo->AddItem( L"4x", (void*)(size_t)4 );
+		pCombo->AddItem( L"8x", (void*)(size_t)8 );
+		pCombo->SetSelectedByData( (void*)(size_t)g_MSAACount );
+	}
+	g_HUD.m_GUI.AddCheckBox( IDC_MSAA_AWARE, L"MSAA Aware Edges", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bMSAAAwareMLAA );
+#if SHOW_HALF_RES_EDGES
+	g_HUD.m_GUI.AddCheckBox( IDC_HALF_RES_EDGES, L"Half Res Edge Detection", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bHalfResEdges );
+#endif
+	g_HUD.m_GUI.AddCheckBox( IDC_FOVEATED_MLAA, L"Foveated MLAA", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bFoveatedMLAA );
+	g_HUD.m_GUI.AddCheckBox( IDC_BUDGET_GOVERNOR, L"MLAA Budget Governor", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bBudgetGovernor );
+	swprintf_s( szTemp, L"MLAA Budget:%.1f ms", g_fMLAABudget);	
+	g_HUD.m_GUI.AddStatic( IDC_MLAA_BUDGET_STATIC, szTemp, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddSlider( IDC_MLAA_BUDGET, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 1, 300, (int)(g_fMLAABudget * 10.0f));
+	g_HUD.m_GUI.GetSlider( IDC_MLAA_BUDGET )->SetEnabled( g_bBudgetGovernor );
+
+	g_HUD.m_GUI.AddStatic( IDC_EDGE_FETCH_STATIC, L"Edge Detection Reads:", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddComboBox( IDC_EDGE_FETCH, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 0, false, &pCombo );
+	if (pCombo)
+	{
+		pCombo->AddItem( L"3 loads", (void*)(size_t)EDGE_FETCH_LOAD );
+		pCombo->AddItem( L"Gather", (void*)(size_t)EDGE_FETCH_GATHER );
+		pCombo->AddItem( L"Gather 2x2 quads", (void*)(size_t)EDGE_FETCH_GATHER_QUADS );
+		pCombo->SetSelectedByData( (void*)(size_t)g_nEdgeFetch );
+	}
+
+	g_HUD.m_GUI.AddStatic( IDC_EDGE_SEARCH_STATIC, L"Edge Length Search:", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddComboBox( IDC_EDGE_SEARCH, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 0, false, &pCombo );
+	if (pCombo)
+	{
+		pCombo->AddItem( L"4 bit", (void*)(size_t)MLAA::EDGE_SEARCH_SHORT );
+		pCombo->AddItem( L"8 bit blocks", (void*)(size_t)MLAA::EDGE_SEARCH_LONG );
+		pCombo->AddItem( L"8 bit naive", (void*)(size_t)MLAA::EDGE_SEARCH_LONG_NAIVE );
+		pCombo->SetSelectedByData( (void*)(size_t)g_nEdgeSearch );
+	}
+
+	g_HUD.m_GUI.AddStatic( IDC_PASS_SHADER_STATIC, L"GPU Passes:", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddComboBox( IDC_PASS_SHADER, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 0, false, &pCombo );
+	if (pCombo)
+	{
+		pCombo->AddItem( L"Pixel shaders", (void*)(size_t)PASS_SHADER_PIXEL );
+		pCombo->AddItem( L"Compute 8x8 groups", (void*)(size_t)PASS_SHADER_COMPUTE );
+#if SHOW_FUSED_TILE_CS
+		pCombo->AddItem( L"Compute fused 16x16 tiles", (void*)(size_t)PASS_SHADER_COMPUTE_TILE );
+#endif
+		pCombo->SetSelectedByData( (void*)(size_t)g_nPassShader );
+	}
+	g_HUD.m_GUI.AddCheckBox( IDC_MLAA_MAGNIFIED_REGION, L"MLAA Magnified Region Only", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, g_bMLAAMagnifiedRegion );
+
+	g_HUD.m_GUI.AddStatic( IDC_ATLAS_MODE_STATIC, L"Atlas Views:", AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22 );
+	g_HUD.m_GUI.AddComboBox( IDC_ATLAS_MODE, AMD::HUD::iElementOffset, iY += AMD::HUD::iElementDelta, 170, 22, 0, false, &pCombo );
+	if (pCombo)
+	{
+		pCombo->AddItem( L"Off", (void*)(size_t)ATLAS_MODE_OFF );
+		pCombo->AddItem( L"Batched", (void*)(size_t)ATLAS_MODE_BATCHED );
+		pCombo->AddItem( L"Per View", (void*)(size_t)ATLAS_MODE_PER_VIEW );
+		pCombo->SetSelectedByData( (void*)(size_t)g_nAtlasMode );
+	}
 
     iY += AMD::HUD::iGroupDelta;
 
@@ -293,6 +744,34 @@ void RenderText()
 	WCHAR szTemp[256];
 	swprintf_s( szTemp, L"Effect cost in milliseconds (Detect Edge = %.2f, Compute Edge Length = %.2f, Blend Color = %.2f, Total = %.2f)", gPass1Time, gPass2Time, gPass3Time, gTotalTime);
 	g_pTxtHelper->DrawTextLine( szTemp );
+	if (g_bShowMLAA && g_bUseCPUMLAA)
+	{
+		swprintf_s( szTemp, L"CPU latency in milliseconds with %d frames in flight = %.2f", g_nCPUFramesInFlight, gCPULatency);
+		g_pTxtHelper->DrawTextLine( szTemp );
+	}
+	if (g_bShowMLAA && g_nAtlasMode != ATLAS_MODE_OFF && !g_bMLAAMagnifiedRegion)
+	{
+		swprintf_s( szTemp, L"Atlas: %d views of %dx%d, %s", (int)g_AtlasViews.size(), ATLAS_VIEW_SIZE, ATLAS_VIEW_SIZE,
+			(g_nAtlasMode == ATLAS_MODE_BATCHED) ? L"batched" : L"one call per view" );
+		g_pTxtHelper->DrawTextLine( szTemp );
+	}
+	if (g_bShowMLAA && g_bFoveatedMLAA && g_nAtlasMode == ATLAS_MODE_OFF && !g_bMLAAMagnifiedRegion)
+	{
+		swprintf_s( szTemp, L"Foveated: %d full, %d short edge and %d skipped tiles of %dx%d", g_nQualityTiles[MLAA::QUALITY_FULL],
+			g_nQualityTiles[MLAA::QUALITY_SHORT_EDGES], g_nQualityTiles[MLAA::QUALITY_SKIP], QUALITY_TILE_SIZE, QUALITY_TILE_SIZE );
+		g_pTxtHelper->DrawTextLine( szTemp );
+	}
+	if (g_bShowMLAA && g_bBudgetGovernor)
+	{
+		swprintf_s( szTemp, L"Budget governor: step %d of %d, threshold %.3f, %s edges, %s resolution detection%s, %d frames over %.1f ms",
+			g_Governor.GetStep() + 1, g_Governor.GetStepCount(), g_FrameSettings.fThreshold,
+			g_FrameSettings.bShortEdges ? L"short" : ((g_FrameSettings.nEdgeSearch != MLAA::EDGE_SEARCH_SHORT) ? L"long" : L"4 bit"),
+			g_FrameSettings.bHalfResEdges ? L"half" : L"full", g_FrameSettings.bSkip ? L", skipped" : L"",
+			g_Governor.GetOverBudgetCount(), g_fMLAABudget );
+		g_pTxtHelper->DrawTextLine( szTemp );
+	}
+	swprintf_s( szTemp, L"Render target pool: %d surfaces, %d allocations, %d frees", g_TargetPool.GetSurfaceCount(), g_TargetPool.GetAllocationCount(), g_TargetPool.GetFreeCount());
+	g_pTxtHelper->DrawTextLine( szTemp );
 
 	g_pTxtHelper->SetInsertionPos( 5, DXUTGetDXGIBackBufferSurfaceDesc()->Height - AMD::HUD::iElementDelta );
 	g_pTxtHelper->DrawTextLine( L"Toggle GUI    : F1" );
@@ -309,6 +788,42 @@ bool CALLBACK IsD3D11DeviceAcceptable( const CD3D11EnumAdapterInfo *AdapterInfo,
     return true;
 }
 //--------------------------------------------------------------------------------------
+// Get a surface from the render target pool. The returned interfaces hold their own 
+// reference, the pool keeps the surface alive until it is trimmed.
+//--------------------------------------------------------------------------------------
+HRESULT AcquireTarget(const MLAA::SurfaceDesc& Desc, bool bExactSize, ID3D11Texture2D** ppTexture,
+					  ID3D11RenderTargetView** ppRTV, ID3D11ShaderResourceView** ppSRV, ID3D11DepthStencilView** ppDSV,
+					  ID3D11UnorderedAccessView** ppUAV = NULL)
+{
+	PooledTexture* pPooled = (PooledTexture*)g_TargetPool.Acquire(Desc, NULL, NULL, bExactSize);
+	if (pPooled == NULL)
+		return E_OUTOFMEMORY;
+
+	*ppTexture = pPooled->pTexture;
+	(*ppTexture)->AddRef();
+	if (ppRTV)
+	{
+		*ppRTV = pPooled->pRTV;
+		(*ppRTV)->AddRef();
+	}
+	if (ppSRV)
+	{
+		*ppSRV = pPooled->pSRV;
+		(*ppSRV)->AddRef();
+	}
+	if (ppDSV)
+	{
+		*ppDSV = pPooled->pDSV;
+		(*ppDSV)->AddRef();
+	}
+	if (ppUAV)
+	{
+		*ppUAV = pPooled->pUAV;
+		(*ppUAV)->AddRef();
+	}
+	return S_OK;
+}
+//--------------------------------------------------------------------------------------
 // Create render targets for MLAA post processing
 //--------------------------------------------------------------------------------------
 HRESULT CreateMLAARenderTargets(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
@@ -320,147 +835,63 @@ HRESULT CreateMLAARenderTargets(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DES
     SAFE_RELEASE( g_SceneColorSRV );
 	SAFE_RELEASE( g_ResolvedSceneColor );
 	SAFE_RELEASE( g_ResolvedSceneColorSRV );
+	SAFE_RELEASE( g_ResolvedSceneColorRTV );
 
-	SAFE_RELEASE( g_EdgeMask );
-    SAFE_RELEASE( g_EdgeMaskRTV );
-    SAFE_RELEASE( g_EdgeMaskSRV );    
-
-	SAFE_RELEASE( g_EdgeCount );
-    SAFE_RELEASE( g_EdgeCountRTV );
-    SAFE_RELEASE( g_EdgeCountSRV );    
+	g_MLAAEffect.ReleaseIntermediates();
 
 	SAFE_RELEASE( g_SceneDepthStencilState);
 	SAFE_RELEASE( g_DepthStencilState);
 	SAFE_RELEASE( g_ScreenQuadDepthStencilState);
 	SAFE_RELEASE( g_DepthStencil);	
 	SAFE_RELEASE( g_DepthStencilView); 
+	SAFE_RELEASE( g_MLAADepthStencil );
+	SAFE_RELEASE( g_MLAADepthStencilView );
+
+	SAFE_RELEASE( g_CPUSceneColor );
+	ReleaseCPUQueue();
+
+	SAFE_RELEASE( g_ComputeOutput );
+	SAFE_RELEASE( g_ComputeOutputSRV );
+	SAFE_RELEASE( g_ComputeOutputUAV );
 
 
 	g_Width = (float)pBackBufferSurfaceDesc->Width;
 	g_Height = (float)pBackBufferSurfaceDesc->Height;
 
-	// Create other render resources here	
-    D3D11_TEXTURE2D_DESC td;
-	D3D11_RENDER_TARGET_VIEW_DESC rtvd;
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvd;
-
-	// Create offscreen render target
-    memset(&td, 0, sizeof(td));
-    td.ArraySize = 1;
-    td.Format = OFFSCREENFORMAT;
-	td.Height = pBackBufferSurfaceDesc->Height;
-	td.Width = pBackBufferSurfaceDesc->Width;
-    td.CPUAccessFlags = 0;
-    td.MipLevels = 1;
-    td.MiscFlags = 0;
-	td.SampleDesc = pBackBufferSurfaceDesc->SampleDesc;    
-    td.Usage = D3D11_USAGE_DEFAULT;
-	if (g_MSAACount <= 1)
-		td.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;    
-	else
-		td.BindFlags = D3D11_BIND_RENDER_TARGET;    
-    V_RETURN(pd3dDevice->CreateTexture2D(&td, NULL, &g_SceneColor));
-    
-    memset(&rtvd, 0, sizeof(rtvd));
-    rtvd.Format = OFFSCREENFORMAT;
-	if (g_MSAACount <= 1)
-		rtvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	else
-		rtvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DMS;
-    rtvd.Texture2D.MipSlice = 0;
-    V_RETURN(pd3dDevice->CreateRenderTargetView(g_SceneColor, &rtvd, &g_SceneColorRTV));
-    
-	if (g_MSAACount <= 1)
-	{
-		memset(&srvd, 0, sizeof(srvd));
-		srvd.Format = OFFSCREENFORMAT;
-		srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvd.Texture2D.MostDetailedMip = 0;
-		srvd.Texture2D.MipLevels = 1;
-		V_RETURN(pd3dDevice->CreateShaderResourceView(g_SceneColor, &srvd, &g_SceneColorSRV));
-	}
+	// Hand the surfaces back to the pool, the ones that still fit are reused below
+	g_TargetPool.ReleaseAll();
+
+	// Create offscreen render target. The pool may return a larger surface, the passes only
+	// touch the back buffer sized viewport of it.
+	MLAA::SurfaceDesc sd;
+	sd.Width = pBackBufferSurfaceDesc->Width;
+	sd.Height = pBackBufferSurfaceDesc->Height;
+	sd.Format = OFFSCREENFORMAT;
+	sd.ViewFormat = OFFSCREENFORMAT;
+	sd.SampleCount = g_MSAACount;
+	sd.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	sd.Usage = D3D11_USAGE_DEFAULT;
+	V_RETURN(AcquireTarget(sd, false, &g_SceneColor, &g_SceneColorRTV, &g_SceneColorSRV, NULL));
+
+	// Everything else matches the scene color surface so resolves and copies see equal sizes
+	D3D11_TEXTURE2D_DESC td;
+	g_SceneColor->GetDesc(&td);
+	sd.Width = td.Width;
+	sd.Height = td.Height;
 
 	if (g_MSAACount > 1)
 	{
-		// Create resolved offscreen render target when MSAA is enabled
-		memset(&td, 0, sizeof(td));
-		td.ArraySize = 1;
-		td.Format = OFFSCREENFORMAT;
-		td.Height = pBackBufferSurfaceDesc->Height;
-		td.Width = pBackBufferSurfaceDesc->Width;
-		td.CPUAccessFlags = 0;
-		td.MipLevels = 1;
-		td.MiscFlags = 0;
-		td.SampleDesc.Count = 1;
-		td.SampleDesc.Quality = 0;
-		td.Usage = D3D11_USAGE_DEFAULT;
-		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;    
-		V_RETURN(pd3dDevice->CreateTexture2D(&td, NULL, &g_ResolvedSceneColor));
-	    
-		memset(&srvd, 0, sizeof(srvd));
-		srvd.Format = OFFSCREENFORMAT;
-		srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvd.Texture2D.MostDetailedMip = 0;
-		srvd.Texture2D.MipLevels = 1;
-		V_RETURN(pd3dDevice->CreateShaderResourceView(g_ResolvedSceneColor, &srvd, &g_ResolvedSceneColorSRV));
+		// Create resolved offscreen render target when MSAA is enabled. MSAA aware edge detection 
+		// writes the resolved color as a second render target
+		sd.SampleCount = 1;
+		V_RETURN(AcquireTarget(sd, true, &g_ResolvedSceneColor, &g_ResolvedSceneColorRTV, &g_ResolvedSceneColorSRV, NULL));
 	}
 
-	// Create edge mask render target
-    memset(&td, 0, sizeof(td));
-    td.ArraySize = 1;
-    td.Format = DXGI_FORMAT_R8_TYPELESS;
-	td.Height = pBackBufferSurfaceDesc->Height;
-	td.Width = pBackBufferSurfaceDesc->Width;
-    td.CPUAccessFlags = 0;
-    td.MipLevels = 1;
-    td.MiscFlags = 0;
-	td.SampleDesc.Count = 1;
-	td.SampleDesc.Quality = 0;
-    td.Usage = D3D11_USAGE_DEFAULT;
-	td.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;    
-    V_RETURN(pd3dDevice->CreateTexture2D(&td, NULL, &g_EdgeMask));
-    
-    memset(&rtvd, 0, sizeof(rtvd));
-    rtvd.Format = DXGI_FORMAT_R8_UINT;
-    rtvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-    rtvd.Texture2D.MipSlice = 0;
-    V_RETURN(pd3dDevice->CreateRenderTargetView(g_EdgeMask, &rtvd, &g_EdgeMaskRTV));
-    
-    memset(&srvd, 0, sizeof(srvd));
-    srvd.Format = DXGI_FORMAT_R8_UINT;
-    srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srvd.Texture2D.MostDetailedMip = 0;
-    srvd.Texture2D.MipLevels = 1;
-    V_RETURN(pd3dDevice->CreateShaderResourceView(g_EdgeMask, &srvd, &g_EdgeMaskSRV));
-
-	// Create edge count render target
-    memset(&td, 0, sizeof(td));
-    td.ArraySize = 1;
-    td.Format = DXGI_FORMAT_R8G8_TYPELESS;
-	td.Height = pBackBufferSurfaceDesc->Height;
-	td.Width = pBackBufferSurfaceDesc->Width;
-    td.CPUAccessFlags = 0;
-    td.MipLevels = 1;
-    td.MiscFlags = 0;
-	td.SampleDesc.Count = 1;
-	td.SampleDesc.Quality = 0;
-    td.Usage = D3D11_USAGE_DEFAULT;
-	td.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;    
-    V_RETURN(pd3dDevice->CreateTexture2D(&td, NULL, &g_EdgeCount));
-    
-    memset(&rtvd, 0, sizeof(rtvd));
-    rtvd.Format = DXGI_FORMAT_R8G8_UINT;
-    rtvd.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-    rtvd.Texture2D.MipSlice = 0;
-    V_RETURN(pd3dDevice->CreateRenderTargetView(g_EdgeCount, &rtvd, &g_EdgeCountRTV));
-    
-    memset(&srvd, 0, sizeof(srvd));
-    srvd.Format = DXGI_FORMAT_R8G8_UINT;
-    srvd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srvd.Texture2D.MostDetailedMip = 0;
-    srvd.Texture2D.MipLevels = 1;
-    V_RETURN(pd3dDevice->CreateShaderResourceView(g_EdgeCount, &srvd, &g_EdgeCountSRV));
-
+	// The intermediates of the passes are created here rather than on first use so they 
+	// are acquired while the pool still holds the surfaces of the previous size
+	MLAA::EffectSurface Input = { (g_MSAACount > 1) ? g_ResolvedSceneColorSRV : g_SceneColorSRV, (int)g_Width, (int)g_Height, 0 };
+	if (!g_MLAAEffect.CreateIntermediates(Input))
+		return E_OUTOFMEMORY;
 
 	D3D11_DEPTH_STENCIL_DESC desc;
     desc.DepthEnable = FALSE;
@@ -492,27 +923,34 @@ HRESULT CreateMLAARenderTargets(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DES
     desc.StencilEnable = FALSE;
     pd3dDevice->CreateDepthStencilState(&desc, &g_ScreenQuadDepthStencilState);	
 
-	memset(&td, 0, sizeof(td));
-	td.ArraySize = 1;
-    td.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-    td.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    td.Height = pBackBufferSurfaceDesc->Height;
-    td.Width = pBackBufferSurfaceDesc->Width;
-    td.CPUAccessFlags = 0;
-    td.MipLevels = 1;
-    td.MiscFlags = 0;
-    td.SampleDesc = pBackBufferSurfaceDesc->SampleDesc;
-    td.Usage = D3D11_USAGE_DEFAULT;
-      
-    V_RETURN(pd3dDevice->CreateTexture2D(&td, NULL, &g_DepthStencil));
-    D3D11_DEPTH_STENCIL_VIEW_DESC dsvd;
-    memset(&dsvd, 0, sizeof(dsvd));
-
-    dsvd.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-    dsvd.Flags = 0;
-	dsvd.ViewDimension = (pBackBufferSurfaceDesc->SampleDesc.Count > 1) ? D3D11_DSV_DIMENSION_TEXTURE2DMS : D3D11_DSV_DIMENSION_TEXTURE2D;
-    dsvd.Texture2D.MipSlice = 0;
-    V_RETURN(pd3dDevice->CreateDepthStencilView(g_DepthStencil, &dsvd, &g_DepthStencilView));
+	sd.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	sd.ViewFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	sd.SampleCount = g_MSAACount;
+	sd.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	V_RETURN(AcquireTarget(sd, true, &g_DepthStencil, NULL, NULL, &g_DepthStencilView));
+
+	// The MLAA passes render to single sampled targets, so they need their own stencil when the scene is multisampled
+	if (g_MSAACount > 1)
+	{
+		sd.SampleCount = 1;
+		V_RETURN(AcquireTarget(sd, true, &g_MLAADepthStencil, NULL, NULL, &g_MLAADepthStencilView));
+	}
+	else
+	{
+		g_MLAADepthStencilView = g_DepthStencilView;
+		g_MLAADepthStencilView->AddRef();
+	}
+
+	// Create the staging texture used to read the scene color back for CPU MLAA
+	sd.Format = OFFSCREENFORMAT;
+	sd.ViewFormat = OFFSCREENFORMAT;
+	sd.SampleCount = 1;
+	sd.BindFlags = 0;
+	sd.Usage = D3D11_USAGE_STAGING;
+	V_RETURN(AcquireTarget(sd, true, &g_CPUSceneColor, NULL, NULL, NULL));
+
+	// Free whatever the new size didn't reuse
+	g_TargetPool.Trim();
             
 	return S_OK;
 }
@@ -531,7 +969,6 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
 
 	g_Width = (float)pBackBufferSurfaceDesc->Width;
 	g_Height = (float)pBackBufferSurfaceDesc->Height;
-	g_MSAACount = pBackBufferSurfaceDesc->SampleDesc.Count;
 
 	// Hooks to various AMD helper classes
     g_MagnifyTool.OnCreateDevice( pd3dDevice );
@@ -621,6 +1058,7 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
     DXUT_SetDebugName( g_pcbVSPerFrame11, "CB_VS_PER_FRAME" );
 
 	// Create other render resources here	
+	g_TargetAllocator.SetDevice(pd3dDevice);
 	CreateMLAARenderTargets(pd3dDevice, pBackBufferSurfaceDesc);
 
 	// Create a layout for the screen quad vertex
@@ -677,6 +1115,13 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
                                              pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgePSStencilPS ) );	
     DXUT_SetDebugName( g_pSeparateEdgePSStencilPS, "g_pComputeEdgeUsingStencilPS" );	
 
+	// create MSAA aware first pass pixel shader which resolves the scene and detects the edges.
+	V_RETURN( D3DCompileFromFile( str, NULL, NULL, "MLAA_SeperatingLinesMSAA_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeMSAAPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeMSAAPS, "g_pSeparateEdgeMSAAPS" );	
+
 
 	// create second pass pixel shader which conpute the length of edges.
 	V_RETURN( D3DCompileFromFile( str, NULL, NULL, "MLAA_ComputeLineLength_PS", "ps_4_0", dwShaderFlags, 0, 
@@ -710,6 +1155,227 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
                                              pPixelShaderBuffer->GetBufferSize(), NULL, &g_pClearPS ) );	
     DXUT_SetDebugName( g_pClearPS, "MLAA_Clear_PS" );			
 
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_Copy_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pCopyPS ) );	
+    DXUT_SetDebugName( g_pCopyPS, "MLAA_Copy_PS" );			
+
+	// create the half resolution edge detection permutations
+	ShaderMacros[0].Name = "HALF_RES_EDGES";
+    ShaderMacros[0].Definition = "1";
+	ShaderMacros[1].Name = NULL;
+    ShaderMacros[1].Definition = "1";
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLines_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeHalfResPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeHalfResPS, "g_pSeparateEdgeHalfResPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_ComputeLineLength_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeHalfResPS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeHalfResPS, "g_pComputeEdgeHalfResPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pBlendColorHalfResPS ) );	
+    DXUT_SetDebugName( g_pBlendColorHalfResPS, "g_pBlendColorHalfResPS" );	
+
+	ShaderMacros[1].Name = "USE_STENCIL";
+    ShaderMacros[1].Definition = "1";
+	ShaderMacros[2].Name = NULL;
+    ShaderMacros[2].Definition = "1";
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLines_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeHalfResStencilPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeHalfResStencilPS, "g_pSeparateEdgeHalfResStencilPS" );	
+
+	ShaderMacros[1].Name = "SHOW_EDGES";
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pShowEdgesHalfResPS ) );	
+    DXUT_SetDebugName( g_pShowEdgesHalfResPS, "g_pShowEdgesHalfResPS" );	
+
+	// create the gather permutations of the first pass
+	ShaderMacros[0].Name = "USE_GATHER";
+	ShaderMacros[1].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLines_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeGatherPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeGatherPS, "g_pSeparateEdgeGatherPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLinesQuad_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeQuadPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeQuadPS, "g_pSeparateEdgeQuadPS" );	
+
+	ShaderMacros[1].Name = "USE_STENCIL";
+	ShaderMacros[2].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLines_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeGatherStencilPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeGatherStencilPS, "g_pSeparateEdgeGatherStencilPS" );	
+
+	// create the quality map permutations of the last two passes
+	ShaderMacros[0].Name = "USE_QUALITY_MAP";
+	ShaderMacros[1].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_ComputeLineLength_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeFoveatedPS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeFoveatedPS, "g_pComputeEdgeFoveatedPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pBlendColorFoveatedPS ) );	
+    DXUT_SetDebugName( g_pBlendColorFoveatedPS, "g_pBlendColorFoveatedPS" );	
+
+	// create the long edge permutations, 8 bits per side of the counts
+	ShaderMacros[0].Name = "MAX_EDGE_COUNT_BITS";
+    ShaderMacros[0].Definition = "8";
+	ShaderMacros[1].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_ComputeLineLength_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeLongPS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeLongPS, "g_pComputeEdgeLongPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pBlendColorLongPS ) );	
+    DXUT_SetDebugName( g_pBlendColorLongPS, "g_pBlendColorLongPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_EdgeBlocksH_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pEdgeBlocksHPS ) );	
+    DXUT_SetDebugName( g_pEdgeBlocksHPS, "g_pEdgeBlocksHPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_EdgeBlocksV_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pEdgeBlocksVPS ) );	
+    DXUT_SetDebugName( g_pEdgeBlocksVPS, "g_pEdgeBlocksVPS" );	
+
+	ShaderMacros[1].Name = "SHOW_EDGES";
+    ShaderMacros[1].Definition = "1";
+	ShaderMacros[2].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pShowEdgesLongPS ) );	
+    DXUT_SetDebugName( g_pShowEdgesLongPS, "g_pShowEdgesLongPS" );	
+
+	// The block walk uses firstbitlow and firstbithigh
+	ShaderMacros[1].Name = "HIERARCHICAL_SEARCH";
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_ComputeLineLength_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeHierarchicalPS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeHierarchicalPS, "g_pComputeEdgeHierarchicalPS" );	
+
+	ShaderMacros[0].Name = "SHOW_EDGES";
+    ShaderMacros[0].Definition = "1";
+	ShaderMacros[1].Name = NULL;
+
+	// create the atlas variants of the passes, the views are instances of a quad generated by the vertex shader
+    const D3D11_INPUT_ELEMENT_DESC AtlasViewLayout[] =
+    {
+        { "VIEW_REGION",    0, DXGI_FORMAT_R32G32B32A32_SINT, 0,  0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "VIEW_THRESHOLD", 0, DXGI_FORMAT_R32_FLOAT,         0, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+    SAFE_RELEASE( pVertexShaderBuffer );
+    V_RETURN( D3DCompileFromFile( str, NULL, NULL, "AtlasViewVS", "vs_4_0", dwShaderFlags, 0, 
+                                  &pVertexShaderBuffer, NULL ) );   
+    V_RETURN( pd3dDevice->CreateVertexShader( pVertexShaderBuffer->GetBufferPointer(),
+                                              pVertexShaderBuffer->GetBufferSize(), NULL, &g_pAtlasViewVS ) );
+    DXUT_SetDebugName( g_pAtlasViewVS, "AtlasViewVS" );
+	V_RETURN( pd3dDevice->CreateInputLayout( AtlasViewLayout, ARRAYSIZE( AtlasViewLayout ), pVertexShaderBuffer->GetBufferPointer(), pVertexShaderBuffer->GetBufferSize(), &g_pAtlasViewLayout ) );	    
+
+	V_RETURN( D3DCompileFromFile( str, NULL, NULL, "MLAA_SeperatingLinesAtlas_PS", "ps_5_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeAtlasPS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeAtlasPS, "g_pSeparateEdgeAtlasPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, NULL, NULL, "MLAA_ComputeLineLengthAtlas_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeAtlasPS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeAtlasPS, "g_pComputeEdgeAtlasPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, NULL, NULL, "MLAA_BlendColorAtlas_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pBlendColorAtlasPS ) );	
+    DXUT_SetDebugName( g_pBlendColorAtlasPS, "g_pBlendColorAtlasPS" );	
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColorAtlas_PS", "ps_4_0", dwShaderFlags, 0, 
+                                  &pPixelShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreatePixelShader( pPixelShaderBuffer->GetBufferPointer(),
+                                             pPixelShaderBuffer->GetBufferSize(), NULL, &g_pShowEdgesAtlasPS ) );	
+    DXUT_SetDebugName( g_pShowEdgesAtlasPS, "g_pShowEdgesAtlasPS" );	
+
+	// create the compute shader passes
+	ID3DBlob* pComputeShaderBuffer = NULL;
+	ShaderMacros[0].Name = "COMPUTE_PASSES";
+    ShaderMacros[0].Definition = "1";
+	ShaderMacros[1].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_SeperatingLines_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pSeparateEdgeCS ) );	
+    DXUT_SetDebugName( g_pSeparateEdgeCS, "g_pSeparateEdgeCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_ComputeLineLength_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pComputeEdgeCS ) );	
+    DXUT_SetDebugName( g_pComputeEdgeCS, "g_pComputeEdgeCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pBlendColorCS ) );	
+    DXUT_SetDebugName( g_pBlendColorCS, "g_pBlendColorCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_Tile_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pTileCS ) );	
+    DXUT_SetDebugName( g_pTileCS, "g_pTileCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
+	ShaderMacros[1].Name = "SHOW_EDGES";
+    ShaderMacros[1].Definition = "1";
+	ShaderMacros[2].Name = NULL;
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_BlendColor_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pShowEdgesCS ) );	
+    DXUT_SetDebugName( g_pShowEdgesCS, "g_pShowEdgesCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
+	V_RETURN( D3DCompileFromFile( str, ShaderMacros, NULL, "MLAA_Tile_CS", "cs_5_0", dwShaderFlags, 0, 
+                                  &pComputeShaderBuffer, NULL ) );
+	V_RETURN( pd3dDevice->CreateComputeShader( pComputeShaderBuffer->GetBufferPointer(),
+                                               pComputeShaderBuffer->GetBufferSize(), NULL, &g_pShowEdgesTileCS ) );	
+    DXUT_SetDebugName( g_pShowEdgesTileCS, "g_pShowEdgesTileCS" );	
+	SAFE_RELEASE( pComputeShaderBuffer );
+
 
 	// No longer need the shader blobs
     SAFE_RELEASE( pVertexShaderBuffer );
@@ -742,11 +1408,17 @@ HRESULT CALLBACK OnD3D11CreateDevice( ID3D11Device* pd3dDevice, const DXGI_SURFA
         BlendDesc.RenderTarget[i].BlendEnable = FALSE;        
     }
 	V_RETURN( pd3dDevice->CreateBlendState( &BlendDesc, &g_pNoBlendingBS ) );
+
+	D3D11_RASTERIZER_DESC RasterizerDesc;
+	memset(&RasterizerDesc, 0, sizeof(RasterizerDesc));
+	RasterizerDesc.FillMode = D3D11_FILL_SOLID;
+	RasterizerDesc.CullMode = D3D11_CULL_NONE;
+	RasterizerDesc.DepthClipEnable = TRUE;
+	RasterizerDesc.ScissorEnable = TRUE;
+	V_RETURN( pd3dDevice->CreateRasterizerState( &RasterizerDesc, &g_pScissorRS ) );
 	
-	// create constant buffer for MLAA
-	cbDesc.ByteWidth = sizeof( CB_MLAA );
-    V_RETURN( pd3dDevice->CreateBuffer( &cbDesc, NULL, &g_pcbMLAA11 ) );
-    DXUT_SetDebugName( g_pcbMLAA11, "CB_MLAA" );
+	// Constant buffer and upload buffers of the MLAA passes
+	V_RETURN( g_D3D11Backend.CreateDeviceObjects( pd3dDevice ) );
 
     static bool bFirstPass = true;
 
@@ -817,7 +1489,7 @@ void RenderScene(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateCon
 	TIMER_Reset();
 
 	ID3D11RenderTargetView* RTVArray[3] = {NULL, NULL, NULL};
-	if (g_bShowMLAA)
+	if (g_bShowMLAA || g_MSAACount > 1)
 	{
 		RTVArray[0] = g_SceneColorRTV;		
 	}
@@ -877,142 +1549,1026 @@ void RenderScene(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateCon
     // Render the scene mesh 
 	g_SceneMesh.Render( pd3dImmediateContext, 0 );	
 	
-	// Resolve the offscreen if MSAA is enabled
+	// Resolve the offscreen if MSAA is enabled. The MSAA aware GPU edge detection does its own resolve.
 	if (g_MSAACount > 1)
 	{
-		pd3dImmediateContext->ResolveSubresource(g_ResolvedSceneColor, 0, g_SceneColor, 0, OFFSCREENFORMAT);
+		if (!g_bShowMLAA)
+		{
+			// The pooled surfaces can be larger than the back buffer, so resolve then copy the visible part
+			pd3dImmediateContext->ResolveSubresource(g_ResolvedSceneColor, 0, g_SceneColor, 0, OFFSCREENFORMAT);
+
+			ID3D11Resource* pBackBuffer = NULL;
+			DXUTGetD3D11RenderTargetView()->GetResource(&pBackBuffer);
+			D3D11_BOX Box = { 0, 0, 0, (UINT)g_Width, (UINT)g_Height, 1 };
+			pd3dImmediateContext->CopySubresourceRegion(pBackBuffer, 0, 0, 0, 0, g_ResolvedSceneColor, 0, &Box);
+			SAFE_RELEASE(pBackBuffer);
+		}
+		else if (!g_bMSAAAwareMLAA || g_bUseCPUMLAA || g_bMLAAMagnifiedRegion || g_nAtlasMode != ATLAS_MODE_OFF)
+		{
+			pd3dImmediateContext->ResolveSubresource(g_ResolvedSceneColor, 0, g_SceneColor, 0, OFFSCREENFORMAT);
+		}
+
+		pd3dImmediateContext->ClearDepthStencilView( g_MLAADepthStencilView, D3D11_CLEAR_STENCIL, 1.0, 0 );
 	}	
 }
 //--------------------------------------------------------------------------------------
-// Render MLAA post processing 
+// Wait for the frames still in flight and free the CPU MLAA queue
 //--------------------------------------------------------------------------------------
-void RenderMLAA(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
-{	
-	static int Count = 0;
-	static float T = 0.0f, T1 = 0.0f, T2 = 0.0f, T3 = 0.0f;	
-	static float ZeroColor[4] = {0, 0, 0, 0};
-	
-	if (g_bShowMLAA)
-	{	
-		ID3D11ShaderResourceView* SRVArray[3] = {NULL, NULL, NULL};
-
-		// Upload constants
-		D3D11_MAPPED_SUBRESOURCE MappedResource;
-		pd3dImmediateContext->Map( g_pcbMLAA11, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource );
-		CB_MLAA* pMLAAParam = ( CB_MLAA* )MappedResource.pData;
-		pMLAAParam->m_Param = XMVectorSet( g_Width, g_Height, 1.0f/gEdgeDetectionThreshold, 0.0f);
-		pd3dImmediateContext->Unmap( g_pcbMLAA11, 0 );
-		pd3dImmediateContext->PSSetConstantBuffers( 0, 1, &g_pcbMLAA11 );
-		const float BlendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-		pd3dImmediateContext->OMSetBlendState(g_pNoBlendingBS, BlendFactor, 0xffffffff);		
-	
-		TIMER_Begin(0, L"Pass1");
-			// 1st pass, detect edges ---------------------------------------------------------------------			
-			// Set render resources
-			pd3dImmediateContext->IASetInputLayout( g_pScreenQuadLayout );
-			UINT Offset[1] = {0};		
-			UINT Stride[1] = {sizeof(float)*6};
-			pd3dImmediateContext->IASetVertexBuffers(0, 1, &g_pScreenQuadVB, Stride, Offset);
-			pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-			pd3dImmediateContext->VSSetShader( g_pScreenQuadVS, NULL, 0 );						
-			
-			ID3D11RenderTargetView* pRTV = g_EdgeMaskRTV; 
-			if (g_bUseStencilBuffer)
-			{				
-				pd3dImmediateContext->PSSetShader( g_pSeparateEdgePSStencilPS, NULL, 0 );
-				pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, g_DepthStencilView);	       			
-				pd3dImmediateContext->ClearRenderTargetView( g_EdgeMaskRTV, ZeroColor );	
-				pd3dImmediateContext->OMSetDepthStencilState(g_DepthStencilState, 1);
-			}
-			else
-			{		
-				pd3dImmediateContext->PSSetShader( g_pSeparateEdgePS, NULL, 0 );				
-				pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, NULL);	       					
-			}						
-			
-			if (g_MSAACount > 1)
-				SRVArray[0] = g_ResolvedSceneColorSRV;			
-			else
-				SRVArray[0] = g_SceneColorSRV;			
-			pd3dImmediateContext->PSSetShaderResources(0, 3, SRVArray);
-            pd3dImmediateContext->PSSetSamplers( 1, 1, &g_pSceneColorSam );
-			pd3dImmediateContext->Draw(4, 0);
-		TIMER_End( );		
+void ReleaseCPUQueue()
+{
+	SAFE_DELETE(g_pCPUQueue);
+	for (int i = 0; i < MAX_CPU_FRAMES_IN_FLIGHT; i++)
+	{
+		g_CPUFrames[i].Done = std::future<MLAA::FrameResult>();
+	}
+	g_nCPUFrameHead = 0;
+}
+//--------------------------------------------------------------------------------------
+// Grow a region by a halo and clip it to the back buffer
+//--------------------------------------------------------------------------------------
+D3D11_BOX RegionToBox(const RECT& Region, int Halo)
+{
+	LONG Left = std::min(std::max(Region.left - Halo, (LONG)0), (LONG)g_Width);
+	LONG Top = std::min(std::max(Region.top - Halo, (LONG)0), (LONG)g_Height);
+	LONG Right = std::max(std::min(Region.right + Halo, (LONG)g_Width), Left);
+	LONG Bottom = std::max(std::min(Region.bottom + Halo, (LONG)g_Height), Top);
+
+	D3D11_BOX Box;
+	Box.left = (UINT)Left;
+	Box.top = (UINT)Top;
+	Box.right = (UINT)Right;
+	Box.bottom = (UINT)Bottom;
+	Box.front = 0;
+	Box.back = 1;
+	return Box;
+}
+void SetScissorRegion(ID3D11DeviceContext* pd3dImmediateContext, const MLAA::Rect* pRegion, int Halo)
+{
+	if (pRegion)
+	{
+		RECT Region = { pRegion->Left, pRegion->Top, pRegion->Right, pRegion->Bottom };
+		D3D11_BOX Box = RegionToBox(Region, Halo);
+		D3D11_RECT Scissor = { (LONG)Box.left, (LONG)Box.top, (LONG)Box.right, (LONG)Box.bottom };
+		pd3dImmediateContext->RSSetScissorRects(1, &Scissor);
+	}
+}
+//--------------------------------------------------------------------------------------
+// Split the frame into a grid of atlas views. Every other view uses twice the threshold,
+// which shows that each view is processed with its own settings.
+//--------------------------------------------------------------------------------------
+void BuildAtlasViews()
+{
+	int Width = (int)g_Width;
+	int Height = (int)g_Height;
+	int Columns = (Width + ATLAS_VIEW_SIZE - 1) / ATLAS_VIEW_SIZE;
+	int Rows = (Height + ATLAS_VIEW_SIZE - 1) / ATLAS_VIEW_SIZE;
+
+	g_AtlasViews.resize((size_t)Columns * Rows);
+	for (int y = 0; y < Rows; y++)
+	{
+		for (int x = 0; x < Columns; x++)
+		{
+			MLAA::View& View = g_AtlasViews[y * Columns + x];
+			View.Region.Left = x * ATLAS_VIEW_SIZE;
+			View.Region.Top = y * ATLAS_VIEW_SIZE;
+			View.Region.Right = std::min(View.Region.Left + ATLAS_VIEW_SIZE, Width);
+			View.Region.Bottom = std::min(View.Region.Top + ATLAS_VIEW_SIZE, Height);
+			View.fThreshold = (((x + y) & 1) ? 2.0f : 1.0f) * g_FrameSettings.fThreshold;
+		}
+	}
+}
+//--------------------------------------------------------------------------------------
+// Quality map of the frame, radial around the center of the screen for foveated MLAA and
+// limited to short edges when the governor asks for it, and the number of tiles at each level
+//--------------------------------------------------------------------------------------
+void BuildQualityMap()
+{
+	float InnerRadius = g_bFoveatedMLAA ? g_Height * FOVEA_INNER_RADIUS : g_Width + g_Height;
+	float OuterRadius = g_bFoveatedMLAA ? g_Height * FOVEA_OUTER_RADIUS : g_Width + g_Height;
+	MLAA::BuildFoveatedQualityMap((int)g_Width, (int)g_Height, QUALITY_TILE_SIZE, g_Width * 0.5f, g_Height * 0.5f,
+		InnerRadius, OuterRadius, g_QualityLevels, g_QualityMap);
+	if (g_FrameSettings.bShortEdges)
+	{
+		for (size_t i = 0; i < g_QualityLevels.size(); i++)
+			g_QualityLevels[i] = std::min(g_QualityLevels[i], (uint8_t)MLAA::QUALITY_SHORT_EDGES);
+	}
+
+	memset(g_nQualityTiles, 0, sizeof(g_nQualityTiles));
+	for (size_t i = 0; i < g_QualityLevels.size(); i++)
+		g_nQualityTiles[g_QualityLevels[i]]++;
+}
+//--------------------------------------------------------------------------------------
+// D3D11 backend of MLAA::Effect
+//--------------------------------------------------------------------------------------
+D3D11EffectBackend::D3D11EffectBackend() :
+	m_pDevice(NULL),
+	m_pConstants(NULL),
+	m_pViewVB(NULL),
+	m_nViewCapacity(0),
+	m_pQualityMapTexture(NULL),
+	m_pQualityMapSRV(NULL),
+	m_nWidth(0),
+	m_nHeight(0)
+{
+	memset(&m_EdgeMask, 0, sizeof(m_EdgeMask));
+	memset(&m_EdgeCount, 0, sizeof(m_EdgeCount));
+	memset(&m_LongEdgeCount, 0, sizeof(m_LongEdgeCount));
+	memset(&m_EdgeBlocksH, 0, sizeof(m_EdgeBlocksH));
+	memset(&m_EdgeBlocksV, 0, sizeof(m_EdgeBlocksV));
+}
+
+HRESULT D3D11EffectBackend::CreateDeviceObjects(ID3D11Device* pDevice)
+{
+	HRESULT hr;
+
+	m_pDevice = pDevice;
+
+	D3D11_BUFFER_DESC bd;
+	bd.Usage = D3D11_USAGE_DYNAMIC;
+	bd.ByteWidth = sizeof( CB_MLAA );
+	bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bd.MiscFlags = 0;
+	bd.StructureByteStride = 0;
+	V_RETURN( pDevice->CreateBuffer( &bd, NULL, &m_pConstants ) );
+	DXUT_SetDebugName( m_pConstants, "CB_MLAA" );
+
+	return S_OK;
+}
+
+void D3D11EffectBackend::ReleaseDeviceObjects()
+{
+	SAFE_RELEASE( m_pConstants );
+	SAFE_RELEASE( m_pViewVB );
+	m_nViewCapacity = 0;
+	SAFE_RELEASE( m_pQualityMapSRV );
+	SAFE_RELEASE( m_pQualityMapTexture );
+	m_pDevice = NULL;
+}
+
+bool D3D11EffectBackend::CreateIntermediates(const MLAA::EffectSurface& Input)
+{
+	m_nWidth = Input.Width;
+	m_nHeight = Input.Height;
+
+	// The intermediates match the texture of the input, which the pool may have made larger
+	// than the frame, so the passes can share the stencil of the scene
+	D3D11_TEXTURE2D_DESC td;
+	td.Width = (UINT)Input.Width;
+	td.Height = (UINT)Input.Height;
+	if (Input.pHandle)
+	{
+		ID3D11Texture2D* pTexture = NULL;
+		((ID3D11ShaderResourceView*)Input.pHandle)->GetResource((ID3D11Resource**)&pTexture);
+		pTexture->GetDesc(&td);
+		SAFE_RELEASE( pTexture );
+	}
+
+	// Edge mask, the quad edge detection and the compute passes write it as a UAV
+	MLAA::SurfaceDesc sd;
+	sd.Width = td.Width;
+	sd.Height = td.Height;
+	sd.Format = DXGI_FORMAT_R8_TYPELESS;
+	sd.ViewFormat = DXGI_FORMAT_R8_UINT;
+	sd.SampleCount = 1;
+	sd.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	sd.Usage = D3D11_USAGE_DEFAULT;
+	if (FAILED(AcquireTarget(sd, true, &m_EdgeMask.pTexture, &m_EdgeMask.pRTV, &m_EdgeMask.pSRV, NULL, &m_EdgeMask.pUAV)))
+		return false;
+
+	// Edge counts, written as a UAV by the compute passes
+	sd.Format = DXGI_FORMAT_R8G8_TYPELESS;
+	sd.ViewFormat = DXGI_FORMAT_R8G8_UINT;
+	sd.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	if (FAILED(AcquireTarget(sd, true, &m_EdgeCount.pTexture, &m_EdgeCount.pRTV, &m_EdgeCount.pSRV, NULL, &m_EdgeCount.pUAV)))
+		return false;
+	sd.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+
+	// Long edge counts hold 8 bits per side
+	sd.Format = DXGI_FORMAT_R16G16_TYPELESS;
+	sd.ViewFormat = DXGI_FORMAT_R16G16_UINT;
+	if (FAILED(AcquireTarget(sd, true, &m_LongEdgeCount.pTexture, &m_LongEdgeCount.pRTV, &m_LongEdgeCount.pSRV, NULL)))
+		return false;
+
+	// Block summaries of the hierarchical search, one texel per 8 pixels of a row or a column
+	sd.Format = DXGI_FORMAT_R8_TYPELESS;
+	sd.ViewFormat = DXGI_FORMAT_R8_UINT;
+	sd.Width = (td.Width + 7) / 8;
+	if (FAILED(AcquireTarget(sd, true, &m_EdgeBlocksH.pTexture, &m_EdgeBlocksH.pRTV, &m_EdgeBlocksH.pSRV, NULL)))
+		return false;
+	sd.Width = td.Width;
+	sd.Height = (td.Height + 7) / 8;
+	if (FAILED(AcquireTarget(sd, true, &m_EdgeBlocksV.pTexture, &m_EdgeBlocksV.pRTV, &m_EdgeBlocksV.pSRV, NULL)))
+		return false;
+
+	return true;
+}
+
+void D3D11EffectBackend::ReleaseIntermediates()
+{
+	D3D11EffectTarget* pTargets[] = { &m_EdgeMask, &m_EdgeCount, &m_LongEdgeCount, &m_EdgeBlocksH, &m_EdgeBlocksV };
+	for (int i = 0; i < (int)ARRAYSIZE(pTargets); i++)
+	{
+		SAFE_RELEASE( pTargets[i]->pTexture );
+		SAFE_RELEASE( pTargets[i]->pRTV );
+		SAFE_RELEASE( pTargets[i]->pSRV );
+		SAFE_RELEASE( pTargets[i]->pUAV );
+	}
+	m_nWidth = 0;
+	m_nHeight = 0;
+}
+
+// The flags follow the settings as they are, RenderMLAA only sets combinations with shaders
+D3D11EffectBackend::PassOptions D3D11EffectBackend::GetPassOptions(const MLAA::EffectSettings& Settings)
+{
+	assert(Settings.pBackendOptions);
+
+	PassOptions o;
+	(D3D11PassOptions&)o = *(const D3D11PassOptions*)Settings.pBackendOptions;
+	o.pRegion = Settings.pRegion;
+	o.nViews = Settings.nViews;
+	o.bAtlas = (Settings.pViews != NULL);
+	o.bHalfRes = (Settings.DetectionResolution == MLAA::DETECTION_HALF);
+	o.bGatherQuads = (Settings.DetectionKernel == MLAA::DETECTION_KERNEL_QUAD);
+	o.bFoveated = (Settings.pQualityMap != NULL);
+	o.bLongEdges = (Settings.EdgeSearch != MLAA::EDGE_SEARCH_SHORT);
+	o.bHierarchical = (Settings.EdgeSearch == MLAA::EDGE_SEARCH_LONG);
+	return o;
+}
+
+// Upload the atlas views to the instance buffer, growing it as needed
+HRESULT D3D11EffectBackend::UploadViews(ID3D11DeviceContext* pContext, const MLAA::View* pViews, int nViews)
+{
+	HRESULT hr;
+
+	if (nViews > m_nViewCapacity)
+	{
+		SAFE_RELEASE( m_pViewVB );
+		m_nViewCapacity = 0;
+
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = (UINT)(nViews * sizeof(MLAA::View));
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.MiscFlags = 0;
+		bd.StructureByteStride = 0;
+		V_RETURN( m_pDevice->CreateBuffer(&bd, NULL, &m_pViewVB) );
+		DXUT_SetDebugName( m_pViewVB, "AtlasViews" );
+		m_nViewCapacity = nViews;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	V_RETURN( pContext->Map( m_pViewVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource ) );
+	memcpy( MappedResource.pData, pViews, nViews * sizeof(MLAA::View) );
+	pContext->Unmap( m_pViewVB, 0 );
+
+	return S_OK;
+}
+
+// Upload the quality map, the texture is recreated when the number of tiles changes
+HRESULT D3D11EffectBackend::UploadQualityMap(ID3D11DeviceContext* pContext, const MLAA::QualityMap& Map)
+{
+	HRESULT hr;
+
+	D3D11_TEXTURE2D_DESC td;
+	if (m_pQualityMapTexture)
+		m_pQualityMapTexture->GetDesc(&td);
+	if (m_pQualityMapTexture == NULL || (int)td.Width != Map.Columns || (int)td.Height != Map.Rows)
+	{
+		SAFE_RELEASE( m_pQualityMapSRV );
+		SAFE_RELEASE( m_pQualityMapTexture );
+
+		memset(&td, 0, sizeof(td));
+		td.Width = Map.Columns;
+		td.Height = Map.Rows;
+		td.MipLevels = 1;
+		td.ArraySize = 1;
+		td.Format = DXGI_FORMAT_R8_UINT;
+		td.SampleDesc.Count = 1;
+		td.Usage = D3D11_USAGE_DYNAMIC;
+		td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		td.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		V_RETURN( m_pDevice->CreateTexture2D(&td, NULL, &m_pQualityMapTexture) );
+		DXUT_SetDebugName( m_pQualityMapTexture, "QualityMap" );
+		V_RETURN( m_pDevice->CreateShaderResourceView(m_pQualityMapTexture, NULL, &m_pQualityMapSRV) );
+	}
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	V_RETURN( pContext->Map( m_pQualityMapTexture, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource ) );
+	for (int y = 0; y < Map.Rows; y++)
+		memcpy( (uint8_t*)MappedResource.pData + y * MappedResource.RowPitch, Map.pLevels + y * Map.Columns, Map.Columns );
+	pContext->Unmap( m_pQualityMapTexture, 0 );
+
+	return S_OK;
+}
+
+// Bind the geometry of a pass: a full screen quad, or a quad per atlas view
+void D3D11EffectBackend::SetGeometry(const PassOptions& o, bool bAtlas)
+{
+	UINT Offset[1] = {0};
+	if (bAtlas)
+	{
+		UINT Stride[1] = {sizeof(MLAA::View)};
+		o.pContext->IASetInputLayout( g_pAtlasViewLayout );
+		o.pContext->IASetVertexBuffers(0, 1, &m_pViewVB, Stride, Offset);
+		o.pContext->VSSetShader( g_pAtlasViewVS, NULL, 0 );
+	}
+	else
+	{
+		UINT Stride[1] = {sizeof(float)*6};
+		o.pContext->IASetInputLayout( g_pScreenQuadLayout );
+		o.pContext->IASetVertexBuffers(0, 1, &g_pScreenQuadVB, Stride, Offset);
+		o.pContext->VSSetShader( g_pScreenQuadVS, NULL, 0 );
+	}
+	o.pContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+}
 
+// Draw a pass. Atlas views take a single instanced draw, or one draw per view to compare against
+void D3D11EffectBackend::DrawPass(const PassOptions& o, bool bAtlas)
+{
+	if (!bAtlas)
+	{
+		o.pContext->Draw(4, 0);
+	}
+	else if (!o.bDrawViewsSeparately)
+	{
+		o.pContext->DrawInstanced(4, (UINT)o.nViews, 0, 0);
+	}
+	else
+	{
+		for (UINT i = 0; i < (UINT)o.nViews; i++)
+			o.pContext->DrawInstanced(4, 1, 0, i);
+	}
+}
+
+void D3D11EffectBackend::SetFullViewport(ID3D11DeviceContext* pContext)
+{
+	D3D11_VIEWPORT Viewport = { 0.0f, 0.0f, (float)m_nWidth, (float)m_nHeight, 0.0f, 1.0f };
+	pContext->RSSetViewports(1, &Viewport);
+}
+
+// One thread per pixel in the square groups of the COMPUTE_PASSES shaders, 8x8 for the 
+// separate passes and 16x16 for the tile shader
+void D3D11EffectBackend::Dispatch(ID3D11DeviceContext* pContext, ID3D11ComputeShader* pShader, int nGroupSize)
+{
+	pContext->CSSetShader(pShader, NULL, 0);
+	pContext->Dispatch((UINT)((m_nWidth + nGroupSize - 1) / nGroupSize), (UINT)((m_nHeight + nGroupSize - 1) / nGroupSize), 1);
+}
+
+double D3D11EffectBackend::GetPassTime(MLAA::PASS Pass) const
+{
+	static const WCHAR* s_PassNames[MLAA::PASS_COUNT] = { L"Pass1", L"Pass2", L"Pass3" };
+	return TIMER_GetTime(Gpu, s_PassNames[Pass]) * 1000.0;
+}
+
+bool D3D11EffectBackend::DetectEdges(const MLAA::EffectSurface& Input, const MLAA::EffectSettings& Settings)
+{
+	static float ZeroColor[4] = {0, 0, 0, 0};
+	const PassOptions o = GetPassOptions(Settings);
+	ID3D11DeviceContext* pContext = o.pContext;
+
+	// Upload constants, the views and the quality map
+	if (o.bAtlas && FAILED(UploadViews(pContext, Settings.pViews, Settings.nViews)))
+		return false;
+	if (o.bFoveated && FAILED(UploadQualityMap(pContext, *Settings.pQualityMap)))
+		return false;
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	if (FAILED(pContext->Map( m_pConstants, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource )))
+		return false;
+	CB_MLAA* pMLAAParam = ( CB_MLAA* )MappedResource.pData;
+	float fTileSize = o.bFoveated ? (float)Settings.pQualityMap->TileSize : 0.0f;
+	pMLAAParam->m_Param = XMVectorSet( (float)Input.Width, (float)Input.Height, Settings.fThreshold, fTileSize );
+	pContext->Unmap( m_pConstants, 0 );
+	pContext->PSSetConstantBuffers( 0, 1, &m_pConstants );
+
+	if (o.bCompute)
+	{
+		// The scene color may still be bound as a render target, which would keep it from
+		// being read
+		pContext->OMSetRenderTargets(0, NULL, NULL);
+		pContext->CSSetConstantBuffers( 0, 1, &m_pConstants );
+
+		// The tile shader runs everything in BlendColor, the empty timers read zero
+		if (o.bComputeTile)
+		{
+			TIMER_Begin(0, L"Pass1");
+			TIMER_End( );
+			return true;
+		}
+
+		TIMER_Begin(0, L"Pass1");
+			ID3D11ShaderResourceView* pInputSRV = (ID3D11ShaderResourceView*)Input.pHandle;
+			pContext->CSSetShaderResources(0, 1, &pInputSRV);
+			pContext->CSSetUnorderedAccessViews(0, 1, &m_EdgeMask.pUAV, NULL);
+			Dispatch(pContext, g_pSeparateEdgeCS);
+		TIMER_End( );
+		return true;
+	}
+
+	TIMER_Begin(0, L"Pass1");
+		SetScissorRegion(pContext, o.pRegion, MLAA::kRegionHalo);
+		// 1st pass, detect edges ---------------------------------------------------------------------			
+		// Set render resources
+		SetGeometry(o, o.bAtlas);
+		
+		ID3D11RenderTargetView* pRTV = m_EdgeMask.pRTV; 
+		if (o.bHalfRes)
+		{
+			D3D11_VIEWPORT HalfResViewport = { 0.0f, 0.0f, (float)((m_nWidth + 1) / 2), (float)((m_nHeight + 1) / 2), 0.0f, 1.0f };
+			pContext->RSSetViewports(1, &HalfResViewport);
+		}
+
+		if (o.bMSAAAware)
+		{
+			// Resolve and edge detection in one pass. Every pixel writes its resolved color,
+			// so the stencil optimization can't discard pixels here
+			ID3D11RenderTargetView* pMRT[2] = { m_EdgeMask.pRTV, o.pResolvedRTV };
+			pContext->PSSetShader( g_pSeparateEdgeMSAAPS, NULL, 0 );
+			pContext->OMSetRenderTargets(2, pMRT, NULL);
+		}
+		else if (o.bGatherQuads)
+		{
+			D3D11_VIEWPORT QuadViewport = { 0.0f, 0.0f, (float)((m_nWidth + 1) / 2), (float)((m_nHeight + 1) / 2), 0.0f, 1.0f };
+			pContext->RSSetViewports(1, &QuadViewport);
+			pContext->PSSetShader( g_pSeparateEdgeQuadPS, NULL, 0 );
+			pContext->OMSetRenderTargetsAndUnorderedAccessViews(0, NULL, NULL, 0, 1, &m_EdgeMask.pUAV, NULL);
+		}
+		else if (o.bUseStencil)
+		{				
+			pContext->PSSetShader( o.bHalfRes ? g_pSeparateEdgeHalfResStencilPS : (o.bGather ? g_pSeparateEdgeGatherStencilPS : g_pSeparateEdgePSStencilPS), NULL, 0 );
+			pContext->OMSetRenderTargets(1, &pRTV, o.pStencilView);	       			
+			pContext->ClearRenderTargetView( m_EdgeMask.pRTV, ZeroColor );	
+			pContext->OMSetDepthStencilState(o.pStencilState, 1);
+		}
+		else
+		{		
+			pContext->PSSetShader( o.bAtlas ? g_pSeparateEdgeAtlasPS : (o.bHalfRes ? g_pSeparateEdgeHalfResPS : (o.bGather ? g_pSeparateEdgeGatherPS : g_pSeparateEdgePS)), NULL, 0 );				
+			pContext->OMSetRenderTargets(1, &pRTV, NULL);	       					
+		}						
+		
+		// MSAA aware detection writes the resolved color, so it reads the multisampled one
+		ID3D11ShaderResourceView* SRVArray[3] = { o.bMSAAAware ? NULL : (ID3D11ShaderResourceView*)Input.pHandle, NULL, NULL };
+		ID3D11ShaderResourceView* pSceneColorMSSRV = o.bMSAAAware ? o.pSceneColorMSSRV : NULL;
+		pContext->PSSetShaderResources(0, 3, SRVArray);
+		pContext->PSSetShaderResources(3, 1, &pSceneColorMSSRV);
+        pContext->PSSetSamplers( 1, 1, &g_pSceneColorSam );
+		DrawPass(o, o.bAtlas);
+		if (o.bGatherQuads)
+		{
+			SetFullViewport(pContext);
+			ID3D11UnorderedAccessView* pNullUAV = NULL;
+			pContext->OMSetRenderTargetsAndUnorderedAccessViews(0, NULL, NULL, 0, 1, &pNullUAV, NULL);
+		}
+	TIMER_End( );		
+	return true;
+}
+
+void D3D11EffectBackend::ComputeLineLength(const MLAA::EffectSurface& Input, const MLAA::EffectSettings& Settings)
+{
+	static float ZeroColor[4] = {0, 0, 0, 0};
+	const PassOptions o = GetPassOptions(Settings);
+	ID3D11DeviceContext* pContext = o.pContext;
+	ID3D11ShaderResourceView* SRVArray[3] = {NULL, NULL, NULL};
+
+	if (o.bComputeTile)
+	{
 		TIMER_Begin(0, L"Pass2");
-			// 2nd pass, compute the length of edges --------------------------------------------------------		
-			pRTV = g_EdgeCountRTV;
-			if (g_bUseStencilBuffer)
-			{
-				pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, g_DepthStencilView);				
-				pd3dImmediateContext->ClearRenderTargetView( g_EdgeCountRTV, ZeroColor );	
-				pd3dImmediateContext->OMSetDepthStencilState(g_DepthStencilState, 0);				
-			}
-			else
-			{
-				pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, NULL);				
-			}
-			// Set render resources
-			pd3dImmediateContext->IASetInputLayout( g_pScreenQuadLayout );	
-			pd3dImmediateContext->IASetVertexBuffers(0, 1, &g_pScreenQuadVB, Stride, Offset);
-			pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-			pd3dImmediateContext->VSSetShader( g_pScreenQuadVS, NULL, 0 );
-			pd3dImmediateContext->PSSetShader( g_pComputeEdgePS, NULL, 0 );
-			SRVArray[1] = g_EdgeMaskSRV;
-			pd3dImmediateContext->PSSetShaderResources(0, 3, SRVArray);
-			pd3dImmediateContext->Draw(4, 0);
 		TIMER_End( );
+		return;
+	}
+
+	if (o.bCompute)
+	{
+		TIMER_Begin(0, L"Pass2");
+			ID3D11UnorderedAccessView* pUAVArray[2] = { NULL, m_EdgeCount.pUAV };
+			pContext->CSSetUnorderedAccessViews(0, 2, pUAVArray, NULL);
+			SRVArray[1] = m_EdgeMask.pSRV;
+			pContext->CSSetShaderResources(1, 1, &SRVArray[1]);
+			Dispatch(pContext, g_pComputeEdgeCS);
+		TIMER_End( );
+		return;
+	}
+
+	TIMER_Begin(0, L"Pass2");
+		SetScissorRegion(pContext, o.pRegion, 1);
+		if (o.bHierarchical)
+		{
+			// Summarize the edge mask in blocks of 8 pixels along rows and columns
+			SRVArray[1] = m_EdgeMask.pSRV;
+			pContext->PSSetShaderResources(0, 3, SRVArray);
+			SetGeometry(o, false);
+
+			D3D11_VIEWPORT BlockViewport = { 0.0f, 0.0f, (float)((m_nWidth + 7) / 8), (float)m_nHeight, 0.0f, 1.0f };
+			pContext->RSSetViewports(1, &BlockViewport);
+			pContext->OMSetRenderTargets(1, &m_EdgeBlocksH.pRTV, NULL);
+			pContext->PSSetShader( g_pEdgeBlocksHPS, NULL, 0 );
+			DrawPass(o, false);
+
+			BlockViewport.Width = (float)m_nWidth;
+			BlockViewport.Height = (float)((m_nHeight + 7) / 8);
+			pContext->RSSetViewports(1, &BlockViewport);
+			pContext->OMSetRenderTargets(1, &m_EdgeBlocksV.pRTV, NULL);
+			pContext->PSSetShader( g_pEdgeBlocksVPS, NULL, 0 );
+			DrawPass(o, false);
+
+			SetFullViewport(pContext);
+		}
+		// 2nd pass, compute the length of edges --------------------------------------------------------		
+		ID3D11RenderTargetView* pRTV = o.bLongEdges ? m_LongEdgeCount.pRTV : m_EdgeCount.pRTV;
+		if (o.bUseStencil)
+		{
+			pContext->OMSetRenderTargets(1, &pRTV, o.pStencilView);				
+			pContext->ClearRenderTargetView( pRTV, ZeroColor );	
+			pContext->OMSetDepthStencilState(o.pStencilState, 0);				
+		}
+		else
+		{
+			pContext->OMSetRenderTargets(1, &pRTV, NULL);				
+		}
+		// Set render resources
+		SetGeometry(o, o.bAtlas);
+		if (o.bFoveated)
+			pContext->PSSetShader( g_pComputeEdgeFoveatedPS, NULL, 0 );
+		else if (o.bLongEdges)
+			pContext->PSSetShader( o.bHierarchical ? g_pComputeEdgeHierarchicalPS : g_pComputeEdgeLongPS, NULL, 0 );
+		else
+			pContext->PSSetShader( o.bAtlas ? g_pComputeEdgeAtlasPS : (o.bHalfRes ? g_pComputeEdgeHalfResPS : g_pComputeEdgePS), NULL, 0 );
+		ID3D11ShaderResourceView* pSceneColorMSSRV = NULL;
+		pContext->PSSetShaderResources(3, 1, &pSceneColorMSSRV);
+		ID3D11ShaderResourceView* pQualityMapSRV = o.bFoveated ? m_pQualityMapSRV : NULL;
+		pContext->PSSetShaderResources(4, 1, &pQualityMapSRV);
+		ID3D11ShaderResourceView* pEdgeBlocksSRV[2] = { m_EdgeBlocksH.pSRV, m_EdgeBlocksV.pSRV };
+		if (o.bHierarchical)
+			pContext->PSSetShaderResources(5, 2, pEdgeBlocksSRV);
+		SRVArray[0] = (ID3D11ShaderResourceView*)Input.pHandle;
+		SRVArray[1] = m_EdgeMask.pSRV;
+		pContext->PSSetShaderResources(0, 3, SRVArray);
+		DrawPass(o, o.bAtlas);
+	TIMER_End( );
+}
+
+void D3D11EffectBackend::BlendColor(const MLAA::EffectSurface& Input, const MLAA::EffectSurface& Output, const MLAA::EffectSettings& Settings)
+{
+	const PassOptions o = GetPassOptions(Settings);
+	ID3D11DeviceContext* pContext = o.pContext;
+
+	if (o.bCompute)
+	{
+		ID3D11UnorderedAccessView* pUAVArray[3] = { NULL, NULL, (ID3D11UnorderedAccessView*)Output.pHandle };
+		ID3D11ShaderResourceView* SRVArray[3] = { (ID3D11ShaderResourceView*)Input.pHandle, NULL, m_EdgeCount.pSRV };
 
 		TIMER_Begin(0, L"Pass3");
-			// 3rd pass, blend colors according to the edge shape and length ----------------------------------
-			pRTV = DXUTGetD3D11RenderTargetView();
-			pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, NULL);		
-			
-			// Set render resources
-			pd3dImmediateContext->IASetInputLayout( g_pScreenQuadLayout );	
-			pd3dImmediateContext->IASetVertexBuffers(0, 1, &g_pScreenQuadVB, Stride, Offset);
-			pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-			pd3dImmediateContext->VSSetShader( g_pScreenQuadVS, NULL, 0 );
-			if (g_bShowEdges)
-				pd3dImmediateContext->PSSetShader( g_pShowEdgesPS, NULL, 0 );				
+			pContext->CSSetUnorderedAccessViews(0, 3, pUAVArray, NULL);
+			pContext->CSSetShaderResources(0, 3, SRVArray);
+			if (o.bComputeTile)
+				Dispatch(pContext, o.bShowEdges ? g_pShowEdgesTileCS : g_pTileCS, 16);
 			else
-			{
-				pd3dImmediateContext->PSSetShader( g_pBlendColorPS, NULL, 0 );
-			}
-			SRVArray[1] = NULL;
-			SRVArray[2] = g_EdgeCountSRV;
-			pd3dImmediateContext->PSSetShaderResources(0, 3, SRVArray);		
-			pd3dImmediateContext->PSSetSamplers( 0, 1, &g_pSceneColorSam );
-			pd3dImmediateContext->Draw(4, 0);
-		TIMER_End( );			
+				Dispatch(pContext, o.bShowEdges ? g_pShowEdgesCS : g_pBlendColorCS);
+		TIMER_End( );
 
+		pUAVArray[2] = NULL;
 		SRVArray[0] = NULL;
-		SRVArray[1] = NULL;
 		SRVArray[2] = NULL;
-		pd3dImmediateContext->PSSetShaderResources(0, 3, SRVArray);
-		pd3dImmediateContext->VSSetShader( NULL, NULL, 0 );
-		pd3dImmediateContext->PSSetShader( NULL, NULL, 0 );
-		Count++;
+		pContext->CSSetUnorderedAccessViews(0, 3, pUAVArray, NULL);
+		pContext->CSSetShaderResources(0, 3, SRVArray);
+		pContext->CSSetShader( NULL, NULL, 0 );
+		return;
+	}
 
-		T1 += (float)TIMER_GetTime(Gpu, L"Pass1") * 1000.0f;
-		T2 += (float)TIMER_GetTime(Gpu, L"Pass2") * 1000.0f;
-		T3 += (float)TIMER_GetTime(Gpu, L"Pass3") * 1000.0f;
+	TIMER_Begin(0, L"Pass3");
+		SetScissorRegion(pContext, o.pRegion, 0);
+		// 3rd pass, blend colors according to the edge shape and length ----------------------------------
+		if (o.bHalfRes)
+			SetFullViewport(pContext);
+		ID3D11RenderTargetView* pRTV = (ID3D11RenderTargetView*)Output.pHandle;
+		pContext->OMSetRenderTargets(1, &pRTV, NULL);		
 		
-		if (Count == 100)
+		// Set render resources
+		SetGeometry(o, o.bAtlas);
+		if (o.bShowEdges && o.bLongEdges)
+			pContext->PSSetShader( g_pShowEdgesLongPS, NULL, 0 );
+		else if (o.bLongEdges)
+			pContext->PSSetShader( g_pBlendColorLongPS, NULL, 0 );
+		else if (o.bShowEdges)
+			pContext->PSSetShader( o.bAtlas ? g_pShowEdgesAtlasPS : (o.bHalfRes ? g_pShowEdgesHalfResPS : g_pShowEdgesPS), NULL, 0 );				
+		else if (o.bFoveated)
+			pContext->PSSetShader( g_pBlendColorFoveatedPS, NULL, 0 );
+		else
+		{
+			pContext->PSSetShader( o.bAtlas ? g_pBlendColorAtlasPS : (o.bHalfRes ? g_pBlendColorHalfResPS : g_pBlendColorPS), NULL, 0 );
+		}
+		ID3D11ShaderResourceView* SRVArray[3] = { (ID3D11ShaderResourceView*)Input.pHandle, NULL, o.bLongEdges ? m_LongEdgeCount.pSRV : m_EdgeCount.pSRV };
+		pContext->PSSetShaderResources(0, 3, SRVArray);		
+		pContext->PSSetSamplers( 0, 1, &g_pSceneColorSam );
+		DrawPass(o, o.bAtlas);
+	TIMER_End( );			
+
+	SRVArray[0] = NULL;
+	SRVArray[1] = NULL;
+	SRVArray[2] = NULL;
+	pContext->PSSetShaderResources(0, 3, SRVArray);
+	pContext->PSSetShaderResources(4, 1, SRVArray);
+	pContext->PSSetShaderResources(5, 2, SRVArray);
+	pContext->VSSetShader( NULL, NULL, 0 );
+	pContext->PSSetShader( NULL, NULL, 0 );
+	pContext->RSSetState( NULL );
+}
+//--------------------------------------------------------------------------------------
+// Run MLAA on the CPU: read the scene color back, apply the three passes and upload the 
+// result to the back buffer. This stalls on the GPU, it is meant for comparing timings.
+//--------------------------------------------------------------------------------------
+void RenderMLAACPU(ID3D11DeviceContext* pd3dImmediateContext, const RECT* pRegion)
+{
+	// With a region only the pixels the region depends on are read back
+	ID3D11Resource* pSceneColor = (g_MSAACount > 1) ? g_ResolvedSceneColor : g_SceneColor;
+	D3D11_BOX Box = { 0, 0, 0, (UINT)g_Width, (UINT)g_Height, 1 };
+	if (pRegion && g_nCPUFramesInFlight <= 1)
+	{
+		int Halo = (g_FrameSettings.nEdgeSearch != MLAA::EDGE_SEARCH_SHORT) ? MLAA::kLongRegionHalo : MLAA::kRegionHalo;
+		Box = RegionToBox(*pRegion, g_FrameSettings.bHalfResEdges ? 2 * MLAA::kRegionHalo + 1 : Halo);
+	}
+	pd3dImmediateContext->CopySubresourceRegion(g_CPUSceneColor, 0, Box.left, Box.top, 0, pSceneColor, 0, &Box);
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	if (FAILED(pd3dImmediateContext->Map(g_CPUSceneColor, 0, D3D11_MAP_READ, 0, &MappedResource)))
+		return;
+
+	int Width = (int)g_Width;
+	int Height = (int)g_Height;
+	g_CPUResultColor.resize((size_t)Width * Height * 4);
+
+	MLAA::Surface Src = { (uint8_t*)MappedResource.pData, Width, Height, (int)MappedResource.RowPitch };
+	MLAA::Surface Dst = { &g_CPUResultColor[0], Width, Height, Width * 4 };
+
+	MLAA::VERTICAL_SEARCH VerticalSearch = g_bCPUTransposedSearch ? MLAA::VERTICAL_SEARCH_TRANSPOSED : MLAA::VERTICAL_SEARCH_DIRECT;
+	MLAA::DETECTION_RESOLUTION DetectionResolution = g_FrameSettings.bHalfResEdges ? MLAA::DETECTION_HALF : MLAA::DETECTION_FULL;
+	MLAA::DETECTION_KERNEL DetectionKernel = (g_nEdgeFetch == EDGE_FETCH_GATHER_QUADS) ? MLAA::DETECTION_KERNEL_QUAD : MLAA::DETECTION_KERNEL_PIXEL;
+	bool bAtlas = (g_nAtlasMode != ATLAS_MODE_OFF) && (pRegion == NULL);
+	const MLAA::QualityMap* pQualityMap = (g_bFoveatedMLAA || g_FrameSettings.bShortEdges) ? &g_QualityMap : NULL;
+	if (g_nCPUFramesInFlight <= 1)
+	{
+		double StartTime = MLAA::GetTimeMs();
+		g_CPUMLAA.SetThreshold(g_FrameSettings.fThreshold);
+		g_CPUMLAA.SetVerticalSearch(VerticalSearch);
+		g_CPUMLAA.SetDetectionResolution(DetectionResolution);
+		g_CPUMLAA.SetDetectionKernel(DetectionKernel);
+		g_CPUMLAA.SetQualityMap(pQualityMap);
+		g_CPUMLAA.SetEdgeSearch((MLAA::EDGE_SEARCH)g_FrameSettings.nEdgeSearch);
+		if (pRegion)
+		{
+			MLAA::Rect Region = { pRegion->left, pRegion->top, pRegion->right, pRegion->bottom };
+			g_CPUMLAA.Apply(Src, Dst, Region);
+		}
+		else if (bAtlas && g_nAtlasMode == ATLAS_MODE_BATCHED)
+		{
+			g_CPUMLAA.ApplyViews(Src, Dst, &g_AtlasViews[0], (int)g_AtlasViews.size());
+		}
+		else if (bAtlas)
+		{
+			double PassTime[MLAA::PASS_COUNT] = { 0.0 };
+			for (size_t i = 0; i < g_AtlasViews.size(); i++)
+			{
+				g_CPUMLAA.ApplyView(Src, Dst, g_AtlasViews[i]);
+				for (int j = 0; j < MLAA::PASS_COUNT; j++)
+					PassTime[j] += g_CPUMLAA.GetPassTime((MLAA::PASS)j);
+			}
+			memcpy(g_CPULastResult.PassTime, PassTime, sizeof(PassTime));
+		}
+		else
+		{
+			g_CPUMLAA.Apply(Src, Dst);
+		}
+
+		g_CPULastResult.LatencyMs = MLAA::GetTimeMs() - StartTime;
+		if (!bAtlas || g_nAtlasMode == ATLAS_MODE_BATCHED)
+		{
+			for (int i = 0; i < MLAA::PASS_COUNT; i++)
+				g_CPULastResult.PassTime[i] = g_CPUMLAA.GetPassTime((MLAA::PASS)i);
+		}
+	}
+	else
+	{
+		// Frames in flight always process the whole frame
+		pRegion = NULL;
+		if (g_pCPUQueue == NULL || g_pCPUQueue->GetFramesInFlight() != g_nCPUFramesInFlight)
+		{
+			ReleaseCPUQueue();
+			g_pCPUQueue = new MLAA::CPUQueue(g_nCPUFramesInFlight);
+		}
+		g_pCPUQueue->SetThreshold(g_FrameSettings.fThreshold);
+		g_pCPUQueue->SetVerticalSearch(VerticalSearch);
+		g_pCPUQueue->SetDetectionResolution(DetectionResolution);
+		g_pCPUQueue->SetDetectionKernel(DetectionKernel);
+		g_pCPUQueue->SetQualityMap(pQualityMap);
+		g_pCPUQueue->SetEdgeSearch((MLAA::EDGE_SEARCH)g_FrameSettings.nEdgeSearch);
+
+		// Collect the oldest frame, this only blocks if the CPU can't keep up
+		CPUFrame& Frame = g_CPUFrames[g_nCPUFrameHead];
+		Frame.Source.resize(g_CPUResultColor.size());
+		Frame.Result.resize(g_CPUResultColor.size());
+		if (Frame.Done.valid())
+		{
+			g_CPULastResult = Frame.Done.get();
+			memcpy(Dst.pData, &Frame.Result[0], Frame.Result.size());
+		}
+		else
+		{
+			// Nothing to show until the pipeline is full
+			for (int y = 0; y < Height; y++)
+				memcpy(Dst.pData + y * Dst.Pitch, Src.pData + y * Src.Pitch, Width * 4);
+		}
+
+		// The staging texture is reused next frame, so the queue gets its own copy
+		for (int y = 0; y < Height; y++)
+			memcpy(&Frame.Source[y * Width * 4], Src.pData + y * Src.Pitch, Width * 4);
+
+		MLAA::Surface FrameSrc = { &Frame.Source[0], Width, Height, Width * 4 };
+		MLAA::Surface FrameDst = { &Frame.Result[0], Width, Height, Width * 4 };
+		if (bAtlas)
+			Frame.Done = g_pCPUQueue->SubmitViews(FrameSrc, FrameDst, &g_AtlasViews[0], (int)g_AtlasViews.size());
+		else
+			Frame.Done = g_pCPUQueue->Submit(FrameSrc, FrameDst);
+		g_nCPUFrameHead = (g_nCPUFrameHead + 1) % g_nCPUFramesInFlight;
+	}
+
+	pd3dImmediateContext->Unmap(g_CPUSceneColor, 0);
+
+	ID3D11Resource* pBackBuffer = NULL;
+	DXUTGetD3D11RenderTargetView()->GetResource(&pBackBuffer);
+	if (pRegion)
+	{
+		D3D11_BOX RegionBox = RegionToBox(*pRegion, 0);
+		const uint8_t* pData = Dst.pData + RegionBox.top * Dst.Pitch + RegionBox.left * 4;
+		pd3dImmediateContext->UpdateSubresource(pBackBuffer, 0, &RegionBox, pData, Dst.Pitch, 0);
+	}
+	else
+	{
+		pd3dImmediateContext->UpdateSubresource(pBackBuffer, 0, NULL, Dst.pData, Dst.Pitch, 0);
+	}
+	SAFE_RELEASE(pBackBuffer);
+}
+//--------------------------------------------------------------------------------------
+// Settings of the passes for this frame: the HUD settings, made cheaper by the governor
+//--------------------------------------------------------------------------------------
+void UpdateFrameSettings()
+{
+	MLAA::GovernorSettings Step = { 1.0f, MLAA::kLongMaxEdgeLength, MLAA::DETECTION_FULL, true };
+	if (g_bBudgetGovernor)
+		Step = g_Governor.GetSettings();
+
+	g_FrameSettings.fThreshold = Step.fThresholdScale / gEdgeDetectionThreshold;
+	g_FrameSettings.nEdgeSearch = (Step.MaxEdgeLength < MLAA::kLongMaxEdgeLength) ? MLAA::EDGE_SEARCH_SHORT : g_nEdgeSearch;
+	g_FrameSettings.bHalfResEdges = g_bHalfResEdges || (Step.DetectionResolution == MLAA::DETECTION_HALF);
+	g_FrameSettings.bShortEdges = (Step.MaxEdgeLength <= MLAA::kShortEdgeLength);
+	g_FrameSettings.bSkip = !Step.bEnabled;
+}
+//--------------------------------------------------------------------------------------
+// Pass the time of the passes to the governor. Its settings are used a number of frames
+// before their time is known, which depends on where the passes ran
+//--------------------------------------------------------------------------------------
+void UpdateGovernor(double fTimeMs, bool bCPUTime, int nLatency)
+{
+	static bool bLastCPUTime = false;
+	static int nLastLatency = -1;
+	if (!g_bBudgetGovernor)
+		return;
+
+	// Times from another clock say nothing about the costs learnt so far
+	if (bCPUTime != bLastCPUTime || nLatency != nLastLatency)
+	{
+		g_Governor.Reset();
+		g_Governor.SetMeasurementLatency(nLatency);
+		bLastCPUTime = bCPUTime;
+		nLastLatency = nLatency;
+	}
+	g_Governor.SetAllowSkip(true);
+	g_Governor.SetBudget(g_fMLAABudget);
+	g_Governor.Update(fTimeMs);
+}
+//--------------------------------------------------------------------------------------
+// Get the output surface of the compute passes for the current size
+//--------------------------------------------------------------------------------------
+HRESULT AcquireComputeOutput()
+{
+	MLAA::SurfaceDesc sd;
+	sd.Width = (int)g_Width;
+	sd.Height = (int)g_Height;
+	sd.Format = OFFSCREENFORMAT;
+	sd.ViewFormat = OFFSCREENFORMAT;
+	sd.SampleCount = 1;
+	sd.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS;
+	sd.Usage = D3D11_USAGE_DEFAULT;
+	return AcquireTarget(sd, true, &g_ComputeOutput, NULL, &g_ComputeOutputSRV, NULL, &g_ComputeOutputUAV);
+}
+//--------------------------------------------------------------------------------------
+// Draw the output of the compute passes to the back buffer, which is left bound as the
+// pixel passes leave it
+//--------------------------------------------------------------------------------------
+void CopyComputeOutput(ID3D11DeviceContext* pd3dImmediateContext)
+{
+	ID3D11RenderTargetView* pRTV = DXUTGetD3D11RenderTargetView();
+	pd3dImmediateContext->OMSetRenderTargets(1, &pRTV, NULL);
+	D3D11_VIEWPORT Viewport = { 0.0f, 0.0f, g_Width, g_Height, 0.0f, 1.0f };
+	pd3dImmediateContext->RSSetViewports(1, &Viewport);
+
+	UINT Stride[1] = {sizeof(float)*6};
+	UINT Offset[1] = {0};
+	pd3dImmediateContext->IASetInputLayout( g_pScreenQuadLayout );
+	pd3dImmediateContext->IASetVertexBuffers(0, 1, &g_pScreenQuadVB, Stride, Offset);
+	pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	pd3dImmediateContext->VSSetShader( g_pScreenQuadVS, NULL, 0 );
+	pd3dImmediateContext->PSSetShader( g_pCopyPS, NULL, 0 );
+	pd3dImmediateContext->PSSetShaderResources(0, 1, &g_ComputeOutputSRV);
+	pd3dImmediateContext->Draw(4, 0);
+
+	ID3D11ShaderResourceView* pNullSRV = NULL;
+	pd3dImmediateContext->PSSetShaderResources(0, 1, &pNullSRV);
+}
+//--------------------------------------------------------------------------------------
+// Render MLAA post processing 
+//--------------------------------------------------------------------------------------
+void RenderMLAA(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+{	
+	static int Count = 0;
+	static float T = 0.0f, T1 = 0.0f, T2 = 0.0f, T3 = 0.0f, TL = 0.0f;	
+
+	// Limit MLAA to the magnified region, the rest of the frame shows the scene as is
+	RECT Region;
+	RECT* pRegion = NULL;
+	bool bSkipMLAA = false;
+	if (g_bShowMLAA && g_bMLAAMagnifiedRegion)
+	{
+		ID3D11Resource* pBackBuffer = NULL;
+		DXUTGetD3D11RenderTargetView()->GetResource(&pBackBuffer);
+		D3D11_BOX Box = { 0, 0, 0, (UINT)g_Width, (UINT)g_Height, 1 };
+		pd3dImmediateContext->CopySubresourceRegion(pBackBuffer, 0, 0, 0, 0, (g_MSAACount > 1) ? g_ResolvedSceneColor : g_SceneColor, 0, &Box);
+		SAFE_RELEASE(pBackBuffer);
+
+		pRegion = &Region;
+		if (g_MagnifyTool.GetCaptureRegion(Region))
+		{
+			D3D11_BOX Clipped = RegionToBox(Region, 0);
+			bSkipMLAA = (Clipped.left >= Clipped.right) || (Clipped.top >= Clipped.bottom);
+			SetRect(&Region, (int)Clipped.left, (int)Clipped.top, (int)Clipped.right, (int)Clipped.bottom);
+		}
+		else
+		{
+			bSkipMLAA = true;
+		}
+	}
+	
+	UpdateFrameSettings();
+
+	// Atlas views split the whole frame, they don't apply to a region
+	bool bAtlas = (g_nAtlasMode != ATLAS_MODE_OFF) && (pRegion == NULL);
+	if (bAtlas)
+		BuildAtlasViews();
+	if (g_bFoveatedMLAA || g_FrameSettings.bShortEdges)
+		BuildQualityMap();
+
+	bool bCPUTime = g_bUseCPUMLAA;
+	int nLatency = !g_bUseCPUMLAA ? GPU_TIMER_LATENCY : (g_nCPUFramesInFlight > 1 ? g_nCPUFramesInFlight : 0);
+	if (g_bShowMLAA && !bSkipMLAA && g_FrameSettings.bSkip)
+	{
+		// Last step of the governor, show the scene without MLAA. With a region the back
+		// buffer already holds it
+		if (pRegion == NULL)
 		{
-			gPass1Time = T1 / (float)Count;
-			gPass2Time = T2 / (float)Count;
-			gPass3Time = T3 / (float)Count;
-			gTotalTime = gPass1Time + gPass2Time + gPass3Time;
+			if (g_MSAACount > 1)
+				pd3dImmediateContext->ResolveSubresource(g_ResolvedSceneColor, 0, g_SceneColor, 0, OFFSCREENFORMAT);
 
-			T1 = T2 = T3 = 0.0f;
-			Count = 0;		
+			ID3D11Resource* pBackBuffer = NULL;
+			DXUTGetD3D11RenderTargetView()->GetResource(&pBackBuffer);
+			D3D11_BOX Box = { 0, 0, 0, (UINT)g_Width, (UINT)g_Height, 1 };
+			pd3dImmediateContext->CopySubresourceRegion(pBackBuffer, 0, 0, 0, 0, (g_MSAACount > 1) ? g_ResolvedSceneColor : g_SceneColor, 0, &Box);
+			SAFE_RELEASE(pBackBuffer);
 		}
+		Count++;
+		UpdateGovernor(0.0, bCPUTime, nLatency);
+	}
+	else if (g_bShowMLAA && g_bUseCPUMLAA && !bSkipMLAA)
+	{
+		RenderMLAACPU(pd3dImmediateContext, pRegion);
+		Count++;
+
+		T1 += (float)g_CPULastResult.PassTime[MLAA::PASS_DETECT_EDGES];
+		T2 += (float)g_CPULastResult.PassTime[MLAA::PASS_COMPUTE_LINE_LENGTH];
+		T3 += (float)g_CPULastResult.PassTime[MLAA::PASS_BLEND_COLOR];
+		TL += (float)g_CPULastResult.LatencyMs;
+
+		double fTimeMs = 0.0;
+		for (int i = 0; i < MLAA::PASS_COUNT; i++)
+			fTimeMs += g_CPULastResult.PassTime[i];
+		UpdateGovernor(fTimeMs, bCPUTime, nLatency);
+	}
+	else if (g_bShowMLAA && !bSkipMLAA)
+	{	
+		// Atlas views have no MSAA aware, stencil or half resolution variants. The scissor 
+		// rectangle of a region is in full resolution pixels, so regions stay at full resolution
+		D3D11PassOptions Options;
+		Options.pContext = pd3dImmediateContext;
+		Options.bMSAAAware = g_bMSAAAwareMLAA && (g_MSAACount > 1) && !bAtlas;
+		Options.bUseStencil = g_bUseStencilBuffer && !Options.bMSAAAware && !bAtlas;
+		bool bHalfRes = g_FrameSettings.bHalfResEdges && !Options.bMSAAAware && !bAtlas && (pRegion == NULL);
+		// The quad shader covers 2x2 pixels per invocation and can't write the stencil
+		Options.bGather = (g_nEdgeFetch == EDGE_FETCH_GATHER) && !Options.bMSAAAware && !bAtlas && !bHalfRes;
+		bool bGatherQuads = (g_nEdgeFetch == EDGE_FETCH_GATHER_QUADS) && !Options.bMSAAAware && !bAtlas && !bHalfRes && (pRegion == NULL);
+		Options.bUseStencil = Options.bUseStencil && !bGatherQuads;
+		// The quality map is in full resolution pixels of the whole frame
+		bool bFoveated = (g_bFoveatedMLAA || g_FrameSettings.bShortEdges) && !bHalfRes && !bAtlas && (pRegion == NULL);
+		// Long edges have no atlas, region, half resolution or quality map variants
+		bool bLongEdges = (g_FrameSettings.nEdgeSearch != MLAA::EDGE_SEARCH_SHORT) && !bAtlas && !bHalfRes && !bFoveated && (pRegion == NULL);
+		Options.bShowEdges = g_bShowEdges;
+		Options.bCompute = (g_nPassShader != PASS_SHADER_PIXEL) && !bAtlas && !Options.bMSAAAware && !bHalfRes && !bFoveated &&
+						   !bLongEdges && (pRegion == NULL);
+		// Without their output surface the frame takes the pixel passes
+		if (Options.bCompute && !g_ComputeOutputUAV)
+			Options.bCompute = SUCCEEDED(AcquireComputeOutput());
+		Options.bComputeTile = Options.bCompute && (g_nPassShader == PASS_SHADER_COMPUTE_TILE);
+		if (Options.bCompute)
+			Options.bUseStencil = Options.bGather = bGatherQuads = false;
+		Options.bDrawViewsSeparately = (g_nAtlasMode == ATLAS_MODE_PER_VIEW);
+		Options.pSceneColorMSSRV = g_SceneColorSRV;
+		Options.pResolvedRTV = g_ResolvedSceneColorRTV;
+		Options.pStencilView = g_MLAADepthStencilView;
+		Options.pStencilState = g_DepthStencilState;
+
+		MLAA::Rect MLAARegion = { 0, 0, 0, 0 };
+		if (pRegion)
+		{
+			MLAARegion.Left = pRegion->left;
+			MLAARegion.Top = pRegion->top;
+			MLAARegion.Right = pRegion->right;
+			MLAARegion.Bottom = pRegion->bottom;
+		}
+
+		const float BlendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		pd3dImmediateContext->OMSetBlendState(g_pNoBlendingBS, BlendFactor, 0xffffffff);		
+
+		// Each pass covers what the next one reads: the blend pass reads counts one pixel 
+		// away and the counts depend on edges up to the halo away
+		if (pRegion)
+			pd3dImmediateContext->RSSetState(g_pScissorRS);
+
+		g_MLAAEffect.SetThreshold(g_FrameSettings.fThreshold);
+		g_MLAAEffect.SetEdgeSearch(bLongEdges ? (MLAA::EDGE_SEARCH)g_FrameSettings.nEdgeSearch : MLAA::EDGE_SEARCH_SHORT);
+		g_MLAAEffect.SetDetectionResolution(bHalfRes ? MLAA::DETECTION_HALF : MLAA::DETECTION_FULL);
+		g_MLAAEffect.SetDetectionKernel(bGatherQuads ? MLAA::DETECTION_KERNEL_QUAD : MLAA::DETECTION_KERNEL_PIXEL);
+		g_MLAAEffect.SetQualityMap(bFoveated ? &g_QualityMap : NULL);
+		g_MLAAEffect.SetViews(bAtlas ? &g_AtlasViews[0] : NULL, bAtlas ? (int)g_AtlasViews.size() : 0);
+		g_MLAAEffect.SetRegion(pRegion ? &MLAARegion : NULL);
+		g_MLAAEffect.SetBackendOptions(&Options);
+
+		MLAA::EffectSurface Input = { (g_MSAACount > 1) ? g_ResolvedSceneColorSRV : g_SceneColorSRV, (int)g_Width, (int)g_Height, 0 };
+		void* pOutput = Options.bCompute ? (void*)g_ComputeOutputUAV : (void*)DXUTGetD3D11RenderTargetView();
+		MLAA::EffectSurface Output = { pOutput, (int)g_Width, (int)g_Height, 0 };
+		if (!g_MLAAEffect.Apply(Input, Output))
+		{
+			// The views or the quality map could not be uploaded, show the scene as is
+			pd3dImmediateContext->RSSetState(NULL);
+			ID3D11Resource* pBackBuffer = NULL;
+			DXUTGetD3D11RenderTargetView()->GetResource(&pBackBuffer);
+			D3D11_BOX Box = { 0, 0, 0, (UINT)g_Width, (UINT)g_Height, 1 };
+			pd3dImmediateContext->CopySubresourceRegion(pBackBuffer, 0, 0, 0, 0, (g_MSAACount > 1) ? g_ResolvedSceneColor : g_SceneColor, 0, &Box);
+			SAFE_RELEASE(pBackBuffer);
+		}
+		else if (Options.bCompute)
+		{
+			CopyComputeOutput(pd3dImmediateContext);
+		}
+
+		// The settings point to locals of this frame
+		g_MLAAEffect.SetRegion(NULL);
+		g_MLAAEffect.SetBackendOptions(NULL);
+		Count++;
+
+		T1 += (float)g_MLAAEffect.GetPassTime(MLAA::PASS_DETECT_EDGES);
+		T2 += (float)g_MLAAEffect.GetPassTime(MLAA::PASS_COMPUTE_LINE_LENGTH);
+		T3 += (float)g_MLAAEffect.GetPassTime(MLAA::PASS_BLEND_COLOR);
+
+		double fTimeMs = 0.0;
+		for (int i = 0; i < MLAA::PASS_COUNT; i++)
+			fTimeMs += g_MLAAEffect.GetPassTime((MLAA::PASS)i);
+		UpdateGovernor(fTimeMs, bCPUTime, nLatency);
 	}
 	else
 	{
 		gTotalTime = gPass1Time = gPass2Time = gPass3Time = 0.0f;
 	}
+
+	if (Count == 100)
+	{
+		gPass1Time = T1 / (float)Count;
+		gPass2Time = T2 / (float)Count;
+		gPass3Time = T3 / (float)Count;
+		gTotalTime = gPass1Time + gPass2Time + gPass3Time;
+		gCPULatency = TL / (float)Count;
+
+		T1 = T2 = T3 = TL = 0.0f;
+		Count = 0;		
+	}
 }
 //--------------------------------------------------------------------------------------
 // Render the scene using the D3D11 device
@@ -1076,43 +2632,78 @@ void CALLBACK OnD3D11DestroyDevice( void* pUserContext )
 	SAFE_RELEASE( g_pSceneColorSam );	
 	SAFE_RELEASE( g_pBS );
 	SAFE_RELEASE( g_pNoBlendingBS );
+	SAFE_RELEASE( g_pScissorRS );
 	
 	SAFE_RELEASE( g_pScreenQuadLayout );
     SAFE_RELEASE( g_pScreenQuadVS );
 	SAFE_RELEASE( g_pScreenQuadVB );
     SAFE_RELEASE( g_pSeparateEdgePS );
 	SAFE_RELEASE( g_pSeparateEdgePSStencilPS );
+	SAFE_RELEASE( g_pSeparateEdgeMSAAPS );
     SAFE_RELEASE( g_pComputeEdgePS );
 	SAFE_RELEASE( g_pBlendColorPS );	
 	SAFE_RELEASE( g_pShowEdgesPS );
 	SAFE_RELEASE( g_pClearPS );
+	SAFE_RELEASE( g_pCopyPS );
+	SAFE_RELEASE( g_pSeparateEdgeHalfResPS );
+	SAFE_RELEASE( g_pSeparateEdgeHalfResStencilPS );
+	SAFE_RELEASE( g_pComputeEdgeHalfResPS );
+	SAFE_RELEASE( g_pBlendColorHalfResPS );
+	SAFE_RELEASE( g_pShowEdgesHalfResPS );
+	SAFE_RELEASE( g_pSeparateEdgeGatherPS );
+	SAFE_RELEASE( g_pSeparateEdgeGatherStencilPS );
+	SAFE_RELEASE( g_pSeparateEdgeQuadPS );
+	SAFE_RELEASE( g_pComputeEdgeFoveatedPS );
+	SAFE_RELEASE( g_pBlendColorFoveatedPS );
+	SAFE_RELEASE( g_pComputeEdgeLongPS );
+	SAFE_RELEASE( g_pComputeEdgeHierarchicalPS );
+	SAFE_RELEASE( g_pBlendColorLongPS );
+	SAFE_RELEASE( g_pShowEdgesLongPS );
+	SAFE_RELEASE( g_pEdgeBlocksHPS );
+	SAFE_RELEASE( g_pEdgeBlocksVPS );
+	SAFE_RELEASE( g_pAtlasViewLayout );
+	SAFE_RELEASE( g_pAtlasViewVS );
+	SAFE_RELEASE( g_pSeparateEdgeAtlasPS );
+	SAFE_RELEASE( g_pComputeEdgeAtlasPS );
+	SAFE_RELEASE( g_pBlendColorAtlasPS );
+	SAFE_RELEASE( g_pShowEdgesAtlasPS );
+	SAFE_RELEASE( g_pSeparateEdgeCS );
+	SAFE_RELEASE( g_pComputeEdgeCS );
+	SAFE_RELEASE( g_pBlendColorCS );
+	SAFE_RELEASE( g_pShowEdgesCS );
+	SAFE_RELEASE( g_pTileCS );
+	SAFE_RELEASE( g_pShowEdgesTileCS );
 
 	SAFE_RELEASE( g_SceneColor );
     SAFE_RELEASE( g_SceneColorRTV );
     SAFE_RELEASE( g_SceneColorSRV );
 	SAFE_RELEASE( g_ResolvedSceneColor );
 	SAFE_RELEASE( g_ResolvedSceneColorSRV );
+	SAFE_RELEASE( g_ResolvedSceneColorRTV );
 
-	SAFE_RELEASE( g_EdgeMask );
-    SAFE_RELEASE( g_EdgeMaskRTV );
-    SAFE_RELEASE( g_EdgeMaskSRV );    
-
-	SAFE_RELEASE( g_EdgeCount );
-    SAFE_RELEASE( g_EdgeCountRTV );
-    SAFE_RELEASE( g_EdgeCountSRV );    
+	g_MLAAEffect.ReleaseIntermediates();
 
 	SAFE_RELEASE( g_SceneDepthStencilState);
 	SAFE_RELEASE( g_DepthStencilState);
 	SAFE_RELEASE( g_ScreenQuadDepthStencilState);
 	SAFE_RELEASE( g_DepthStencil);	
 	SAFE_RELEASE( g_DepthStencilView);  
+	SAFE_RELEASE( g_MLAADepthStencil );
+	SAFE_RELEASE( g_MLAADepthStencilView );
+
+	SAFE_RELEASE( g_CPUSceneColor );
+	ReleaseCPUQueue();
+	SAFE_RELEASE( g_ComputeOutput );
+	SAFE_RELEASE( g_ComputeOutputSRV );
+	SAFE_RELEASE( g_ComputeOutputUAV );
+	g_TargetPool.Clear();
 
     // Delete additional render resources here...
     g_SceneMesh.Destroy();
 
     SAFE_RELEASE( g_pcbVSPerObject11 );
     SAFE_RELEASE( g_pcbVSPerFrame11 );
-	SAFE_RELEASE( g_pcbMLAA11 );
+	g_D3D11Backend.ReleaseDeviceObjects();
 
 	TIMER_Destroy();
 }
@@ -1229,12 +2820,18 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
 				g_HUD.m_GUI.GetCheckBox(IDC_USE_STENCIL)->SetEnabled(TRUE);
 				g_HUD.m_GUI.GetCheckBox(IDC_SHOWEDGE)->SetEnabled(TRUE);
 				g_HUD.m_GUI.GetSlider(IDC_THRESHOLD)->SetEnabled(TRUE);
+				g_HUD.m_GUI.GetCheckBox(IDC_CPU_MLAA)->SetEnabled(TRUE);
+				g_HUD.m_GUI.GetCheckBox(IDC_CPU_TRANSPOSED_SEARCH)->SetEnabled(g_bUseCPUMLAA);
+				g_HUD.m_GUI.GetSlider(IDC_CPU_FRAMES_IN_FLIGHT)->SetEnabled(g_bUseCPUMLAA);
 			}
 			else
 			{
 				g_HUD.m_GUI.GetCheckBox(IDC_USE_STENCIL)->SetEnabled(FALSE);
 				g_HUD.m_GUI.GetCheckBox(IDC_SHOWEDGE)->SetEnabled(FALSE);
 				g_HUD.m_GUI.GetSlider(IDC_THRESHOLD)->SetEnabled(FALSE);
+				g_HUD.m_GUI.GetCheckBox(IDC_CPU_MLAA)->SetEnabled(FALSE);
+				g_HUD.m_GUI.GetCheckBox(IDC_CPU_TRANSPOSED_SEARCH)->SetEnabled(FALSE);
+				g_HUD.m_GUI.GetSlider(IDC_CPU_FRAMES_IN_FLIGHT)->SetEnabled(FALSE);
 			}
 			break;
 		
@@ -1245,6 +2842,87 @@ void CALLBACK OnGUIEvent( UINT nEvent, int nControlID, CDXUTControl* pControl, v
         case IDC_SHOWEDGE :
 			g_bShowEdges = !g_bShowEdges;			
 			break;
+
+        case IDC_CPU_MLAA:
+			g_bUseCPUMLAA = !g_bUseCPUMLAA;
+			g_HUD.m_GUI.GetCheckBox(IDC_CPU_TRANSPOSED_SEARCH)->SetEnabled(g_bUseCPUMLAA);
+			g_HUD.m_GUI.GetSlider(IDC_CPU_FRAMES_IN_FLIGHT)->SetEnabled(g_bUseCPUMLAA);
+			if (!g_bUseCPUMLAA)
+				ReleaseCPUQueue();
+			break;
+
+        case IDC_CPU_TRANSPOSED_SEARCH:
+			g_bCPUTransposedSearch = !g_bCPUTransposedSearch;
+			break;
+
+        case IDC_CPU_FRAMES_IN_FLIGHT:
+			g_nCPUFramesInFlight = ((CDXUTSlider*)pControl)->GetValue();
+			swprintf_s( szTemp, L"CPU Frames In Flight:%d", g_nCPUFramesInFlight);	
+			g_HUD.m_GUI.GetStatic( IDC_CPU_FRAMES_IN_FLIGHT_STATIC )->SetText( szTemp );
+			ReleaseCPUQueue();
+			break;
+
+        case IDC_SCENE_MSAA:
+			{
+				int SampleCount = (int)(size_t)((CDXUTComboBox*)pControl)->GetSelectedData();
+				UINT ColorQuality = 0, DepthQuality = 0;
+				ID3D11Device* pd3dDevice = DXUTGetD3D11Device();
+				pd3dDevice->CheckMultisampleQualityLevels( OFFSCREENFORMAT, SampleCount, &ColorQuality );
+				pd3dDevice->CheckMultisampleQualityLevels( DXGI_FORMAT_D24_UNORM_S8_UINT, SampleCount, &DepthQuality );
+				if (ColorQuality > 0 && DepthQuality > 0)
+				{
+					g_MSAACount = SampleCount;
+					CreateMLAARenderTargets( pd3dDevice, DXUTGetDXGIBackBufferSurfaceDesc() );
+				}
+				else
+				{
+					((CDXUTComboBox*)pControl)->SetSelectedByData( (void*)(size_t)g_MSAACount );
+				}
+			}
+			break;
+
+        case IDC_MSAA_AWARE:
+			g_bMSAAAwareMLAA = !g_bMSAAAwareMLAA;
+			break;
+
+        case IDC_HALF_RES_EDGES:
+			g_bHalfResEdges = !g_bHalfResEdges;
+			break;
+
+        case IDC_FOVEATED_MLAA:
+			g_bFoveatedMLAA = !g_bFoveatedMLAA;
+			break;
+
+        case IDC_BUDGET_GOVERNOR:
+			g_bBudgetGovernor = !g_bBudgetGovernor;
+			g_HUD.m_GUI.GetSlider(IDC_MLAA_BUDGET)->SetEnabled(g_bBudgetGovernor);
+			g_Governor.Reset();
+			break;
+
+        case IDC_MLAA_BUDGET:
+			g_fMLAABudget = (float)(((CDXUTSlider*)pControl)->GetValue()) / 10.0f;
+			swprintf_s( szTemp, L"MLAA Budget:%.1f ms", g_fMLAABudget);
+			g_HUD.m_GUI.GetStatic( IDC_MLAA_BUDGET_STATIC )->SetText( szTemp );
+			break;
+
+        case IDC_EDGE_FETCH:
+			g_nEdgeFetch = (int)(size_t)((CDXUTComboBox*)pControl)->GetSelectedData();
+			break;
+        case IDC_PASS_SHADER:
+			g_nPassShader = (int)(size_t)((CDXUTComboBox*)pControl)->GetSelectedData();
+			break;
+
+        case IDC_EDGE_SEARCH:
+			g_nEdgeSearch = (int)(size_t)((CDXUTComboBox*)pControl)->GetSelectedData();
+			break;
+
+        case IDC_MLAA_MAGNIFIED_REGION:
+			g_bMLAAMagnifiedRegion = !g_bMLAAMagnifiedRegion;
+			break;
+
+        case IDC_ATLAS_MODE:
+			g_nAtlasMode = (int)(size_t)((CDXUTComboBox*)pControl)->GetSelectedData();
+			break;
 		
         case IDC_THRESHOLD:          
 			gEdgeDetectionThreshold = (float)(((CDXUTSlider*)pControl)->GetValue());
@@ -0,0 +1,2232 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_CPU.cpp
+//
+// CPU implementation of the three MLAA passes. Each pass produces the same result as
+// the matching pixel shader in MLAA11.hlsl.
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_CPU.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// SSE2 is part of x64, the planar edge kernel falls back to 16 bit lanes elsewhere
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MLAA_CPU_SSE2 1
+#endif
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// The engine is compiled with precise float semantics, so that its output is bit exact
+// whatever the float model of the project. The sample builds with fast floating point,
+// which lets the compiler contract the blend into fused multiply-adds, turn the divisions
+// by 255 into multiplications and do either differently in vectorized and scalar code.
+// Only the blend pass and the threshold use floats.
+//--------------------------------------------------------------------------------------
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma float_control(precise, on)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma float_control(precise, on)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("no-unsafe-math-optimizations", "no-associative-math", "no-reciprocal-math", "fp-contract=off")
+#endif
+
+//--------------------------------------------------------------------------------------
+// Bit scan helpers, the argument must not be zero
+//--------------------------------------------------------------------------------------
+static inline int LowestBit( uint64_t v )
+{
+    assert( v != 0 );
+#if defined(_MSC_VER)
+    unsigned long Index;
+    _BitScanForward64( &Index, v );
+    return (int)Index;
+#else
+    return __builtin_ctzll( v );
+#endif
+}
+
+static inline int HighestBit( uint64_t v )
+{
+    assert( v != 0 );
+#if defined(_MSC_VER)
+    unsigned long Index;
+    _BitScanReverse64( &Index, v );
+    return (int)Index;
+#else
+    return 63 - __builtin_clzll( v );
+#endif
+}
+
+//--------------------------------------------------------------------------------------
+// Millisecond time stamp for the pass timings
+//--------------------------------------------------------------------------------------
+double MLAA::GetTimeMs()
+{
+#if defined(_MSC_VER)
+    static LARGE_INTEGER Frequency = { 0 };
+    if ( Frequency.QuadPart == 0 )
+        QueryPerformanceFrequency( &Frequency );
+    LARGE_INTEGER Counter;
+    QueryPerformanceCounter( &Counter );
+    return (double)Counter.QuadPart * 1000.0 / (double)Frequency.QuadPart;
+#else
+    timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+#endif
+}
+
+//--------------------------------------------------------------------------------------
+// Returns 64 bits of an edge bit plane row starting at Pos. Positions outside the row
+// are clamped to the first and last pixel, the same as the clamp() around the Loads in
+// MLAA_ComputeLineLength_PS.
+//--------------------------------------------------------------------------------------
+static inline uint64_t FetchBits( const uint64_t* pRow, int nLength, int Pos )
+{
+    if ( Pos >= 0 && Pos + 64 <= nLength )
+    {
+        int Word = Pos >> 6;
+        int Shift = Pos & 63;
+        uint64_t Bits = pRow[Word] >> Shift;
+        if ( Shift )
+            Bits |= pRow[Word + 1] << (64 - Shift);
+        return Bits;
+    }
+
+    uint64_t Bits = 0;
+    for ( int i = 0; i < 64; i++ )
+    {
+        int p = Pos + i;
+        p = p < 0 ? 0 : ( p >= nLength ? nLength - 1 : p );
+        Bits |= ( (pRow[p >> 6] >> (p & 63)) & 1 ) << i;
+    }
+    return Bits;
+}
+
+//--------------------------------------------------------------------------------------
+// Layout of the counts of one direction: the negative count in the upper half and the
+// positive one in the lower half, each with a stop bit on top. uint8_t counts are the
+// g_EdgeCount layout, uint16_t counts the layout of the long edge search.
+//--------------------------------------------------------------------------------------
+template <typename CountType>
+struct CountFormat
+{
+    static const unsigned int NumCountBits = sizeof( CountType ) * 4;
+    static const unsigned int MaxEdgeLength = ( 1 << (NumCountBits - 1) ) - 1;
+    static const unsigned int StopBit = ( 1 << (NumCountBits - 1) );
+    static const unsigned int CountMask = ( 1 << NumCountBits ) - 1;
+};
+
+template <typename CountType>
+static inline CountType EncodeCountAs( unsigned int NegCount, unsigned int PosCount )
+{
+    typedef CountFormat<CountType> Format;
+    return (CountType)( ((NegCount & Format::CountMask) << Format::NumCountBits) | (PosCount & Format::CountMask) );
+}
+
+//--------------------------------------------------------------------------------------
+// Run length kernel shared by horizontal and (transposed) vertical edges. For every set
+// bit of a row it counts the consecutive set bits on either side, up to kMaxEdgeLength,
+// and adds the stop bit when the run ends within the search range.
+//--------------------------------------------------------------------------------------
+static inline uint8_t EncodeCount( unsigned int NegCount, unsigned int PosCount )
+{
+    return EncodeCountAs<uint8_t>( NegCount, PosCount );
+}
+
+// MaxLength is at most kMaxEdgeLength
+static inline unsigned int PositiveRun( const uint64_t* pRow, int nLength, int Pos, unsigned int MaxLength )
+{
+    uint64_t Zeros = ~FetchBits( pRow, nLength, Pos + 1 ) | ( 1ULL << MaxLength );
+    unsigned int Run = (unsigned int)LowestBit( Zeros );
+    return ( Run < MaxLength ) ? ( Run | kStopBit ) : Run;
+}
+
+static inline unsigned int NegativeRun( const uint64_t* pRow, int nLength, int Pos, unsigned int MaxLength )
+{
+    uint64_t Zeros = ~FetchBits( pRow, nLength, Pos - 64 ) | ( 1ULL << (63 - MaxLength) );
+    unsigned int Run = (unsigned int)( 63 - HighestBit( Zeros ) );
+    return ( Run < MaxLength ) ? ( Run | kStopBit ) : Run;
+}
+
+//--------------------------------------------------------------------------------------
+// Runs of the long edge search, up to kLongMaxEdgeLength. The 64 bit words summarize
+// blocks of 64 pixels: a word that is all edge is stepped over at once and a bit scan
+// finds the end of the run in the first word that has a gap, so a run of n pixels
+// takes n / 64 + 1 fetches instead of n tests. MaxLength is at most kLongMaxEdgeLength.
+//--------------------------------------------------------------------------------------
+static inline unsigned int LongPositiveRun( const uint64_t* pRow, int nLength, int Pos, unsigned int MaxLength )
+{
+    unsigned int Run = 0;
+    for ( ;; )
+    {
+        uint64_t Zeros = ~FetchBits( pRow, nLength, Pos + 1 + (int)Run );
+        if ( Zeros )
+        {
+            Run += (unsigned int)LowestBit( Zeros );
+            break;
+        }
+        Run += 64;
+        if ( Run >= MaxLength )
+            break;
+    }
+    return ( Run < MaxLength ) ? ( Run | kLongStopBit ) : MaxLength;
+}
+
+static inline unsigned int LongNegativeRun( const uint64_t* pRow, int nLength, int Pos, unsigned int MaxLength )
+{
+    unsigned int Run = 0;
+    for ( ;; )
+    {
+        uint64_t Zeros = ~FetchBits( pRow, nLength, Pos - 64 - (int)Run );
+        if ( Zeros )
+        {
+            Run += (unsigned int)( 63 - HighestBit( Zeros ) );
+            break;
+        }
+        Run += 64;
+        if ( Run >= MaxLength )
+            break;
+    }
+    return ( Run < MaxLength ) ? ( Run | kLongStopBit ) : MaxLength;
+}
+
+//--------------------------------------------------------------------------------------
+// How far the search follows the run of a position. With a quality map the search stops
+// after kShortEdgeLength pixels in QUALITY_SHORT_EDGES tiles, where a longer run would
+// only be cut back to that length
+//--------------------------------------------------------------------------------------
+struct FullSearch
+{
+    unsigned int    MaxLength;
+
+    unsigned int operator()( int ) const { return MaxLength; }
+};
+
+struct TileSearch
+{
+    const uint8_t*  pLevels;        // Quality of the first position of the row
+    int             LevelDivisor;   // Positions per quality, 1 along a row and the tile size down a column
+    int             LevelStride;    // Distance between the qualities of consecutive tiles
+    unsigned int    MaxLength;
+
+    unsigned int operator()( int Pos ) const
+    {
+        return ( pLevels[(size_t)( Pos / LevelDivisor ) * LevelStride] == QUALITY_SHORT_EDGES ) ? kShortEdgeLength : MaxLength;
+    }
+};
+
+// CountStride is the distance in counts between the counts of two consecutive bits.
+// bSwapSides stores the positive run as the negative count, as vertical edges need.
+// uint16_t counts take the long edge search.
+template <bool bSwapSides, typename CountType, typename SearchType>
+static void RunLengthRow( const uint64_t* pRow, int nLength, CountType* pCounts, int CountStride, const SearchType& Search )
+{
+    const bool bLong = ( sizeof( CountType ) > 1 );
+    int nWords = (nLength + 63) >> 6;
+    for ( int w = 0; w < nWords; w++ )
+    {
+        uint64_t Bits = pRow[w];
+        while ( Bits )
+        {
+            int Pos = (w << 6) + LowestBit( Bits );
+            Bits &= Bits - 1;
+
+            unsigned int MaxLength = Search( Pos );
+            unsigned int NegRun = bLong ? LongNegativeRun( pRow, nLength, Pos, MaxLength ) : NegativeRun( pRow, nLength, Pos, MaxLength );
+            unsigned int PosRun = bLong ? LongPositiveRun( pRow, nLength, Pos, MaxLength ) : PositiveRun( pRow, nLength, Pos, MaxLength );
+            pCounts[Pos * CountStride] = bSwapSides ? EncodeCountAs<CountType>( PosRun, NegRun ) : EncodeCountAs<CountType>( NegRun, PosRun );
+        }
+    }
+}
+
+// pLevels is NULL without a quality map
+template <bool bSwapSides, typename CountType>
+static void RunLengthRow( const uint64_t* pRow, int nLength, CountType* pCounts, int CountStride,
+                          const uint8_t* pLevels, int LevelDivisor, int LevelStride )
+{
+    if ( pLevels == NULL )
+    {
+        FullSearch Search = { CountFormat<CountType>::MaxEdgeLength };
+        RunLengthRow<bSwapSides>( pRow, nLength, pCounts, CountStride, Search );
+    }
+    else
+    {
+        TileSearch Search = { pLevels, LevelDivisor, LevelStride, CountFormat<CountType>::MaxEdgeLength };
+        RunLengthRow<bSwapSides>( pRow, nLength, pCounts, CountStride, Search );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// 64x64 bit matrix transpose using recursive block swaps (Hacker's Delight, 7-3).
+// Each step swaps the off-diagonal blocks of every 2jx2j sub matrix with masked shifts,
+// so the whole transpose takes 6 rounds of 32 word operations.
+//--------------------------------------------------------------------------------------
+void MLAA::TransposeBits64( uint64_t Rows[64] )
+{
+    uint64_t Mask = 0x00000000FFFFFFFFULL;
+    for ( int j = 32; j != 0; j >>= 1, Mask ^= ( Mask << j ) )
+    {
+        for ( int k = 0; k < 64; k = ( (k | j) + 1 ) & ~j )
+        {
+            uint64_t t = ( (Rows[k] >> j) ^ Rows[k | j] ) & Mask;
+            Rows[k] ^= t << j;
+            Rows[k | j] ^= t;
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Constructor
+//--------------------------------------------------------------------------------------
+CPUEngine::CPUEngine()
+{
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_nWordsPerRow = 0;
+    m_nColumnCounts = 0;
+    m_pScratch = NULL;
+    m_pEdgeMask = NULL;
+    m_pEdgeCount = NULL;
+    m_pHorizontalBits = NULL;
+    m_pVerticalBits = NULL;
+    m_pColumnBits = NULL;
+    m_pColumnCounts = NULL;
+    m_pLongEdgeCount = NULL;
+    m_pLongColumnCounts = NULL;
+    m_pActiveWords = NULL;
+    m_pPixelLevels = NULL;
+    m_pHalfResBits = NULL;
+    m_pHalfResWords = NULL;
+    m_VerticalSearch = VERTICAL_SEARCH_TRANSPOSED;
+    m_DetectionResolution = DETECTION_FULL;
+    m_DetectionKernel = DETECTION_KERNEL_PIXEL;
+    m_bHalfResEdges = false;
+    m_nEdgeLeft = 0;
+    m_nEdgeTop = 0;
+    m_bChromaEdges = false;
+    m_fHDRThreshold = 0.5f;
+    m_fHDRBlackLevel = 1.0f / 1024.0f;
+    m_EdgeSearch = EDGE_SEARCH_SHORT;
+    m_bLongCounts = false;
+    m_nQualityTileSize = 0;
+    m_nQualityColumns = 0;
+    m_nQualityRows = 0;
+    SetThreshold( kDefaultThreshold );
+
+    for ( int i = 0; i < PASS_COUNT; i++ )
+        m_PassTime[i] = 0.0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Destructor
+//--------------------------------------------------------------------------------------
+CPUEngine::~CPUEngine()
+{
+}
+
+
+//--------------------------------------------------------------------------------------
+// The shader compares UNORM luma values as floats: abs(a - b) > gParam.z. Find the
+// smallest 8 bit difference that passes this test so the CPU can compare integers.
+//--------------------------------------------------------------------------------------
+void CPUEngine::SetThreshold( float fThreshold )
+{
+    m_nThresholdLevel = 256;
+    for ( int d = 0; d < 256; d++ )
+    {
+        if ( (float)d / 255.0f > fThreshold )
+        {
+            m_nThresholdLevel = d;
+            break;
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Radial quality map, a tile takes the level of its point closest to the center
+//--------------------------------------------------------------------------------------
+void MLAA::BuildFoveatedQualityMap( int Width, int Height, int TileSize, float CenterX, float CenterY,
+                                    float InnerRadius, float OuterRadius, std::vector<uint8_t>& Levels, QualityMap& Map )
+{
+    assert( TileSize > 0 );
+
+    Map.TileSize = TileSize;
+    Map.Columns = ( Width + TileSize - 1 ) / TileSize;
+    Map.Rows = ( Height + TileSize - 1 ) / TileSize;
+    Levels.resize( (size_t)Map.Columns * Map.Rows );
+
+    for ( int y = 0; y < Map.Rows; y++ )
+    {
+        for ( int x = 0; x < Map.Columns; x++ )
+        {
+            float Left = (float)( x * TileSize );
+            float Top = (float)( y * TileSize );
+            float dx = ( CenterX < Left ) ? Left - CenterX : ( CenterX > Left + TileSize ? CenterX - Left - TileSize : 0.0f );
+            float dy = ( CenterY < Top ) ? Top - CenterY : ( CenterY > Top + TileSize ? CenterY - Top - TileSize : 0.0f );
+            float Distance = sqrtf( dx * dx + dy * dy );
+
+            QUALITY_LEVEL Level = QUALITY_SKIP;
+            if ( Distance <= InnerRadius )
+                Level = QUALITY_FULL;
+            else if ( Distance <= OuterRadius )
+                Level = QUALITY_SHORT_EDGES;
+            Levels[y * Map.Columns + x] = (uint8_t)Level;
+        }
+    }
+
+    Map.pLevels = Levels.empty() ? NULL : &Levels[0];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Copy a quality map
+//--------------------------------------------------------------------------------------
+void CPUEngine::SetQualityMap( const QualityMap* pMap )
+{
+    if ( pMap == NULL || pMap->pLevels == NULL )
+    {
+        m_QualityLevels.clear();
+        m_nQualityTileSize = m_nQualityColumns = m_nQualityRows = 0;
+        return;
+    }
+
+    assert( pMap->TileSize > 0 );
+    m_nQualityTileSize = pMap->TileSize;
+    m_nQualityColumns = pMap->Columns;
+    m_nQualityRows = pMap->Rows;
+    m_QualityLevels.assign( pMap->pLevels, pMap->pLevels + (size_t)pMap->Columns * pMap->Rows );
+}
+
+inline QUALITY_LEVEL CPUEngine::GetQualityLevel( int x, int y ) const
+{
+    int Column = x / m_nQualityTileSize;
+    int Row = y / m_nQualityTileSize;
+    if ( Column >= m_nQualityColumns || Row >= m_nQualityRows )
+        return QUALITY_FULL;
+    return (QUALITY_LEVEL)m_QualityLevels[Row * m_nQualityColumns + Column];
+}
+
+
+//--------------------------------------------------------------------------------------
+// The quality of every pixel of a row, for each row of tiles
+//--------------------------------------------------------------------------------------
+void CPUEngine::ExpandQualityLevels()
+{
+    const int nTileRows = ( m_nHeight + m_nQualityTileSize - 1 ) / m_nQualityTileSize;
+    m_pPixelLevels = GetScratch<uint8_t>( SCRATCH_PIXEL_LEVELS, (size_t)nTileRows * m_nWidth );
+
+    for ( int y = 0; y < nTileRows; y++ )
+    {
+        uint8_t* pLevels = &m_pPixelLevels[(size_t)y * m_nWidth];
+        for ( int x = 0; x < m_nWidth; x += m_nQualityTileSize )
+        {
+            int xEnd = ( x + m_nQualityTileSize < m_nWidth ) ? x + m_nQualityTileSize : m_nWidth;
+            memset( &pLevels[x], GetQualityLevel( x, y * m_nQualityTileSize ), xEnd - x );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Find the words of each row that the tiles which aren't skipped depend on, the same
+// halo as a region
+//--------------------------------------------------------------------------------------
+void CPUEngine::UpdateActiveWords()
+{
+    const int nTileRows = ( m_nHeight + m_nQualityTileSize - 1 ) / m_nQualityTileSize;
+    const int Halo = GetRegionHalo();
+    m_pActiveWords = GetScratch<uint8_t>( SCRATCH_ACTIVE_WORDS, (size_t)nTileRows * m_nWordsPerRow );
+    memset( m_pActiveWords, 0, (size_t)nTileRows * m_nWordsPerRow );
+
+    for ( int y = 0; y < nTileRows; y++ )
+    {
+        for ( int x = 0; x * m_nQualityTileSize < m_nWidth; x++ )
+        {
+            if ( GetQualityLevel( x * m_nQualityTileSize, y * m_nQualityTileSize ) == QUALITY_SKIP )
+                continue;
+
+            int Left = x * m_nQualityTileSize - Halo;
+            int Top = y * m_nQualityTileSize - Halo;
+            int Right = ( x + 1 ) * m_nQualityTileSize + Halo;
+            int Bottom = ( y + 1 ) * m_nQualityTileSize + Halo;
+
+            int FirstWord = ( Left > 0 ? Left : 0 ) >> 6;
+            int LastWord = ( ( Right < m_nWidth ? Right : m_nWidth ) - 1 ) >> 6;
+            int FirstRow = ( Top > 0 ? Top : 0 ) / m_nQualityTileSize;
+            int LastRow = ( ( Bottom < m_nHeight ? Bottom : m_nHeight ) - 1 ) / m_nQualityTileSize;
+
+            for ( int r = FirstRow; r <= LastRow; r++ )
+                memset( &m_pActiveWords[(size_t)r * m_nWordsPerRow + FirstWord], 1, LastWord - FirstWord + 1 );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Limit the counts of QUALITY_SHORT_EDGES tiles to kShortEdgeLength. This gives the same
+// counts as a search that stops after kShortEdgeLength pixels, for the searches that
+// can't stop early: half resolution detection, the direct vertical search and the naive
+// long search.
+//--------------------------------------------------------------------------------------
+static inline unsigned int ClampRun( unsigned int Run, unsigned int MaxLength, unsigned int StopBit )
+{
+    return ( (Run & ~StopBit) < MaxLength ) ? Run : MaxLength;
+}
+
+void CPUEngine::ClampShortEdges()
+{
+    if ( m_bLongCounts )
+    {
+        for ( int y = 0; y < m_nHeight; y++ )
+        {
+            uint16_t* pCount = &m_pLongEdgeCount[(size_t)y * m_nWidth * 2];
+            for ( int x = 0; x < m_nWidth; x++ )
+            {
+                if ( GetQualityLevel( x, y ) != QUALITY_SHORT_EDGES )
+                    continue;
+                for ( int i = 0; i < 2; i++ )
+                {
+                    unsigned int Count = pCount[x * 2 + i];
+                    pCount[x * 2 + i] = EncodeCountAs<uint16_t>( ClampRun( Count >> kLongNumCountBits, kShortEdgeLength, kLongStopBit ),
+                                                                 ClampRun( Count & 0xFF, kShortEdgeLength, kLongStopBit ) );
+                }
+            }
+        }
+        return;
+    }
+
+    uint8_t ShortCount[256];
+    for ( unsigned int Count = 0; Count < 256; Count++ )
+    {
+        ShortCount[Count] = EncodeCount( ClampRun( (Count >> kNegCountShift) & kCountShiftMask, kShortEdgeLength, kStopBit ),
+                                         ClampRun( (Count >> kPosCountShift) & kCountShiftMask, kShortEdgeLength, kStopBit ) );
+    }
+
+    for ( int Row = 0; Row < m_nQualityRows; Row++ )
+    {
+        for ( int Column = 0; Column < m_nQualityColumns; Column++ )
+        {
+            if ( m_QualityLevels[Row * m_nQualityColumns + Column] != QUALITY_SHORT_EDGES )
+                continue;
+
+            int xEnd = ( (Column + 1) * m_nQualityTileSize < m_nWidth ) ? (Column + 1) * m_nQualityTileSize : m_nWidth;
+            int yEnd = ( (Row + 1) * m_nQualityTileSize < m_nHeight ) ? (Row + 1) * m_nQualityTileSize : m_nHeight;
+
+            for ( int y = Row * m_nQualityTileSize; y < yEnd; y++ )
+            {
+                uint8_t* pCount = &m_pEdgeCount[(size_t)y * m_nWidth * 2];
+                for ( int i = Column * m_nQualityTileSize * 2; i < xEnd * 2; i++ )
+                {
+                    pCount[i] = ShortCount[pCount[i]];
+                }
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Switch the intermediates to those of the image size. A size in the scratch cache keeps
+// the intermediates of its last use, which the passes overwrite like those of the frame
+// before at an unchanged size. A new size gets them cleared
+//--------------------------------------------------------------------------------------
+void CPUEngine::Resize( int nWidth, int nHeight )
+{
+    m_nEdgeLeft = 0;
+    m_nEdgeTop = 0;
+
+    if ( m_pScratch && nWidth == m_nWidth && nHeight == m_nHeight )
+        return;
+
+    m_nWidth = nWidth;
+    m_nHeight = nHeight;
+    m_nWordsPerRow = (nWidth + 63) >> 6;
+
+    int nBlockRows = (nHeight + 63) >> 6;
+    m_nColumnCounts = (size_t)64 * 64 * nBlockRows;
+
+    m_pScratch = &m_Scratch.Acquire( nWidth, nHeight );
+    m_pEdgeMask = GetScratch<uint8_t>( SCRATCH_EDGE_MASK, (size_t)nWidth * nHeight );
+    m_pEdgeCount = GetScratch<uint8_t>( SCRATCH_EDGE_COUNT, (size_t)nWidth * nHeight * 2 );
+    m_pHorizontalBits = GetScratch<uint64_t>( SCRATCH_HORIZONTAL_BITS, (size_t)m_nWordsPerRow * nHeight );
+    m_pVerticalBits = GetScratch<uint64_t>( SCRATCH_VERTICAL_BITS, (size_t)m_nWordsPerRow * nHeight );
+    m_pColumnBits = GetScratch<uint64_t>( SCRATCH_COLUMN_BITS, (size_t)64 * nBlockRows );
+    m_pColumnCounts = GetScratch<uint8_t>( SCRATCH_COLUMN_COUNTS, m_nColumnCounts );
+    m_pLongEdgeCount = (uint16_t*)m_pScratch->Slots[SCRATCH_LONG_EDGE_COUNT].pData;
+    m_pLongColumnCounts = (uint16_t*)m_pScratch->Slots[SCRATCH_LONG_COLUMN_COUNTS].pData;
+    m_pActiveWords = NULL;
+    m_pPixelLevels = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Gives the scratch of every resolution back
+//--------------------------------------------------------------------------------------
+void CPUEngine::ReleaseIntermediates()
+{
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_nWordsPerRow = 0;
+    m_nColumnCounts = 0;
+
+    m_Scratch.Release();
+    m_pScratch = NULL;
+    m_pEdgeMask = NULL;
+    m_pEdgeCount = NULL;
+    m_pHorizontalBits = NULL;
+    m_pVerticalBits = NULL;
+    m_pColumnBits = NULL;
+    m_pColumnCounts = NULL;
+    m_pLongEdgeCount = NULL;
+    m_pLongColumnCounts = NULL;
+    m_pActiveWords = NULL;
+    m_pPixelLevels = NULL;
+    m_pHalfResBits = NULL;
+    m_pHalfResWords = NULL;
+    m_nEdgeLeft = 0;
+    m_nEdgeTop = 0;
+    m_pHalfRes.reset();
+    m_pChroma.reset();
+    m_bChromaEdges = false;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The counts of the last ComputeLineLength are the long ones or the 8 bit ones
+//--------------------------------------------------------------------------------------
+EdgeView CPUEngine::GetEdgeView() const
+{
+    EdgeView Edges;
+    Edges.Width = m_nWidth;
+    Edges.Height = m_nHeight;
+    Edges.Left = m_nEdgeLeft;
+    Edges.Top = m_nEdgeTop;
+    Edges.pEdgeMask = m_pEdgeMask;
+    if ( m_bLongCounts )
+    {
+        Edges.pCounts = (const uint8_t*)m_pLongEdgeCount;
+        Edges.CountBytes = 2;
+        Edges.MaxEdgeLength = kLongMaxEdgeLength;
+    }
+    else
+    {
+        Edges.pCounts = m_pEdgeCount;
+        Edges.CountBytes = 1;
+        Edges.MaxEdgeLength = kMaxEdgeLength;
+    }
+    return Edges;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Scratch statistics and trimming, including the engines of the downsampled images
+//--------------------------------------------------------------------------------------
+size_t CPUEngine::GetScratchBytes() const
+{
+    return m_Scratch.GetBytes() + ( m_pHalfRes ? m_pHalfRes->GetScratchBytes() : 0 ) +
+           ( m_pChroma ? m_pChroma->GetScratchBytes() : 0 );
+}
+
+size_t CPUEngine::GetScratchHighWater() const
+{
+    return m_Scratch.GetHighWater() + ( m_pHalfRes ? m_pHalfRes->GetScratchHighWater() : 0 ) +
+           ( m_pChroma ? m_pChroma->GetScratchHighWater() : 0 );
+}
+
+uint64_t CPUEngine::GetScratchAllocations() const
+{
+    return m_Scratch.GetHeapAllocations() + ( m_pHalfRes ? m_pHalfRes->GetScratchAllocations() : 0 ) +
+           ( m_pChroma ? m_pChroma->GetScratchAllocations() : 0 );
+}
+
+void CPUEngine::TrimScratch()
+{
+    m_Scratch.Trim();
+    if ( m_pHalfRes )
+        m_pHalfRes->TrimScratch();
+    if ( m_pChroma )
+        m_pChroma->TrimScratch();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Long searches depend on longer edges. Half resolution detection also depends on the
+// 2x2 blocks next to the ones around an edge.
+//--------------------------------------------------------------------------------------
+int CPUEngine::GetRegionHalo() const
+{
+    int Halo = ( m_EdgeSearch != EDGE_SEARCH_SHORT ) ? kLongRegionHalo : kRegionHalo;
+    if ( m_DetectionResolution == DETECTION_HALF )
+        Halo += kHalfResHalo;
+    return Halo;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Run all three passes
+//--------------------------------------------------------------------------------------
+void CPUEngine::Apply( const Surface& Src, const Surface& Dst )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height );
+    assert( Src.pData != Dst.pData );
+
+    DetectEdges( Src );
+    ComputeLineLength();
+    BlendColor( Src, Dst );
+}
+
+//--------------------------------------------------------------------------------------
+// Run the three passes on a region of interest. The passes see the region plus halo as
+// the whole image: where that rectangle stops inside the image the results are wrong
+// near its border, but never within GetRegionHalo() of it. Half resolution detection also
+// needs a rectangle aligned to the 2x2 blocks of the full image.
+//--------------------------------------------------------------------------------------
+void CPUEngine::Apply( const Surface& Src, const Surface& Dst, const Rect& Region )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height );
+    assert( Src.pData != Dst.pData );
+
+    Rect Clipped;
+    Clipped.Left = ( Region.Left > 0 ) ? Region.Left : 0;
+    Clipped.Top = ( Region.Top > 0 ) ? Region.Top : 0;
+    Clipped.Right = ( Region.Right < Src.Width ) ? Region.Right : Src.Width;
+    Clipped.Bottom = ( Region.Bottom < Src.Height ) ? Region.Bottom : Src.Height;
+    if ( Clipped.Left >= Clipped.Right || Clipped.Top >= Clipped.Bottom )
+    {
+        return;
+    }
+
+    const int Halo = GetRegionHalo();
+
+    Rect Work;
+    Work.Left = ( Clipped.Left > Halo ) ? Clipped.Left - Halo : 0;
+    Work.Top = ( Clipped.Top > Halo ) ? Clipped.Top - Halo : 0;
+    Work.Right = ( Clipped.Right + Halo < Src.Width ) ? Clipped.Right + Halo : Src.Width;
+    Work.Bottom = ( Clipped.Bottom + Halo < Src.Height ) ? Clipped.Bottom + Halo : Src.Height;
+    if ( m_DetectionResolution == DETECTION_HALF )
+    {
+        Work.Left &= ~1;
+        Work.Top &= ~1;
+    }
+
+    Surface WorkSrc = GetSubSurface( Src, Work );
+    Surface WorkDst = GetSubSurface( Dst, Work );
+
+    Rect Inner = { Clipped.Left - Work.Left, Clipped.Top - Work.Top, Clipped.Right - Work.Left, Clipped.Bottom - Work.Top };
+
+    // The quality map is in whole image coordinates
+    std::vector<uint8_t> QualityLevels;
+    QualityLevels.swap( m_QualityLevels );
+
+    DetectEdges( WorkSrc );
+    m_nEdgeLeft = Work.Left;
+    m_nEdgeTop = Work.Top;
+    ComputeLineLength();
+    BlendColor( WorkSrc, WorkDst, &Inner );
+
+    QualityLevels.swap( m_QualityLevels );
+}
+
+//--------------------------------------------------------------------------------------
+// Run the three passes on views of an atlas. A view is a sub-surface, so the clamping
+// and out of bounds reads happen at its borders exactly as at the border of an image.
+//--------------------------------------------------------------------------------------
+static Rect ClipView( const Surface& Src, const View& AtlasView )
+{
+    Rect Clipped;
+    Clipped.Left = ( AtlasView.Region.Left > 0 ) ? AtlasView.Region.Left : 0;
+    Clipped.Top = ( AtlasView.Region.Top > 0 ) ? AtlasView.Region.Top : 0;
+    Clipped.Right = ( AtlasView.Region.Right < Src.Width ) ? AtlasView.Region.Right : Src.Width;
+    Clipped.Bottom = ( AtlasView.Region.Bottom < Src.Height ) ? AtlasView.Region.Bottom : Src.Height;
+    return Clipped;
+}
+
+void CPUEngine::ApplyView( const Surface& Src, const Surface& Dst, const View& AtlasView )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height );
+
+    Rect Clipped = ClipView( Src, AtlasView );
+    if ( Clipped.Left >= Clipped.Right || Clipped.Top >= Clipped.Bottom )
+    {
+        return;
+    }
+
+    std::vector<uint8_t> QualityLevels;
+    QualityLevels.swap( m_QualityLevels );
+
+    int nThresholdLevel = m_nThresholdLevel;
+    SetThreshold( AtlasView.fThreshold );
+    Apply( GetSubSurface( Src, Clipped ), GetSubSurface( Dst, Clipped ) );
+    m_nThresholdLevel = nThresholdLevel;
+    m_nEdgeLeft = Clipped.Left;
+    m_nEdgeTop = Clipped.Top;
+
+    QualityLevels.swap( m_QualityLevels );
+}
+
+//--------------------------------------------------------------------------------------
+// Batch of views, in the order given so neighbouring views share pages of the atlas. The
+// quality map is set aside and the threshold of the engine saved once for the batch, the
+// threshold level is only recomputed when it changes and views of the size before reuse
+// its intermediates
+//--------------------------------------------------------------------------------------
+void CPUEngine::ApplyViews( const Surface& Src, const Surface& Dst, const View* pViews, int nViews )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height );
+
+    double TotalTime[PASS_COUNT] = { 0.0 };
+
+    std::vector<uint8_t> QualityLevels;
+    QualityLevels.swap( m_QualityLevels );
+    const int nThresholdLevel = m_nThresholdLevel;
+    bool bThresholdSet = false;
+    float fViewThreshold = 0.0f;
+
+    for ( int i = 0; i < nViews; i++ )
+    {
+        const View& AtlasView = pViews[i];
+        Rect Clipped = ClipView( Src, AtlasView );
+        if ( Clipped.Left >= Clipped.Right || Clipped.Top >= Clipped.Bottom )
+            continue;
+
+        if ( !bThresholdSet || AtlasView.fThreshold != fViewThreshold )
+        {
+            SetThreshold( AtlasView.fThreshold );
+            fViewThreshold = AtlasView.fThreshold;
+            bThresholdSet = true;
+        }
+
+        Surface ViewSrc = GetSubSurface( Src, Clipped );
+        Surface ViewDst = GetSubSurface( Dst, Clipped );
+        DetectEdges( ViewSrc );
+        ComputeLineLength();
+        BlendColor( ViewSrc, ViewDst );
+        m_nEdgeLeft = Clipped.Left;
+        m_nEdgeTop = Clipped.Top;
+
+        for ( int j = 0; j < PASS_COUNT; j++ )
+            TotalTime[j] += m_PassTime[j];
+    }
+
+    m_nThresholdLevel = nThresholdLevel;
+    QualityLevels.swap( m_QualityLevels );
+
+    for ( int j = 0; j < PASS_COUNT; j++ )
+        m_PassTime[j] = TotalTime[j];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Run all three passes on a multisampled image, resolving it on the way
+//--------------------------------------------------------------------------------------
+void CPUEngine::ApplyMSAA( const MSAASurface& Src, const Surface& Resolved, const Surface& Dst )
+{
+    assert( Resolved.Width == Dst.Width && Resolved.Height == Dst.Height );
+    assert( Resolved.pData != Dst.pData );
+
+    ResolveAndDetectEdges( Src, Resolved );
+    ComputeLineLength();
+    BlendColor( Resolved, Dst );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Run all three passes on a planar video frame
+//--------------------------------------------------------------------------------------
+void CPUEngine::ApplyPlanar( const PlanarImage& Src, const PlanarImage& Dst, bool bBlendChroma )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height && Src.Format == Dst.Format );
+    assert( Src.pY != Dst.pY );
+
+    DetectEdgesPlanar( Src, bBlendChroma );
+    ComputeLineLength();
+    BlendPlanar( Src, Dst );
+}
+
+
+//--------------------------------------------------------------------------------------
+// First pass, equivalent to MLAA_SeperatingLines_PS. Writes the edge mask and splits it
+// into one bit plane for horizontal edges and one for vertical edges.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdges( const Surface& Src )
+{
+    double StartTime = GetTimeMs();
+
+    Resize( Src.Width, Src.Height );
+
+    m_bChromaEdges = false;
+    m_bHalfResEdges = ( m_DetectionResolution == DETECTION_HALF );
+
+    if ( m_DetectionKernel == DETECTION_KERNEL_QUAD && m_QualityLevels.empty() && !m_bHalfResEdges )
+    {
+        for ( int y = 0; y < m_nHeight; y += 2 )
+        {
+            const uint8_t* pRow = Src.pData + (size_t)y * Src.Pitch;
+            const uint8_t* pUp = Src.pData + (size_t)( y > 0 ? y - 1 : 0 ) * Src.Pitch;
+            if ( y + 1 < m_nHeight )
+                DetectEdgesQuadRows( y, pUp, pRow, pRow + Src.Pitch );
+            else
+                DetectEdgesRow( y, pRow, pUp, NULL, NULL, NULL );
+        }
+
+        m_PassTime[PASS_DETECT_EDGES] = GetTimeMs() - StartTime;
+        return;
+    }
+
+    // With a quality map, edges far from the tiles that get anti-aliased are left out
+    if ( !m_QualityLevels.empty() )
+        UpdateActiveWords();
+
+    // At half resolution, edges far from the ones found on the downsampled luma are too
+    if ( m_bHalfResEdges )
+        DetectEdgesHalfRes( Src );
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pRow = Src.pData + (size_t)y * Src.Pitch;
+        const uint8_t* pUp = Src.pData + (size_t)( y > 0 ? y - 1 : 0 ) * Src.Pitch;
+        const uint8_t* pActiveWords = m_QualityLevels.empty() ? NULL : &m_pActiveWords[(size_t)( y / m_nQualityTileSize ) * m_nWordsPerRow];
+        if ( m_bHalfResEdges )
+            pActiveWords = &m_pHalfResWords[(size_t)y * m_nWordsPerRow];
+        DetectEdgesRow( y, pRow, pUp, NULL, NULL, pActiveWords );
+        if ( m_bHalfResEdges )
+            ClearFarEdges( y, &m_pHalfResBits[(size_t)y * m_nWordsPerRow] );
+    }
+
+    m_PassTime[PASS_DETECT_EDGES] = GetTimeMs() - StartTime;
+}
+
+
+//--------------------------------------------------------------------------------------
+// MSAA aware first pass, equivalent to MLAA_SeperatingLinesMSAA_PS. Each row is resolved
+// into Resolved, then edges are detected on the resolved luma. An edge is only kept when
+// one of the two pixels it separates has samples that disagree, i.e. partial coverage.
+// Edges between fully covered pixels were not produced by geometry and are left alone.
+//--------------------------------------------------------------------------------------
+void CPUEngine::ResolveAndDetectEdges( const MSAASurface& Src, const Surface& Resolved )
+{
+    double StartTime = GetTimeMs();
+
+    assert( Src.Width == Resolved.Width && Src.Height == Resolved.Height );
+    assert( Src.SampleCount >= 1 );
+
+    Resize( Src.Width, Src.Height );
+    uint8_t* pPartialCoverage = GetScratch<uint8_t>( SCRATCH_PARTIAL_COVERAGE, (size_t)m_nWidth * 2 );
+    m_bHalfResEdges = false;
+    m_bChromaEdges = false;
+
+    const int Threshold = m_nThresholdLevel;
+    const int nSamples = Src.SampleCount;
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pSamples = Src.pData + (size_t)y * Src.Pitch;
+        uint8_t* pResolved = Resolved.pData + (size_t)y * Resolved.Pitch;
+        uint8_t* pPartial = &pPartialCoverage[(size_t)( y & 1 ) * m_nWidth];
+
+        for ( int x = 0; x < m_nWidth; x++ )
+        {
+            const uint8_t* pPixel = pSamples + (size_t)x * nSamples * 4;
+            int Sum[4] = { 0, 0, 0, 0 };
+            int Spread = 0;
+
+            for ( int s = 0; s < nSamples; s++ )
+            {
+                for ( int i = 0; i < 4; i++ )
+                    Sum[i] += pPixel[s * 4 + i];
+
+                int Difference = abs( (int)pPixel[s * 4 + 3] - (int)pPixel[3] );
+                Spread = Difference > Spread ? Difference : Spread;
+            }
+
+            for ( int i = 0; i < 4; i++ )
+                pResolved[x * 4 + i] = (uint8_t)( ( Sum[i] + nSamples / 2 ) / nSamples );
+
+            pPartial[x] = ( Spread >= Threshold ) ? 1 : 0;
+        }
+
+        const uint8_t* pUp = Resolved.pData + (size_t)( y > 0 ? y - 1 : 0 ) * Resolved.Pitch;
+        const uint8_t* pPartialUp = &pPartialCoverage[(size_t)( y > 0 ? ( (y - 1) & 1 ) : 0 ) * m_nWidth];
+        DetectEdgesRow( y, pResolved, pUp, pPartial, pPartialUp, NULL );
+    }
+
+    m_PassTime[PASS_DETECT_EDGES] = GetTimeMs() - StartTime;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Edge detection for one row. When pPartial is set an edge also needs partial coverage
+// on at least one of its sides. When pActiveWords is set only the 64 pixel words it flags
+// are processed, the others get no edges.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesRow( int y, const uint8_t* pRow, const uint8_t* pUp,
+                                const uint8_t* pPartial, const uint8_t* pPartialUp, const uint8_t* pActiveWords )
+{
+    const int Threshold = m_nThresholdLevel;
+
+    uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+    uint64_t* pHBits = &m_pHorizontalBits[(size_t)y * m_nWordsPerRow];
+    uint64_t* pVBits = &m_pVerticalBits[(size_t)y * m_nWordsPerRow];
+
+    for ( int w = 0; w < m_nWordsPerRow; w++ )
+    {
+        uint64_t HBits = 0;
+        uint64_t VBits = 0;
+        int xEnd = ( (w + 1) << 6 ) < m_nWidth ? ( (w + 1) << 6 ) : m_nWidth;
+
+        if ( pActiveWords && !pActiveWords[w] )
+        {
+            memset( &pMask[w << 6], 0, xEnd - (w << 6) );
+            pHBits[w] = 0;
+            pVBits[w] = 0;
+            continue;
+        }
+
+        for ( int x = w << 6; x < xEnd; x++ )
+        {
+            int xRight = ( x + 1 < m_nWidth ) ? x + 1 : x;
+            int Center = pRow[x * 4 + 3];
+            int Up = pUp[x * 4 + 3];
+            int Right = pRow[xRight * 4 + 3];
+
+            unsigned int Mask = 0;
+            if ( abs( Center - Up ) >= Threshold )
+                Mask |= kUpperMask;
+            if ( abs( Center - Right ) >= Threshold )
+                Mask |= kRightMask;
+
+            if ( pPartial )
+            {
+                if ( !( pPartial[x] | pPartialUp[x] ) )
+                    Mask &= ~kUpperMask;
+                if ( !( pPartial[x] | pPartial[xRight] ) )
+                    Mask &= ~kRightMask;
+            }
+
+            pMask[x] = (uint8_t)Mask;
+            HBits |= (uint64_t)( Mask & kUpperMask ) << (x & 63);
+            VBits |= (uint64_t)( (Mask & kRightMask) >> 1 ) << (x & 63);
+        }
+
+        pHBits[w] = HBits;
+        pVBits[w] = VBits;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Luma of 4 consecutive pixels in the 16 bit lanes of a word, pixel i in lane i
+//--------------------------------------------------------------------------------------
+static const uint64_t kLaneOnes = 0x0001000100010001ULL;
+static const uint64_t kLaneSigns = 0x8000800080008000ULL;
+
+// Bit i of the index moved to bit 0 of byte i, in memory order on a little endian CPU
+static const uint32_t kNibbleBytes[16] =
+{
+    0x00000000, 0x00000001, 0x00000100, 0x00000101, 0x00010000, 0x00010001, 0x00010100, 0x00010101,
+    0x01000000, 0x01000001, 0x01000100, 0x01000101, 0x01010000, 0x01010001, 0x01010100, 0x01010101,
+};
+
+static inline uint64_t LoadLumaLanes( const uint8_t* pPixels )
+{
+    return (uint64_t)pPixels[3] | ( (uint64_t)pPixels[7] << 16 ) |
+           ( (uint64_t)pPixels[11] << 32 ) | ( (uint64_t)pPixels[15] << 48 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Bit i is set when lane i of Center and Adjacent differ by Threshold or more. The lanes 
+// of Center + 256 - Adjacent stay within 1 to 511 so nothing borrows across lanes, and 
+// each bound is tested on the top bit of a lane after adding 0x8000 minus the bound.
+//--------------------------------------------------------------------------------------
+static inline unsigned int CompareLumaLanes( uint64_t Center, uint64_t Adjacent, int Threshold )
+{
+    uint64_t Difference = ( Center | ( kLaneOnes << 8 ) ) - Adjacent;
+    uint64_t Above = Difference + kLaneOnes * (uint64_t)( 0x8000 - 256 - Threshold );
+    uint64_t NotBelow = Difference + kLaneOnes * (uint64_t)( 0x8000 - 257 + Threshold );
+    uint64_t Edges = ( ( Above | ~NotBelow ) & kLaneSigns ) >> 15;
+
+    // Move the lane bits 0, 16, 32 and 48 to bits 45 to 48
+    return (unsigned int)( ( Edges * 0x0000200040008001ULL ) >> 45 ) & 0xF;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Edge detection for rows y and y + 1 by 2x2 quads, equivalent to 
+// MLAA_SeperatingLinesQuad_PS. Two quads are processed at a time with a row of each in 
+// the lanes of a word. Row y is loaded once for its own edges and as the up neighbour of 
+// row y + 1, and the right neighbours are the lanes shifted down by one plus a single 
+// load: 14 loads for 8 pixels where DetectEdgesRow takes 24. The columns from the last 
+// multiple of 4 below the width on repeat the last pixel on the right and are done one 
+// at a time.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesQuadRows( int y, const uint8_t* pUp, const uint8_t* pRow0, const uint8_t* pRow1 )
+{
+    const int Threshold = m_nThresholdLevel;
+    const int nLaneWidth = ( ( m_nWidth - 1 ) / 4 ) * 4;
+    const uint8_t* pRows[3] = { pUp, pRow0, pRow1 };
+
+    for ( int r = 0; r < 2; r++ )
+    {
+        memset( &m_pHorizontalBits[(size_t)( y + r ) * m_nWordsPerRow], 0, m_nWordsPerRow * sizeof(uint64_t) );
+        memset( &m_pVerticalBits[(size_t)( y + r ) * m_nWordsPerRow], 0, m_nWordsPerRow * sizeof(uint64_t) );
+    }
+
+    for ( int x = 0; x < nLaneWidth; x += 4 )
+    {
+        uint64_t Up = LoadLumaLanes( pUp + x * 4 );
+        uint64_t Center0 = LoadLumaLanes( pRow0 + x * 4 );
+        uint64_t Center1 = LoadLumaLanes( pRow1 + x * 4 );
+        uint64_t Right0 = ( Center0 >> 16 ) | ( (uint64_t)pRow0[( x + 4 ) * 4 + 3] << 48 );
+        uint64_t Right1 = ( Center1 >> 16 ) | ( (uint64_t)pRow1[( x + 4 ) * 4 + 3] << 48 );
+
+        unsigned int HBits[2] = { CompareLumaLanes( Center0, Up, Threshold ), CompareLumaLanes( Center1, Center0, Threshold ) };
+        unsigned int VBits[2] = { CompareLumaLanes( Center0, Right0, Threshold ), CompareLumaLanes( Center1, Right1, Threshold ) };
+
+        for ( int r = 0; r < 2; r++ )
+        {
+            uint8_t* pMask = &m_pEdgeMask[(size_t)( y + r ) * m_nWidth + x];
+            uint32_t MaskBytes = kNibbleBytes[HBits[r]] | ( kNibbleBytes[VBits[r]] << 1 );
+            memcpy( pMask, &MaskBytes, 4 );
+
+            size_t Word = (size_t)( y + r ) * m_nWordsPerRow + ( x >> 6 );
+            m_pHorizontalBits[Word] |= (uint64_t)HBits[r] << ( x & 63 );
+            m_pVerticalBits[Word] |= (uint64_t)VBits[r] << ( x & 63 );
+        }
+    }
+
+    for ( int r = 0; r < 2; r++ )
+    {
+        const uint8_t* pRow = pRows[r + 1];
+        const uint8_t* pRowUp = pRows[r];
+
+        for ( int x = nLaneWidth; x < m_nWidth; x++ )
+        {
+            int xRight = ( x + 1 < m_nWidth ) ? x + 1 : x;
+            int Center = pRow[x * 4 + 3];
+
+            unsigned int Mask = 0;
+            if ( abs( Center - pRowUp[x * 4 + 3] ) >= Threshold )
+                Mask |= kUpperMask;
+            if ( abs( Center - pRow[xRight * 4 + 3] ) >= Threshold )
+                Mask |= kRightMask;
+
+            m_pEdgeMask[(size_t)( y + r ) * m_nWidth + x] = (uint8_t)Mask;
+            size_t Word = (size_t)( y + r ) * m_nWordsPerRow + ( x >> 6 );
+            m_pHorizontalBits[Word] |= (uint64_t)( Mask & kUpperMask ) << ( x & 63 );
+            m_pVerticalBits[Word] |= (uint64_t)( ( Mask & kRightMask ) >> 1 ) << ( x & 63 );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// First pass on a planar frame. The Y plane is read in place. For chroma it is averaged
+// over 2x2 blocks, clamped at the borders as in DetectEdgesHalfRes, and the chroma engine
+// detects edges on the result.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesPlanar( const PlanarImage& Src, bool bBlendChroma )
+{
+    double StartTime = GetTimeMs();
+
+    DetectEdgesPlane( Src.pY, Src.Width, Src.Height, Src.YPitch );
+
+    m_bChromaEdges = bBlendChroma;
+    if ( bBlendChroma )
+    {
+        const int nChromaWidth = ( m_nWidth + 1 ) / 2;
+        const int nChromaHeight = ( m_nHeight + 1 ) / 2;
+
+        uint8_t* pChromaLuma = GetScratch<uint8_t>( SCRATCH_CHROMA_LUMA, (size_t)nChromaWidth * nChromaHeight );
+        if ( !m_pChroma )
+            m_pChroma.reset( new CPUEngine );
+
+        for ( int y = 0; y < nChromaHeight; y++ )
+        {
+            const uint8_t* pRow0 = Src.pY + (size_t)( 2 * y ) * Src.YPitch;
+            const uint8_t* pRow1 = Src.pY + (size_t)( 2 * y + 1 < m_nHeight ? 2 * y + 1 : 2 * y ) * Src.YPitch;
+            uint8_t* pLuma = &pChromaLuma[(size_t)y * nChromaWidth];
+
+            for ( int x = 0; x < nChromaWidth; x++ )
+            {
+                int x0 = 2 * x;
+                int x1 = ( x0 + 1 < m_nWidth ) ? x0 + 1 : x0;
+                int Sum = pRow0[x0] + pRow0[x1] + pRow1[x0] + pRow1[x1];
+                pLuma[x] = (uint8_t)( ( Sum + 2 ) >> 2 );
+            }
+        }
+
+        m_pChroma->m_nThresholdLevel = m_nThresholdLevel;
+        m_pChroma->DetectEdgesPlane( pChromaLuma, nChromaWidth, nChromaHeight, nChromaWidth );
+    }
+
+    m_PassTime[PASS_DETECT_EDGES] = GetTimeMs() - StartTime;
+}
+
+//--------------------------------------------------------------------------------------
+// Edge detection on an 8 bit luma plane
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesPlane( const uint8_t* pLuma, int Width, int Height, int Pitch )
+{
+    Resize( Width, Height );
+    m_bHalfResEdges = false;
+    m_bChromaEdges = false;
+
+    if ( !m_QualityLevels.empty() )
+        UpdateActiveWords();
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pRow = pLuma + (size_t)y * Pitch;
+        const uint8_t* pUp = pLuma + (size_t)( y > 0 ? y - 1 : 0 ) * Pitch;
+        const uint8_t* pActiveWords = m_QualityLevels.empty() ? NULL : &m_pActiveWords[(size_t)( y / m_nQualityTileSize ) * m_nWordsPerRow];
+        DetectEdgesPlaneRow( y, pRow, pUp, pActiveWords );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// 4 consecutive bytes of a plane in the 16 bit lanes of a word, byte i in lane i
+//--------------------------------------------------------------------------------------
+static inline uint64_t LoadPlaneLanes( const uint8_t* pBytes )
+{
+    uint32_t Bytes;
+    memcpy( &Bytes, pBytes, 4 );
+    uint64_t Lanes = ( (uint64_t)Bytes | ( (uint64_t)Bytes << 16 ) ) & 0x0000FFFF0000FFFFULL;
+    return ( Lanes | ( Lanes << 8 ) ) & 0x00FF00FF00FF00FFULL;
+}
+
+//--------------------------------------------------------------------------------------
+// Edge detection for one row of a luma plane. The luma of consecutive pixels is
+// contiguous, so the right neighbours are a load one byte further on. 16 pixels are
+// compared at a time with SSE2, then 4 at a time in the 16 bit lanes of the quad kernel,
+// and the last pixel, which repeats itself on the right, on its own. Words pActiveWords
+// doesn't flag get no edges, as in DetectEdgesRow.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesPlaneRow( int y, const uint8_t* pRow, const uint8_t* pUp, const uint8_t* pActiveWords )
+{
+    const int Threshold = m_nThresholdLevel;
+
+    uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+    uint64_t* pHBits = &m_pHorizontalBits[(size_t)y * m_nWordsPerRow];
+    uint64_t* pVBits = &m_pVerticalBits[(size_t)y * m_nWordsPerRow];
+    memset( pHBits, 0, m_nWordsPerRow * sizeof(uint64_t) );
+    memset( pVBits, 0, m_nWordsPerRow * sizeof(uint64_t) );
+
+    int x = 0;
+
+#if defined(MLAA_CPU_SSE2)
+    // A difference is an edge when it is the larger of itself and the threshold. A threshold
+    // of 256 doesn't fit in the bytes and finds no edges, the lanes handle it
+    if ( Threshold < 256 )
+    {
+        const __m128i Limit = _mm_set1_epi8( (char)Threshold );
+        const __m128i UpperBits = _mm_set1_epi8( (char)kUpperMask );
+        const __m128i RightBits = _mm_set1_epi8( (char)kRightMask );
+
+        for ( ; x + 16 < m_nWidth; x += 16 )
+        {
+            __m128i Center = _mm_loadu_si128( (const __m128i*)( pRow + x ) );
+            __m128i Up = _mm_loadu_si128( (const __m128i*)( pUp + x ) );
+            __m128i Right = _mm_loadu_si128( (const __m128i*)( pRow + x + 1 ) );
+
+            __m128i UpDifference = _mm_or_si128( _mm_subs_epu8( Center, Up ), _mm_subs_epu8( Up, Center ) );
+            __m128i RightDifference = _mm_or_si128( _mm_subs_epu8( Center, Right ), _mm_subs_epu8( Right, Center ) );
+            __m128i UpEdges = _mm_cmpeq_epi8( _mm_max_epu8( UpDifference, Limit ), UpDifference );
+            __m128i RightEdges = _mm_cmpeq_epi8( _mm_max_epu8( RightDifference, Limit ), RightDifference );
+
+            __m128i Mask = _mm_or_si128( _mm_and_si128( UpEdges, UpperBits ), _mm_and_si128( RightEdges, RightBits ) );
+            _mm_storeu_si128( (__m128i*)( pMask + x ), Mask );
+            pHBits[x >> 6] |= (uint64_t)(uint32_t)_mm_movemask_epi8( UpEdges ) << ( x & 63 );
+            pVBits[x >> 6] |= (uint64_t)(uint32_t)_mm_movemask_epi8( RightEdges ) << ( x & 63 );
+        }
+    }
+#endif
+
+    for ( ; x + 4 < m_nWidth; x += 4 )
+    {
+        uint64_t Center = LoadPlaneLanes( pRow + x );
+        unsigned int HBits = CompareLumaLanes( Center, LoadPlaneLanes( pUp + x ), Threshold );
+        unsigned int VBits = CompareLumaLanes( Center, LoadPlaneLanes( pRow + x + 1 ), Threshold );
+
+        uint32_t MaskBytes = kNibbleBytes[HBits] | ( kNibbleBytes[VBits] << 1 );
+        memcpy( &pMask[x], &MaskBytes, 4 );
+        pHBits[x >> 6] |= (uint64_t)HBits << ( x & 63 );
+        pVBits[x >> 6] |= (uint64_t)VBits << ( x & 63 );
+    }
+
+    for ( ; x < m_nWidth; x++ )
+    {
+        int xRight = ( x + 1 < m_nWidth ) ? x + 1 : x;
+        int Center = pRow[x];
+
+        unsigned int Mask = 0;
+        if ( abs( Center - pUp[x] ) >= Threshold )
+            Mask |= kUpperMask;
+        if ( abs( Center - pRow[xRight] ) >= Threshold )
+            Mask |= kRightMask;
+
+        pMask[x] = (uint8_t)Mask;
+        pHBits[x >> 6] |= (uint64_t)( Mask & kUpperMask ) << ( x & 63 );
+        pVBits[x >> 6] |= (uint64_t)( ( Mask & kRightMask ) >> 1 ) << ( x & 63 );
+    }
+
+    if ( pActiveWords )
+        ClearInactiveWords( y, pActiveWords );
+}
+
+//--------------------------------------------------------------------------------------
+// Removes the edges of row y from the 64 pixel words pActiveWords doesn't flag
+//--------------------------------------------------------------------------------------
+void CPUEngine::ClearInactiveWords( int y, const uint8_t* pActiveWords )
+{
+    uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+
+    for ( int w = 0; w < m_nWordsPerRow; w++ )
+    {
+        if ( pActiveWords[w] )
+            continue;
+
+        int xEnd = ( (w + 1) << 6 ) < m_nWidth ? ( (w + 1) << 6 ) : m_nWidth;
+        memset( &pMask[w << 6], 0, xEnd - (w << 6) );
+        m_pHorizontalBits[(size_t)y * m_nWordsPerRow + w] = 0;
+        m_pVerticalBits[(size_t)y * m_nWordsPerRow + w] = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Log luma as in LogLuma() of MLAA11.hlsl: the bits of the float luma read as an integer,
+// a piecewise linear log2 scaled by 2^23. Negative luma and NaN are black, infinity the
+// largest float. Halves are widened by rebiasing the exponent, which is exact for normal
+// numbers. Zero and denormals end up below the smallest normal half, so below any black
+// level, and infinity and NaN keep their maximum exponent.
+//--------------------------------------------------------------------------------------
+static const int32_t kMaxFloatBits = 0x7F7FFFFF;
+static const int32_t kInfinityBits = 0x7F800000;
+
+static inline int32_t HalfToFloatBits( uint16_t Half )
+{
+    uint32_t Magnitude = (uint32_t)( Half & 0x7FFF ) << 13;
+    uint32_t Bias = ( ( Half & 0x7C00 ) == 0x7C00 ) ? 0x70000000u : 0x38000000u;
+    return (int32_t)( ( Magnitude + Bias ) | ( (uint32_t)( Half & 0x8000 ) << 16 ) );
+}
+
+static inline int32_t ClampLogLuma( int32_t Bits, int32_t BlackBits )
+{
+    Bits = ( Bits > kInfinityBits ) ? BlackBits : Bits;
+    Bits = ( Bits < BlackBits ) ? BlackBits : Bits;
+    return ( Bits > kMaxFloatBits ) ? kMaxFloatBits : Bits;
+}
+
+
+//--------------------------------------------------------------------------------------
+// First pass on a float HDR image. The alpha of each row is converted to log luma once,
+// then compared with the row above and the next pixel as integers, so the result matches
+// the shader exactly and there is no half to float conversion or log in the inner loop.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesHDR( const HDRSurface& Src )
+{
+    double StartTime = GetTimeMs();
+
+    Resize( Src.Width, Src.Height );
+    m_bHalfResEdges = false;
+    m_bChromaEdges = false;
+    int32_t* pLogLuma = GetScratch<int32_t>( SCRATCH_LOG_LUMA, (size_t)m_nWidth * 2 );
+
+    // Same float math as SetImage() in the shader, the scale is a power of two
+    const int Threshold = (int)( m_fHDRThreshold * 8388608.0f );
+    const float fBlackLevel = m_fHDRBlackLevel > 1.0f / 16384.0f ? m_fHDRBlackLevel : 1.0f / 16384.0f;
+    int32_t BlackBits;
+    memcpy( &BlackBits, &fBlackLevel, 4 );
+
+    if ( !m_QualityLevels.empty() )
+        UpdateActiveWords();
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pPixels = Src.pData + (size_t)y * Src.Pitch;
+        int32_t* pRow = &pLogLuma[(size_t)( y & 1 ) * m_nWidth];
+
+        if ( Src.Format == HDR_FORMAT_RGBA16F )
+        {
+            for ( int x = 0; x < m_nWidth; x++ )
+            {
+                uint16_t Half;
+                memcpy( &Half, pPixels + (size_t)x * 8 + 6, 2 );
+                pRow[x] = ClampLogLuma( HalfToFloatBits( Half ), BlackBits );
+            }
+        }
+        else
+        {
+            for ( int x = 0; x < m_nWidth; x++ )
+            {
+                int32_t Bits;
+                memcpy( &Bits, pPixels + (size_t)x * 16 + 12, 4 );
+                pRow[x] = ClampLogLuma( Bits, BlackBits );
+            }
+        }
+
+        const int32_t* pUp = y > 0 ? &pLogLuma[(size_t)( (y - 1) & 1 ) * m_nWidth] : pRow;
+        const uint8_t* pActiveWords = m_QualityLevels.empty() ? NULL : &m_pActiveWords[(size_t)( y / m_nQualityTileSize ) * m_nWordsPerRow];
+        DetectEdgesLogRow( y, pRow, pUp, Threshold, pActiveWords );
+    }
+
+    m_PassTime[PASS_DETECT_EDGES] = GetTimeMs() - StartTime;
+}
+
+//--------------------------------------------------------------------------------------
+// Edge detection for one row of log luma, an edge is a difference above Threshold. With
+// SSE2 4 pixels are compared at a time in 32 bit lanes, taking the absolute value of the
+// differences with the sign trick as there is no abs instruction before SSSE3. The log
+// luma is clamped to positive floats, so the differences don't overflow.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesLogRow( int y, const int32_t* pRow, const int32_t* pUp, int Threshold, const uint8_t* pActiveWords )
+{
+    uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+    uint64_t* pHBits = &m_pHorizontalBits[(size_t)y * m_nWordsPerRow];
+    uint64_t* pVBits = &m_pVerticalBits[(size_t)y * m_nWordsPerRow];
+    memset( pHBits, 0, m_nWordsPerRow * sizeof(uint64_t) );
+    memset( pVBits, 0, m_nWordsPerRow * sizeof(uint64_t) );
+
+    int x = 0;
+
+#if defined(MLAA_CPU_SSE2)
+    const __m128i Limit = _mm_set1_epi32( Threshold );
+
+    for ( ; x + 4 < m_nWidth; x += 4 )
+    {
+        __m128i Center = _mm_loadu_si128( (const __m128i*)( pRow + x ) );
+        __m128i UpDifference = _mm_sub_epi32( Center, _mm_loadu_si128( (const __m128i*)( pUp + x ) ) );
+        __m128i RightDifference = _mm_sub_epi32( Center, _mm_loadu_si128( (const __m128i*)( pRow + x + 1 ) ) );
+        __m128i UpSign = _mm_srai_epi32( UpDifference, 31 );
+        __m128i RightSign = _mm_srai_epi32( RightDifference, 31 );
+        UpDifference = _mm_sub_epi32( _mm_xor_si128( UpDifference, UpSign ), UpSign );
+        RightDifference = _mm_sub_epi32( _mm_xor_si128( RightDifference, RightSign ), RightSign );
+
+        unsigned int HBits = (unsigned int)_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpgt_epi32( UpDifference, Limit ) ) );
+        unsigned int VBits = (unsigned int)_mm_movemask_ps( _mm_castsi128_ps( _mm_cmpgt_epi32( RightDifference, Limit ) ) );
+
+        uint32_t MaskBytes = kNibbleBytes[HBits] | ( kNibbleBytes[VBits] << 1 );
+        memcpy( &pMask[x], &MaskBytes, 4 );
+        pHBits[x >> 6] |= (uint64_t)HBits << ( x & 63 );
+        pVBits[x >> 6] |= (uint64_t)VBits << ( x & 63 );
+    }
+#endif
+
+    for ( ; x < m_nWidth; x++ )
+    {
+        int xRight = ( x + 1 < m_nWidth ) ? x + 1 : x;
+        int32_t Center = pRow[x];
+
+        unsigned int Mask = 0;
+        if ( abs( Center - pUp[x] ) > Threshold )
+            Mask |= kUpperMask;
+        if ( abs( Center - pRow[xRight] ) > Threshold )
+            Mask |= kRightMask;
+
+        pMask[x] = (uint8_t)Mask;
+        pHBits[x >> 6] |= (uint64_t)( Mask & kUpperMask ) << ( x & 63 );
+        pVBits[x >> 6] |= (uint64_t)( ( Mask & kRightMask ) >> 1 ) << ( x & 63 );
+    }
+
+    if ( pActiveWords )
+        ClearInactiveWords( y, pActiveWords );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Second pass, equivalent to MLAA_ComputeLineLength_PS
+//--------------------------------------------------------------------------------------
+void CPUEngine::ComputeLineLength()
+{
+    double StartTime = GetTimeMs();
+
+    m_bLongCounts = ( m_EdgeSearch != EDGE_SEARCH_SHORT );
+    if ( m_bLongCounts && !m_pLongEdgeCount )
+    {
+        m_pLongEdgeCount = GetScratch<uint16_t>( SCRATCH_LONG_EDGE_COUNT, (size_t)m_nWidth * m_nHeight * 2 );
+        m_pLongColumnCounts = GetScratch<uint16_t>( SCRATCH_LONG_COLUMN_COUNTS, m_nColumnCounts );
+    }
+
+    if ( m_bChromaEdges )
+    {
+        m_pChroma->SetVerticalSearch( m_VerticalSearch );
+        m_pChroma->SetEdgeSearch( m_EdgeSearch );
+        m_pChroma->ComputeLineLength();
+    }
+
+    // The row searches read the quality of every pixel to stop early in short edge tiles,
+    // the other searches are clamped afterwards
+    bool bStopsEarly = false;
+    if ( !m_QualityLevels.empty() )
+        ExpandQualityLevels();
+
+    if ( m_EdgeSearch == EDGE_SEARCH_LONG_NAIVE )
+    {
+        ComputeLongCountsNaive();
+    }
+    else
+    {
+        ComputeHorizontalCounts();
+
+        // The direct search only follows short edges
+        if ( m_VerticalSearch == VERTICAL_SEARCH_TRANSPOSED || m_bLongCounts )
+        {
+            ComputeVerticalCountsTransposed();
+            bStopsEarly = true;
+        }
+        else
+            ComputeVerticalCountsDirect();
+    }
+
+    if ( !m_QualityLevels.empty() && !bStopsEarly )
+        ClampShortEdges();
+
+    m_PassTime[PASS_COMPUTE_LINE_LENGTH] = GetTimeMs() - StartTime;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Half resolution first pass: average the luma of 2x2 blocks, clamped at the right and
+// bottom borders of odd sized images, and detect edges on the result. The full resolution
+// pass then only runs near them: counts of 2x2 blocks put every edge on the block grid,
+// which loses more than it smooths.
+//--------------------------------------------------------------------------------------
+void CPUEngine::DetectEdgesHalfRes( const Surface& Src )
+{
+    const int nHalfWidth = ( m_nWidth + 1 ) / 2;
+    const int nHalfHeight = ( m_nHeight + 1 ) / 2;
+
+    uint8_t* pHalfResLuma = GetScratch<uint8_t>( SCRATCH_HALF_RES_LUMA, (size_t)nHalfWidth * nHalfHeight * 4 );
+    if ( !m_pHalfRes )
+        m_pHalfRes.reset( new CPUEngine );
+
+    for ( int y = 0; y < nHalfHeight; y++ )
+    {
+        const uint8_t* pRow0 = Src.pData + (size_t)( 2 * y ) * Src.Pitch;
+        const uint8_t* pRow1 = Src.pData + (size_t)( 2 * y + 1 < m_nHeight ? 2 * y + 1 : 2 * y ) * Src.Pitch;
+        uint8_t* pLuma = &pHalfResLuma[(size_t)y * nHalfWidth * 4];
+
+        for ( int x = 0; x < nHalfWidth; x++ )
+        {
+            int x0 = 2 * x;
+            int x1 = ( x0 + 1 < m_nWidth ) ? x0 + 1 : x0;
+            int Sum = pRow0[x0 * 4 + 3] + pRow0[x1 * 4 + 3] + pRow1[x0 * 4 + 3] + pRow1[x1 * 4 + 3];
+            pLuma[x * 4 + 3] = (uint8_t)( ( Sum + 2 ) >> 2 );
+        }
+    }
+
+    Surface HalfRes = { pHalfResLuma, nHalfWidth, nHalfHeight, nHalfWidth * 4 };
+    m_pHalfRes->m_nThresholdLevel = m_nThresholdLevel;
+    m_pHalfRes->SetDetectionResolution( DETECTION_FULL );
+    m_pHalfRes->SetDetectionKernel( m_DetectionKernel );
+    m_pHalfRes->DetectEdges( HalfRes );
+
+    UpdateHalfResBits();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Set the bits of the pixels within kHalfResReach of each 2x2 block with an edge, and
+// mark the words of each row that have one. The words also have to be active with a
+// quality map.
+//--------------------------------------------------------------------------------------
+void CPUEngine::UpdateHalfResBits()
+{
+    const int nHalfWidth = m_pHalfRes->GetWidth();
+    const int nHalfHeight = m_pHalfRes->GetHeight();
+    const uint8_t* pHalfMask = m_pHalfRes->GetEdgeMask();
+    const size_t nWords = (size_t)m_nWordsPerRow * m_nHeight;
+
+    m_pHalfResBits = GetScratch<uint64_t>( SCRATCH_HALF_RES_BITS, nWords );
+    m_pHalfResWords = GetScratch<uint8_t>( SCRATCH_HALF_RES_WORDS, nWords );
+    memset( m_pHalfResBits, 0, nWords * sizeof(uint64_t) );
+
+    for ( int y = 0; y < nHalfHeight; y++ )
+    {
+        const uint8_t* pHalfMaskRow = pHalfMask + (size_t)y * nHalfWidth;
+        const int Top = ( 2 * y - kHalfResReach > 0 ) ? 2 * y - kHalfResReach : 0;
+        const int Bottom = ( 2 * y + 1 + kHalfResReach < m_nHeight ) ? 2 * y + 1 + kHalfResReach : m_nHeight - 1;
+
+        for ( int x = 0; x < nHalfWidth; x++ )
+        {
+            if ( !pHalfMaskRow[x] )
+                continue;
+
+            int Left = ( 2 * x - kHalfResReach > 0 ) ? 2 * x - kHalfResReach : 0;
+            int Right = ( 2 * x + 1 + kHalfResReach < m_nWidth ) ? 2 * x + 1 + kHalfResReach : m_nWidth - 1;
+            uint64_t LeftBits = ~0ull << (Left & 63);
+            uint64_t RightBits = ~0ull >> (63 - (Right & 63));
+
+            for ( int r = Top; r <= Bottom; r++ )
+            {
+                uint64_t* pBits = &m_pHalfResBits[(size_t)r * m_nWordsPerRow];
+                if ( (Left >> 6) == (Right >> 6) )
+                    pBits[Left >> 6] |= LeftBits & RightBits;
+                else
+                {
+                    pBits[Left >> 6] |= LeftBits;
+                    pBits[Right >> 6] |= RightBits;
+                }
+            }
+        }
+    }
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint64_t* pBits = &m_pHalfResBits[(size_t)y * m_nWordsPerRow];
+        const uint8_t* pActiveWords = m_QualityLevels.empty() ? NULL : &m_pActiveWords[(size_t)( y / m_nQualityTileSize ) * m_nWordsPerRow];
+        uint8_t* pWords = &m_pHalfResWords[(size_t)y * m_nWordsPerRow];
+
+        for ( int w = 0; w < m_nWordsPerRow; w++ )
+            pWords[w] = ( pBits[w] != 0 ) && ( !pActiveWords || pActiveWords[w] );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Drop the edges of row y whose bit in pNearBits is clear
+//--------------------------------------------------------------------------------------
+void CPUEngine::ClearFarEdges( int y, const uint64_t* pNearBits )
+{
+    uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+    uint64_t* pHBits = &m_pHorizontalBits[(size_t)y * m_nWordsPerRow];
+    uint64_t* pVBits = &m_pVerticalBits[(size_t)y * m_nWordsPerRow];
+
+    for ( int w = 0; w < m_nWordsPerRow; w++ )
+    {
+        uint64_t Far = ( pHBits[w] | pVBits[w] ) & ~pNearBits[w];
+        pHBits[w] &= pNearBits[w];
+        pVBits[w] &= pNearBits[w];
+
+        for ( ; Far; Far &= Far - 1 )
+            pMask[(w << 6) + LowestBit( Far )] = 0;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Horizontal edges run along the rows of the kUpperMask bit plane. The negative count
+// looks left and the positive count looks right. Both counts of every pixel are cleared
+// here, the vertical searches only write the counts of their edges. Rows of tiles whose
+// words are all inactive have no edges and are only cleared.
+//--------------------------------------------------------------------------------------
+void CPUEngine::ComputeHorizontalCounts()
+{
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint64_t* pRow = &m_pHorizontalBits[(size_t)y * m_nWordsPerRow];
+        const uint8_t* pLevels = m_QualityLevels.empty() ? NULL : &m_pPixelLevels[(size_t)( y / m_nQualityTileSize ) * m_nWidth];
+        const bool bActive = m_QualityLevels.empty() ||
+                             memchr( &m_pActiveWords[(size_t)( y / m_nQualityTileSize ) * m_nWordsPerRow], 1, m_nWordsPerRow ) != NULL;
+        if ( m_bLongCounts )
+        {
+            uint16_t* pCounts = &m_pLongEdgeCount[(size_t)y * m_nWidth * 2];
+            memset( pCounts, 0, (size_t)m_nWidth * 2 * sizeof( uint16_t ) );
+            if ( bActive )
+                RunLengthRow<false>( pRow, m_nWidth, pCounts, 2, pLevels, 1, 1 );
+        }
+        else
+        {
+            uint8_t* pCounts = &m_pEdgeCount[(size_t)y * m_nWidth * 2];
+            memset( pCounts, 0, (size_t)m_nWidth * 2 );
+            if ( bActive )
+                RunLengthRow<false>( pRow, m_nWidth, pCounts, 2, pLevels, 1, 1 );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Vertical edges are found by transposing each 64 column strip of the kRightMask bit
+// plane, one 64x64 block at a time, so every column becomes a contiguous bit row. The
+// row kernel then runs on the columns and the counts are transposed back block by block.
+// In the shader the negative vertical count looks down (+y) and the positive one looks
+// up (-y), which is the opposite of the order along the transposed row.
+//
+// Blocks without an edge, which include those the quality map leaves inactive, are not
+// transposed and strips without one are not searched. Only the counts of the edges are
+// copied back, ComputeHorizontalCounts() cleared the others.
+//--------------------------------------------------------------------------------------
+void CPUEngine::ComputeVerticalCountsTransposed()
+{
+    const int nBlockRows = (m_nHeight + 63) >> 6;
+
+    for ( int Strip = 0; Strip < m_nWordsPerRow; Strip++ )
+    {
+        const int x0 = Strip << 6;
+        const int nColumns = ( m_nWidth - x0 ) < 64 ? ( m_nWidth - x0 ) : 64;
+        const uint8_t* pLevels = m_QualityLevels.empty() ? NULL : &m_pPixelLevels[x0];
+
+        // Transpose the strip into one bit row per column
+        bool bHasEdges = false;
+        for ( int b = 0; b < nBlockRows; b++ )
+        {
+            const int Top = b << 6;
+            const int Bottom = ( Top + 64 < m_nHeight ) ? Top + 64 : m_nHeight;
+            bool bActive = m_QualityLevels.empty();
+            if ( !bActive )
+            {
+                for ( int t = Top / m_nQualityTileSize; !bActive && t <= ( Bottom - 1 ) / m_nQualityTileSize; t++ )
+                    bActive = ( m_pActiveWords[(size_t)t * m_nWordsPerRow + Strip] != 0 );
+            }
+
+            uint64_t Block[64];
+            uint64_t AnyBits = 0;
+            for ( int r = 0; r < 64; r++ )
+            {
+                Block[r] = ( bActive && Top + r < Bottom ) ? m_pVerticalBits[(size_t)( Top + r ) * m_nWordsPerRow + Strip] : 0;
+                AnyBits |= Block[r];
+            }
+
+            if ( AnyBits )
+                TransposeBits64( Block );
+            bHasEdges = bHasEdges || ( AnyBits != 0 );
+
+            for ( int c = 0; c < 64; c++ )
+                m_pColumnBits[(size_t)c * nBlockRows + b] = Block[c];
+        }
+        if ( !bHasEdges )
+            continue;
+
+        // Horizontal kernel on the transposed columns, counts stored column major, then
+        // transposed back into g_EdgeCount layout
+        if ( m_bLongCounts )
+        {
+            for ( int c = 0; c < nColumns; c++ )
+            {
+                RunLengthRow<true>( &m_pColumnBits[(size_t)c * nBlockRows], m_nHeight,
+                                    &m_pLongColumnCounts[(size_t)c * nBlockRows * 64], 1,
+                                    pLevels ? pLevels + c : NULL, m_nQualityTileSize, m_nWidth );
+            }
+
+            for ( int y = 0; y < m_nHeight; y++ )
+            {
+                uint16_t* pCounts = &m_pLongEdgeCount[( (size_t)y * m_nWidth + x0 ) * 2 + 1];
+                for ( uint64_t Bits = m_pVerticalBits[(size_t)y * m_nWordsPerRow + Strip]; Bits; Bits &= Bits - 1 )
+                {
+                    const int c = LowestBit( Bits );
+                    pCounts[c * 2] = m_pLongColumnCounts[(size_t)c * nBlockRows * 64 + y];
+                }
+            }
+            continue;
+        }
+
+        for ( int c = 0; c < nColumns; c++ )
+        {
+            RunLengthRow<true>( &m_pColumnBits[(size_t)c * nBlockRows], m_nHeight,
+                                &m_pColumnCounts[(size_t)c * nBlockRows * 64], 1,
+                                pLevels ? pLevels + c : NULL, m_nQualityTileSize, m_nWidth );
+        }
+
+        for ( int y = 0; y < m_nHeight; y++ )
+        {
+            uint8_t* pCounts = &m_pEdgeCount[( (size_t)y * m_nWidth + x0 ) * 2 + 1];
+            for ( uint64_t Bits = m_pVerticalBits[(size_t)y * m_nWordsPerRow + Strip]; Bits; Bits &= Bits - 1 )
+            {
+                const int c = LowestBit( Bits );
+                pCounts[c * 2] = m_pColumnCounts[(size_t)c * nBlockRows * 64 + y];
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Reference vertical search that walks the edge mask the way MLAA_ComputeLineLength_PS
+// does. Kept to compare against the transposed search.
+//--------------------------------------------------------------------------------------
+void CPUEngine::ComputeVerticalCountsDirect()
+{
+    const int Bottom = m_nHeight - 1;
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+        uint8_t* pCounts = &m_pEdgeCount[(size_t)y * m_nWidth * 2];
+
+        for ( int x = 0; x < m_nWidth; x++ )
+        {
+            unsigned int Down = 0;
+            unsigned int Up = 0;
+
+            if ( pMask[x] & kRightMask )
+            {
+                bool bDown = true;
+                bool bUp = true;
+                for ( int i = 1; i <= (int)kMaxEdgeLength; i++ )
+                {
+                    int yDown = ( y + i ) > Bottom ? Bottom : ( y + i );
+                    int yUp = ( y - i ) < 0 ? 0 : ( y - i );
+
+                    bDown = bDown && ( m_pEdgeMask[(size_t)yDown * m_nWidth + x] & kRightMask );
+                    bUp = bUp && ( m_pEdgeMask[(size_t)yUp * m_nWidth + x] & kRightMask );
+
+                    Down = bDown ? ( Down + 1 ) : ( Down | kStopBit );
+                    Up = bUp ? ( Up + 1 ) : ( Up | kStopBit );
+                }
+            }
+
+            pCounts[x * 2 + 1] = EncodeCount( Down, Up );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Long edge search one pixel at a time in all four directions, the way a shader loop over
+// kLongMaxEdgeLength pixels walks the edge mask. Kept to compare against the word steps.
+//--------------------------------------------------------------------------------------
+void CPUEngine::ComputeLongCountsNaive()
+{
+    static const int Directions[4][2] = { { -1, 0 }, { 1, 0 }, { 0, 1 }, { 0, -1 } };
+    static const unsigned int DirectionMask[4] = { kUpperMask, kUpperMask, kRightMask, kRightMask };
+
+    for ( int y = 0; y < m_nHeight; y++ )
+    {
+        const uint8_t* pMask = &m_pEdgeMask[(size_t)y * m_nWidth];
+        uint16_t* pCounts = &m_pLongEdgeCount[(size_t)y * m_nWidth * 2];
+
+        for ( int x = 0; x < m_nWidth; x++ )
+        {
+            // Left, right, down and up, as x, y, z and w in MLAA_ComputeLineLength_PS
+            unsigned int Count[4] = { 0, 0, 0, 0 };
+
+            for ( int d = 0; d < 4; d++ )
+            {
+                if ( !(pMask[x] & DirectionMask[d]) )
+                    continue;
+
+                bool bFound = true;
+                for ( int i = 1; i <= (int)kLongMaxEdgeLength; i++ )
+                {
+                    int xi = x + Directions[d][0] * i;
+                    int yi = y + Directions[d][1] * i;
+                    xi = xi < 0 ? 0 : ( xi >= m_nWidth ? m_nWidth - 1 : xi );
+                    yi = yi < 0 ? 0 : ( yi >= m_nHeight ? m_nHeight - 1 : yi );
+
+                    bFound = bFound && ( m_pEdgeMask[(size_t)yi * m_nWidth + xi] & DirectionMask[d] );
+                    Count[d] = bFound ? ( Count[d] + 1 ) : ( Count[d] | kLongStopBit );
+                }
+            }
+
+            pCounts[x * 2] = EncodeCountAs<uint16_t>( Count[0], Count[1] );
+            pCounts[x * 2 + 1] = EncodeCountAs<uint16_t>( Count[2], Count[3] );
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Helpers for the third pass. Loads outside of the texture return zero, like Load().
+// A source blends its first kChannels bytes of a pixel and copies the others
+//--------------------------------------------------------------------------------------
+struct BlendSource
+{
+    static const int kChannels = 3;
+    static const int kPixelBytes = 4;
+    static const bool kSigned = false;
+
+    const uint8_t*  pData;
+    int             Width;
+    int             Height;
+    int             Pitch;
+
+    inline const uint8_t* Texel( int x, int y ) const
+    {
+        static const uint8_t Zero[4] = { 0, 0, 0, 0 };
+        if ( x < 0 || y < 0 || x >= Width || y >= Height )
+            return Zero;
+        return pData + (size_t)y * Pitch + x * 4;
+    }
+
+    inline int Luma( int x, int y ) const
+    {
+        return Texel( x, y )[3];
+    }
+};
+
+// A plane of nChannels interleaved 8 bit channels, with the luma of the shape test in a
+// plane of its own. For Y the luma plane is the plane itself. Chroma is offset binary,
+// bSigned blends it linearly around 128 rather than through the gamma approximation.
+// Reads past the plane repeat its border, a zero would be a saturated color in chroma
+template <int nChannels, bool bSigned>
+struct PlaneBlendSource
+{
+    static const int kChannels = nChannels;
+    static const int kPixelBytes = nChannels;
+    static const bool kSigned = bSigned;
+
+    const uint8_t*  pData;
+    int             Width;
+    int             Height;
+    int             Pitch;
+    const uint8_t*  pLuma;
+    int             LumaPitch;
+
+    inline const uint8_t* Texel( int x, int y ) const
+    {
+        x = ( x < 0 ) ? 0 : ( x >= Width ? Width - 1 : x );
+        y = ( y < 0 ) ? 0 : ( y >= Height ? Height - 1 : y );
+        return pData + (size_t)y * Pitch + x * nChannels;
+    }
+
+    inline int Luma( int x, int y ) const
+    {
+        x = ( x < 0 ) ? 0 : ( x >= Width ? Width - 1 : x );
+        y = ( y < 0 ) ? 0 : ( y >= Height ? Height - 1 : y );
+        return pLuma[(size_t)y * LumaPitch + x];
+    }
+};
+
+static inline bool IsBitSet( unsigned int Value, unsigned int BitPosition )
+{
+    return ( Value & (1 << BitPosition) ) != 0;
+}
+
+static inline float GammaBlend( float Color, float Adjacent, float Weight )
+{
+    // Cheap approximation of gamma to linear and then back again
+    float a = Color * Color;
+    float b = Adjacent * Adjacent;
+    return sqrtf( a + Weight * (b - a) );
+}
+
+static inline float EdgeArea( float Length, float Distance )
+{
+    float h0 = fabsf( (1.0f / Length) * (Length - Distance) - 0.5f );
+    float h1 = fabsf( (1.0f / Length) * (Length - Distance - 1.0f) - 0.5f );
+    return 0.5f * (h0 + h1);
+}
+
+template <bool bSigned>
+static inline float BlendChannel( float Color, float Adjacent, float Weight )
+{
+    return bSigned ? Color + Weight * (Adjacent - Color) : GammaBlend( Color, Adjacent, Weight );
+}
+
+//--------------------------------------------------------------------------------------
+// Channels as floats and back. Signed channels are centered on 128 and rounded half away
+// from zero, so a chroma frame and its negation blend to negations of each other
+//--------------------------------------------------------------------------------------
+template <bool bSigned>
+static inline float FromUNorm8( uint8_t v )
+{
+    return bSigned ? ( (int)v - 128 ) / 255.0f : v / 255.0f;
+}
+
+static inline uint8_t ToUNorm8( float v )
+{
+    v = v < 0.0f ? 0.0f : ( v > 1.0f ? 1.0f : v );
+    return (uint8_t)( v * 255.0f + 0.5f );
+}
+
+static inline uint8_t ToSigned8( float v )
+{
+    v = v * 255.0f;
+    int Value = (int)( v < 0.0f ? v - 0.5f : v + 0.5f ) + 128;
+    return (uint8_t)( Value < 0 ? 0 : ( Value > 255 ? 255 : Value ) );
+}
+
+//--------------------------------------------------------------------------------------
+// Port of BlendColor() from MLAA11.hlsl
+//--------------------------------------------------------------------------------------
+template <typename SourceType, typename CountType>
+static void BlendEdge( const SourceType& Src, int Threshold, unsigned int MaxEdgeLength, unsigned int Count,
+                       int PosX, int PosY, int DirX, int DirY, int OrthoX, int OrthoY,
+                       bool bInverse, float Color[4] )
+{
+    typedef CountFormat<CountType> Format;
+    const unsigned int kStopBitPosition = Format::NumCountBits - 1;
+    bool bPosStop = IsBitSet( Count, kStopBitPosition );
+    bool bNegStop = IsBitSet( Count, kStopBitPosition + Format::NumCountBits );
+
+    // Only process pixel edge if it contains a stop bit
+    if ( !bPosStop && !bNegStop )
+        return;
+
+    unsigned int NegCount = ( Count >> Format::NumCountBits ) & Format::CountMask & (Format::StopBit - 1);
+    unsigned int PosCount = Count & Format::CountMask & (Format::StopBit - 1);
+
+    const uint8_t* pAdjacent = Src.Texel( PosX + DirX, PosY + DirY );
+    float Adjacent[SourceType::kChannels];
+    for ( int i = 0; i < SourceType::kChannels; i++ )
+        Adjacent[i] = FromUNorm8<SourceType::kSigned>( pAdjacent[i] );
+
+    if ( (NegCount + PosCount) == 0 )
+    {
+        float Weight = 1.0f / 8.0f;
+        for ( int i = 0; i < SourceType::kChannels; i++ )
+            Color[i] = BlendChannel<SourceType::kSigned>( Color[i], Adjacent[i], Weight );
+        return;
+    }
+
+    // If no stop bit is found on either edge then artificially increase the edge length so
+    // that we don't start anti-aliasing pixels for which we don't have valid data
+    if ( !bPosStop ) PosCount = MaxEdgeLength + 1;
+    if ( !bNegStop ) NegCount = MaxEdgeLength + 1;
+
+    float Length = (float)( NegCount + PosCount + 1 );
+    float MidPoint = Length / 2;
+    float Distance = (float)NegCount;
+
+    const unsigned int upperU   = 0x00;
+    const unsigned int risingZ  = 0x01;
+    const unsigned int fallingZ = 0x02;
+    const unsigned int lowerU   = 0x03;
+
+    int n = (int)NegCount;
+    int p = (int)PosCount;
+
+    unsigned int Shape = upperU;
+    if ( abs( Src.Luma( PosX - OrthoX * n, PosY - OrthoY * n ) -
+              Src.Luma( PosX - OrthoX * (n + 1), PosY - OrthoY * (n + 1) ) ) >= Threshold )
+    {
+        Shape |= risingZ;
+    }
+    if ( abs( Src.Luma( PosX + OrthoX * p, PosY + OrthoY * p ) -
+              Src.Luma( PosX + OrthoX * (p + 1), PosY + OrthoY * (p + 1) ) ) >= Threshold )
+    {
+        Shape |= fallingZ;
+    }
+
+    float fNeg = (float)NegCount;
+    if ( (  bInverse && ( ( (Shape == fallingZ) && (fNeg <= MidPoint) ) ||
+                          ( (Shape == risingZ)  && (fNeg >= MidPoint) ) ||
+                          ( (Shape == upperU) ) ) )
+      || ( !bInverse && ( ( (Shape == fallingZ) && (fNeg >= MidPoint) ) ||
+                          ( (Shape == risingZ)  && (fNeg <= MidPoint) ) ||
+                          ( (Shape == lowerU) ) ) ) )
+    {
+        float Area = EdgeArea( Length, Distance );
+        for ( int i = 0; i < SourceType::kChannels; i++ )
+            Color[i] = BlendChannel<SourceType::kSigned>( Color[i], Adjacent[i], Area );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Port of BlendPixelCounts() from MLAA11.hlsl: the counts of the pixel, of the one below
+// and of the one to the left, in that order. All float math of the pass is done here and
+// in the functions above, not in the CPUEngine members, whose float model is fixed by the
+// declarations in MLAA_CPU.h on some compilers
+//--------------------------------------------------------------------------------------
+template <typename SourceType, typename CountType>
+static void BlendPixel( const SourceType& Src, int Threshold, const unsigned int Counts[4], const unsigned int MaxLengths[4],
+                        int x, int y, uint8_t* pDst )
+{
+    const uint8_t* pSrc = Src.Texel( x, y );
+    float Color[SourceType::kChannels];
+    for ( int i = 0; i < SourceType::kChannels; i++ )
+        Color[i] = FromUNorm8<SourceType::kSigned>( pSrc[i] );
+
+    // Same edges, positions and directions as MLAA_BlendColor_PS
+    if ( Counts[0] )  BlendEdge<SourceType, CountType>( Src, Threshold, MaxLengths[0], Counts[0], x,     y,      0, -1, 1,  0, false, Color );  // H down-up
+    if ( Counts[1] )  BlendEdge<SourceType, CountType>( Src, Threshold, MaxLengths[1], Counts[1], x,     y + 1,  0,  1, 1,  0, true,  Color );  // H up-down
+    if ( Counts[2] )  BlendEdge<SourceType, CountType>( Src, Threshold, MaxLengths[2], Counts[2], x,     y,      1,  0, 0, -1, false, Color );  // V left-right
+    if ( Counts[3] )  BlendEdge<SourceType, CountType>( Src, Threshold, MaxLengths[3], Counts[3], x - 1, y,     -1,  0, 0, -1, true,  Color );  // V right-left
+
+    for ( int i = 0; i < SourceType::kChannels; i++ )
+        pDst[i] = SourceType::kSigned ? ToSigned8( Color[i] ) : ToUNorm8( Color[i] );
+    for ( int i = SourceType::kChannels; i < SourceType::kPixelBytes; i++ )
+        pDst[i] = pSrc[i];
+}
+
+
+//--------------------------------------------------------------------------------------
+// Third pass, equivalent to MLAA_BlendColor_PS
+//--------------------------------------------------------------------------------------
+void CPUEngine::BlendColor( const Surface& Src, const Surface& Dst, const Rect* pRegion )
+{
+    double StartTime = GetTimeMs();
+
+    assert( Src.Width == m_nWidth && Src.Height == m_nHeight );
+
+    Rect Region = { 0, 0, m_nWidth, m_nHeight };
+    if ( pRegion )
+    {
+        Region = *pRegion;
+        assert( Region.Left >= 0 && Region.Top >= 0 && Region.Right <= m_nWidth && Region.Bottom <= m_nHeight );
+    }
+
+    if ( !m_QualityLevels.empty() )
+        ExpandQualityLevels();
+
+    BlendSource Source = { Src.pData, Src.Width, Src.Height, Src.Pitch };
+    BlendImage( Source, Dst.pData, Dst.Pitch, Region );
+
+    m_PassTime[PASS_BLEND_COLOR] = GetTimeMs() - StartTime;
+}
+
+//--------------------------------------------------------------------------------------
+// Third pass on a planar frame. Chroma is blended by the chroma engine with the luma it
+// detected edges on, or copied when there are no chroma edges
+//--------------------------------------------------------------------------------------
+static void CopyPlane( const uint8_t* pSrc, int SrcPitch, uint8_t* pDst, int DstPitch, int RowBytes, int Rows )
+{
+    for ( int y = 0; y < Rows; y++ )
+        memcpy( pDst + (size_t)y * DstPitch, pSrc + (size_t)y * SrcPitch, RowBytes );
+}
+
+void CPUEngine::BlendPlanar( const PlanarImage& Src, const PlanarImage& Dst )
+{
+    double StartTime = GetTimeMs();
+
+    assert( Src.Width == m_nWidth && Src.Height == m_nHeight );
+
+    if ( !m_QualityLevels.empty() )
+        ExpandQualityLevels();
+
+    const Rect Region = { 0, 0, m_nWidth, m_nHeight };
+    PlaneBlendSource<1, false> Y = { Src.pY, Src.Width, Src.Height, Src.YPitch, Src.pY, Src.YPitch };
+    BlendImage( Y, Dst.pY, Dst.YPitch, Region );
+
+    const int nChromaWidth = ( m_nWidth + 1 ) / 2;
+    const int nChromaHeight = ( m_nHeight + 1 ) / 2;
+
+    if ( m_bChromaEdges )
+    {
+        const Rect ChromaRegion = { 0, 0, nChromaWidth, nChromaHeight };
+        const uint8_t* pLuma = GetScratch<uint8_t>( SCRATCH_CHROMA_LUMA, (size_t)nChromaWidth * nChromaHeight );
+
+        if ( Src.Format == PLANAR_FORMAT_NV12 )
+        {
+            PlaneBlendSource<2, true> UV = { Src.pU, nChromaWidth, nChromaHeight, Src.UVPitch, pLuma, nChromaWidth };
+            m_pChroma->BlendImage( UV, Dst.pU, Dst.UVPitch, ChromaRegion );
+        }
+        else
+        {
+            PlaneBlendSource<1, true> U = { Src.pU, nChromaWidth, nChromaHeight, Src.UVPitch, pLuma, nChromaWidth };
+            PlaneBlendSource<1, true> V = { Src.pV, nChromaWidth, nChromaHeight, Src.UVPitch, pLuma, nChromaWidth };
+            m_pChroma->BlendImage( U, Dst.pU, Dst.UVPitch, ChromaRegion );
+            m_pChroma->BlendImage( V, Dst.pV, Dst.UVPitch, ChromaRegion );
+        }
+    }
+    else if ( Src.Format == PLANAR_FORMAT_NV12 )
+    {
+        CopyPlane( Src.pU, Src.UVPitch, Dst.pU, Dst.UVPitch, nChromaWidth * 2, nChromaHeight );
+    }
+    else
+    {
+        CopyPlane( Src.pU, Src.UVPitch, Dst.pU, Dst.UVPitch, nChromaWidth, nChromaHeight );
+        CopyPlane( Src.pV, Src.UVPitch, Dst.pV, Dst.UVPitch, nChromaWidth, nChromaHeight );
+    }
+
+    m_PassTime[PASS_BLEND_COLOR] = GetTimeMs() - StartTime;
+}
+
+//--------------------------------------------------------------------------------------
+// Pick the count layout of the blend pass
+//--------------------------------------------------------------------------------------
+template <typename SourceType>
+void CPUEngine::BlendImage( const SourceType& Source, uint8_t* pDst, int DstPitch, const Rect& Region )
+{
+    if ( m_bLongCounts )
+        BlendRegion<SourceType, uint16_t>( Source, pDst, DstPitch, Region, m_pLongEdgeCount );
+    else
+        BlendRegion<SourceType, uint8_t>( Source, pDst, DstPitch, Region, m_pEdgeCount );
+}
+
+//--------------------------------------------------------------------------------------
+// Blend the pixels of a region, with either count layout
+//--------------------------------------------------------------------------------------
+template <typename SourceType, typename CountType>
+void CPUEngine::BlendRegion( const SourceType& Source, uint8_t* pDstData, int DstPitch, const Rect& Region, const CountType* pCounts )
+{
+    const int kPixelBytes = SourceType::kPixelBytes;
+
+    // CompareColors() in the shape test uses the same threshold as the first pass
+    const int Threshold = m_nThresholdLevel;
+
+    // An edge that isn't stopped spans the search length of the tile owning its count
+    const unsigned int kMaxLength = CountFormat<CountType>::MaxEdgeLength;
+    const unsigned int kLevelMaxEdgeLength[QUALITY_LEVEL_COUNT] = { kMaxLength, kShortEdgeLength, kMaxLength };
+
+    for ( int y = Region.Top; y < Region.Bottom; y++ )
+    {
+        const uint8_t* pSrc = Source.pData + (size_t)y * Source.Pitch;
+        uint8_t* pDst = pDstData + (size_t)y * DstPitch;
+        const CountType* pCount = &pCounts[(size_t)y * m_nWidth * 2];
+        const CountType* pCountDown = ( y + 1 < m_nHeight ) ? &pCounts[(size_t)(y + 1) * m_nWidth * 2] : NULL;
+
+        const uint8_t* pLevels = NULL;
+        const uint8_t* pLevelsDown = NULL;
+        if ( !m_QualityLevels.empty() )
+        {
+            pLevels = &m_pPixelLevels[(size_t)( y / m_nQualityTileSize ) * m_nWidth];
+            pLevelsDown = pCountDown ? &m_pPixelLevels[(size_t)( (y + 1) / m_nQualityTileSize ) * m_nWidth] : pLevels;
+        }
+
+        for ( int x = Region.Left; x < Region.Right; x++ )
+        {
+            // Skipped tiles are copied a tile row at a time
+            if ( pLevels && pLevels[x] == QUALITY_SKIP )
+            {
+                int xEnd = ( x / m_nQualityTileSize + 1 ) * m_nQualityTileSize;
+                if ( xEnd > Region.Right )
+                    xEnd = Region.Right;
+                memcpy( &pDst[x * kPixelBytes], &pSrc[x * kPixelBytes], (xEnd - x) * kPixelBytes );
+                x = xEnd - 1;
+                continue;
+            }
+
+            unsigned int HCount = pCount[x * 2];
+            unsigned int VCount = pCount[x * 2 + 1];
+            unsigned int HCountUp = pCountDown ? pCountDown[x * 2] : 0;
+            unsigned int VCountRight = ( x > 0 ) ? pCount[(x - 1) * 2 + 1] : 0;
+
+            if ( !(HCount | VCount | HCountUp | VCountRight) )
+            {
+                memcpy( &pDst[x * kPixelBytes], &pSrc[x * kPixelBytes], kPixelBytes );
+                continue;
+            }
+
+            const unsigned int Counts[4] = { HCount, HCountUp, VCount, VCountRight };
+            const unsigned int MaxLengths[4] =
+            {
+                pLevels ? kLevelMaxEdgeLength[pLevels[x]] : kMaxLength,
+                pLevels ? kLevelMaxEdgeLength[pLevelsDown[x]] : kMaxLength,
+                pLevels ? kLevelMaxEdgeLength[pLevels[x]] : kMaxLength,
+                ( pLevels && x > 0 ) ? kLevelMaxEdgeLength[pLevels[x - 1]] : kMaxLength
+            };
+            BlendPixel<SourceType, CountType>( Source, Threshold, Counts, MaxLengths, x, y, &pDst[x * kPixelBytes] );
+        }
+    }
+}
@@ -0,0 +1,575 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_CPU.h
+//
+// CPU implementation of the three MLAA passes found in MLAA11.hlsl. The engine has no
+// dependency on Direct3D so it can be used to post-process images outside of the sample.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_CPU_H
+#define MLAA_CPU_H
+
+#include "MLAA_Scratch.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Constants, these mirror the static constants of MLAA11.hlsl
+    //--------------------------------------------------------------------------------------
+    static const unsigned int kNumCountBits         = 4;
+    static const unsigned int kMaxEdgeLength        = ( (1 << (kNumCountBits - 1)) - 1 );
+    static const unsigned int kUpperMask            = (1 << 0);
+    static const unsigned int kRightMask            = (1 << 1);
+    static const unsigned int kStopBit              = (1 << (kNumCountBits - 1));
+    static const unsigned int kNegCountShift        = (kNumCountBits);
+    static const unsigned int kPosCountShift        = (0);
+    static const unsigned int kCountShiftMask       = ((1 << kNumCountBits) - 1);
+
+    // Pixels around a region that the passes depend on: the blend pass reads counts one
+    // pixel away, a count depends on edges up to kMaxEdgeLength + 1 pixels along its line
+    // and an edge depends on the pixel next to it
+    static const int          kRegionHalo           = ( kMaxEdgeLength + 3 );
+
+    // Long edge searches store 16 bit counts per direction, 8 bits per side
+    static const unsigned int kLongNumCountBits     = 8;
+    static const unsigned int kLongMaxEdgeLength    = ( (1 << (kLongNumCountBits - 1)) - 1 );
+    static const unsigned int kLongStopBit          = (1 << (kLongNumCountBits - 1));
+    static const int          kLongRegionHalo       = ( kLongMaxEdgeLength + 3 );
+
+    // Half resolution detection looks for edges at full resolution within kHalfResReach
+    // pixels of the 2x2 blocks with an edge. Whether a block has one depends on the blocks
+    // next to it, which adds kHalfResHalo pixels to the halo of a region.
+    static const int          kHalfResReach         = 2;
+    static const int          kHalfResHalo          = ( 2 * kHalfResReach + 4 );
+
+    // Threshold of the sample at its default slider position, 1 / gEdgeDetectionThreshold
+    static const float        kDefaultThreshold     = 1.0f / 12.0f;
+
+    //--------------------------------------------------------------------------------------
+    // An RGBA8 image with luma stored in alpha, as written by RenderScenePS
+    //--------------------------------------------------------------------------------------
+    struct Surface
+    {
+        uint8_t*    pData;
+        int         Width;
+        int         Height;
+        int         Pitch;      // Row pitch in bytes
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A multisampled RGBA8 image, the samples of a pixel are stored next to each other
+    //--------------------------------------------------------------------------------------
+    struct MSAASurface
+    {
+        uint8_t*    pData;
+        int         Width;
+        int         Height;
+        int         Pitch;          // Row pitch in bytes
+        int         SampleCount;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Float formats of an HDR image
+    //--------------------------------------------------------------------------------------
+    enum HDR_FORMAT
+    {
+        HDR_FORMAT_RGBA16F,             // DXGI_FORMAT_R16G16B16A16_FLOAT
+        HDR_FORMAT_RGBA32F              // DXGI_FORMAT_R32G32B32A32_FLOAT
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A float HDR image with linear luma stored in alpha
+    //--------------------------------------------------------------------------------------
+    struct HDRSurface
+    {
+        HDR_FORMAT  Format;
+        uint8_t*    pData;
+        int         Width;
+        int         Height;
+        int         Pitch;      // Row pitch in bytes
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Layout of the chroma samples of a planar video frame
+    //--------------------------------------------------------------------------------------
+    enum PLANAR_FORMAT
+    {
+        PLANAR_FORMAT_NV12,             // One plane of interleaved U and V samples
+        PLANAR_FORMAT_I420              // Separate U and V planes
+    };
+
+    //--------------------------------------------------------------------------------------
+    // An 8 bit 4:2:0 video frame. Each chroma plane is (Width + 1) / 2 by (Height + 1) / 2
+    // samples, a sample covers a 2x2 block of the Y plane
+    //--------------------------------------------------------------------------------------
+    struct PlanarImage
+    {
+        PLANAR_FORMAT   Format;
+        int             Width;          // Of the Y plane
+        int             Height;
+        uint8_t*        pY;
+        int             YPitch;         // Row pitch in bytes
+        uint8_t*        pU;             // The interleaved UV plane for NV12
+        uint8_t*        pV;             // I420 only
+        int             UVPitch;        // Row pitch of each chroma plane
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A rectangle of pixels, Right and Bottom are exclusive
+    //--------------------------------------------------------------------------------------
+    struct Rect
+    {
+        int         Left;
+        int         Top;
+        int         Right;
+        int         Bottom;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // One view of an atlas, anti-aliased as an image of its own
+    //--------------------------------------------------------------------------------------
+    struct View
+    {
+        Rect        Region;
+        float       fThreshold;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // How far the second pass follows an edge
+    //--------------------------------------------------------------------------------------
+    enum EDGE_SEARCH
+    {
+        EDGE_SEARCH_SHORT,              // Up to kMaxEdgeLength, the counts of MLAA11.hlsl
+        EDGE_SEARCH_LONG,               // Up to kLongMaxEdgeLength, steps over whole words of edge
+        EDGE_SEARCH_LONG_NAIVE,         // Up to kLongMaxEdgeLength a pixel at a time, for comparison
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Per tile quality for variable rate MLAA
+    //--------------------------------------------------------------------------------------
+    enum QUALITY_LEVEL
+    {
+        QUALITY_SKIP,                   // Left as is
+        QUALITY_SHORT_EDGES,            // Edge searches stop after kShortEdgeLength pixels
+        QUALITY_FULL,
+        QUALITY_LEVEL_COUNT
+    };
+
+    static const unsigned int kShortEdgeLength      = 2;
+
+    // Tiles past the last column or row are QUALITY_FULL
+    struct QualityMap
+    {
+        int             TileSize;       // In pixels
+        int             Columns;
+        int             Rows;
+        const uint8_t*  pLevels;        // QUALITY_LEVEL of each tile, row after row
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Radial quality map for a fovea at (CenterX, CenterY). Tiles that come within
+    // InnerRadius of the center are QUALITY_FULL, within OuterRadius QUALITY_SHORT_EDGES and
+    // the others QUALITY_SKIP. Levels holds the storage Map points to.
+    //--------------------------------------------------------------------------------------
+    void BuildFoveatedQualityMap( int Width, int Height, int TileSize, float CenterX, float CenterY,
+                                  float InnerRadius, float OuterRadius, std::vector<uint8_t>& Levels, QualityMap& Map );
+
+    //--------------------------------------------------------------------------------------
+    // The part of a surface covered by a rectangle, which must lie inside the surface
+    //--------------------------------------------------------------------------------------
+    inline Surface GetSubSurface( const Surface& Parent, const Rect& Region )
+    {
+        Surface Sub = { Parent.pData + (size_t)Region.Top * Parent.Pitch + Region.Left * 4,
+                        Region.Right - Region.Left, Region.Bottom - Region.Top, Parent.Pitch };
+        return Sub;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // How the second pass finds the length of vertical edges. The direct walk is up to a
+    // fifth faster on the scenes of the vertical-search benchmark, but two to three times
+    // slower on noise, so the transposed search is the default. Long searches always
+    // transpose
+    //--------------------------------------------------------------------------------------
+    enum VERTICAL_SEARCH
+    {
+        VERTICAL_SEARCH_TRANSPOSED,     // Transpose 64x64 blocks of the edge bits and reuse the row kernel
+        VERTICAL_SEARCH_DIRECT          // Walk the edge mask column by column, like MLAA_ComputeLineLength_PS
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Resolution of the edge detection and line length passes, blending is always done at 
+    // full resolution
+    //--------------------------------------------------------------------------------------
+    enum DETECTION_RESOLUTION
+    {
+        DETECTION_FULL,
+        DETECTION_HALF                  // On a 2x2 downsampled luma plane, then at full resolution around the edges found
+    };
+
+    //--------------------------------------------------------------------------------------
+    // How the first pass reads the luma of a pixel and its up and right neighbours
+    //--------------------------------------------------------------------------------------
+    enum DETECTION_KERNEL
+    {
+        DETECTION_KERNEL_PIXEL,         // Three loads per pixel, like MLAA_SeperatingLines_PS
+        DETECTION_KERNEL_QUAD           // 2x2 quads in 16 bit lanes, like MLAA_SeperatingLinesQuad_PS
+    };
+
+    enum PASS
+    {
+        PASS_DETECT_EDGES,
+        PASS_COMPUTE_LINE_LENGTH,
+        PASS_BLEND_COLOR,
+        PASS_COUNT
+    };
+
+    //--------------------------------------------------------------------------------------
+    // The edges of a pixel: its upper edge, kUpperMask, runs horizontally and its right
+    // edge, kRightMask, vertically
+    //--------------------------------------------------------------------------------------
+    enum EDGE_DIRECTION
+    {
+        EDGE_HORIZONTAL,
+        EDGE_VERTICAL
+    };
+
+    // How far an edge continues on either side of a pixel, not counting the pixel itself.
+    // A side that doesn't end stopped at the longest length of the search
+    struct EdgeSpan
+    {
+        unsigned int    NegLength;      // Left of a horizontal edge, below a vertical one
+        unsigned int    PosLength;      // Right of a horizontal edge, above a vertical one
+        bool            bNegEnds;
+        bool            bPosEnds;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Read-only view of the edge mask and counts of the first two passes, for filters that
+    // run after MLAA and need the same edges. It points into the intermediates of the
+    // engine, laid out like g_EdgeMask and g_EdgeCount: a mask byte per pixel, and per
+    // pixel the count of its horizontal edge then that of its vertical edge. A count holds
+    // the negative side in its upper half and the positive side in its lower half, each
+    // with a stop bit on top, and is 0 where the pixel has no such edge
+    //--------------------------------------------------------------------------------------
+    struct EdgeView
+    {
+        int             Width;
+        int             Height;
+        int             Left;           // Position of pixel 0,0 in the image passed to Apply
+        int             Top;
+        const uint8_t*  pEdgeMask;
+        const uint8_t*  pCounts;        // 2 counts of CountBytes bytes per pixel
+        int             CountBytes;     // 1, or 2 for long edge searches
+        unsigned int    MaxEdgeLength;  // kMaxEdgeLength or kLongMaxEdgeLength
+
+        bool IsValid() const { return pEdgeMask != NULL; }
+
+        unsigned int GetEdges( int x, int y ) const
+        {
+            return pEdgeMask[(size_t)y * Width + x];
+        }
+
+        unsigned int GetCount( int x, int y, EDGE_DIRECTION Direction ) const
+        {
+            size_t Index = ( (size_t)y * Width + x ) * 2 + Direction;
+            return ( CountBytes == 2 ) ? ((const uint16_t*)pCounts)[Index] : pCounts[Index];
+        }
+
+        EdgeSpan GetSpan( int x, int y, EDGE_DIRECTION Direction ) const
+        {
+            const unsigned int Count = GetCount( x, y, Direction );
+            const unsigned int NegCount = Count >> ( ( CountBytes == 2 ) ? kLongNumCountBits : kNumCountBits );
+            const unsigned int StopBit = MaxEdgeLength + 1;
+
+            EdgeSpan Span;
+            Span.NegLength = NegCount & MaxEdgeLength;
+            Span.PosLength = Count & MaxEdgeLength;
+            Span.bNegEnds = ( NegCount & StopBit ) != 0;
+            Span.bPosEnds = ( Count & StopBit ) != 0;
+            return Span;
+        }
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Transposes a 64x64 bit matrix in place: bit c of row r becomes bit r of row c
+    //--------------------------------------------------------------------------------------
+    void TransposeBits64( uint64_t Rows[64] );
+
+    //--------------------------------------------------------------------------------------
+    // Millisecond time stamp from a high resolution clock
+    //--------------------------------------------------------------------------------------
+    double GetTimeMs();
+
+    class CPUEngine
+    {
+    public:
+
+        CPUEngine();
+        ~CPUEngine();
+
+        // Luminance difference that counts as an edge, same meaning as gParam.z
+        void SetThreshold( float fThreshold );
+        void SetVerticalSearch( VERTICAL_SEARCH Mode ) { m_VerticalSearch = Mode; }
+        VERTICAL_SEARCH GetVerticalSearch() const { return m_VerticalSearch; }
+        void SetDetectionResolution( DETECTION_RESOLUTION Resolution ) { m_DetectionResolution = Resolution; }
+        DETECTION_RESOLUTION GetDetectionResolution() const { return m_DetectionResolution; }
+
+        // The quad kernel is used for whole images and views without a quality map
+        void SetDetectionKernel( DETECTION_KERNEL Kernel ) { m_DetectionKernel = Kernel; }
+        DETECTION_KERNEL GetDetectionKernel() const { return m_DetectionKernel; }
+
+        // Long searches apply at full detection resolution, their counts are returned by
+        // GetLongEdgeCount() instead of GetEdgeCount()
+        void SetEdgeSearch( EDGE_SEARCH Search ) { m_EdgeSearch = Search; }
+        EDGE_SEARCH GetEdgeSearch() const { return m_EdgeSearch; }
+
+        // Settings of DetectEdgesHDR: the luma ratio that counts as an edge in stops, same
+        // meaning as gParam.z with HDR_LOG_EDGES, and the luma below which everything compares
+        // as black, like HDR_BLACK_LEVEL. The black level is at least the smallest normal half
+        void SetHDRThreshold( float fStops ) { m_fHDRThreshold = fStops; }
+        float GetHDRThreshold() const { return m_fHDRThreshold; }
+        void SetHDRBlackLevel( float fLuma ) { m_fHDRBlackLevel = fLuma; }
+        float GetHDRBlackLevel() const { return m_fHDRBlackLevel; }
+
+        // Pixels around a region that Apply() with a region reads with the current settings
+        int GetRegionHalo() const;
+
+        // Variable rate MLAA, the map is copied. NULL processes the whole image at full quality.
+        // Only applies to whole images: Apply with a region and ApplyView(s) ignore it
+        void SetQualityMap( const QualityMap* pMap );
+
+        // Runs all three passes. Src and Dst must be the same size and must not alias
+        void Apply( const Surface& Src, const Surface& Dst );
+
+        // Region of interest variant: only writes the pixels of Dst inside Region and only
+        // processes Region plus kRegionHalo. The pixels written match a full frame Apply.
+        // The intermediates then cover the processed rectangle, not the whole image
+        void Apply( const Surface& Src, const Surface& Dst, const Rect& Region );
+
+        // Atlas variant: each view is processed with its own threshold as if it were a separate
+        // image, so edge searches stop at view borders. Views must not overlap. Pass times
+        // are the sum over the views. ApplyViews only sets the engine up once per batch,
+        // the cost of a view is in its passes, see CPUQueue::SubmitViews to spread them
+        // over threads
+        void ApplyView( const Surface& Src, const Surface& Dst, const View& AtlasView );
+        void ApplyViews( const Surface& Src, const Surface& Dst, const View* pViews, int nViews );
+
+        // MSAA aware variant: resolves Src into Resolved in the edge detection pass and only
+        // keeps edges where the MSAA coverage is partial. Resolved and Dst must not alias
+        void ApplyMSAA( const MSAASurface& Src, const Surface& Resolved, const Surface& Dst );
+
+        // Planar video variant, runs on the Y plane with no conversion to RGBA. The threshold
+        // applies to Y as it does to the luma in alpha. With bBlendChroma the chroma planes are
+        // blended linearly around 128 at their own resolution from edges detected on Y averaged
+        // over 2x2 blocks, otherwise they are copied. Reads past a plane repeat its border. Src
+        // and Dst must match in size and format and must not alias. Detection is always at
+        // full resolution and the quality map only covers Y
+        void ApplyPlanar( const PlanarImage& Src, const PlanarImage& Dst, bool bBlendChroma );
+
+        // Individual passes, the equivalent of the three full screen draws in RenderMLAA.
+        // ResolveAndDetectEdges always works at full resolution
+        void DetectEdges( const Surface& Src );
+        void ResolveAndDetectEdges( const MSAASurface& Src, const Surface& Resolved );
+        void ComputeLineLength();
+        void BlendColor( const Surface& Src, const Surface& Dst, const Rect* pRegion = NULL );
+
+        // The passes of ApplyPlanar, with ComputeLineLength in between. The chroma edges are
+        // kept by an engine of their own, BlendPlanar copies chroma when there are none
+        void DetectEdgesPlanar( const PlanarImage& Src, bool bBlendChroma );
+        void BlendPlanar( const PlanarImage& Src, const PlanarImage& Dst );
+
+        // HDR variant of the first pass, equivalent to MLAA_SeperatingLines_PS with
+        // HDR_LOG_EDGES. Edges are detected at full resolution and honor the quality map.
+        // There is no float blend pass: ComputeLineLength runs as usual and the counts are
+        // for a blend of the HDR image elsewhere, e.g. on the GPU
+        void DetectEdgesHDR( const HDRSurface& Src );
+
+        // Intermediates laid out like g_EdgeMask (R8) and g_EdgeCount (R8G8)
+        const uint8_t* GetEdgeMask() const { return m_pEdgeMask; }
+        const uint8_t* GetEdgeCount() const { return m_pEdgeCount; }
+        const uint16_t* GetLongEdgeCount() const { return m_pLongEdgeCount; }
+        int GetWidth() const { return m_nWidth; }
+        int GetHeight() const { return m_nHeight; }
+
+        // The intermediates as an EdgeView, nothing is copied. Valid after ComputeLineLength
+        // until the next edge detection or ReleaseIntermediates. After Apply with a region or ApplyView
+        // it covers the rectangle processed, placed by Left and Top. Counts of half resolution
+        // detection are scaled up, those of QUALITY_SHORT_EDGES tiles are cut short and skipped
+        // tiles have no edges. ApplyPlanar only exposes the edges of the Y plane
+        EdgeView GetEdgeView() const;
+
+        // Frees the intermediates, the next DetectEdges allocates them again. Settings are kept
+        void ReleaseIntermediates();
+
+        // Intermediates are kept for the last nResolutions image sizes, 4 by default, so tiles,
+        // views or frames of a few sizes reuse them with no allocation or clearing. The scratch
+        // is owned by the engine and used by one thread at a time
+        void SetScratchResolutions( int nResolutions ) { m_Scratch.SetMaxEntries( nResolutions ); }
+        int GetScratchResolutions() const { return m_Scratch.GetMaxEntries(); }
+
+        // Bytes of scratch held, the most held since the last trim and the heap allocations
+        // made for it, with those of the engines of half resolution detection and chroma
+        size_t GetScratchBytes() const;
+        size_t GetScratchHighWater() const;
+        uint64_t GetScratchAllocations() const;
+
+        // Frees the scratch of every resolution but the current one
+        void TrimScratch();
+
+        // Time taken by the last run of a pass, in milliseconds
+        double GetPassTime( PASS Pass ) const { return m_PassTime[Pass]; }
+
+    private:
+
+        // Buffers of the scratch of a resolution
+        enum SCRATCH_SLOT
+        {
+            SCRATCH_EDGE_MASK,
+            SCRATCH_EDGE_COUNT,
+            SCRATCH_HORIZONTAL_BITS,
+            SCRATCH_VERTICAL_BITS,
+            SCRATCH_COLUMN_BITS,
+            SCRATCH_COLUMN_COUNTS,
+            SCRATCH_LONG_EDGE_COUNT,
+            SCRATCH_LONG_COLUMN_COUNTS,
+            SCRATCH_PARTIAL_COVERAGE,
+            SCRATCH_HALF_RES_LUMA,
+            SCRATCH_HALF_RES_BITS,
+            SCRATCH_HALF_RES_WORDS,
+            SCRATCH_CHROMA_LUMA,
+            SCRATCH_LOG_LUMA,
+            SCRATCH_ACTIVE_WORDS,
+            SCRATCH_PIXEL_LEVELS,
+            SCRATCH_SLOT_COUNT
+        };
+
+        // A buffer of nCount elements from the scratch of the current resolution, zeroed when
+        // it is allocated and kept while the resolution stays in the cache
+        template <typename T>
+        T* GetScratch( SCRATCH_SLOT Slot, size_t nCount )
+        {
+            return (T*)m_Scratch.GetSlot( *m_pScratch, Slot, nCount * sizeof(T) );
+        }
+
+        void Resize( int nWidth, int nHeight );
+
+        void DetectEdgesRow( int y, const uint8_t* pRow, const uint8_t* pUp,
+                             const uint8_t* pPartial, const uint8_t* pPartialUp, const uint8_t* pActiveWords );
+        void DetectEdgesQuadRows( int y, const uint8_t* pUp, const uint8_t* pRow0, const uint8_t* pRow1 );
+        void DetectEdgesPlane( const uint8_t* pLuma, int Width, int Height, int Pitch );
+        void DetectEdgesPlaneRow( int y, const uint8_t* pRow, const uint8_t* pUp, const uint8_t* pActiveWords );
+        void DetectEdgesLogRow( int y, const int32_t* pRow, const int32_t* pUp, int Threshold, const uint8_t* pActiveWords );
+        void ClearInactiveWords( int y, const uint8_t* pActiveWords );
+
+        void ComputeHorizontalCounts();
+        void ComputeVerticalCountsTransposed();
+        void ComputeVerticalCountsDirect();
+        void ComputeLongCountsNaive();
+
+        // SourceType is one of the blend sources of MLAA_CPU.cpp
+        template <typename SourceType>
+        void BlendImage( const SourceType& Source, uint8_t* pDst, int DstPitch, const Rect& Region );
+        template <typename SourceType, typename CountType>
+        void BlendRegion( const SourceType& Source, uint8_t* pDst, int DstPitch, const Rect& Region, const CountType* pCounts );
+
+        void DetectEdgesHalfRes( const Surface& Src );
+        void UpdateHalfResBits();
+        void ClearFarEdges( int y, const uint64_t* pNearBits );
+
+        QUALITY_LEVEL GetQualityLevel( int x, int y ) const;
+        void UpdateActiveWords();
+        void ClampShortEdges();
+        void ExpandQualityLevels();
+
+    private:
+
+        int                     m_nWidth;
+        int                     m_nHeight;
+        int                     m_nWordsPerRow;     // 64 bit words per row of an edge bit plane
+        int                     m_nThresholdLevel;  // Smallest 8 bit luma difference that counts as an edge
+        VERTICAL_SEARCH         m_VerticalSearch;
+        DETECTION_RESOLUTION    m_DetectionResolution;
+        DETECTION_KERNEL        m_DetectionKernel;
+        bool                    m_bHalfResEdges;    // The last edge detection ran at half resolution
+        int                     m_nEdgeLeft;        // Origin of the intermediates in the image passed to Apply
+        int                     m_nEdgeTop;
+
+        // Intermediates of every resolution, and the scratch of the current one. The buffers
+        // below point into it
+        ScratchCache            m_Scratch;
+        ScratchCache::Entry*    m_pScratch;
+
+        uint8_t*                m_pEdgeMask;
+        uint8_t*                m_pEdgeCount;
+
+        // Edge mask split into bit planes, one bit per pixel
+        uint64_t*               m_pHorizontalBits;  // kUpperMask
+        uint64_t*               m_pVerticalBits;    // kRightMask
+
+        // Scratch for one 64 column strip of the transposed vertical search
+        uint64_t*               m_pColumnBits;
+        uint8_t*                m_pColumnCounts;
+        size_t                  m_nColumnCounts;
+
+        // Half resolution detection: an engine that runs the first pass on the downsampled
+        // luma, and one bit per pixel set near the edges it finds
+        std::unique_ptr<CPUEngine>  m_pHalfRes;
+        uint64_t*                   m_pHalfResBits;
+        uint8_t*                    m_pHalfResWords;    // The words of each row with a bit set
+
+        // Planar chroma: an engine that finds the edges of chroma resolution on the Y plane
+        // averaged over 2x2 blocks
+        bool                        m_bChromaEdges;
+        std::unique_ptr<CPUEngine>  m_pChroma;
+
+        // HDR detection settings
+        float                       m_fHDRThreshold;
+        float                       m_fHDRBlackLevel;
+
+        // Long edge search, the counts are allocated on first use
+        EDGE_SEARCH                 m_EdgeSearch;
+        bool                        m_bLongCounts;
+        uint16_t*                   m_pLongEdgeCount;
+        uint16_t*                   m_pLongColumnCounts;
+
+        // Variable rate: the quality of each tile, and for each row of tiles the 64 pixel words
+        // of a row whose edges are needed, i.e. within kRegionHalo of a tile that isn't skipped,
+        // and the quality of every pixel of a row for each row of tiles
+        int                     m_nQualityTileSize;
+        int                     m_nQualityColumns;
+        int                     m_nQualityRows;
+        std::vector<uint8_t>    m_QualityLevels;
+        uint8_t*                m_pActiveWords;
+        uint8_t*                m_pPixelLevels;
+
+        double                  m_PassTime[PASS_COUNT];
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_CPU_H
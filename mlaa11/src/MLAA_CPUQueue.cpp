@@ -0,0 +1,417 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_CPUQueue.cpp
+//
+// Frames move through two tasks: edge detection plus line length, then the blend pass.
+// Blend tasks go to the front of the shared task list so a frame that is half done is
+// finished before new frames are started. This keeps latency low when the pool is busy.
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_CPUQueue.h"
+
+#include <assert.h>
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+CPUQueue::CPUQueue( int nFramesInFlight, int nThreads ) :
+    m_nBusyFrames( 0 ),
+    m_nCompletingFrames( 0 ),
+    m_nNextFrameIndex( 0 ),
+    m_bQuit( false ),
+    m_fThreshold( kDefaultThreshold ),
+    m_VerticalSearch( VERTICAL_SEARCH_TRANSPOSED ),
+    m_DetectionResolution( DETECTION_FULL ),
+    m_DetectionKernel( DETECTION_KERNEL_PIXEL ),
+    m_EdgeSearch( EDGE_SEARCH_SHORT )
+{
+    if ( nFramesInFlight < 1 )
+    {
+        nFramesInFlight = 1;
+    }
+    if ( nThreads <= 0 )
+    {
+        nThreads = (int)std::thread::hardware_concurrency();
+    }
+    if ( nThreads <= 0 )
+    {
+        nThreads = 1;
+    }
+
+    for ( int i = 0; i < nFramesInFlight; i++ )
+    {
+        std::unique_ptr<Frame> pFrame( new Frame );
+        pFrame->FrameIndex = 0;
+        pFrame->SubmitTime = 0.0;
+        pFrame->bBusy = false;
+        pFrame->nViewsLeft = 0;
+        pFrame->bPlanar = false;
+        pFrame->bBlendChroma = false;
+        m_Frames.push_back( std::move( pFrame ) );
+    }
+
+    for ( int i = 0; i < nThreads; i++ )
+    {
+        m_WorkerEngines.push_back( std::unique_ptr<CPUEngine>( new CPUEngine ) );
+    }
+    for ( int i = 0; i < nThreads; i++ )
+    {
+        m_Workers.push_back( std::thread( &CPUQueue::WorkerMain, this, i ) );
+    }
+}
+
+CPUQueue::~CPUQueue()
+{
+    Flush();
+
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_bQuit = true;
+    }
+    m_TaskReady.notify_all();
+
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        m_Workers[i].join();
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Settings
+//--------------------------------------------------------------------------------------
+void CPUQueue::SetThreshold( float fThreshold )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_fThreshold = fThreshold;
+}
+
+void CPUQueue::SetVerticalSearch( VERTICAL_SEARCH Mode )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_VerticalSearch = Mode;
+}
+
+void CPUQueue::SetDetectionResolution( DETECTION_RESOLUTION Resolution )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_DetectionResolution = Resolution;
+}
+
+void CPUQueue::SetDetectionKernel( DETECTION_KERNEL Kernel )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_DetectionKernel = Kernel;
+}
+
+void CPUQueue::SetEdgeSearch( EDGE_SEARCH Search )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_EdgeSearch = Search;
+}
+
+void CPUQueue::SetQualityMap( const QualityMap* pMap )
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    if ( pMap == NULL || pMap->pLevels == NULL )
+    {
+        m_QualityLevels.clear();
+        return;
+    }
+
+    m_QualityMap = *pMap;
+    m_QualityLevels.assign( pMap->pLevels, pMap->pLevels + (size_t)pMap->Columns * pMap->Rows );
+    m_QualityMap.pLevels = m_QualityLevels.empty() ? NULL : &m_QualityLevels[0];
+}
+
+//--------------------------------------------------------------------------------------
+// Claim a frame slot, waits for a free one if all frames are in flight
+//--------------------------------------------------------------------------------------
+CPUQueue::Frame* CPUQueue::BeginFrame( std::unique_lock<std::mutex>& Lock, const Surface& Src, const Surface& Dst, Callback OnComplete )
+{
+    while ( m_nBusyFrames == (int)m_Frames.size() )
+    {
+        m_FrameDone.wait( Lock );
+    }
+
+    Frame* pFrame = NULL;
+    for ( size_t i = 0; i < m_Frames.size(); i++ )
+    {
+        if ( !m_Frames[i]->bBusy )
+        {
+            pFrame = m_Frames[i].get();
+            break;
+        }
+    }
+    assert( pFrame != NULL );
+
+    pFrame->Engine.SetThreshold( m_fThreshold );
+    pFrame->Engine.SetVerticalSearch( m_VerticalSearch );
+    pFrame->Engine.SetDetectionResolution( m_DetectionResolution );
+    pFrame->Engine.SetDetectionKernel( m_DetectionKernel );
+    pFrame->Engine.SetEdgeSearch( m_EdgeSearch );
+    pFrame->Engine.SetQualityMap( m_QualityLevels.empty() ? NULL : &m_QualityMap );
+    pFrame->Src = Src;
+    pFrame->Dst = Dst;
+    pFrame->Promise = std::promise<FrameResult>();
+    pFrame->OnComplete = OnComplete;
+    pFrame->FrameIndex = m_nNextFrameIndex++;
+    pFrame->SubmitTime = GetTimeMs();
+    pFrame->bBusy = true;
+    pFrame->Views.clear();
+    pFrame->nViewsLeft = 0;
+    pFrame->bPlanar = false;
+    m_nBusyFrames++;
+
+    return pFrame;
+}
+
+//--------------------------------------------------------------------------------------
+// Submit a frame
+//--------------------------------------------------------------------------------------
+std::future<FrameResult> CPUQueue::Submit( const Surface& Src, const Surface& Dst, Callback OnComplete )
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+
+    Frame* pFrame = BeginFrame( Lock, Src, Dst, OnComplete );
+    std::future<FrameResult> Future = pFrame->Promise.get_future();
+
+    Task NewTask = { pFrame, PASS_DETECT_EDGES, -1 };
+    m_Tasks.push_back( NewTask );
+    Lock.unlock();
+    m_TaskReady.notify_one();
+
+    return Future;
+}
+
+//--------------------------------------------------------------------------------------
+// Submit the views of an atlas as one frame
+//--------------------------------------------------------------------------------------
+std::future<FrameResult> CPUQueue::SubmitViews( const Surface& Src, const Surface& Dst, const View* pViews, int nViews,
+                                                Callback OnComplete )
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+
+    Frame* pFrame = BeginFrame( Lock, Src, Dst, OnComplete );
+    std::future<FrameResult> Future = pFrame->Promise.get_future();
+
+    if ( nViews <= 0 )
+    {
+        Lock.unlock();
+        double PassTime[PASS_COUNT] = { 0.0 };
+        CompleteFrame( pFrame, PassTime );
+        return Future;
+    }
+
+    pFrame->Views.assign( pViews, pViews + nViews );
+    pFrame->nViewsLeft = nViews;
+    for ( int i = 0; i < PASS_COUNT; i++ )
+    {
+        pFrame->ViewPassTime[i] = 0.0;
+    }
+
+    for ( int i = 0; i < nViews; i++ )
+    {
+        Task NewTask = { pFrame, PASS_DETECT_EDGES, i };
+        m_Tasks.push_back( NewTask );
+    }
+    Lock.unlock();
+    m_TaskReady.notify_all();
+
+    return Future;
+}
+
+//--------------------------------------------------------------------------------------
+// Submit a planar frame, it goes through the same two tasks as Submit
+//--------------------------------------------------------------------------------------
+std::future<FrameResult> CPUQueue::SubmitPlanar( const PlanarImage& Src, const PlanarImage& Dst, bool bBlendChroma,
+                                                 Callback OnComplete )
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+
+    const Surface NoSurface = { NULL, 0, 0, 0 };
+    Frame* pFrame = BeginFrame( Lock, NoSurface, NoSurface, OnComplete );
+    std::future<FrameResult> Future = pFrame->Promise.get_future();
+
+    pFrame->bPlanar = true;
+    pFrame->bBlendChroma = bBlendChroma;
+    pFrame->PlanarSrc = Src;
+    pFrame->PlanarDst = Dst;
+
+    Task NewTask = { pFrame, PASS_DETECT_EDGES, -1 };
+    m_Tasks.push_back( NewTask );
+    Lock.unlock();
+    m_TaskReady.notify_one();
+
+    return Future;
+}
+
+//--------------------------------------------------------------------------------------
+// Wait for all frames
+//--------------------------------------------------------------------------------------
+void CPUQueue::Flush()
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+    while ( m_nBusyFrames > 0 || m_nCompletingFrames > 0 )
+    {
+        m_FrameDone.wait( Lock );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Worker thread, runs tasks from the shared list until the queue is destroyed
+//--------------------------------------------------------------------------------------
+void CPUQueue::WorkerMain( int nWorker )
+{
+    for ( ;; )
+    {
+        Task CurrentTask = { NULL, PASS_COUNT, -1 };
+        {
+            std::unique_lock<std::mutex> Lock( m_Lock );
+            while ( m_Tasks.empty() && !m_bQuit )
+            {
+                m_TaskReady.wait( Lock );
+            }
+            if ( m_Tasks.empty() )
+            {
+                return;
+            }
+            CurrentTask = m_Tasks.front();
+            m_Tasks.pop_front();
+        }
+
+        Frame* pFrame = CurrentTask.pFrame;
+        if ( CurrentTask.nView >= 0 )
+        {
+            RunView( nWorker, pFrame, CurrentTask.nView );
+        }
+        else if ( CurrentTask.Pass == PASS_DETECT_EDGES )
+        {
+            if ( pFrame->bPlanar )
+            {
+                pFrame->Engine.DetectEdgesPlanar( pFrame->PlanarSrc, pFrame->bBlendChroma );
+            }
+            else
+            {
+                pFrame->Engine.DetectEdges( pFrame->Src );
+            }
+            pFrame->Engine.ComputeLineLength();
+
+            Task BlendTask = { pFrame, PASS_BLEND_COLOR, -1 };
+            {
+                std::lock_guard<std::mutex> Lock( m_Lock );
+                m_Tasks.push_front( BlendTask );
+            }
+            m_TaskReady.notify_one();
+        }
+        else
+        {
+            if ( pFrame->bPlanar )
+            {
+                pFrame->Engine.BlendPlanar( pFrame->PlanarSrc, pFrame->PlanarDst );
+            }
+            else
+            {
+                pFrame->Engine.BlendColor( pFrame->Src, pFrame->Dst );
+            }
+
+            double PassTime[PASS_COUNT];
+            for ( int i = 0; i < PASS_COUNT; i++ )
+            {
+                PassTime[i] = pFrame->Engine.GetPassTime( (PASS)i );
+            }
+            CompleteFrame( pFrame, PassTime );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Process one view of an atlas frame with the worker's own intermediates
+//--------------------------------------------------------------------------------------
+void CPUQueue::RunView( int nWorker, Frame* pFrame, int nView )
+{
+    CPUEngine& Engine = *m_WorkerEngines[nWorker];
+    Engine.SetVerticalSearch( pFrame->Engine.GetVerticalSearch() );
+    Engine.SetDetectionResolution( pFrame->Engine.GetDetectionResolution() );
+    Engine.SetDetectionKernel( pFrame->Engine.GetDetectionKernel() );
+    Engine.SetEdgeSearch( pFrame->Engine.GetEdgeSearch() );
+    Engine.ApplyView( pFrame->Src, pFrame->Dst, pFrame->Views[nView] );
+
+    bool bLastView;
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        for ( int i = 0; i < PASS_COUNT; i++ )
+        {
+            pFrame->ViewPassTime[i] += Engine.GetPassTime( (PASS)i );
+        }
+        bLastView = ( --pFrame->nViewsLeft == 0 );
+    }
+
+    if ( bLastView )
+    {
+        CompleteFrame( pFrame, pFrame->ViewPassTime );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Hand the slot back to Submit, then report the result. The slot is free before the
+// callback runs, so the callback can submit the next frame even with one frame in flight
+//--------------------------------------------------------------------------------------
+void CPUQueue::CompleteFrame( Frame* pFrame, const double PassTime[PASS_COUNT] )
+{
+    FrameResult Result;
+    Result.FrameIndex = pFrame->FrameIndex;
+    Result.LatencyMs = GetTimeMs() - pFrame->SubmitTime;
+    for ( int i = 0; i < PASS_COUNT; i++ )
+    {
+        Result.PassTime[i] = PassTime[i];
+    }
+
+    // The next frame in the slot gets a new promise and callback
+    Callback OnComplete;
+    std::promise<FrameResult> Promise;
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        OnComplete.swap( pFrame->OnComplete );
+        Promise = std::move( pFrame->Promise );
+        pFrame->bBusy = false;
+        m_nBusyFrames--;
+        m_nCompletingFrames++;
+    }
+    m_FrameDone.notify_all();
+
+    if ( OnComplete )
+    {
+        OnComplete( Result );
+    }
+    Promise.set_value( Result );
+
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_nCompletingFrames--;
+    }
+    m_FrameDone.notify_all();
+}
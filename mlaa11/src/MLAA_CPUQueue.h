@@ -0,0 +1,163 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_CPUQueue.h
+//
+// Asynchronous front end for the CPU MLAA engine. Frames are submitted without blocking
+// the caller and complete on a shared pool of worker threads. Several frames are kept in
+// flight so that the edge passes of one frame overlap the blend pass of the previous one.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_CPU_QUEUE_H
+#define MLAA_CPU_QUEUE_H
+
+#include "MLAA_CPU.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Reported when a submitted frame completes
+    //--------------------------------------------------------------------------------------
+    struct FrameResult
+    {
+        uint64_t    FrameIndex;         // Submission order, starting at 0
+        double      LatencyMs;          // From Submit to the end of the blend pass
+        double      PassTime[PASS_COUNT];
+    };
+
+    class CPUQueue
+    {
+    public:
+
+        typedef std::function<void ( const FrameResult& )> Callback;
+
+        // nFramesInFlight is the queue depth, nThreads = 0 uses one thread per core
+        CPUQueue( int nFramesInFlight, int nThreads = 0 );
+        ~CPUQueue();
+
+        // Settings are picked up by the frames submitted after the call
+        void SetThreshold( float fThreshold );
+        void SetVerticalSearch( VERTICAL_SEARCH Mode );
+        void SetDetectionResolution( DETECTION_RESOLUTION Resolution );
+        void SetDetectionKernel( DETECTION_KERNEL Kernel );
+        void SetEdgeSearch( EDGE_SEARCH Search );
+        void SetQualityMap( const QualityMap* pMap );
+
+        // Queues a frame and returns once it has a slot, blocking only if nFramesInFlight frames
+        // are still being processed. Src and Dst must stay valid until the frame completes.
+        // OnComplete, if set, runs on a worker thread before the future becomes ready. The
+        // slot of the frame is free by then, so OnComplete may submit the next frame
+        std::future<FrameResult> Submit( const Surface& Src, const Surface& Dst, Callback OnComplete = Callback() );
+
+        // Queues the views of an atlas as one frame. Every view becomes a task of its own,
+        // so the views are spread over the whole pool. See CPUEngine::ApplyViews
+        std::future<FrameResult> SubmitViews( const Surface& Src, const Surface& Dst, const View* pViews, int nViews,
+                                              Callback OnComplete = Callback() );
+
+        // Queues a planar video frame. A transcoder keeps several frames in flight to use the
+        // whole pool. See CPUEngine::ApplyPlanar
+        std::future<FrameResult> SubmitPlanar( const PlanarImage& Src, const PlanarImage& Dst, bool bBlendChroma,
+                                               Callback OnComplete = Callback() );
+
+        // Waits until every submitted frame has completed and its callback has returned, so it
+        // must not be called from a callback
+        void Flush();
+
+        int GetFramesInFlight() const { return (int)m_Frames.size(); }
+        int GetThreadCount() const { return (int)m_Workers.size(); }
+
+    private:
+
+        // One slot per frame in flight, each with its own intermediates
+        struct Frame
+        {
+            CPUEngine                   Engine;
+            Surface                     Src;
+            Surface                     Dst;
+            std::promise<FrameResult>   Promise;
+            Callback                    OnComplete;
+            uint64_t                    FrameIndex;
+            double                      SubmitTime;
+            bool                        bBusy;
+
+            // Atlas frames only
+            std::vector<View>           Views;
+            int                         nViewsLeft;
+            double                      ViewPassTime[PASS_COUNT];
+
+            // Planar frames only
+            bool                        bPlanar;
+            bool                        bBlendChroma;
+            PlanarImage                 PlanarSrc;
+            PlanarImage                 PlanarDst;
+        };
+
+        // Edge detection and line length run as one task, the blend pass as a second.
+        // Atlas frames have one task per view instead
+        struct Task
+        {
+            Frame*      pFrame;
+            PASS        Pass;
+            int         nView;
+        };
+
+        Frame* BeginFrame( std::unique_lock<std::mutex>& Lock, const Surface& Src, const Surface& Dst, Callback OnComplete );
+        void WorkerMain( int nWorker );
+        void RunView( int nWorker, Frame* pFrame, int nView );
+        void CompleteFrame( Frame* pFrame, const double PassTime[PASS_COUNT] );
+
+    private:
+
+        std::vector< std::unique_ptr<Frame> >   m_Frames;
+        std::vector<std::thread>                m_Workers;
+        std::vector< std::unique_ptr<CPUEngine> > m_WorkerEngines;  // Intermediates for atlas views
+
+        std::mutex                              m_Lock;
+        std::condition_variable                 m_TaskReady;
+        std::condition_variable                 m_FrameDone;
+        std::deque<Task>                        m_Tasks;
+        int                                     m_nBusyFrames;
+        int                                     m_nCompletingFrames;    // Slot released, callback or promise pending
+        uint64_t                                m_nNextFrameIndex;
+        bool                                    m_bQuit;
+
+        float                                   m_fThreshold;
+        VERTICAL_SEARCH                         m_VerticalSearch;
+        DETECTION_RESOLUTION                    m_DetectionResolution;
+        DETECTION_KERNEL                        m_DetectionKernel;
+        EDGE_SEARCH                             m_EdgeSearch;
+        QualityMap                              m_QualityMap;
+        std::vector<uint8_t>                    m_QualityLevels;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_CPU_QUEUE_H
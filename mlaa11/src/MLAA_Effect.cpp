@@ -0,0 +1,175 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Effect.cpp
+//
+// Backend independent MLAA effect and its CPU backend, see MLAA_Effect.h
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Effect.h"
+
+#include <assert.h>
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+Effect::Effect( IEffectBackend* pBackend ) :
+    m_pBackend( pBackend ),
+    m_nWidth( 0 ),
+    m_nHeight( 0 )
+{
+    assert( pBackend );
+
+    m_Settings.fThreshold = kDefaultThreshold;
+    m_Settings.EdgeSearch = EDGE_SEARCH_SHORT;
+    m_Settings.DetectionResolution = DETECTION_FULL;
+    m_Settings.DetectionKernel = DETECTION_KERNEL_PIXEL;
+    m_Settings.pQualityMap = NULL;
+    m_Settings.pViews = NULL;
+    m_Settings.nViews = 0;
+    m_Settings.pRegion = NULL;
+    m_Settings.pBackendOptions = NULL;
+}
+
+Effect::~Effect()
+{
+    ReleaseIntermediates();
+}
+
+
+void Effect::SetViews( const View* pViews, int nViews )
+{
+    assert( nViews >= 0 && ( pViews || nViews == 0 ) );
+
+    m_Settings.pViews = ( nViews > 0 ) ? pViews : NULL;
+    m_Settings.nViews = nViews;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The three passes of RenderMLAA, the intermediates follow the size of the input
+//--------------------------------------------------------------------------------------
+bool Effect::Apply( const EffectSurface& Input, const EffectSurface& Output )
+{
+    assert( Input.Width == Output.Width && Input.Height == Output.Height );
+    assert( m_Settings.pViews == NULL || m_Settings.pRegion == NULL );
+
+    if ( !CreateIntermediates( Input ) )
+        return false;
+
+    if ( !m_pBackend->DetectEdges( Input, m_Settings ) )
+        return false;
+    m_pBackend->ComputeLineLength( Input, m_Settings );
+    m_pBackend->BlendColor( Input, Output, m_Settings );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------
+bool Effect::CreateIntermediates( const EffectSurface& Input )
+{
+    if ( Input.Width == m_nWidth && Input.Height == m_nHeight )
+        return true;
+
+    ReleaseIntermediates();
+    if ( !m_pBackend->CreateIntermediates( Input ) )
+    {
+        m_pBackend->ReleaseIntermediates();
+        return false;
+    }
+    m_nWidth = Input.Width;
+    m_nHeight = Input.Height;
+    return true;
+}
+
+void Effect::ReleaseIntermediates()
+{
+    if ( m_nWidth == 0 && m_nHeight == 0 )
+        return;
+
+    m_pBackend->ReleaseIntermediates();
+    m_nWidth = 0;
+    m_nHeight = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// CPU backend. CPUEngine sizes its intermediates on the first pass of a frame and is set
+// up from the settings there
+//--------------------------------------------------------------------------------------
+static Surface ToSurface( const EffectSurface& Image )
+{
+    Surface Result = { (uint8_t*)Image.pHandle, Image.Width, Image.Height, Image.Pitch };
+    return Result;
+}
+
+// A region or views run all three passes in BlendColor
+static bool IsWholeFrame( const EffectSettings& Settings )
+{
+    return Settings.pRegion == NULL && Settings.pViews == NULL;
+}
+
+bool CPUBackend::CreateIntermediates( const EffectSurface& /*Input*/ )
+{
+    return true;
+}
+
+void CPUBackend::ReleaseIntermediates()
+{
+    m_Engine.ReleaseIntermediates();
+}
+
+bool CPUBackend::DetectEdges( const EffectSurface& Input, const EffectSettings& Settings )
+{
+    assert( Settings.pBackendOptions == NULL );
+
+    m_Engine.SetThreshold( Settings.fThreshold );
+    m_Engine.SetEdgeSearch( Settings.EdgeSearch );
+    m_Engine.SetDetectionResolution( Settings.DetectionResolution );
+    m_Engine.SetDetectionKernel( Settings.DetectionKernel );
+    m_Engine.SetQualityMap( Settings.pQualityMap );
+
+    if ( IsWholeFrame( Settings ) )
+        m_Engine.DetectEdges( ToSurface( Input ) );
+    return true;
+}
+
+void CPUBackend::ComputeLineLength( const EffectSurface& /*Input*/, const EffectSettings& Settings )
+{
+    if ( IsWholeFrame( Settings ) )
+        m_Engine.ComputeLineLength();
+}
+
+void CPUBackend::BlendColor( const EffectSurface& Input, const EffectSurface& Output, const EffectSettings& Settings )
+{
+    if ( Settings.pViews )
+        m_Engine.ApplyViews( ToSurface( Input ), ToSurface( Output ), Settings.pViews, Settings.nViews );
+    else if ( Settings.pRegion )
+        m_Engine.Apply( ToSurface( Input ), ToSurface( Output ), *Settings.pRegion );
+    else
+        m_Engine.BlendColor( ToSurface( Input ), ToSurface( Output ) );
+}
@@ -0,0 +1,174 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Effect.h
+//
+// MLAA as a component. Effect records the three passes on a backend that owns the
+// intermediates, so the same code drives the GPU and the CPU implementations. 
+// CPUBackend runs the passes with CPUEngine and has no dependency on a graphics API,
+// the sample implements a D3D11 backend around the shaders of MLAA11.hlsl. Every pass
+// gets the settings of the frame, a backend keeps nothing between frames but its
+// intermediates and device objects.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_EFFECT_H
+#define MLAA_EFFECT_H
+
+#include "MLAA_CPU.h"
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // An image handed to a backend. What the handle points to is up to the backend: pixel
+    // data for CPUBackend, a view of a texture for a GPU backend
+    //--------------------------------------------------------------------------------------
+    struct EffectSurface
+    {
+        void*   pHandle;
+        int     Width;
+        int     Height;
+        int     Pitch;          // Bytes per row of pixel data, unused by GPU backends
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Settings of a frame, the same meaning as the CPUEngine settings of the same names. A
+    // backend without a variant for a setting fails DetectEdges, see each backend. The
+    // map, views, region and backend options are not copied
+    //--------------------------------------------------------------------------------------
+    struct EffectSettings
+    {
+        float                   fThreshold;
+        EDGE_SEARCH             EdgeSearch;
+        DETECTION_RESOLUTION    DetectionResolution;
+        DETECTION_KERNEL        DetectionKernel;
+        const QualityMap*       pQualityMap;        // NULL for full quality everywhere
+        const View*             pViews;             // Atlas views, NULL for the whole frame
+        int                     nViews;
+        const Rect*             pRegion;            // Region of interest, NULL for the whole frame
+        const void*             pBackendOptions;    // Settings of one backend, NULL for its defaults
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Device side of the effect. For each frame the passes are called in order with the
+    // settings of the frame, after CreateIntermediates if the size of the frame changed
+    //--------------------------------------------------------------------------------------
+    class IEffectBackend
+    {
+    public:
+
+        virtual ~IEffectBackend() {}
+
+        // Intermediates for images the size of Input. A GPU backend may size them after the
+        // texture behind Input, which can be larger. Returns false on failure
+        virtual bool CreateIntermediates( const EffectSurface& Input ) = 0;
+        virtual void ReleaseIntermediates() = 0;
+
+        // Returns false when the frame can't be run with these settings, e.g. the views could
+        // not be uploaded. The other passes are then skipped and Output is left as it was
+        virtual bool DetectEdges( const EffectSurface& Input, const EffectSettings& Settings ) = 0;
+        virtual void ComputeLineLength( const EffectSurface& Input, const EffectSettings& Settings ) = 0;
+        virtual void BlendColor( const EffectSurface& Input, const EffectSurface& Output, const EffectSettings& Settings ) = 0;
+
+        // Time taken by a pass in milliseconds. GPU backends may report an earlier frame
+        virtual double GetPassTime( PASS Pass ) const = 0;
+    };
+
+    class Effect
+    {
+    public:
+
+        // The backend is not owned and must outlive the effect
+        Effect( IEffectBackend* pBackend );
+        ~Effect();
+
+        // Luminance difference that counts as an edge, same meaning as gParam.z
+        void SetThreshold( float fThreshold ) { m_Settings.fThreshold = fThreshold; }
+        float GetThreshold() const { return m_Settings.fThreshold; }
+
+        void SetEdgeSearch( EDGE_SEARCH Search ) { m_Settings.EdgeSearch = Search; }
+        void SetDetectionResolution( DETECTION_RESOLUTION Resolution ) { m_Settings.DetectionResolution = Resolution; }
+        void SetDetectionKernel( DETECTION_KERNEL Kernel ) { m_Settings.DetectionKernel = Kernel; }
+
+        // Not copied, they must stay valid until the last Apply they are set for. Views and a
+        // region don't combine
+        void SetQualityMap( const QualityMap* pMap ) { m_Settings.pQualityMap = pMap; }
+        void SetViews( const View* pViews, int nViews );
+        void SetRegion( const Rect* pRegion ) { m_Settings.pRegion = pRegion; }
+        void SetBackendOptions( const void* pOptions ) { m_Settings.pBackendOptions = pOptions; }
+
+        const EffectSettings& GetSettings() const { return m_Settings; }
+
+        // Runs the three passes. Input and Output must be the same size and must not alias.
+        // Returns false if the intermediates could not be created or the backend could not
+        // run the frame with the settings
+        bool Apply( const EffectSurface& Input, const EffectSurface& Output );
+
+        // Creates the intermediates ahead of the first Apply of that size, e.g. when the
+        // swap chain is resized. Returns false on failure
+        bool CreateIntermediates( const EffectSurface& Input );
+
+        // Frees the intermediates, the next Apply creates them again
+        void ReleaseIntermediates();
+
+        double GetPassTime( PASS Pass ) const { return m_pBackend->GetPassTime( Pass ); }
+        IEffectBackend* GetBackend() const { return m_pBackend; }
+
+    private:
+
+        IEffectBackend*     m_pBackend;
+        EffectSettings      m_Settings;
+        int                 m_nWidth;       // Size of the intermediates, zero when there are none
+        int                 m_nHeight;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Backend running the passes with a CPUEngine. Surface handles point to 32 bit pixels
+    // with the luma in alpha, as for CPUEngine::Apply. There are no backend options. A
+    // region or views are run by CPUEngine in one call, in BlendColor, and the first two
+    // passes do nothing; the pass times are still those of each pass
+    //--------------------------------------------------------------------------------------
+    class CPUBackend : public IEffectBackend
+    {
+    public:
+
+        virtual bool CreateIntermediates( const EffectSurface& Input );
+        virtual void ReleaseIntermediates();
+
+        virtual bool DetectEdges( const EffectSurface& Input, const EffectSettings& Settings );
+        virtual void ComputeLineLength( const EffectSurface& Input, const EffectSettings& Settings );
+        virtual void BlendColor( const EffectSurface& Input, const EffectSurface& Output, const EffectSettings& Settings );
+
+        virtual double GetPassTime( PASS Pass ) const { return m_Engine.GetPassTime( Pass ); }
+
+        // The engine is set up from the settings of each frame, it is exposed for its
+        // intermediates, e.g. GetEdgeView
+        const CPUEngine& GetEngine() const { return m_Engine; }
+
+    private:
+
+        CPUEngine       m_Engine;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_EFFECT_H
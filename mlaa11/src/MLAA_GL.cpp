@@ -0,0 +1,447 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_GL.cpp
+//
+// OpenGL backend of MLAA::Effect and surfaceless EGL context, see MLAA_GL.h
+//--------------------------------------------------------------------------------------
+
+#ifndef _WIN32
+
+#define GL_GLEXT_PROTOTYPES
+#include "MLAA_GL.h"
+
+#include <EGL/eglext.h>
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Surfaceless EGL context
+//--------------------------------------------------------------------------------------
+GLContext::GLContext() :
+    m_Display( EGL_NO_DISPLAY ),
+    m_Context( EGL_NO_CONTEXT )
+{
+}
+
+GLContext::~GLContext()
+{
+    Destroy();
+}
+
+static bool HasExtension( const char* pExtensions, const char* pName )
+{
+    size_t Length = strlen( pName );
+    for ( const char* p = pExtensions; p && ( p = strstr( p, pName ) ) != NULL; p += Length )
+    {
+        if ( ( p == pExtensions || p[-1] == ' ' ) && ( p[Length] == ' ' || p[Length] == 0 ) )
+            return true;
+    }
+    return false;
+}
+
+bool GLContext::Create()
+{
+    assert( m_Display == EGL_NO_DISPLAY );
+
+    // The surfaceless platform needs no X11 or Wayland server and no DRM device, Mesa 
+    // falls back to llvmpipe on it
+    const char* pClientExtensions = eglQueryString( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+    PFNEGLGETPLATFORMDISPLAYEXTPROC pGetPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+    if ( pGetPlatformDisplay && HasExtension( pClientExtensions, "EGL_MESA_platform_surfaceless" ) )
+        m_Display = pGetPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+    else
+        m_Display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+    EGLint Major, Minor;
+    if ( m_Display == EGL_NO_DISPLAY || !eglInitialize( m_Display, &Major, &Minor ) )
+    {
+        m_Display = EGL_NO_DISPLAY;
+        return false;
+    }
+
+    const char* pExtensions = eglQueryString( m_Display, EGL_EXTENSIONS );
+    if ( !HasExtension( pExtensions, "EGL_KHR_surfaceless_context" ) || !HasExtension( pExtensions, "EGL_KHR_create_context" ) ||
+         !eglBindAPI( EGL_OPENGL_API ) )
+    {
+        Destroy();
+        return false;
+    }
+
+    EGLConfig Config = (EGLConfig)0;
+    if ( !HasExtension( pExtensions, "EGL_KHR_no_config_context" ) )
+    {
+        const EGLint ConfigAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLint nConfigs = 0;
+        if ( !eglChooseConfig( m_Display, ConfigAttribs, &Config, 1, &nConfigs ) || nConfigs == 0 )
+        {
+            Destroy();
+            return false;
+        }
+    }
+
+    const EGLint ContextAttribs[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION_KHR,          3,
+        EGL_CONTEXT_MINOR_VERSION_KHR,          3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR,    EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+        EGL_NONE
+    };
+    m_Context = eglCreateContext( m_Display, Config, EGL_NO_CONTEXT, ContextAttribs );
+    if ( m_Context == EGL_NO_CONTEXT || !MakeCurrent() )
+    {
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void GLContext::Destroy()
+{
+    if ( m_Display == EGL_NO_DISPLAY )
+        return;
+
+    eglMakeCurrent( m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+    if ( m_Context != EGL_NO_CONTEXT )
+        eglDestroyContext( m_Display, m_Context );
+    eglTerminate( m_Display );
+    m_Display = EGL_NO_DISPLAY;
+    m_Context = EGL_NO_CONTEXT;
+}
+
+bool GLContext::MakeCurrent()
+{
+    return eglMakeCurrent( m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, m_Context ) == EGL_TRUE;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+GLBackend::GLBackend() :
+    m_VertexArray( 0 ),
+    m_ScreenQuadVB( 0 ),
+    m_Sampler( 0 ),
+    m_Framebuffer( 0 ),
+    m_EdgeMask( 0 ),
+    m_EdgeCount( 0 ),
+    m_nWidth( 0 ),
+    m_nHeight( 0 )
+{
+    for ( int i = 0; i < PROGRAM_COUNT; i++ )
+    {
+        m_Programs[i] = 0;
+        m_ParamLocations[i] = -1;
+    }
+    for ( int i = 0; i < PASS_COUNT; i++ )
+    {
+        m_Queries[i] = 0;
+        m_bQueryPending[i] = false;
+        m_PassTime[i] = 0.0;
+    }
+}
+
+GLBackend::~GLBackend()
+{
+    // Objects must be released while the context is current, as for the D3D resources
+    // of the sample
+    assert( m_Programs[0] == 0 && m_EdgeMask == 0 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Shaders and the screen quad
+//--------------------------------------------------------------------------------------
+GLuint GLBackend::CompileProgram( const std::string& Source, const char* pDefines )
+{
+    const GLenum Stages[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    const char* StageDefines[2] = { "#define VERTEX_SHADER 1\n", pDefines };
+    GLuint Program = glCreateProgram();
+
+    for ( int i = 0; i < 2; i++ )
+    {
+        const char* Strings[3] = { "#version 330 core\n", StageDefines[i], Source.c_str() };
+        GLuint Shader = glCreateShader( Stages[i] );
+        glShaderSource( Shader, 3, Strings, NULL );
+        glCompileShader( Shader );
+
+        GLint Status = GL_FALSE;
+        glGetShaderiv( Shader, GL_COMPILE_STATUS, &Status );
+        if ( !Status )
+        {
+            char Log[4096] = "";
+            glGetShaderInfoLog( Shader, sizeof( Log ), NULL, Log );
+            m_ShaderLog += pDefines;
+            m_ShaderLog += Log;
+        }
+        glAttachShader( Program, Shader );
+        glDeleteShader( Shader );
+    }
+
+    glLinkProgram( Program );
+    GLint Status = GL_FALSE;
+    glGetProgramiv( Program, GL_LINK_STATUS, &Status );
+    if ( !Status )
+    {
+        char Log[4096] = "";
+        glGetProgramInfoLog( Program, sizeof( Log ), NULL, Log );
+        m_ShaderLog += Log;
+        glDeleteProgram( Program );
+        return 0;
+    }
+
+    // Texture units match the registers of MLAA11.hlsl
+    glUseProgram( Program );
+    glUniform1i( glGetUniformLocation( Program, "g_txSceneColor" ), 0 );
+    glUniform1i( glGetUniformLocation( Program, "g_txEdgeMask" ), 1 );
+    glUniform1i( glGetUniformLocation( Program, "g_txEdgeCount" ), 2 );
+    glUseProgram( 0 );
+    return Program;
+}
+
+bool GLBackend::CreateShaders( const char* pFileName )
+{
+    assert( m_Programs[0] == 0 );
+    m_ShaderLog.clear();
+
+    FILE* pFile = fopen( pFileName, "rb" );
+    if ( !pFile )
+    {
+        m_ShaderLog = std::string( "Cannot open " ) + pFileName;
+        return false;
+    }
+    std::string Source;
+    char Buffer[4096];
+    for ( size_t Read; ( Read = fread( Buffer, 1, sizeof( Buffer ), pFile ) ) > 0; )
+        Source.append( Buffer, Read );
+    fclose( pFile );
+
+    static const char* s_Defines[PROGRAM_COUNT] =
+    {
+        "#define MLAA_PASS 1\n",
+        "#define MLAA_PASS 2\n",
+        "#define MLAA_PASS 3\n",
+        "#define MLAA_PASS 3\n#define SHOW_EDGES 1\n",
+    };
+    for ( int i = 0; i < PROGRAM_COUNT; i++ )
+    {
+        m_Programs[i] = CompileProgram( Source, s_Defines[i] );
+        if ( m_Programs[i] == 0 )
+        {
+            ReleaseShaders();
+            return false;
+        }
+        m_ParamLocations[i] = glGetUniformLocation( m_Programs[i], "gParam" );
+    }
+
+    // The vertices of the screen quad of MLAA11.cpp: position and texture coordinates
+    static const float s_ScreenQuadVertex[] = { -1, -1, 1, 1, 0, 1,
+                                                -1,  1, 1, 1, 0, 0,
+                                                 1, -1, 1, 1, 1, 1,
+                                                 1,  1, 1, 1, 1, 0 };
+    glGenVertexArrays( 1, &m_VertexArray );
+    glBindVertexArray( m_VertexArray );
+    glGenBuffers( 1, &m_ScreenQuadVB );
+    glBindBuffer( GL_ARRAY_BUFFER, m_ScreenQuadVB );
+    glBufferData( GL_ARRAY_BUFFER, sizeof( s_ScreenQuadVertex ), s_ScreenQuadVertex, GL_STATIC_DRAW );
+    glVertexAttribPointer( 0, 4, GL_FLOAT, GL_FALSE, 6 * sizeof( float ), (const void*)0 );
+    glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, 6 * sizeof( float ), (const void*)( 4 * sizeof( float ) ) );
+    glEnableVertexAttribArray( 0 );
+    glEnableVertexAttribArray( 1 );
+    glBindVertexArray( 0 );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    glGenSamplers( 1, &m_Sampler );
+    glSamplerParameteri( m_Sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+    glSamplerParameteri( m_Sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+    glGenFramebuffers( 1, &m_Framebuffer );
+    glGenQueries( PASS_COUNT, m_Queries );
+    return glGetError() == GL_NO_ERROR;
+}
+
+void GLBackend::ReleaseShaders()
+{
+    for ( int i = 0; i < PROGRAM_COUNT; i++ )
+    {
+        if ( m_Programs[i] )
+            glDeleteProgram( m_Programs[i] );
+        m_Programs[i] = 0;
+        m_ParamLocations[i] = -1;
+    }
+    if ( m_VertexArray )
+        glDeleteVertexArrays( 1, &m_VertexArray );
+    if ( m_ScreenQuadVB )
+        glDeleteBuffers( 1, &m_ScreenQuadVB );
+    if ( m_Sampler )
+        glDeleteSamplers( 1, &m_Sampler );
+    if ( m_Framebuffer )
+        glDeleteFramebuffers( 1, &m_Framebuffer );
+    if ( m_Queries[0] )
+        glDeleteQueries( PASS_COUNT, m_Queries );
+    m_VertexArray = m_ScreenQuadVB = m_Sampler = m_Framebuffer = 0;
+    for ( int i = 0; i < PASS_COUNT; i++ )
+    {
+        m_Queries[i] = 0;
+        m_bQueryPending[i] = false;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Intermediates, the formats of g_EdgeMask and g_EdgeCount
+//--------------------------------------------------------------------------------------
+bool GLBackend::CreateIntermediates( const EffectSurface& Input )
+{
+    assert( m_EdgeMask == 0 );
+
+    const int Width = Input.Width;
+    const int Height = Input.Height;
+
+    GLuint Textures[2];
+    glGenTextures( 2, Textures );
+    m_EdgeMask = Textures[0];
+    m_EdgeCount = Textures[1];
+
+    const GLenum Formats[2] = { GL_R8UI, GL_RG8UI };
+    for ( int i = 0; i < 2; i++ )
+    {
+        glBindTexture( GL_TEXTURE_2D, Textures[i] );
+        glTexStorage2D( GL_TEXTURE_2D, 1, Formats[i], Width, Height );
+    }
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    m_nWidth = Width;
+    m_nHeight = Height;
+    return glGetError() == GL_NO_ERROR;
+}
+
+void GLBackend::ReleaseIntermediates()
+{
+    if ( m_EdgeMask )
+    {
+        GLuint Textures[2] = { m_EdgeMask, m_EdgeCount };
+        glDeleteTextures( 2, Textures );
+    }
+    m_EdgeMask = m_EdgeCount = 0;
+    m_nWidth = m_nHeight = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// The passes. Each one draws the screen quad to one texture inside its own time query
+//--------------------------------------------------------------------------------------
+void GLBackend::DrawQuad( PROGRAM Program, GLuint Target, const EffectSurface& Input, float fThreshold, PASS Pass )
+{
+    assert( m_Programs[Program] && m_EdgeMask );
+    assert( Input.Width == m_nWidth && Input.Height == m_nHeight );
+
+    // The result of the previous frame is kept if it was not read back in time
+    if ( m_bQueryPending[Pass] )
+        GetPassTime( Pass );
+    glBeginQuery( GL_TIME_ELAPSED, m_Queries[Pass] );
+
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, m_Framebuffer );
+    glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Target, 0 );
+    glViewport( 0, 0, m_nWidth, m_nHeight );
+    glDisable( GL_BLEND );
+    glDisable( GL_DEPTH_TEST );
+    glDisable( GL_SCISSOR_TEST );
+
+    const GLuint Textures[3] = { (GLuint)(uintptr_t)Input.pHandle, m_EdgeMask, m_EdgeCount };
+    for ( int i = 0; i < 3; i++ )
+    {
+        glActiveTexture( GL_TEXTURE0 + i );
+        glBindTexture( GL_TEXTURE_2D, Textures[i] );
+        glBindSampler( i, m_Sampler );
+    }
+
+    // Same meaning as gParam in MLAA11.hlsl, without the quality map tile size
+    glUseProgram( m_Programs[Program] );
+    glUniform4f( m_ParamLocations[Program], (float)m_nWidth, (float)m_nHeight, fThreshold, 0.0f );
+    glBindVertexArray( m_VertexArray );
+    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+
+    // Unbind everything, so the target can be read by the next pass
+    glBindVertexArray( 0 );
+    glUseProgram( 0 );
+    for ( int i = 2; i >= 0; i-- )
+    {
+        glActiveTexture( GL_TEXTURE0 + i );
+        glBindTexture( GL_TEXTURE_2D, 0 );
+        glBindSampler( i, 0 );
+    }
+    glFramebufferTexture2D( GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0 );
+    glBindFramebuffer( GL_DRAW_FRAMEBUFFER, 0 );
+
+    glEndQuery( GL_TIME_ELAPSED );
+    m_bQueryPending[Pass] = true;
+}
+
+bool GLBackend::DetectEdges( const EffectSurface& Input, const EffectSettings& Settings )
+{
+    if ( Settings.EdgeSearch != EDGE_SEARCH_SHORT || Settings.DetectionResolution != DETECTION_FULL ||
+         Settings.pQualityMap || Settings.pViews || Settings.pRegion )
+        return false;
+
+    DrawQuad( PROGRAM_SEPERATING_LINES, m_EdgeMask, Input, Settings.fThreshold, PASS_DETECT_EDGES );
+    return true;
+}
+
+void GLBackend::ComputeLineLength( const EffectSurface& Input, const EffectSettings& Settings )
+{
+    DrawQuad( PROGRAM_COMPUTE_LINE_LENGTH, m_EdgeCount, Input, Settings.fThreshold, PASS_COMPUTE_LINE_LENGTH );
+}
+
+void GLBackend::BlendColor( const EffectSurface& Input, const EffectSurface& Output, const EffectSettings& Settings )
+{
+    assert( Output.pHandle != Input.pHandle );
+
+    const GLBackendOptions* pOptions = (const GLBackendOptions*)Settings.pBackendOptions;
+    PROGRAM Program = ( pOptions && pOptions->bShowEdges ) ? PROGRAM_SHOW_EDGES : PROGRAM_BLEND_COLOR;
+    DrawQuad( Program, (GLuint)(uintptr_t)Output.pHandle, Input, Settings.fThreshold, PASS_BLEND_COLOR );
+}
+
+double GLBackend::GetPassTime( PASS Pass ) const
+{
+    if ( m_bQueryPending[Pass] )
+    {
+        GLuint Available = GL_FALSE;
+        glGetQueryObjectuiv( m_Queries[Pass], GL_QUERY_RESULT_AVAILABLE, &Available );
+        if ( Available )
+        {
+            GLuint64 Elapsed = 0;
+            glGetQueryObjectui64v( m_Queries[Pass], GL_QUERY_RESULT, &Elapsed );
+            m_PassTime[Pass] = Elapsed / 1000000.0;
+            m_bQueryPending[Pass] = false;
+        }
+    }
+    return m_PassTime[Pass];
+}
+
+#endif // _WIN32
@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_GL.h
+//
+// OpenGL backend of MLAA::Effect, running the passes of Shaders/MLAA11.glsl as full 
+// screen quads, and an EGL context that needs no window system, e.g. on Mesa llvmpipe.
+// Linux only: the file is empty on Windows, the MLAA11_GL project builds it on Linux.
+// Link with libEGL and libOpenGL.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_GL_H
+#define MLAA_GL_H
+
+#ifndef _WIN32
+
+#include "MLAA_Effect.h"
+
+#include <stdint.h>
+#include <string>
+
+#include <EGL/egl.h>
+#include <GL/glcorearb.h>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // OpenGL 3.3 core context on the surfaceless EGL platform. There is no default 
+    // framebuffer, everything is drawn to framebuffer objects
+    //--------------------------------------------------------------------------------------
+    class GLContext
+    {
+    public:
+
+        GLContext();
+        ~GLContext();
+
+        // Creates the context and makes it current. Returns false if EGL or the display lack
+        // surfaceless contexts or OpenGL 3.3
+        bool Create();
+        void Destroy();
+
+        bool MakeCurrent();
+
+    private:
+
+        EGLDisplay      m_Display;
+        EGLContext      m_Context;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Options of GLBackend, EffectSettings::pBackendOptions
+    //--------------------------------------------------------------------------------------
+    struct GLBackendOptions
+    {
+        bool    bShowEdges;     // Third pass shows the edges found in red instead of blending, like SHOW_EDGES
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Backend running the passes with OpenGL, the calls need the context of the backend to
+    // be current. Surface handles are texture names: GL_RGBA8 textures with the luma in 
+    // alpha for the input and a GL_RGBA8 texture the backend renders to for the output. 
+    // The passes leave blending, depth and scissor tests disabled. Only the short edge
+    // search at full resolution over the whole frame is implemented: DetectEdges returns
+    // false for long searches, half resolution, a quality map, views or a region. Both
+    // detection kernels find the same edges
+    //--------------------------------------------------------------------------------------
+    class GLBackend : public IEffectBackend
+    {
+    public:
+
+        GLBackend();
+        virtual ~GLBackend();
+
+        // Compiles the passes from MLAA11.glsl. Returns false on failure, GetShaderLog() 
+        // then holds the compiler or linker messages
+        bool CreateShaders( const char* pFileName );
+        void ReleaseShaders();
+        const std::string& GetShaderLog() const { return m_ShaderLog; }
+
+        virtual bool CreateIntermediates( const EffectSurface& Input );
+        virtual void ReleaseIntermediates();
+
+        virtual bool DetectEdges( const EffectSurface& Input, const EffectSettings& Settings );
+        virtual void ComputeLineLength( const EffectSurface& Input, const EffectSettings& Settings );
+        virtual void BlendColor( const EffectSurface& Input, const EffectSurface& Output, const EffectSettings& Settings );
+
+        // From GL_TIME_ELAPSED queries. The last frame whose result is available, which
+        // may be an earlier one
+        virtual double GetPassTime( PASS Pass ) const;
+
+        // Intermediates with the layout of g_EdgeMask (GL_R8UI) and g_EdgeCount (GL_RG8UI)
+        GLuint GetEdgeMask() const { return m_EdgeMask; }
+        GLuint GetEdgeCount() const { return m_EdgeCount; }
+
+        static EffectSurface MakeSurface( GLuint Texture, int Width, int Height )
+        {
+            EffectSurface Surface = { (void*)(uintptr_t)Texture, Width, Height, 0 };
+            return Surface;
+        }
+
+    private:
+
+        enum PROGRAM
+        {
+            PROGRAM_SEPERATING_LINES,
+            PROGRAM_COMPUTE_LINE_LENGTH,
+            PROGRAM_BLEND_COLOR,
+            PROGRAM_SHOW_EDGES,
+            PROGRAM_COUNT
+        };
+
+        GLuint CompileProgram( const std::string& Source, const char* pDefines );
+        void DrawQuad( PROGRAM Program, GLuint Target, const EffectSurface& Input, float fThreshold, PASS Pass );
+
+        std::string         m_ShaderLog;
+        GLuint              m_Programs[PROGRAM_COUNT];
+        GLint               m_ParamLocations[PROGRAM_COUNT];
+        GLuint              m_VertexArray;
+        GLuint              m_ScreenQuadVB;
+        GLuint              m_Sampler;          // Point sampling, so inputs without mipmaps are complete
+        GLuint              m_Framebuffer;
+        GLuint              m_Queries[PASS_COUNT];
+
+        GLuint              m_EdgeMask;
+        GLuint              m_EdgeCount;
+        int                 m_nWidth;
+        int                 m_nHeight;
+
+        mutable bool        m_bQueryPending[PASS_COUNT];
+        mutable double      m_PassTime[PASS_COUNT];
+    };
+
+} // namespace MLAA
+
+#endif // _WIN32
+
+#endif // MLAA_GL_H
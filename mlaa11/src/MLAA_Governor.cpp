@@ -0,0 +1,241 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Governor.cpp
+//
+// Frame budget governor, see MLAA_Governor.h
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Governor.h"
+
+#include <assert.h>
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// The ladder, from the application's settings down to skipping MLAA. The costs relative
+// to the first step are starting points, the governor replaces them with measured ones
+//--------------------------------------------------------------------------------------
+struct GovernorStep
+{
+    GovernorSettings    Settings;
+    double              fRelativeCost;
+};
+
+static const GovernorStep kLadder[] =
+{
+    { { 1.0f, kLongMaxEdgeLength, DETECTION_FULL, true  }, 1.00 },
+    { { 1.5f, kLongMaxEdgeLength, DETECTION_FULL, true  }, 0.90 },
+    { { 1.5f, kMaxEdgeLength,     DETECTION_FULL, true  }, 0.80 },
+    { { 2.0f, kMaxEdgeLength,     DETECTION_FULL, true  }, 0.70 },
+    { { 2.0f, kShortEdgeLength,   DETECTION_FULL, true  }, 0.60 },
+    { { 3.0f, kShortEdgeLength,   DETECTION_FULL, true  }, 0.55 },
+    { { 4.0f, kShortEdgeLength,   DETECTION_FULL, true  }, 0.50 },
+    { { 6.0f, kShortEdgeLength,   DETECTION_FULL, true  }, 0.45 },
+    { { 6.0f, kShortEdgeLength,   DETECTION_FULL, false }, 0.00 },
+};
+
+static const double kTargetFraction     = 0.9;      // Of the budget, margin for the noise of the timings
+static const double kRiseFraction       = 0.75;     // Of the target, predicted cost of the step above needed to step up
+static const double kLoadDecay          = 0.1;      // Rate at which the load estimate follows lower costs
+static const double kSkipDecay          = 0.9;      // Load estimate decay per frame while MLAA is skipped
+static const double kCostBlend          = 0.5;      // Weight of a new relative cost measurement
+static const double kMinRelativeCost    = 0.01;
+static const int    kMinRiseDelay       = 30;       // Frames
+static const int    kMaxRiseDelay       = 960;
+
+//--------------------------------------------------------------------------------------
+// Constructor
+//--------------------------------------------------------------------------------------
+BudgetGovernor::BudgetGovernor() :
+    m_fBudgetMs( 0.0 ),
+    m_nLatency( 0 ),
+    m_bAllowSkip( false )
+{
+    static_assert( sizeof( kLadder ) / sizeof( kLadder[0] ) == kStepCount, "kStepCount must match the ladder" );
+    Reset();
+}
+
+//--------------------------------------------------------------------------------------
+// Settings
+//--------------------------------------------------------------------------------------
+void BudgetGovernor::SetBudget( double fBudgetMs )
+{
+    m_fBudgetMs = fBudgetMs;
+    if ( m_fBudgetMs <= 0.0 )
+        m_nStep = 0;
+}
+
+void BudgetGovernor::SetMeasurementLatency( int nFrames )
+{
+    m_nLatency = ( nFrames < 0 ) ? 0 : ( nFrames > kMaxLatency ? kMaxLatency : nFrames );
+}
+
+void BudgetGovernor::SetAllowSkip( bool bAllowSkip )
+{
+    m_bAllowSkip = bAllowSkip;
+    if ( m_nStep > GetLastStep() )
+        m_nStep = GetLastStep();
+}
+
+void BudgetGovernor::Reset()
+{
+    m_nStep = 0;
+    for ( int i = 0; i <= kMaxLatency; i++ )
+        m_History[i] = 0;
+    m_nFrame = 0;
+
+    for ( int i = 0; i < kStepCount; i++ )
+        m_RelativeCost[i] = kLadder[i].fRelativeCost;
+    m_fLoadMs = 0.0;
+    m_nLastMeasuredStep = -1;
+    m_fLastMeasuredMs = 0.0;
+
+    m_nHeadroomFrames = 0;
+    m_nRiseDelay = kMinRiseDelay;
+    m_nSinceRise = -1;
+    m_nOverBudget = 0;
+}
+
+const GovernorSettings& BudgetGovernor::GetSettings() const
+{
+    return kLadder[m_nStep].Settings;
+}
+
+int BudgetGovernor::GetStepCount() const
+{
+    return GetLastStep() + 1;
+}
+
+int BudgetGovernor::GetLastStep() const
+{
+    return m_bAllowSkip ? kStepCount - 1 : kStepCount - 2;
+}
+
+//--------------------------------------------------------------------------------------
+// First step predicted to fit in fTargetMs at the current load, the last step if none does
+//--------------------------------------------------------------------------------------
+int BudgetGovernor::FindStep( double fTargetMs ) const
+{
+    int nLast = GetLastStep();
+    for ( int i = 0; i < nLast; i++ )
+    {
+        if ( m_fLoadMs * m_RelativeCost[i] <= fTargetMs )
+            return i;
+    }
+    return nLast;
+}
+
+//--------------------------------------------------------------------------------------
+// The time measured is that of the step used m_nLatency frames ago. It gives the load, the
+// cost the first step would have had, and when the step differs from the one measured 
+// the frame before, the ratio of the costs of the two steps
+//--------------------------------------------------------------------------------------
+void BudgetGovernor::Update( double fTimeMs )
+{
+    const int nHistory = kMaxLatency + 1;
+    m_History[m_nFrame % nHistory] = m_nStep;
+    int nMeasured = ( m_nFrame >= m_nLatency ) ? m_History[( m_nFrame - m_nLatency ) % nHistory] : -1;
+    m_nFrame++;
+
+    if ( m_fBudgetMs <= 0.0 || nMeasured < 0 )
+        return;
+
+    if ( !kLadder[nMeasured].Settings.bEnabled )
+    {
+        // Nothing ran, so nothing was learnt. Let the load estimate decay until the step
+        // above looks affordable and gets tried
+        m_fLoadMs *= kSkipDecay;
+        m_nLastMeasuredStep = -1;
+    }
+    else
+    {
+        if ( fTimeMs > m_fBudgetMs )
+            m_nOverBudget++;
+
+        if ( m_nLastMeasuredStep >= 0 && m_nLastMeasuredStep != nMeasured && m_fLastMeasuredMs > 0.0 && fTimeMs > 0.0 )
+        {
+            double fRatio = fTimeMs / m_fLastMeasuredMs;
+            if ( nMeasured > 0 )
+            {
+                double fCost = m_RelativeCost[m_nLastMeasuredStep] * fRatio;
+                m_RelativeCost[nMeasured] += kCostBlend * ( fCost - m_RelativeCost[nMeasured] );
+            }
+            else
+            {
+                // The first step is the reference, the ratio applies to the other one
+                double fCost = m_RelativeCost[0] / fRatio;
+                m_RelativeCost[m_nLastMeasuredStep] += kCostBlend * ( fCost - m_RelativeCost[m_nLastMeasuredStep] );
+            }
+
+            // Each step costs no more than the one before
+            for ( int i = 1; i < kStepCount - 1; i++ )
+            {
+                if ( m_RelativeCost[i] > m_RelativeCost[i - 1] )
+                    m_RelativeCost[i] = m_RelativeCost[i - 1];
+                if ( m_RelativeCost[i] < kMinRelativeCost )
+                    m_RelativeCost[i] = kMinRelativeCost;
+            }
+        }
+        m_nLastMeasuredStep = nMeasured;
+        m_fLastMeasuredMs = fTimeMs;
+
+        // A heavier load is followed at once, a lighter one gradually
+        double fLoadMs = fTimeMs / m_RelativeCost[nMeasured];
+        m_fLoadMs = ( fLoadMs > m_fLoadMs ) ? fLoadMs : m_fLoadMs + kLoadDecay * ( fLoadMs - m_fLoadMs );
+    }
+
+    double fTargetMs = m_fBudgetMs * kTargetFraction;
+    int nNeeded = FindStep( fTargetMs );
+    if ( nNeeded > m_nStep )
+    {
+        // A step up that did not hold makes the next one wait longer
+        if ( m_nSinceRise >= 0 )
+            m_nRiseDelay = ( 2 * m_nRiseDelay < kMaxRiseDelay ) ? 2 * m_nRiseDelay : kMaxRiseDelay;
+        m_nSinceRise = -1;
+        m_nHeadroomFrames = 0;
+        m_nStep = nNeeded;
+        return;
+    }
+
+    if ( m_nSinceRise >= 0 && ++m_nSinceRise > m_nRiseDelay + m_nLatency )
+    {
+        m_nRiseDelay = ( m_nRiseDelay / 2 > kMinRiseDelay ) ? m_nRiseDelay / 2 : kMinRiseDelay;
+        m_nSinceRise = -1;
+    }
+
+    if ( m_nStep > 0 && m_fLoadMs * m_RelativeCost[m_nStep - 1] <= fTargetMs * kRiseFraction )
+    {
+        if ( ++m_nHeadroomFrames >= m_nRiseDelay + m_nLatency )
+        {
+            m_nStep--;
+            m_nHeadroomFrames = 0;
+            m_nSinceRise = 0;
+        }
+    }
+    else
+    {
+        m_nHeadroomFrames = 0;
+    }
+}
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Governor.h
+//
+// Keeps the cost of MLAA under a time budget per frame. The governor steps along a ladder
+// of settings, each cheaper than the one before: a higher edge threshold and shorter edge
+// searches. It is fed the measured time of the passes once per frame, from either a CPU
+// clock or GPU timestamp queries, and picks the settings of the next frame.
+//
+// Over budget frames move down the ladder at once, as far as the measured cost requires.
+// Moving back up takes a run of frames with headroom, and a step up that has to be undone
+// makes the next one wait twice as long, so the settings don't oscillate.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_GOVERNOR_H
+#define MLAA_GOVERNOR_H
+
+#include "MLAA_CPU.h"
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Settings of a step of the ladder, applied on top of the application's settings
+    //--------------------------------------------------------------------------------------
+    struct GovernorSettings
+    {
+        float                   fThresholdScale;    // Multiplies the edge threshold
+        unsigned int            MaxEdgeLength;      // kLongMaxEdgeLength, kMaxEdgeLength or kShortEdgeLength
+        DETECTION_RESOLUTION    DetectionResolution;
+        bool                    bEnabled;           // false skips MLAA for the frame
+    };
+
+    class BudgetGovernor
+    {
+    public:
+
+        BudgetGovernor();
+
+        // Time allowed for the three passes, in milliseconds. Zero or less keeps the first
+        // step, i.e. the application's settings
+        void SetBudget( double fBudgetMs );
+        double GetBudget() const { return m_fBudgetMs; }
+
+        // Frames between the frame settings are used for and the frame its time is passed to
+        // Update(). Zero for a synchronous CPU clock, GPU timestamps are read a few frames late
+        void SetMeasurementLatency( int nFrames );
+        int GetMeasurementLatency() const { return m_nLatency; }
+
+        // Lets the last step skip MLAA, which is the only way to stay under any budget
+        void SetAllowSkip( bool bAllowSkip );
+
+        // Back to the first step, forgets what was measured. For a change of timing source
+        void Reset();
+
+        // Call once per frame after the passes have run, with the time reported for them
+        void Update( double fTimeMs );
+
+        // Settings for the next frame
+        const GovernorSettings& GetSettings() const;
+        int GetStep() const { return m_nStep; }
+        int GetStepCount() const;
+
+        // Measured frames that went over the budget since the last Reset()
+        int GetOverBudgetCount() const { return m_nOverBudget; }
+
+    private:
+
+        static const int    kMaxLatency = 8;
+        static const int    kStepCount  = 9;
+
+        int GetLastStep() const;
+        int FindStep( double fTargetMs ) const;
+
+    private:
+
+        double          m_fBudgetMs;
+        int             m_nLatency;
+        bool            m_bAllowSkip;
+
+        int             m_nStep;
+        int             m_History[kMaxLatency + 1];     // Step used by the last frames, ring indexed by m_nFrame
+        int             m_nFrame;
+
+        // Cost of each step relative to the first, learnt when the step changes, and the
+        // measured cost of the first step that the current load amounts to
+        double          m_RelativeCost[kStepCount];
+        double          m_fLoadMs;
+        int             m_nLastMeasuredStep;            // -1 until a frame has been measured
+        double          m_fLastMeasuredMs;
+
+        int             m_nHeadroomFrames;              // Consecutive frames with room for the step above
+        int             m_nRiseDelay;                   // Headroom frames needed to step up
+        int             m_nSinceRise;                   // Frames since the last step up, -1 once it has held
+        int             m_nOverBudget;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_GOVERNOR_H
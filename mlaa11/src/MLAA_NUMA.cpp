@@ -0,0 +1,470 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_NUMA.cpp
+//
+// Every job is run by all the workers at once and Apply waits for them: the halo copy
+// completes on every node before any band is processed, as a thread reads the halo its
+// node's copy wrote. The bands of Src are only read by the passes, so the nodes don't
+// wait for each other otherwise.
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_NUMA.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Topology. Windows reports the processors of a node as an affinity mask within a
+// processor group, Linux as a list in sysfs such as "0-31,64-95"
+//--------------------------------------------------------------------------------------
+#if defined(__linux__)
+static bool ReadProcessorList( const char* pPath, std::vector<int>& Processors )
+{
+    Processors.clear();
+
+    FILE* pFile = fopen( pPath, "r" );
+    if ( !pFile )
+        return false;
+
+    char Line[4096];
+    bool bRead = ( fgets( Line, sizeof(Line), pFile ) != NULL );
+    fclose( pFile );
+    if ( !bRead )
+        return false;
+
+    const char* p = Line;
+    while ( *p >= '0' && *p <= '9' )
+    {
+        char* pEnd;
+        int First = (int)strtol( p, &pEnd, 10 );
+        int Last = First;
+        if ( *pEnd == '-' )
+            Last = (int)strtol( pEnd + 1, &pEnd, 10 );
+
+        for ( int i = First; i <= Last; i++ )
+            Processors.push_back( i );
+
+        p = ( *pEnd == ',' ) ? pEnd + 1 : pEnd;
+    }
+    return true;
+}
+
+static bool GetNodeProcessors( int Node, std::vector<int>& Processors )
+{
+    char Path[64];
+    snprintf( Path, sizeof(Path), "/sys/devices/system/node/node%d/cpulist", Node );
+    return ReadProcessorList( Path, Processors ) && !Processors.empty();
+}
+#endif
+
+void MLAA::GetNUMANodes( std::vector<NUMANodeInfo>& Nodes )
+{
+    Nodes.clear();
+
+#if defined(_WIN32)
+    ULONG HighestNode = 0;
+    if ( GetNumaHighestNodeNumber( &HighestNode ) )
+    {
+        for ( USHORT Node = 0; Node <= HighestNode; Node++ )
+        {
+            GROUP_AFFINITY Affinity;
+            if ( !GetNumaNodeProcessorMaskEx( Node, &Affinity ) )
+                continue;
+
+            int nProcessors = 0;
+            for ( KAFFINITY Mask = Affinity.Mask; Mask; Mask &= Mask - 1 )
+                nProcessors++;
+
+            if ( nProcessors > 0 )
+            {
+                NUMANodeInfo Info = { (int)Node, nProcessors };
+                Nodes.push_back( Info );
+            }
+        }
+    }
+#elif defined(__linux__)
+    std::vector<int> Online;
+    ReadProcessorList( "/sys/devices/system/node/online", Online );
+    for ( size_t i = 0; i < Online.size(); i++ )
+    {
+        std::vector<int> Processors;
+        if ( GetNodeProcessors( Online[i], Processors ) )
+        {
+            NUMANodeInfo Info = { Online[i], (int)Processors.size() };
+            Nodes.push_back( Info );
+        }
+    }
+#endif
+
+    if ( Nodes.empty() )
+    {
+        int nProcessors = (int)std::thread::hardware_concurrency();
+        NUMANodeInfo Info = { 0, nProcessors > 0 ? nProcessors : 1 };
+        Nodes.push_back( Info );
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Restricts the calling thread to the processors of a node, the OS then also allocates
+// the pages it touches first on that node
+//--------------------------------------------------------------------------------------
+static bool PinThreadToNode( int Node )
+{
+#if defined(_WIN32)
+    GROUP_AFFINITY Affinity;
+    if ( !GetNumaNodeProcessorMaskEx( (USHORT)Node, &Affinity ) || !Affinity.Mask )
+        return false;
+    return SetThreadGroupAffinity( GetCurrentThread(), &Affinity, NULL ) != 0;
+#elif defined(__linux__)
+    std::vector<int> Processors;
+    if ( !GetNodeProcessors( Node, Processors ) )
+        return false;
+
+    cpu_set_t Set;
+    CPU_ZERO( &Set );
+    for ( size_t i = 0; i < Processors.size(); i++ )
+    {
+        if ( Processors[i] < CPU_SETSIZE )
+            CPU_SET( Processors[i], &Set );
+    }
+    return sched_setaffinity( 0, sizeof(Set), &Set ) == 0;
+#else
+    (void)Node;
+    return false;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// NUMAFrame
+//--------------------------------------------------------------------------------------
+NUMAFrame::NUMAFrame() :
+    m_nWidth( 0 ),
+    m_nHeight( 0 ),
+    m_nHalo( 0 )
+{
+}
+
+Surface NUMAFrame::GetBand( int n ) const
+{
+    const Band& B = m_Bands[n];
+    Surface Owned = { NULL, m_nWidth, B.Bottom - B.Top, m_nWidth * 4 };
+    if ( B.Top < B.Bottom )
+        Owned.pData = const_cast<uint8_t*>( &B.Storage[0] ) + (size_t)( B.Top - B.StorageTop ) * Owned.Pitch;
+    return Owned;
+}
+
+Surface NUMAFrame::GetStorage( int n ) const
+{
+    const Band& B = m_Bands[n];
+    Surface Stored = { NULL, m_nWidth, B.StorageBottom - B.StorageTop, m_nWidth * 4 };
+    if ( !B.Storage.empty() )
+        Stored.pData = const_cast<uint8_t*>( &B.Storage[0] );
+    return Stored;
+}
+
+uint8_t* NUMAFrame::GetRow( int y ) const
+{
+    assert( y >= 0 && y < m_nHeight );
+
+    for ( size_t n = 0; n < m_Bands.size(); n++ )
+    {
+        const Band& B = m_Bands[n];
+        if ( y >= B.Top && y < B.Bottom )
+            return const_cast<uint8_t*>( &B.Storage[0] ) + (size_t)( y - B.StorageTop ) * m_nWidth * 4;
+    }
+    return NULL;
+}
+
+void NUMAFrame::CopyFrom( const Surface& Src )
+{
+    assert( Src.Width == m_nWidth && Src.Height == m_nHeight );
+
+    for ( int y = 0; y < m_nHeight; y++ )
+        memcpy( GetRow( y ), Src.pData + (size_t)y * Src.Pitch, (size_t)m_nWidth * 4 );
+}
+
+void NUMAFrame::CopyTo( const Surface& Dst ) const
+{
+    assert( Dst.Width == m_nWidth && Dst.Height == m_nHeight );
+
+    for ( int y = 0; y < m_nHeight; y++ )
+        memcpy( Dst.pData + (size_t)y * Dst.Pitch, GetRow( y ), (size_t)m_nWidth * 4 );
+}
+
+void NUMAFrame::Release()
+{
+    m_nWidth = 0;
+    m_nHeight = 0;
+    m_nHalo = 0;
+    m_Bands.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+NUMAEngine::NUMAEngine( bool bNodeLocal, int nThreadsPerNode ) :
+    m_bNodeLocal( bNodeLocal ),
+    m_Job( JOB_APPLY ),
+    m_nGeneration( 0 ),
+    m_nPending( 0 ),
+    m_bQuit( false ),
+    m_pSrc( NULL ),
+    m_pDst( NULL ),
+    m_fHaloTime( 0.0 )
+{
+    for ( int i = 0; i < PASS_COUNT; i++ )
+        m_PassTime[i] = 0.0;
+
+    GetNUMANodes( m_Nodes );
+
+    for ( int n = 0; n < (int)m_Nodes.size(); n++ )
+    {
+        int nThreads = ( nThreadsPerNode > 0 ) ? nThreadsPerNode : m_Nodes[n].nProcessors;
+        m_NodeThreads.push_back( nThreads );
+
+        for ( int i = 0; i < nThreads; i++ )
+        {
+            std::unique_ptr<Worker> pWorker( new Worker );
+            pWorker->nNode = n;
+            pWorker->nNodeThread = i;
+            pWorker->nNodeThreads = nThreads;
+            pWorker->pEngine.reset( new CPUEngine );
+            m_Workers.push_back( std::move( pWorker ) );
+        }
+    }
+
+    for ( int i = 0; i < (int)m_Workers.size(); i++ )
+        m_Workers[i]->Thread = std::thread( &NUMAEngine::WorkerMain, this, i );
+}
+
+NUMAEngine::~NUMAEngine()
+{
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_bQuit = true;
+    }
+    m_JobReady.notify_all();
+
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+        m_Workers[i]->Thread.join();
+}
+
+//--------------------------------------------------------------------------------------
+// Settings, Apply only returns once the workers are idle so the engines can be changed
+// from the calling thread
+//--------------------------------------------------------------------------------------
+void NUMAEngine::SetThreshold( float fThreshold )
+{
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+        m_Workers[i]->pEngine->SetThreshold( fThreshold );
+}
+
+void NUMAEngine::SetEdgeSearch( EDGE_SEARCH Search )
+{
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+        m_Workers[i]->pEngine->SetEdgeSearch( Search );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Band n gets the rows after those of the bands before it, in proportion to the threads
+// of node n. The halo is what CPUEngine::Apply with a region reads around it
+//--------------------------------------------------------------------------------------
+void NUMAEngine::CreateFrame( int Width, int Height, NUMAFrame& Frame )
+{
+    assert( Width > 0 && Height > 0 );
+
+    Frame.Release();
+    Frame.m_nWidth = Width;
+    Frame.m_nHeight = Height;
+    Frame.m_nHalo = m_Workers[0]->pEngine->GetRegionHalo();
+    Frame.m_Bands.resize( m_Nodes.size() );
+
+    const int nThreads = (int)m_Workers.size();
+    int nThreadsBefore = 0;
+
+    for ( int n = 0; n < (int)m_Nodes.size(); n++ )
+    {
+        NUMAFrame::Band& B = Frame.m_Bands[n];
+        B.Top = (int)( (int64_t)Height * nThreadsBefore / nThreads );
+        nThreadsBefore += m_NodeThreads[n];
+        B.Bottom = (int)( (int64_t)Height * nThreadsBefore / nThreads );
+        B.StorageTop = ( B.Top > Frame.m_nHalo ) ? B.Top - Frame.m_nHalo : 0;
+        B.StorageBottom = ( B.Bottom + Frame.m_nHalo < Height ) ? B.Bottom + Frame.m_nHalo : Height;
+    }
+
+    if ( m_bNodeLocal )
+    {
+        m_pDst = &Frame;
+        Dispatch( JOB_ALLOCATE );
+        m_pDst = NULL;
+    }
+    else
+    {
+        for ( int n = 0; n < (int)m_Nodes.size(); n++ )
+            AllocateBand( Frame, n );
+    }
+}
+
+void NUMAEngine::AllocateBand( NUMAFrame& Frame, int nBand )
+{
+    NUMAFrame::Band& B = Frame.m_Bands[nBand];
+    if ( B.Top < B.Bottom )
+        B.Storage.assign( (size_t)( B.StorageBottom - B.StorageTop ) * Frame.m_nWidth * 4, 0 );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Runs the passes on every band
+//--------------------------------------------------------------------------------------
+void NUMAEngine::Apply( NUMAFrame& Src, NUMAFrame& Dst )
+{
+    assert( Src.m_nWidth == Dst.m_nWidth && Src.m_nHeight == Dst.m_nHeight );
+    assert( Src.m_Bands.size() == m_Nodes.size() && Dst.m_Bands.size() == m_Nodes.size() );
+    assert( Src.m_nHalo >= m_Workers[0]->pEngine->GetRegionHalo() );
+
+    m_pSrc = &Src;
+    m_pDst = &Dst;
+
+    double StartTime = GetTimeMs();
+    Dispatch( JOB_COPY_HALO );
+    m_fHaloTime = GetTimeMs() - StartTime;
+
+    Dispatch( JOB_APPLY );
+
+    for ( int p = 0; p < PASS_COUNT; p++ )
+    {
+        m_PassTime[p] = 0.0;
+        for ( size_t i = 0; i < m_Workers.size(); i++ )
+        {
+            double fTime = m_Workers[i]->pEngine->GetPassTime( (PASS)p );
+            m_PassTime[p] = ( fTime > m_PassTime[p] ) ? fTime : m_PassTime[p];
+        }
+    }
+
+    m_pSrc = NULL;
+    m_pDst = NULL;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Workers
+//--------------------------------------------------------------------------------------
+void NUMAEngine::Dispatch( JOB Job )
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+    m_Job = Job;
+    m_nPending = (int)m_Workers.size();
+    m_nGeneration++;
+    m_JobReady.notify_all();
+
+    m_JobDone.wait( Lock, [this] { return m_nPending == 0; } );
+}
+
+void NUMAEngine::WorkerMain( int nWorker )
+{
+    Worker& W = *m_Workers[nWorker];
+    if ( m_bNodeLocal )
+        PinThreadToNode( m_Nodes[W.nNode].Node );
+
+    uint64_t nGeneration = 0;
+
+    for ( ;; )
+    {
+        JOB Job;
+        {
+            std::unique_lock<std::mutex> Lock( m_Lock );
+            m_JobReady.wait( Lock, [&] { return m_bQuit || m_nGeneration != nGeneration; } );
+            if ( m_bQuit )
+                return;
+
+            nGeneration = m_nGeneration;
+            Job = m_Job;
+        }
+
+        RunJob( W, Job );
+
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        if ( --m_nPending == 0 )
+            m_JobDone.notify_all();
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// The first thread of a node allocates and fills the halo of its band. For the passes the
+// threads split the owned rows of the band evenly, each runs CPUEngine::Apply on them with
+// the stored rows as the image, which only reads rows within the halo
+//--------------------------------------------------------------------------------------
+void NUMAEngine::RunJob( Worker& W, JOB Job )
+{
+    if ( Job == JOB_ALLOCATE )
+    {
+        if ( W.nNodeThread == 0 )
+            AllocateBand( *m_pDst, W.nNode );
+        return;
+    }
+
+    NUMAFrame& Src = *m_pSrc;
+    NUMAFrame& Dst = *m_pDst;
+    const NUMAFrame::Band& B = Src.m_Bands[W.nNode];
+    if ( B.Top == B.Bottom )
+        return;
+
+    if ( Job == JOB_COPY_HALO )
+    {
+        if ( W.nNodeThread != 0 )
+            return;
+
+        Surface Stored = Src.GetStorage( W.nNode );
+        for ( int y = B.StorageTop; y < B.StorageBottom; y++ )
+        {
+            if ( y < B.Top || y >= B.Bottom )
+                memcpy( Stored.pData + (size_t)( y - B.StorageTop ) * Stored.Pitch, Src.GetRow( y ), (size_t)Stored.Pitch );
+        }
+        return;
+    }
+
+    const int nRows = B.Bottom - B.Top;
+    Rect Region;
+    Region.Left = 0;
+    Region.Right = Src.m_nWidth;
+    Region.Top = B.Top - B.StorageTop + (int)( (int64_t)nRows * W.nNodeThread / W.nNodeThreads );
+    Region.Bottom = B.Top - B.StorageTop + (int)( (int64_t)nRows * ( W.nNodeThread + 1 ) / W.nNodeThreads );
+    if ( Region.Top == Region.Bottom )
+        return;
+
+    W.pEngine->Apply( Src.GetStorage( W.nNode ), Dst.GetStorage( W.nNode ), Region );
+}
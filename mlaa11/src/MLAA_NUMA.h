@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_NUMA.h
+//
+// MLAA on very large images on hosts with several NUMA nodes. The image is split into one
+// horizontal band per node. Each band is stored in the memory of its node, together with
+// the halo rows the passes need from the bands next to it. The threads of a node are
+// pinned to its processors and run CPUEngine::Apply on parts of the band, so the color,
+// the edge mask and the edge counts of a node stay in local memory. The halo rows are the
+// only data that crosses nodes, copied once per frame before the passes run.
+//
+// Memory is placed by first touch: a band and the intermediates of a thread are allocated
+// and cleared by a thread pinned to the node, which is the default policy of Windows and
+// Linux and needs no NUMA library.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_NUMA_H
+#define MLAA_NUMA_H
+
+#include "MLAA_CPU.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // A NUMA node that has processors
+    //--------------------------------------------------------------------------------------
+    struct NUMANodeInfo
+    {
+        int         Node;               // Number of the node for the OS
+        int         nProcessors;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // The nodes of the host, in order. A single node with every processor where the OS
+    // reports no NUMA topology
+    //--------------------------------------------------------------------------------------
+    void GetNUMANodes( std::vector<NUMANodeInfo>& Nodes );
+
+    //--------------------------------------------------------------------------------------
+    // A 32 bit image with luma in alpha, stored as horizontal bands that each also hold
+    // halo rows above and below them. Created by NUMAEngine::CreateFrame
+    //--------------------------------------------------------------------------------------
+    class NUMAFrame
+    {
+    public:
+
+        NUMAFrame();
+
+        int GetWidth() const { return m_nWidth; }
+        int GetHeight() const { return m_nHeight; }
+        int GetHalo() const { return m_nHalo; }
+        int GetBandCount() const { return (int)m_Bands.size(); }
+
+        // The rows band n owns, without the halo. A band can be empty on small images
+        Surface GetBand( int n ) const;
+        int GetBandTop( int n ) const { return m_Bands[n].Top; }
+
+        // Row y of the image in the band that owns it
+        uint8_t* GetRow( int y ) const;
+
+        // Copy a whole image in or out. Src and Dst must be the size of the frame
+        void CopyFrom( const Surface& Src );
+        void CopyTo( const Surface& Dst ) const;
+
+        // Frees the bands
+        void Release();
+
+    private:
+
+        friend class NUMAEngine;
+
+        struct Band
+        {
+            int                     Top;            // Rows owned, Bottom is exclusive
+            int                     Bottom;
+            int                     StorageTop;     // Rows stored, the owned rows plus the halo
+            int                     StorageBottom;
+            std::vector<uint8_t>    Storage;
+        };
+
+        // The stored rows of band n, as a surface
+        Surface GetStorage( int n ) const;
+
+        int                         m_nWidth;
+        int                         m_nHeight;
+        int                         m_nHalo;
+        std::vector<Band>           m_Bands;
+    };
+
+    class NUMAEngine
+    {
+    public:
+
+        // nThreadsPerNode = 0 uses every processor of a node. With bNodeLocal false the
+        // threads are not pinned and frames are allocated by the calling thread, which puts
+        // the whole image on its node as an ordinary allocation would. That is the baseline
+        // node locality is measured against, the results are the same
+        NUMAEngine( bool bNodeLocal = true, int nThreadsPerNode = 0 );
+        ~NUMAEngine();
+
+        // Settings of the engine of every thread. The halo of a frame depends on the edge
+        // search, so frames must be created after it is set
+        void SetThreshold( float fThreshold );
+        void SetEdgeSearch( EDGE_SEARCH Search );
+
+        // Creates a frame with one band per node. The rows are shared out in proportion to
+        // the threads of the nodes and each band is allocated on its node
+        void CreateFrame( int Width, int Height, NUMAFrame& Frame );
+
+        // Copies the halo rows of Src from the bands next to them, then runs the three passes
+        // on every band. Src and Dst must have been created by this engine with the same size
+        // and the current settings. The output matches CPUEngine::Apply on the whole image
+        void Apply( NUMAFrame& Src, NUMAFrame& Dst );
+
+        int GetNodeCount() const { return (int)m_Nodes.size(); }
+        int GetThreadCount() const { return (int)m_Workers.size(); }
+        bool IsNodeLocal() const { return m_bNodeLocal; }
+
+        // Times of the last Apply in milliseconds: the halo copy, and for each pass the
+        // slowest thread
+        double GetHaloTime() const { return m_fHaloTime; }
+        double GetPassTime( PASS Pass ) const { return m_PassTime[Pass]; }
+
+    private:
+
+        enum JOB
+        {
+            JOB_ALLOCATE,
+            JOB_COPY_HALO,
+            JOB_APPLY
+        };
+
+        struct Worker
+        {
+            int                         nNode;          // Index in m_Nodes
+            int                         nNodeThread;    // Index among the threads of the node
+            int                         nNodeThreads;
+            std::unique_ptr<CPUEngine>  pEngine;
+            std::thread                 Thread;
+        };
+
+        void WorkerMain( int nWorker );
+        void RunJob( Worker& W, JOB Job );
+        void Dispatch( JOB Job );
+        void AllocateBand( NUMAFrame& Frame, int nBand );
+
+    private:
+
+        bool                                    m_bNodeLocal;
+        std::vector<NUMANodeInfo>               m_Nodes;
+        std::vector<int>                        m_NodeThreads;
+        std::vector< std::unique_ptr<Worker> >  m_Workers;
+
+        // Job in progress, the workers wait for m_nGeneration to change
+        std::mutex                              m_Lock;
+        std::condition_variable                 m_JobReady;
+        std::condition_variable                 m_JobDone;
+        JOB                                     m_Job;
+        uint64_t                                m_nGeneration;
+        int                                     m_nPending;
+        bool                                    m_bQuit;
+        NUMAFrame*                              m_pSrc;
+        NUMAFrame*                              m_pDst;
+
+        double                                  m_fHaloTime;
+        double                                  m_PassTime[PASS_COUNT];
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_NUMA_H
@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Scratch.cpp
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Scratch.h"
+
+#include <assert.h>
+#include <string.h>
+#include <new>
+
+using namespace MLAA;
+
+static const size_t kCacheLine = 64;
+static const size_t kMinBlockSize = 64 * 1024;
+
+static inline size_t AlignUp( size_t n, size_t Alignment )
+{
+    return ( n + Alignment - 1 ) & ~( Alignment - 1 );
+}
+
+//--------------------------------------------------------------------------------------
+// ScratchArena. The data of a block starts at the first cache line after its header
+//--------------------------------------------------------------------------------------
+ScratchArena::ScratchArena() :
+    m_pBlocks( NULL ),
+    m_nUsed( 0 ),
+    m_nCapacity( 0 ),
+    m_nHighWater( 0 ),
+    m_nHeapAllocations( 0 )
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    Release();
+}
+
+void ScratchArena::AddBlock( size_t nSize )
+{
+    Block* pBlock = (Block*)::operator new( sizeof(Block) + kCacheLine + nSize );
+    pBlock->pNext = m_pBlocks;
+    pBlock->nSize = nSize;
+    pBlock->nUsed = 0;
+    m_pBlocks = pBlock;
+    m_nCapacity += nSize;
+    m_nHeapAllocations++;
+}
+
+//--------------------------------------------------------------------------------------
+// A new block is at least as large as all the others together, so the number of blocks
+// grows with the log of the memory in use
+//--------------------------------------------------------------------------------------
+void* ScratchArena::Allocate( size_t nBytes )
+{
+    nBytes = AlignUp( nBytes > 0 ? nBytes : 1, kCacheLine );
+
+    if ( !m_pBlocks || m_pBlocks->nUsed + nBytes > m_pBlocks->nSize )
+    {
+        size_t nSize = ( nBytes > m_nCapacity ) ? nBytes : m_nCapacity;
+        AddBlock( AlignUp( nSize > kMinBlockSize ? nSize : kMinBlockSize, kCacheLine ) );
+    }
+
+    uint8_t* pData = (uint8_t*)AlignUp( (uintptr_t)( m_pBlocks + 1 ), kCacheLine ) + m_pBlocks->nUsed;
+    m_pBlocks->nUsed += nBytes;
+    m_nUsed += nBytes;
+    m_nHighWater = ( m_nUsed > m_nHighWater ) ? m_nUsed : m_nHighWater;
+    return pData;
+}
+
+void ScratchArena::Reset()
+{
+    if ( m_pBlocks && m_pBlocks->pNext )
+    {
+        size_t nHighWater = m_nHighWater;
+        Release();
+        AddBlock( nHighWater );
+        m_nHighWater = nHighWater;
+    }
+    else if ( m_pBlocks )
+    {
+        m_pBlocks->nUsed = 0;
+    }
+    m_nUsed = 0;
+}
+
+void ScratchArena::Release()
+{
+    while ( m_pBlocks )
+    {
+        Block* pNext = m_pBlocks->pNext;
+        ::operator delete( m_pBlocks );
+        m_pBlocks = pNext;
+    }
+    m_nUsed = 0;
+    m_nCapacity = 0;
+    m_nHighWater = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// ScratchCache
+//--------------------------------------------------------------------------------------
+ScratchCache::ScratchCache( int nMaxEntries ) :
+    m_nMaxEntries( nMaxEntries > 1 ? nMaxEntries : 1 ),
+    m_nUseCount( 0 ),
+    m_nHighWater( 0 ),
+    m_nFreedAllocations( 0 )
+{
+}
+
+void ScratchCache::SetMaxEntries( int nMaxEntries )
+{
+    m_nMaxEntries = ( nMaxEntries > 1 ) ? nMaxEntries : 1;
+
+    while ( (int)m_Entries.size() > m_nMaxEntries )
+    {
+        size_t nOldest = 0;
+        for ( size_t i = 1; i < m_Entries.size(); i++ )
+        {
+            if ( m_Entries[i]->LastUse < m_Entries[nOldest]->LastUse )
+                nOldest = i;
+        }
+        Free( nOldest );
+    }
+}
+
+ScratchCache::Entry& ScratchCache::Acquire( int Width, int Height )
+{
+    m_nUseCount++;
+
+    size_t nOldest = 0;
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+    {
+        Entry& E = *m_Entries[i];
+        if ( E.Width == Width && E.Height == Height )
+        {
+            E.LastUse = m_nUseCount;
+            return E;
+        }
+        if ( E.LastUse < m_Entries[nOldest]->LastUse )
+            nOldest = i;
+    }
+
+    Entry* pEntry;
+    if ( (int)m_Entries.size() < m_nMaxEntries )
+    {
+        m_Entries.push_back( std::unique_ptr<Entry>( new Entry ) );
+        pEntry = m_Entries.back().get();
+    }
+    else
+    {
+        pEntry = m_Entries[nOldest].get();
+        pEntry->Arena.Reset();
+    }
+
+    pEntry->Width = Width;
+    pEntry->Height = Height;
+    pEntry->LastUse = m_nUseCount;
+    memset( pEntry->Slots, 0, sizeof( pEntry->Slots ) );
+    return *pEntry;
+}
+
+void* ScratchCache::GetSlot( Entry& E, int nSlot, size_t nBytes )
+{
+    assert( nSlot >= 0 && nSlot < kMaxSlots );
+
+    Slot& S = E.Slots[nSlot];
+    if ( !S.pData || S.nBytes < nBytes )
+    {
+        S.pData = E.Arena.Allocate( nBytes );
+        S.nBytes = nBytes;
+        memset( S.pData, 0, nBytes );
+
+        size_t nBytesHeld = GetBytes();
+        m_nHighWater = ( nBytesHeld > m_nHighWater ) ? nBytesHeld : m_nHighWater;
+    }
+    return S.pData;
+}
+
+void ScratchCache::Trim()
+{
+    size_t nNewest = 0;
+    for ( size_t i = 1; i < m_Entries.size(); i++ )
+    {
+        if ( m_Entries[i]->LastUse > m_Entries[nNewest]->LastUse )
+            nNewest = i;
+    }
+    for ( size_t i = m_Entries.size(); i-- > 0; )
+    {
+        if ( i != nNewest )
+            Free( i );
+    }
+    m_nHighWater = GetBytes();
+}
+
+void ScratchCache::Release()
+{
+    while ( !m_Entries.empty() )
+        Free( m_Entries.size() - 1 );
+    m_nHighWater = 0;
+}
+
+void ScratchCache::Free( size_t nEntry )
+{
+    m_nFreedAllocations += m_Entries[nEntry]->Arena.GetHeapAllocations();
+    m_Entries.erase( m_Entries.begin() + nEntry );
+}
+
+size_t ScratchCache::GetBytes() const
+{
+    size_t nBytes = 0;
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+        nBytes += m_Entries[i]->Arena.GetCapacity();
+    return nBytes;
+}
+
+uint64_t ScratchCache::GetHeapAllocations() const
+{
+    uint64_t nAllocations = m_nFreedAllocations;
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+        nAllocations += m_Entries[i]->Arena.GetHeapAllocations();
+    return nAllocations;
+}
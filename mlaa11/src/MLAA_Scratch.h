@@ -0,0 +1,158 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Scratch.h
+//
+// Scratch memory of the CPU MLAA engine, the equivalent of the g_EdgeMask and
+// g_EdgeCount render targets. ScratchArena is a bump allocator that hands out memory
+// from large blocks and frees it all at once. ScratchCache keeps one arena per
+// resolution, so an engine that switches between a few sizes, such as the tiles of an
+// image or the views of an atlas, finds its intermediates ready instead of reallocating
+// and clearing them. After the first frame of each size no heap memory is allocated.
+//
+// Like the engine, an arena or a cache belongs to one thread at a time.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_SCRATCH_H
+#define MLAA_SCRATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+namespace MLAA
+{
+    class ScratchArena
+    {
+    public:
+
+        ScratchArena();
+        ~ScratchArena();
+
+        // Returns nBytes of uninitialized memory aligned to a cache line. A new block is
+        // chained when the current one is full, earlier allocations don't move
+        void* Allocate( size_t nBytes );
+
+        // Frees all allocations. When they took several blocks these are replaced by a single
+        // block of the high water mark, so the next round fits in one
+        void Reset();
+
+        // Frees the blocks and clears the high water mark
+        void Release();
+
+        size_t GetUsed() const { return m_nUsed; }
+        size_t GetCapacity() const { return m_nCapacity; }
+        size_t GetHighWater() const { return m_nHighWater; }
+
+        // Blocks allocated from the heap since the arena was created
+        uint64_t GetHeapAllocations() const { return m_nHeapAllocations; }
+
+    private:
+
+        struct Block
+        {
+            Block*      pNext;
+            size_t      nSize;          // Bytes after the header
+            size_t      nUsed;
+        };
+
+        void AddBlock( size_t nSize );
+
+        ScratchArena( const ScratchArena& );
+        ScratchArena& operator=( const ScratchArena& );
+
+        Block*          m_pBlocks;      // The block allocations come from, then the full ones
+        size_t          m_nUsed;
+        size_t          m_nCapacity;
+        size_t          m_nHighWater;
+        uint64_t        m_nHeapAllocations;
+    };
+
+    class ScratchCache
+    {
+    public:
+
+        static const int kMaxSlots = 16;
+
+        // A buffer of an entry, allocated from its arena on first use
+        struct Slot
+        {
+            void*       pData;
+            size_t      nBytes;
+        };
+
+        // The scratch of one resolution
+        struct Entry
+        {
+            int             Width;
+            int             Height;
+            uint64_t        LastUse;
+            ScratchArena    Arena;
+            Slot            Slots[kMaxSlots];
+        };
+
+        // nMaxEntries resolutions are kept, at least 1
+        explicit ScratchCache( int nMaxEntries = 4 );
+
+        // Fewer entries frees the least recently used ones, except the current entry
+        void SetMaxEntries( int nMaxEntries );
+        int GetMaxEntries() const { return m_nMaxEntries; }
+
+        // The entry of a resolution. When there is none the least recently used entry is
+        // recycled, or a new one added, with every slot empty
+        Entry& Acquire( int Width, int Height );
+
+        // Buffer of a slot of the entry, at least nBytes and zeroed when it is allocated. A
+        // slot that is too small gets a new buffer, the old one is freed with the entry
+        void* GetSlot( Entry& E, int nSlot, size_t nBytes );
+
+        // Frees every entry but the most recently used one, and clears the high water mark
+        void Trim();
+
+        // Frees every entry
+        void Release();
+
+        // Bytes held by the arenas, the most they ever held since the last trim, and the
+        // blocks allocated from the heap
+        size_t GetBytes() const;
+        size_t GetHighWater() const { return m_nHighWater; }
+        uint64_t GetHeapAllocations() const;
+
+    private:
+
+        void Free( size_t nEntry );
+
+        ScratchCache( const ScratchCache& );
+        ScratchCache& operator=( const ScratchCache& );
+
+        std::vector< std::unique_ptr<Entry> >   m_Entries;
+        int                                     m_nMaxEntries;
+        uint64_t                                m_nUseCount;
+        size_t                                  m_nHighWater;
+        uint64_t                                m_nFreedAllocations;    // Heap allocations of freed entries
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_SCRATCH_H
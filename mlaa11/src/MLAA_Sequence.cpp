@@ -0,0 +1,578 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Sequence.cpp
+//
+// Streaming sequence pipeline and Y4M/raw frame files, see MLAA_Sequence.h
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Sequence.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <thread>
+
+#if defined(_MSC_VER)
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Frame layout
+//--------------------------------------------------------------------------------------
+size_t MLAA::GetFrameSize( const SequenceInfo& Info )
+{
+    size_t ChromaSize = (size_t)( ( Info.Width + 1 ) / 2 ) * ( ( Info.Height + 1 ) / 2 );
+    return (size_t)Info.Width * Info.Height + 2 * ChromaSize;
+}
+
+PlanarImage MLAA::GetFrameImage( const SequenceInfo& Info, uint8_t* pData )
+{
+    const int nChromaWidth = ( Info.Width + 1 ) / 2;
+    const int nChromaHeight = ( Info.Height + 1 ) / 2;
+
+    PlanarImage Image;
+    Image.Format = Info.Format;
+    Image.Width = Info.Width;
+    Image.Height = Info.Height;
+    Image.pY = pData;
+    Image.YPitch = Info.Width;
+    Image.pU = pData + (size_t)Info.Width * Info.Height;
+    if ( Info.Format == PLANAR_FORMAT_NV12 )
+    {
+        Image.pV = NULL;
+        Image.UVPitch = nChromaWidth * 2;
+    }
+    else
+    {
+        Image.pV = Image.pU + (size_t)nChromaWidth * nChromaHeight;
+        Image.UVPitch = nChromaWidth;
+    }
+    return Image;
+}
+
+//--------------------------------------------------------------------------------------
+// File helpers. "-" is stdin or stdout, switched to binary mode on Windows
+//--------------------------------------------------------------------------------------
+static FILE* OpenFile( const char* pPath, bool bWrite )
+{
+    if ( strcmp( pPath, "-" ) )
+    {
+#if defined(_MSC_VER)
+        FILE* pFile = NULL;
+        return ( fopen_s( &pFile, pPath, bWrite ? "wb" : "rb" ) == 0 ) ? pFile : NULL;
+#else
+        return fopen( pPath, bWrite ? "wb" : "rb" );
+#endif
+    }
+
+    FILE* pFile = bWrite ? stdout : stdin;
+#if defined(_MSC_VER)
+    _setmode( _fileno( pFile ), _O_BINARY );
+#endif
+    return pFile;
+}
+
+// Returns false if a write to the file failed
+static bool CloseFile( FILE* pFile )
+{
+    bool bFlushed = ( fflush( pFile ) == 0 );
+    if ( pFile == stdin || pFile == stdout )
+        return bFlushed;
+    return ( fclose( pFile ) == 0 ) && bFlushed;
+}
+
+// Reads a line without the '\n', false at the end of the file or if the line is longer
+// than the buffer
+static bool ReadLine( FILE* pFile, char* pLine, size_t Size )
+{
+    size_t Length = 0;
+    for ( int c; ( c = getc( pFile ) ) != EOF; )
+    {
+        if ( c == '\n' )
+        {
+            pLine[Length] = 0;
+            return true;
+        }
+        if ( Length + 1 == Size )
+            return false;
+        pLine[Length++] = (char)c;
+    }
+    return false;
+}
+
+static bool ReadPlane( FILE* pFile, uint8_t* pData, int RowBytes, int Rows, int Pitch )
+{
+    if ( Pitch == RowBytes )
+        return fread( pData, 1, (size_t)RowBytes * Rows, pFile ) == (size_t)RowBytes * Rows;
+
+    for ( int y = 0; y < Rows; y++ )
+    {
+        if ( fread( pData + (size_t)y * Pitch, 1, RowBytes, pFile ) != (size_t)RowBytes )
+            return false;
+    }
+    return true;
+}
+
+static bool WritePlane( FILE* pFile, const uint8_t* pData, int RowBytes, int Rows, int Pitch )
+{
+    if ( Pitch == RowBytes )
+        return fwrite( pData, 1, (size_t)RowBytes * Rows, pFile ) == (size_t)RowBytes * Rows;
+
+    for ( int y = 0; y < Rows; y++ )
+    {
+        if ( fwrite( pData + (size_t)y * Pitch, 1, RowBytes, pFile ) != (size_t)RowBytes )
+            return false;
+    }
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Reader
+//--------------------------------------------------------------------------------------
+SequenceFileReader::SequenceFileReader() :
+    m_pFile( NULL ),
+    m_bY4M( false ),
+    m_bFailed( false )
+{
+    m_Info.Width = 0;
+    m_Info.Height = 0;
+    m_Info.Format = PLANAR_FORMAT_I420;
+}
+
+SequenceFileReader::~SequenceFileReader()
+{
+    Close();
+}
+
+void SequenceFileReader::Close()
+{
+    if ( m_pFile )
+    {
+        CloseFile( m_pFile );
+        m_pFile = NULL;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// The stream header is "YUV4MPEG2" and tags separated by spaces, each a letter and a value.
+// Only 8 bit 4:2:0 chroma is supported, which is the default when there is no C tag
+//--------------------------------------------------------------------------------------
+bool SequenceFileReader::OpenY4M( const char* pPath )
+{
+    Close();
+    m_pFile = OpenFile( pPath, false );
+    if ( !m_pFile )
+        return false;
+
+    m_bY4M = true;
+    m_bFailed = false;
+    m_Info.Width = 0;
+    m_Info.Height = 0;
+    m_Info.Format = PLANAR_FORMAT_I420;
+    m_Info.Y4MParams.clear();
+
+    char Header[1024];
+    if ( !ReadLine( m_pFile, Header, sizeof( Header ) ) || strncmp( Header, "YUV4MPEG2", 9 ) )
+    {
+        Close();
+        return false;
+    }
+
+    for ( char* pTag = strchr( Header, ' ' ); pTag; pTag = strchr( pTag, ' ' ) )
+    {
+        pTag++;
+        char* pEnd = strchr( pTag, ' ' );
+        std::string Tag( pTag, pEnd ? (size_t)( pEnd - pTag ) : strlen( pTag ) );
+
+        if ( Tag.empty() )
+            continue;
+        if ( Tag[0] == 'W' )
+            m_Info.Width = atoi( Tag.c_str() + 1 );
+        else if ( Tag[0] == 'H' )
+            m_Info.Height = atoi( Tag.c_str() + 1 );
+        else
+        {
+            if ( Tag[0] == 'C' && Tag != "C420" && Tag != "C420jpeg" && Tag != "C420mpeg2" && Tag != "C420paldv" )
+            {
+                Close();
+                return false;
+            }
+            m_Info.Y4MParams += " " + Tag;
+        }
+    }
+
+    if ( m_Info.Width <= 0 || m_Info.Height <= 0 )
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool SequenceFileReader::OpenRaw( const char* pPath, const SequenceInfo& Info )
+{
+    Close();
+    m_pFile = OpenFile( pPath, false );
+    if ( !m_pFile )
+        return false;
+
+    m_bY4M = false;
+    m_bFailed = false;
+    m_Info = Info;
+    return true;
+}
+
+//--------------------------------------------------------------------------------------
+// Y4M frames start with a "FRAME" line, its tags are ignored. A frame cut short is an error
+//--------------------------------------------------------------------------------------
+bool SequenceFileReader::ReadFrame( const PlanarImage& Frame )
+{
+    assert( Frame.Width == m_Info.Width && Frame.Height == m_Info.Height && Frame.Format == m_Info.Format );
+
+    if ( !m_pFile || m_bFailed )
+        return false;
+
+    int c = getc( m_pFile );
+    if ( c == EOF )
+    {
+        m_bFailed = ( ferror( m_pFile ) != 0 );
+        return false;
+    }
+    ungetc( c, m_pFile );
+
+    if ( m_bY4M )
+    {
+        char Line[256];
+        if ( !ReadLine( m_pFile, Line, sizeof( Line ) ) || strncmp( Line, "FRAME", 5 ) )
+        {
+            m_bFailed = true;
+            return false;
+        }
+    }
+
+    const int nChromaWidth = ( Frame.Width + 1 ) / 2;
+    const int nChromaHeight = ( Frame.Height + 1 ) / 2;
+
+    bool bRead = ReadPlane( m_pFile, Frame.pY, Frame.Width, Frame.Height, Frame.YPitch );
+    if ( Frame.Format == PLANAR_FORMAT_NV12 )
+    {
+        bRead = bRead && ReadPlane( m_pFile, Frame.pU, nChromaWidth * 2, nChromaHeight, Frame.UVPitch );
+    }
+    else
+    {
+        bRead = bRead && ReadPlane( m_pFile, Frame.pU, nChromaWidth, nChromaHeight, Frame.UVPitch );
+        bRead = bRead && ReadPlane( m_pFile, Frame.pV, nChromaWidth, nChromaHeight, Frame.UVPitch );
+    }
+
+    m_bFailed = !bRead;
+    return bRead;
+}
+
+//--------------------------------------------------------------------------------------
+// Writer
+//--------------------------------------------------------------------------------------
+SequenceFileWriter::SequenceFileWriter() :
+    m_pFile( NULL ),
+    m_bY4M( false ),
+    m_bFailed( false )
+{
+}
+
+SequenceFileWriter::~SequenceFileWriter()
+{
+    Close();
+}
+
+bool SequenceFileWriter::Close()
+{
+    bool bSucceeded = !m_bFailed;
+    if ( m_pFile )
+    {
+        bSucceeded = CloseFile( m_pFile ) && bSucceeded;
+        m_pFile = NULL;
+    }
+    m_bFailed = false;
+    return bSucceeded;
+}
+
+bool SequenceFileWriter::OpenY4M( const char* pPath, const SequenceInfo& Info )
+{
+    Close();
+    if ( Info.Format != PLANAR_FORMAT_I420 )
+        return false;
+
+    m_pFile = OpenFile( pPath, true );
+    if ( !m_pFile )
+        return false;
+
+    m_bY4M = true;
+    m_bFailed = ( fprintf( m_pFile, "YUV4MPEG2 W%d H%d%s\n", Info.Width, Info.Height, Info.Y4MParams.c_str() ) < 0 );
+    return !m_bFailed;
+}
+
+bool SequenceFileWriter::OpenRaw( const char* pPath )
+{
+    Close();
+    m_pFile = OpenFile( pPath, true );
+    m_bY4M = false;
+    return m_pFile != NULL;
+}
+
+bool SequenceFileWriter::WriteFrame( const PlanarImage& Frame )
+{
+    if ( !m_pFile || m_bFailed )
+        return false;
+
+    const int nChromaWidth = ( Frame.Width + 1 ) / 2;
+    const int nChromaHeight = ( Frame.Height + 1 ) / 2;
+
+    bool bWritten = !m_bY4M || fputs( "FRAME\n", m_pFile ) >= 0;
+    bWritten = bWritten && WritePlane( m_pFile, Frame.pY, Frame.Width, Frame.Height, Frame.YPitch );
+    if ( Frame.Format == PLANAR_FORMAT_NV12 )
+    {
+        bWritten = bWritten && WritePlane( m_pFile, Frame.pU, nChromaWidth * 2, nChromaHeight, Frame.UVPitch );
+    }
+    else
+    {
+        bWritten = bWritten && WritePlane( m_pFile, Frame.pU, nChromaWidth, nChromaHeight, Frame.UVPitch );
+        bWritten = bWritten && WritePlane( m_pFile, Frame.pV, nChromaWidth, nChromaHeight, Frame.UVPitch );
+    }
+
+    m_bFailed = !bWritten;
+    return bWritten;
+}
+
+//--------------------------------------------------------------------------------------
+// Frame lists
+//--------------------------------------------------------------------------------------
+void SequencePipeline::FrameList::Reset()
+{
+    std::lock_guard<std::mutex> Lock( m_Lock );
+    m_Frames.clear();
+    m_bClosed = false;
+}
+
+void SequencePipeline::FrameList::Push( Frame* pFrame )
+{
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_Frames.push_back( pFrame );
+    }
+    m_Ready.notify_one();
+}
+
+SequencePipeline::Frame* SequencePipeline::FrameList::Pop()
+{
+    std::unique_lock<std::mutex> Lock( m_Lock );
+    while ( m_Frames.empty() && !m_bClosed )
+    {
+        m_Ready.wait( Lock );
+    }
+    if ( m_Frames.empty() )
+    {
+        return NULL;
+    }
+
+    Frame* pFrame = m_Frames.front();
+    m_Frames.pop_front();
+    return pFrame;
+}
+
+void SequencePipeline::FrameList::Close()
+{
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_bClosed = true;
+    }
+    m_Ready.notify_all();
+}
+
+void SequencePipeline::FrameList::Cancel()
+{
+    {
+        std::lock_guard<std::mutex> Lock( m_Lock );
+        m_Frames.clear();
+        m_bClosed = true;
+    }
+    m_Ready.notify_all();
+}
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+SequencePipeline::SequencePipeline() :
+    m_nFrameCount( 4 ),
+    m_bBlendChroma( false ),
+    m_nFrameSize( 0 ),
+    m_bReadFailed( false ),
+    m_bWriteFailed( false )
+{
+    memset( &m_Stats, 0, sizeof( m_Stats ) );
+    m_FreeFrames.Reset();
+    m_ReadFrames.Reset();
+    m_ProcessedFrames.Reset();
+}
+
+SequencePipeline::~SequencePipeline()
+{
+}
+
+void SequencePipeline::SetFrameCount( int nFrames )
+{
+    m_nFrameCount = ( nFrames > 3 ) ? nFrames : 3;
+}
+
+void SequencePipeline::ReleaseFrames()
+{
+    std::vector<Frame>().swap( m_Frames );
+    m_nFrameSize = 0;
+    m_Engine.ReleaseIntermediates();
+}
+
+//--------------------------------------------------------------------------------------
+// Run the sequence through the stages. Reading and writing get threads of their own, the
+// passes run on the calling thread
+//--------------------------------------------------------------------------------------
+bool SequencePipeline::Run( ISequenceReader& Reader, ISequenceWriter& Writer )
+{
+    double StartTime = GetTimeMs();
+    const SequenceInfo& Info = Reader.GetInfo();
+
+    memset( &m_Stats, 0, sizeof( m_Stats ) );
+    m_bReadFailed = false;
+    m_bWriteFailed = false;
+
+    const size_t FrameSize = GetFrameSize( Info );
+    if ( (int)m_Frames.size() != m_nFrameCount || m_nFrameSize != FrameSize )
+    {
+        m_Frames.resize( m_nFrameCount );
+        for ( size_t i = 0; i < m_Frames.size(); i++ )
+        {
+            m_Frames[i].Src.assign( FrameSize, 0 );
+            m_Frames[i].Dst.assign( FrameSize, 0 );
+        }
+        m_nFrameSize = FrameSize;
+        m_Stats.nAllocations = m_nFrameCount;
+    }
+
+    m_FreeFrames.Reset();
+    m_ReadFrames.Reset();
+    m_ProcessedFrames.Reset();
+    for ( size_t i = 0; i < m_Frames.size(); i++ )
+    {
+        m_FreeFrames.Push( &m_Frames[i] );
+    }
+
+    std::thread ReadThread( &SequencePipeline::ReadStage, this, std::ref( Reader ) );
+    std::thread WriteThread( &SequencePipeline::WriteStage, this, std::ref( Writer ), std::cref( Info ) );
+
+    for ( ;; )
+    {
+        Frame* pFrame = m_ReadFrames.Pop();
+        if ( !pFrame )
+        {
+            break;
+        }
+
+        double FrameStartTime = GetTimeMs();
+        m_Engine.ApplyPlanar( GetFrameImage( Info, &pFrame->Src[0] ), GetFrameImage( Info, &pFrame->Dst[0] ), m_bBlendChroma );
+        m_Stats.ProcessTimeMs += GetTimeMs() - FrameStartTime;
+        for ( int i = 0; i < PASS_COUNT; i++ )
+        {
+            m_Stats.PassTime[i] += m_Engine.GetPassTime( (PASS)i );
+        }
+
+        m_ProcessedFrames.Push( pFrame );
+    }
+    m_ProcessedFrames.Close();
+
+    ReadThread.join();
+    WriteThread.join();
+
+    m_Stats.WallTimeMs = GetTimeMs() - StartTime;
+    return !m_bReadFailed && !m_bWriteFailed;
+}
+
+//--------------------------------------------------------------------------------------
+// First stage, fills free frames until the reader runs out
+//--------------------------------------------------------------------------------------
+void SequencePipeline::ReadStage( ISequenceReader& Reader )
+{
+    const SequenceInfo& Info = Reader.GetInfo();
+
+    for ( ;; )
+    {
+        Frame* pFrame = m_FreeFrames.Pop();
+        if ( !pFrame )
+        {
+            break;
+        }
+
+        double StartTime = GetTimeMs();
+        bool bRead = Reader.ReadFrame( GetFrameImage( Info, &pFrame->Src[0] ) );
+        m_Stats.ReadTimeMs += GetTimeMs() - StartTime;
+
+        if ( !bRead )
+        {
+            m_bReadFailed = Reader.HasFailed();
+            break;
+        }
+        m_ReadFrames.Push( pFrame );
+    }
+    m_ReadFrames.Close();
+}
+
+//--------------------------------------------------------------------------------------
+// Last stage, writes processed frames and hands them back to the first. After a failed
+// write the first stage is stopped, the frames already read are still processed
+//--------------------------------------------------------------------------------------
+void SequencePipeline::WriteStage( ISequenceWriter& Writer, const SequenceInfo& Info )
+{
+    for ( ;; )
+    {
+        Frame* pFrame = m_ProcessedFrames.Pop();
+        if ( !pFrame )
+        {
+            break;
+        }
+
+        double StartTime = GetTimeMs();
+        bool bWritten = Writer.WriteFrame( GetFrameImage( Info, &pFrame->Dst[0] ) );
+        m_Stats.WriteTimeMs += GetTimeMs() - StartTime;
+
+        if ( !bWritten )
+        {
+            m_bWriteFailed = true;
+            m_FreeFrames.Cancel();
+            break;
+        }
+        m_Stats.nFrames++;
+        m_FreeFrames.Push( pFrame );
+    }
+}
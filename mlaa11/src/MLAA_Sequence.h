@@ -0,0 +1,240 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Sequence.h
+//
+// Streaming anti-aliasing of planar video sequences, read from and written to Y4M or raw
+// files. Reading, the MLAA passes and writing run as three stages on their own threads,
+// so the file I/O of one frame overlaps the passes of another. The frames move through
+// the stages and back to a free list. A fixed number of them is allocated once, so
+// reading stalls when the later stages fall behind, and nothing is allocated per frame.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_SEQUENCE_H
+#define MLAA_SEQUENCE_H
+
+#include "MLAA_CPU.h"
+
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Size and layout of the frames of a sequence. Frames are stored without padding, the
+    // Y plane followed by the chroma plane(s)
+    //--------------------------------------------------------------------------------------
+    struct SequenceInfo
+    {
+        int             Width;
+        int             Height;
+        PLANAR_FORMAT   Format;
+        std::string     Y4MParams;      // Stream header tags other than W and H, copied to Y4M output
+    };
+
+    // Bytes per frame
+    size_t GetFrameSize( const SequenceInfo& Info );
+
+    // The planes of a frame stored at pData
+    PlanarImage GetFrameImage( const SequenceInfo& Info, uint8_t* pData );
+
+    //--------------------------------------------------------------------------------------
+    // Frame sources and sinks. Each is only called from the thread of its stage
+    //--------------------------------------------------------------------------------------
+    class ISequenceReader
+    {
+    public:
+
+        virtual ~ISequenceReader() {}
+
+        virtual const SequenceInfo& GetInfo() const = 0;
+
+        // Fills a frame laid out as GetInfo() describes. Returns false at the end of the
+        // sequence and on errors, which HasFailed() tells apart
+        virtual bool ReadFrame( const PlanarImage& Frame ) = 0;
+        virtual bool HasFailed() const = 0;
+    };
+
+    class ISequenceWriter
+    {
+    public:
+
+        virtual ~ISequenceWriter() {}
+
+        // Returns false on failure
+        virtual bool WriteFrame( const PlanarImage& Frame ) = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Y4M and raw frame files. A path of "-" is stdin or stdout. Y4M input must be 4:2:0,
+    // which is read as PLANAR_FORMAT_I420
+    //--------------------------------------------------------------------------------------
+    class SequenceFileReader : public ISequenceReader
+    {
+    public:
+
+        SequenceFileReader();
+        virtual ~SequenceFileReader();
+
+        // Returns false if the file can't be opened or its header is not supported
+        bool OpenY4M( const char* pPath );
+
+        // Info gives the size and layout of every frame
+        bool OpenRaw( const char* pPath, const SequenceInfo& Info );
+
+        void Close();
+
+        virtual const SequenceInfo& GetInfo() const { return m_Info; }
+        virtual bool ReadFrame( const PlanarImage& Frame );
+        virtual bool HasFailed() const { return m_bFailed; }
+
+    private:
+
+        FILE*           m_pFile;
+        bool            m_bY4M;
+        bool            m_bFailed;
+        SequenceInfo    m_Info;
+    };
+
+    class SequenceFileWriter : public ISequenceWriter
+    {
+    public:
+
+        SequenceFileWriter();
+        virtual ~SequenceFileWriter();
+
+        // Writes the stream header for Info, Y4M output requires PLANAR_FORMAT_I420
+        bool OpenY4M( const char* pPath, const SequenceInfo& Info );
+        bool OpenRaw( const char* pPath );
+
+        // Returns false if a write failed
+        bool Close();
+
+        virtual bool WriteFrame( const PlanarImage& Frame );
+
+    private:
+
+        FILE*           m_pFile;
+        bool            m_bY4M;
+        bool            m_bFailed;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Reported by SequencePipeline::Run. Busy times are the time a stage spent on frames,
+    // the rest of the wall time it waited on the other stages
+    //--------------------------------------------------------------------------------------
+    struct SequenceStats
+    {
+        uint64_t    nFrames;
+        double      WallTimeMs;
+        double      ReadTimeMs;
+        double      ProcessTimeMs;
+        double      WriteTimeMs;
+        double      PassTime[PASS_COUNT];   // Sums over the frames
+        int         nAllocations;           // Frames allocated by this run, zero when the last run's were reused
+    };
+
+    class SequencePipeline
+    {
+    public:
+
+        SequencePipeline();
+        ~SequencePipeline();
+
+        // Frames shared by the three stages, at least 3 so that all of them can be busy
+        void SetFrameCount( int nFrames );
+        int GetFrameCount() const { return m_nFrameCount; }
+
+        // Blend chroma as well as Y, see CPUEngine::ApplyPlanar
+        void SetBlendChroma( bool bBlendChroma ) { m_bBlendChroma = bBlendChroma; }
+
+        // The engine running the passes, for its settings
+        CPUEngine& GetEngine() { return m_Engine; }
+
+        // Processes every frame of Reader into Writer, in order. Returns false if a frame
+        // could not be read or written, the frames before it have been written. Frames and
+        // intermediates are kept for the next run of the same size
+        bool Run( ISequenceReader& Reader, ISequenceWriter& Writer );
+
+        const SequenceStats& GetStats() const { return m_Stats; }
+
+        // Frees the frames and the intermediates of the engine
+        void ReleaseFrames();
+
+    private:
+
+        struct Frame
+        {
+            std::vector<uint8_t>    Src;
+            std::vector<uint8_t>    Dst;
+        };
+
+        // Frames waiting for a stage. After Close() Pop() returns NULL once the list is
+        // empty, after Cancel() it does so at once
+        class FrameList
+        {
+        public:
+
+            void Reset();
+            void Push( Frame* pFrame );
+            Frame* Pop();
+            void Close();
+            void Cancel();
+
+        private:
+
+            std::mutex              m_Lock;
+            std::condition_variable m_Ready;
+            std::deque<Frame*>      m_Frames;
+            bool                    m_bClosed;
+        };
+
+        void ReadStage( ISequenceReader& Reader );
+        void WriteStage( ISequenceWriter& Writer, const SequenceInfo& Info );
+
+    private:
+
+        CPUEngine                   m_Engine;
+        int                         m_nFrameCount;
+        bool                        m_bBlendChroma;
+
+        std::vector<Frame>          m_Frames;
+        size_t                      m_nFrameSize;
+
+        // Free -> read -> processed -> written and free again
+        FrameList                   m_FreeFrames;
+        FrameList                   m_ReadFrames;
+        FrameList                   m_ProcessedFrames;
+
+        bool                        m_bReadFailed;
+        bool                        m_bWriteFailed;
+        SequenceStats               m_Stats;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_SEQUENCE_H
@@ -0,0 +1,702 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Service.cpp
+//
+// Layout of the shared memory, each part aligned to a cache line: the header, a wake
+// count per thread, the channels, then the slots of channel 0, of channel 1, ... A slot
+// is a small header followed by the pixels of the largest frame.
+//
+// Every count that is waited on has a count of sleepers next to it. A waiter adds itself
+// before it checks the count a last time and blocks, the other side only makes the wake
+// call when there is a sleeper, so a frame that finishes while the client spins costs no
+// system call.
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Service.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+#endif
+
+using namespace MLAA;
+
+static const uint32_t kServiceMagic     = 0x53414c4d;   // "MLAS"
+static const uint32_t kServiceVersion   = 1;
+static const size_t   kLineSize         = 64;
+static const int      kSpinCount        = 64;           // Checks before a wait blocks
+static const int      kWaitSliceMs      = 100;          // Blocked waits wake up to check the other side is alive
+
+//--------------------------------------------------------------------------------------
+// A count waited on across processes, alone in its cache line
+//--------------------------------------------------------------------------------------
+struct SharedWord
+{
+    std::atomic<uint32_t>   Value;
+    std::atomic<uint32_t>   nSleepers;
+    uint8_t                 Pad[kLineSize - 2 * sizeof(std::atomic<uint32_t>)];
+};
+
+struct ServiceHeader
+{
+    uint32_t                Magic;
+    uint32_t                Version;
+    std::atomic<uint32_t>   bReady;             // Set by Create once the rest is written
+    std::atomic<uint32_t>   bStopping;
+    uint32_t                ServiceProcess;
+    int32_t                 nChannels;
+    int32_t                 nSlots;
+    int32_t                 MaxWidth;
+    int32_t                 MaxHeight;
+    int32_t                 nThreads;
+    uint64_t                SlotBytes;          // Stride of the slots
+    uint64_t                TotalBytes;
+};
+
+struct ServiceChannel
+{
+    std::atomic<uint32_t>   Owner;              // Process of the client, 0 when free
+    uint8_t                 Pad[kLineSize - sizeof(std::atomic<uint32_t>)];
+    SharedWord              Submitted;          // Only written by the client
+    SharedWord              Completed;          // Only written by the service
+};
+
+struct ServiceSlot
+{
+    int32_t                 Width;
+    int32_t                 Height;
+    float                   fThreshold;
+    uint8_t                 Pad[kLineSize - 3 * sizeof(int32_t)];
+};
+
+static size_t RoundToLine( size_t nBytes )
+{
+    return ( nBytes + kLineSize - 1 ) & ~( kLineSize - 1 );
+}
+
+//--------------------------------------------------------------------------------------
+// The mapping of the shared memory in a process
+//--------------------------------------------------------------------------------------
+struct MLAA::ServiceShared
+{
+    std::string     Name;
+    uint8_t*        pBase;
+    size_t          nBytes;
+#if defined(_WIN32)
+    HANDLE          hMapping;
+#endif
+
+    ServiceHeader& GetHeader() const
+    {
+        return *(ServiceHeader*)pBase;
+    }
+
+    SharedWord& GetWake( int nThread ) const
+    {
+        return ( (SharedWord*)( pBase + RoundToLine( sizeof(ServiceHeader) ) ) )[nThread];
+    }
+
+    ServiceChannel& GetChannel( int nChannel ) const
+    {
+        return ( (ServiceChannel*)&GetWake( GetHeader().nThreads ) )[nChannel];
+    }
+
+    ServiceSlot& GetSlot( int nChannel, uint32_t Ticket ) const
+    {
+        const ServiceHeader& H = GetHeader();
+        size_t nSlot = (size_t)nChannel * H.nSlots + ( Ticket & ( H.nSlots - 1 ) );
+        return *(ServiceSlot*)( (uint8_t*)&GetChannel( H.nChannels ) + nSlot * H.SlotBytes );
+    }
+
+    uint8_t* GetPixels( ServiceSlot& Slot ) const
+    {
+        return (uint8_t*)( &Slot + 1 );
+    }
+};
+
+static size_t GetSharedBytes( const ServiceDesc& Desc, int nThreads, size_t nSlotBytes )
+{
+    return RoundToLine( sizeof(ServiceHeader) ) + (size_t)nThreads * sizeof(SharedWord) +
+           (size_t)Desc.nChannels * sizeof(ServiceChannel) + (size_t)Desc.nChannels * Desc.nSlots * nSlotBytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Processes
+//--------------------------------------------------------------------------------------
+static uint32_t GetProcess()
+{
+#if defined(_WIN32)
+    return (uint32_t)GetCurrentProcessId();
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+static bool IsProcessAlive( uint32_t Process )
+{
+#if defined(_WIN32)
+    HANDLE hProcess = OpenProcess( SYNCHRONIZE, FALSE, (DWORD)Process );
+    if ( !hProcess )
+        return GetLastError() == ERROR_ACCESS_DENIED;
+    bool bAlive = ( WaitForSingleObject( hProcess, 0 ) == WAIT_TIMEOUT );
+    CloseHandle( hProcess );
+    return bAlive;
+#else
+    if ( kill( (pid_t)Process, 0 ) != 0 && errno != EPERM )
+        return false;
+#if defined(__linux__)
+    // A process that exited stays a zombie until its parent waits for it
+    char Path[64], Stat[256];
+    sprintf( Path, "/proc/%u/stat", Process );
+    FILE* pFile = fopen( Path, "r" );
+    if ( pFile )
+    {
+        size_t nRead = fread( Stat, 1, sizeof(Stat) - 1, pFile );
+        fclose( pFile );
+        Stat[nRead] = 0;
+        const char* pState = strrchr( Stat, ')' );
+        if ( pState && pState[1] == ' ' && pState[2] == 'Z' )
+            return false;
+    }
+#endif
+    return true;
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Shared memory. On Windows the mapping goes away with its last handle, elsewhere the
+// name stays until unlinked, so the service replaces the memory of one that exited
+//--------------------------------------------------------------------------------------
+static ServiceShared* MapShared( const char* pName, size_t nBytes, bool bCreate )
+{
+    std::unique_ptr<ServiceShared> pShared( new ServiceShared );
+#if defined(_WIN32)
+    pShared->Name = std::string( "Local\\MLAA_" ) + pName;
+    if ( bCreate )
+    {
+        pShared->hMapping = CreateFileMappingA( INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)( (uint64_t)nBytes >> 32 ),
+                                                (DWORD)nBytes, pShared->Name.c_str() );
+        if ( pShared->hMapping && GetLastError() == ERROR_ALREADY_EXISTS )
+        {
+            CloseHandle( pShared->hMapping );
+            return NULL;
+        }
+    }
+    else
+    {
+        pShared->hMapping = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, pShared->Name.c_str() );
+    }
+    if ( !pShared->hMapping )
+        return NULL;
+
+    pShared->pBase = (uint8_t*)MapViewOfFile( pShared->hMapping, FILE_MAP_ALL_ACCESS, 0, 0, nBytes );
+    MEMORY_BASIC_INFORMATION Info;
+    if ( !pShared->pBase || !VirtualQuery( pShared->pBase, &Info, sizeof(Info) ) )
+    {
+        if ( pShared->pBase )
+            UnmapViewOfFile( pShared->pBase );
+        CloseHandle( pShared->hMapping );
+        return NULL;
+    }
+    pShared->nBytes = bCreate ? nBytes : (size_t)Info.RegionSize;
+#else
+    pShared->Name = std::string( "/MLAA_" ) + pName;
+    int File = shm_open( pShared->Name.c_str(), bCreate ? O_RDWR | O_CREAT | O_EXCL : O_RDWR, 0600 );
+    if ( File < 0 && bCreate && errno == EEXIST )
+    {
+        // Left by a service that exited, or in use
+        ServiceShared* pExisting = MapShared( pName, 0, false );
+        bool bInUse = false;
+        if ( pExisting )
+        {
+            const ServiceHeader& H = pExisting->GetHeader();
+            bInUse = H.Magic == kServiceMagic && !H.bStopping.load() && IsProcessAlive( H.ServiceProcess );
+            munmap( pExisting->pBase, pExisting->nBytes );
+            delete pExisting;
+        }
+        if ( bInUse )
+            return NULL;
+
+        shm_unlink( pShared->Name.c_str() );
+        File = shm_open( pShared->Name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+    }
+    if ( File < 0 )
+        return NULL;
+
+    struct stat Stat;
+    bool bSized = bCreate ? ( ftruncate( File, (off_t)nBytes ) == 0 ) : ( fstat( File, &Stat ) == 0 && Stat.st_size >= (off_t)sizeof(ServiceHeader) );
+    if ( bSized && !bCreate )
+        nBytes = (size_t)Stat.st_size;
+
+    void* pBase = bSized ? mmap( NULL, nBytes, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0 ) : MAP_FAILED;
+    close( File );
+    if ( pBase == MAP_FAILED )
+    {
+        if ( bCreate )
+            shm_unlink( pShared->Name.c_str() );
+        return NULL;
+    }
+    pShared->pBase = (uint8_t*)pBase;
+    pShared->nBytes = nBytes;
+#endif
+    return pShared.release();
+}
+
+static void UnmapShared( ServiceShared* pShared, bool bRemove )
+{
+#if defined(_WIN32)
+    (void)bRemove;
+    UnmapViewOfFile( pShared->pBase );
+    CloseHandle( pShared->hMapping );
+#else
+    munmap( pShared->pBase, pShared->nBytes );
+    if ( bRemove )
+        shm_unlink( pShared->Name.c_str() );
+#endif
+    delete pShared;
+}
+
+//--------------------------------------------------------------------------------------
+// Events the counts are waited on with, only used on Windows. An event is named after
+// the service, the kind of count and its index
+//--------------------------------------------------------------------------------------
+static void* OpenCountEvent( const char* pName, const char* pCount, int nIndex, bool bCreate )
+{
+#if defined(_WIN32)
+    char EventName[MAX_PATH];
+    _snprintf( EventName, sizeof(EventName), "Local\\MLAA_%s_%s%d", pName, pCount, nIndex );
+    EventName[sizeof(EventName) - 1] = 0;
+    if ( bCreate )
+        return CreateEventA( NULL, FALSE, FALSE, EventName );
+    return OpenEventA( EVENT_MODIFY_STATE | SYNCHRONIZE, FALSE, EventName );
+#else
+    (void)pName; (void)pCount; (void)nIndex; (void)bCreate;
+    return NULL;
+#endif
+}
+
+static void CloseCountEvents( std::vector<void*>& Events )
+{
+#if defined(_WIN32)
+    for ( size_t i = 0; i < Events.size(); i++ )
+    {
+        if ( Events[i] )
+            CloseHandle( (HANDLE)Events[i] );
+    }
+#endif
+    Events.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Waits while a count has a value, for up to TimeoutMs. Returns whether it changed
+//--------------------------------------------------------------------------------------
+static bool WaitWord( SharedWord& Word, uint32_t Value, void* hEvent, int TimeoutMs )
+{
+    for ( int i = 0; i < kSpinCount; i++ )
+    {
+        if ( Word.Value.load( std::memory_order_acquire ) != Value )
+            return true;
+        std::this_thread::yield();
+    }
+
+    Word.nSleepers.fetch_add( 1 );
+    if ( Word.Value.load() == Value )
+    {
+#if defined(_WIN32)
+        WaitForSingleObject( (HANDLE)hEvent, (DWORD)TimeoutMs );
+#elif defined(__linux__)
+        (void)hEvent;
+        timespec Timeout;
+        Timeout.tv_sec = TimeoutMs / 1000;
+        Timeout.tv_nsec = ( TimeoutMs % 1000 ) * 1000000L;
+        syscall( SYS_futex, (uint32_t*)&Word.Value, FUTEX_WAIT, Value, &Timeout, NULL, 0 );
+#else
+        (void)hEvent;
+        (void)TimeoutMs;
+        std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+#endif
+    }
+    Word.nSleepers.fetch_sub( 1 );
+    return Word.Value.load( std::memory_order_acquire ) != Value;
+}
+
+//--------------------------------------------------------------------------------------
+// Wakes the waiter of a count after it changed. The change and the load of the sleepers
+// are sequentially consistent, so a waiter either sees the new value or is seen
+//--------------------------------------------------------------------------------------
+static void WakeWord( SharedWord& Word, void* hEvent )
+{
+    if ( Word.nSleepers.load() == 0 )
+        return;
+
+#if defined(_WIN32)
+    SetEvent( (HANDLE)hEvent );
+#elif defined(__linux__)
+    (void)hEvent;
+    syscall( SYS_futex, (uint32_t*)&Word.Value, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+#else
+    (void)hEvent;
+#endif
+}
+
+static void SetWord( SharedWord& Word, uint32_t Value, void* hEvent )
+{
+    Word.Value.store( Value );
+    WakeWord( Word, hEvent );
+}
+
+
+//--------------------------------------------------------------------------------------
+// Service
+//--------------------------------------------------------------------------------------
+Service::Service() :
+    m_EdgeSearch( EDGE_SEARCH_SHORT ),
+    m_pShared( NULL ),
+    m_nFrames( 0 )
+{
+}
+
+Service::~Service()
+{
+    Destroy();
+}
+
+bool Service::Create( const char* pName, const ServiceDesc& Desc )
+{
+    assert( Desc.nChannels > 0 && Desc.nSlots > 0 && ( Desc.nSlots & ( Desc.nSlots - 1 ) ) == 0 );
+    assert( Desc.MaxWidth > 0 && Desc.MaxHeight > 0 && Desc.nThreads >= 0 );
+
+    Destroy();
+
+    int nThreads = Desc.nThreads ? Desc.nThreads : (int)std::thread::hardware_concurrency();
+    if ( nThreads < 1 )
+        nThreads = 1;
+    if ( nThreads > Desc.nChannels )
+        nThreads = Desc.nChannels;
+
+    const size_t nSlotBytes = sizeof(ServiceSlot) + RoundToLine( (size_t)Desc.MaxWidth * Desc.MaxHeight * 4 );
+    const size_t nBytes = GetSharedBytes( Desc, nThreads, nSlotBytes );
+    m_pShared = MapShared( pName, nBytes, true );
+    if ( !m_pShared )
+        return false;
+
+    m_Name = pName;
+    for ( int t = 0; t < nThreads; t++ )
+        m_Events.push_back( OpenCountEvent( pName, "Wake", t, true ) );
+    for ( int c = 0; c < Desc.nChannels; c++ )
+        m_Events.push_back( OpenCountEvent( pName, "Done", c, true ) );
+
+    // The memory is zeroed, which is the initial state of the counts
+    ServiceHeader& H = m_pShared->GetHeader();
+    H.Magic = kServiceMagic;
+    H.Version = kServiceVersion;
+    H.ServiceProcess = GetProcess();
+    H.nChannels = Desc.nChannels;
+    H.nSlots = Desc.nSlots;
+    H.MaxWidth = Desc.MaxWidth;
+    H.MaxHeight = Desc.MaxHeight;
+    H.nThreads = nThreads;
+    H.SlotBytes = nSlotBytes;
+    H.TotalBytes = nBytes;
+    H.bReady.store( 1 );
+
+    m_nFrames = 0;
+    for ( int t = 0; t < nThreads; t++ )
+        m_Threads.push_back( std::thread( &Service::ThreadMain, this, t ) );
+    return true;
+}
+
+void Service::Destroy()
+{
+    if ( !m_pShared )
+        return;
+
+    ServiceHeader& H = m_pShared->GetHeader();
+    H.bStopping.store( 1 );
+    for ( int t = 0; t < H.nThreads; t++ )
+    {
+        SharedWord& Wake = m_pShared->GetWake( t );
+        Wake.Value.fetch_add( 1 );
+        WakeWord( Wake, m_Events[t] );
+    }
+    for ( size_t t = 0; t < m_Threads.size(); t++ )
+        m_Threads[t].join();
+    m_Threads.clear();
+
+    // Clients waiting for a frame see the service stop
+    for ( int c = 0; c < H.nChannels; c++ )
+        WakeWord( m_pShared->GetChannel( c ).Completed, m_Events[H.nThreads + c] );
+
+    UnmapShared( m_pShared, true );
+    m_pShared = NULL;
+    CloseCountEvents( m_Events );
+}
+
+//--------------------------------------------------------------------------------------
+// Thread of the service: runs the frames of its channels in order, frees the channels
+// of clients that exited when idle and at least once a second
+//--------------------------------------------------------------------------------------
+void Service::ThreadMain( int nThread )
+{
+    const ServiceShared& Shared = *m_pShared;
+    ServiceHeader& H = Shared.GetHeader();
+    SharedWord& Wake = Shared.GetWake( nThread );
+
+    CPUEngine Engine;
+    Engine.SetEdgeSearch( m_EdgeSearch );
+    std::vector<uint8_t> Output( (size_t)H.MaxWidth * H.MaxHeight * 4 );
+
+    double LastCheck = GetTimeMs();
+    while ( !H.bStopping.load() )
+    {
+        uint32_t nWake = Wake.Value.load();
+        bool bWorked = false;
+
+        for ( int c = nThread; c < H.nChannels; c += H.nThreads )
+        {
+            ServiceChannel& Channel = Shared.GetChannel( c );
+            uint32_t nCompleted = Channel.Completed.Value.load( std::memory_order_relaxed );
+            uint32_t nSubmitted = Channel.Submitted.Value.load( std::memory_order_acquire );
+            for ( ; nCompleted != nSubmitted; nCompleted++ )
+            {
+                // A size the client could not have begun is skipped rather than trusted
+                ServiceSlot& Slot = Shared.GetSlot( c, nCompleted );
+                if ( Slot.Width > 0 && Slot.Width <= H.MaxWidth && Slot.Height > 0 && Slot.Height <= H.MaxHeight )
+                {
+                    Surface Src = { Shared.GetPixels( Slot ), Slot.Width, Slot.Height, Slot.Width * 4 };
+                    Surface Dst = { &Output[0], Slot.Width, Slot.Height, Slot.Width * 4 };
+                    Engine.SetThreshold( Slot.fThreshold );
+                    Engine.Apply( Src, Dst );
+                    memcpy( Src.pData, Dst.pData, (size_t)Src.Pitch * Src.Height );
+                }
+                SetWord( Channel.Completed, nCompleted + 1, m_Events[H.nThreads + c] );
+                m_nFrames++;
+                bWorked = true;
+            }
+        }
+
+        bool bIdle = !bWorked && !WaitWord( Wake, nWake, m_Events[nThread], kWaitSliceMs );
+        if ( bIdle || GetTimeMs() - LastCheck > 1000.0 )
+        {
+            for ( int c = nThread; c < H.nChannels; c += H.nThreads )
+            {
+                ServiceChannel& Channel = Shared.GetChannel( c );
+                uint32_t Owner = Channel.Owner.load();
+                if ( Owner && !IsProcessAlive( Owner ) )
+                {
+                    SetWord( Channel.Completed, Channel.Submitted.Value.load(), m_Events[H.nThreads + c] );
+                    Channel.Owner.store( 0 );
+                }
+            }
+            LastCheck = GetTimeMs();
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Client
+//--------------------------------------------------------------------------------------
+ServiceClient::ServiceClient() :
+    m_pShared( NULL ),
+    m_nChannel( -1 ),
+    m_nSubmitted( 0 ),
+    m_bBegun( false )
+{
+}
+
+ServiceClient::~ServiceClient()
+{
+    Disconnect();
+}
+
+bool ServiceClient::Connect( const char* pName )
+{
+    Disconnect();
+
+    m_pShared = MapShared( pName, 0, false );
+    if ( !m_pShared )
+        return false;
+
+    const ServiceHeader& H = m_pShared->GetHeader();
+    if ( H.Magic != kServiceMagic || H.Version != kServiceVersion || !H.bReady.load() || H.bStopping.load() ||
+         H.TotalBytes > m_pShared->nBytes )
+    {
+        UnmapShared( m_pShared, false );
+        m_pShared = NULL;
+        return false;
+    }
+
+    const uint32_t Process = GetProcess();
+    for ( int c = 0; c < H.nChannels && m_nChannel < 0; c++ )
+    {
+        uint32_t Free = 0;
+        if ( m_pShared->GetChannel( c ).Owner.compare_exchange_strong( Free, Process ) )
+            m_nChannel = c;
+    }
+    if ( m_nChannel < 0 )
+    {
+        UnmapShared( m_pShared, false );
+        m_pShared = NULL;
+        return false;
+    }
+
+    m_Events.push_back( OpenCountEvent( pName, "Wake", m_nChannel % H.nThreads, false ) );
+    m_Events.push_back( OpenCountEvent( pName, "Done", m_nChannel, false ) );
+    m_nSubmitted = m_pShared->GetChannel( m_nChannel ).Submitted.Value.load();
+    m_bBegun = false;
+    return true;
+}
+
+void ServiceClient::Disconnect()
+{
+    if ( !m_pShared )
+        return;
+
+    if ( m_nSubmitted != m_pShared->GetChannel( m_nChannel ).Completed.Value.load() )
+        WaitFrame( m_nSubmitted - 1 );
+    m_pShared->GetChannel( m_nChannel ).Owner.store( 0 );
+
+    UnmapShared( m_pShared, false );
+    m_pShared = NULL;
+    m_nChannel = -1;
+    CloseCountEvents( m_Events );
+}
+
+int ServiceClient::GetSlotCount() const
+{
+    return m_pShared ? m_pShared->GetHeader().nSlots : 0;
+}
+
+int ServiceClient::GetMaxWidth() const
+{
+    return m_pShared ? m_pShared->GetHeader().MaxWidth : 0;
+}
+
+int ServiceClient::GetMaxHeight() const
+{
+    return m_pShared ? m_pShared->GetHeader().MaxHeight : 0;
+}
+
+bool ServiceClient::BeginFrame( int Width, int Height, Surface& Frame )
+{
+    assert( m_pShared && !m_bBegun );
+
+    const ServiceHeader& H = m_pShared->GetHeader();
+    const ServiceChannel& Channel = m_pShared->GetChannel( m_nChannel );
+    if ( Width <= 0 || Width > H.MaxWidth || Height <= 0 || Height > H.MaxHeight ||
+         m_nSubmitted - Channel.Completed.Value.load( std::memory_order_acquire ) >= (uint32_t)H.nSlots )
+    {
+        return false;
+    }
+
+    ServiceSlot& Slot = m_pShared->GetSlot( m_nChannel, m_nSubmitted );
+    Slot.Width = Width;
+    Slot.Height = Height;
+    Frame.pData = m_pShared->GetPixels( Slot );
+    Frame.Width = Width;
+    Frame.Height = Height;
+    Frame.Pitch = Width * 4;
+    m_bBegun = true;
+    return true;
+}
+
+uint32_t ServiceClient::SubmitFrame( float fThreshold )
+{
+    assert( m_pShared && m_bBegun );
+
+    m_pShared->GetSlot( m_nChannel, m_nSubmitted ).fThreshold = fThreshold;
+    SetWord( m_pShared->GetChannel( m_nChannel ).Submitted, m_nSubmitted + 1, NULL );
+    m_bBegun = false;
+
+    SharedWord& Wake = m_pShared->GetWake( m_nChannel % m_pShared->GetHeader().nThreads );
+    Wake.Value.fetch_add( 1 );
+    WakeWord( Wake, m_Events[0] );
+
+    return m_nSubmitted++;
+}
+
+bool ServiceClient::IsFrameDone( uint32_t Ticket ) const
+{
+    assert( m_pShared );
+    return (int32_t)( m_pShared->GetChannel( m_nChannel ).Completed.Value.load( std::memory_order_acquire ) - Ticket ) > 0;
+}
+
+bool ServiceClient::WaitFrame( uint32_t Ticket, int TimeoutMs )
+{
+    assert( m_pShared );
+
+    const ServiceHeader& H = m_pShared->GetHeader();
+    SharedWord& Completed = m_pShared->GetChannel( m_nChannel ).Completed;
+    const double StartTime = GetTimeMs();
+    for ( ;; )
+    {
+        uint32_t nCompleted = Completed.Value.load( std::memory_order_acquire );
+        if ( (int32_t)( nCompleted - Ticket ) > 0 )
+            return true;
+        if ( H.bStopping.load() )
+            return false;
+
+        int SliceMs = kWaitSliceMs;
+        if ( TimeoutMs >= 0 )
+        {
+            int RemainingMs = TimeoutMs - (int)( GetTimeMs() - StartTime );
+            if ( RemainingMs <= 0 )
+                return false;
+            SliceMs = ( RemainingMs < SliceMs ) ? RemainingMs : SliceMs;
+        }
+        if ( !WaitWord( Completed, nCompleted, m_Events[1], SliceMs ) && !IsProcessAlive( H.ServiceProcess ) )
+            return false;
+    }
+}
+
+Surface ServiceClient::GetFrame( uint32_t Ticket ) const
+{
+    assert( m_pShared );
+
+    ServiceSlot& Slot = m_pShared->GetSlot( m_nChannel, Ticket );
+    Surface Frame = { m_pShared->GetPixels( Slot ), Slot.Width, Slot.Height, Slot.Width * 4 };
+    return Frame;
+}
@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Service.h
+//
+// MLAA as a long-lived local service. A Service creates a named shared memory region with
+// a ring of frame slots per channel, and runs engine threads that stay warm between
+// clients. A ServiceClient in another process claims a channel, writes frames into its
+// slots and submits them. The service anti-aliases each frame in its slot and signals its
+// completion.
+//
+// A channel is a single producer, single consumer ring as in DXUTLockFreePipe, across
+// processes. The client only writes the submitted count and the service only writes the
+// completed count. DXUTLockFreePipe relies on compiler barriers and the ordering of x86
+// stores; here the counts are std::atomic with release stores and acquire loads, which
+// also fence on other processors. Waits spin briefly, then block on a futex on Linux or a
+// named event on Windows, and poll elsewhere.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_SERVICE_H
+#define MLAA_SERVICE_H
+
+#include "MLAA_CPU.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Size of the shared memory of a service
+    //--------------------------------------------------------------------------------------
+    struct ServiceDesc
+    {
+        int     nChannels;          // Clients connected at once
+        int     nSlots;             // Frames in flight per client, a power of two
+        int     MaxWidth;           // Largest frame
+        int     MaxHeight;
+        int     nThreads;           // Engine threads, 0 for one per processor. Capped to nChannels
+    };
+
+    struct ServiceShared;
+
+    //--------------------------------------------------------------------------------------
+    // The service. A channel is served by one thread, in submission order: thread t serves
+    // channels t, t + nThreads, ... A channel whose client process exited without
+    // disconnecting is freed by its thread
+    //--------------------------------------------------------------------------------------
+    class Service
+    {
+    public:
+
+        Service();
+        ~Service();
+
+        // Settings of the engines, taken at Create. The threshold is set per frame
+        void SetEdgeSearch( EDGE_SEARCH Search ) { m_EdgeSearch = Search; }
+
+        // Creates the shared memory and starts the threads. Fails if a running service has
+        // the name, the memory of one that exited is replaced
+        bool Create( const char* pName, const ServiceDesc& Desc );
+
+        // Stops the threads, clients then fail to wait, and frees the shared memory
+        void Destroy();
+
+        int GetThreadCount() const { return (int)m_Threads.size(); }
+
+        // Frames processed since Create
+        uint64_t GetFrameCount() const { return m_nFrames.load(); }
+
+    private:
+
+        void ThreadMain( int nThread );
+
+        Service( const Service& );
+        Service& operator=( const Service& );
+
+    private:
+
+        EDGE_SEARCH                 m_EdgeSearch;
+        std::string                 m_Name;
+        ServiceShared*              m_pShared;
+        std::vector<void*>          m_Events;       // Named events on Windows: the threads', then the channels'
+        std::vector<std::thread>    m_Threads;
+        std::atomic<uint64_t>       m_nFrames;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A client. Frames are 32 bit with the luma in alpha, rows packed. A frame is numbered
+    // by a ticket and its slot is reused nSlots tickets later, so the client must be done
+    // reading it before it begins that frame
+    //--------------------------------------------------------------------------------------
+    class ServiceClient
+    {
+    public:
+
+        ServiceClient();
+        ~ServiceClient();
+
+        // Opens the service and claims a free channel
+        bool Connect( const char* pName );
+
+        // Waits for the frames in flight and frees the channel
+        void Disconnect();
+
+        int GetSlotCount() const;
+        int GetMaxWidth() const;
+        int GetMaxHeight() const;
+
+        // The slot of the next frame, to write it in. Fails while nSlots frames are in flight
+        // or if the size is larger than the service allows
+        bool BeginFrame( int Width, int Height, Surface& Frame );
+
+        // Submits the frame begun and returns its ticket
+        uint32_t SubmitFrame( float fThreshold );
+
+        // Whether a frame is done. Its slot then holds the result, see GetFrame
+        bool IsFrameDone( uint32_t Ticket ) const;
+
+        // Waits for a frame. Returns false on timeout or if the service stopped. TimeoutMs
+        // < 0 waits until either
+        bool WaitFrame( uint32_t Ticket, int TimeoutMs = -1 );
+
+        // The slot of a frame, with the size it was submitted with
+        Surface GetFrame( uint32_t Ticket ) const;
+
+    private:
+
+        ServiceClient( const ServiceClient& );
+        ServiceClient& operator=( const ServiceClient& );
+
+        ServiceShared*              m_pShared;
+        std::vector<void*>          m_Events;       // On Windows, the event of the serving thread and the channel's
+        int                         m_nChannel;
+        uint32_t                    m_nSubmitted;   // Tickets so far, the next frame is this ticket
+        bool                        m_bBegun;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_SERVICE_H
@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_SurfacePool.cpp
+//
+// Surface pool with hysteresis, see MLAA_SurfacePool.h
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_SurfacePool.h"
+
+#include <assert.h>
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Constructor / destructor
+//--------------------------------------------------------------------------------------
+SurfacePool::SurfacePool( ISurfaceAllocator* pAllocator ) :
+    m_pAllocator( pAllocator ),
+    m_nGranularity( 64 ),
+    m_nGrowthPercent( 12 ),
+    m_nShrinkPercent( 200 ),
+    m_nShrinkDelay( 8 ),
+    m_nAllocations( 0 ),
+    m_nFrees( 0 )
+{
+}
+
+SurfacePool::~SurfacePool()
+{
+    Clear();
+}
+
+//--------------------------------------------------------------------------------------
+// Policy
+//--------------------------------------------------------------------------------------
+void SurfacePool::SetGrowthPolicy( int nGranularity, int nGrowthPercent )
+{
+    m_nGranularity = ( nGranularity > 1 ) ? nGranularity : 1;
+    m_nGrowthPercent = ( nGrowthPercent > 0 ) ? nGrowthPercent : 0;
+}
+
+void SurfacePool::SetShrinkPolicy( int nShrinkPercent, int nShrinkDelay )
+{
+    m_nShrinkPercent = ( nShrinkPercent > 100 ) ? nShrinkPercent : 100;
+    m_nShrinkDelay = ( nShrinkDelay > 0 ) ? nShrinkDelay : 0;
+}
+
+//--------------------------------------------------------------------------------------
+// Helpers
+//--------------------------------------------------------------------------------------
+bool SurfacePool::SameKey( const SurfaceDesc& a, const SurfaceDesc& b )
+{
+    return ( a.Format == b.Format ) && ( a.ViewFormat == b.ViewFormat ) && ( a.SampleCount == b.SampleCount ) &&
+           ( a.BindFlags == b.BindFlags ) && ( a.Usage == b.Usage );
+}
+
+int SurfacePool::RoundUpSize( int nSize ) const
+{
+    int nPadded = nSize + ( nSize * m_nGrowthPercent ) / 100;
+    return ( ( nPadded + m_nGranularity - 1 ) / m_nGranularity ) * m_nGranularity;
+}
+
+void SurfacePool::FreeEntry( size_t Index )
+{
+    m_pAllocator->Free( m_Entries[Index].pSurface );
+    m_nFrees++;
+    m_Entries.erase( m_Entries.begin() + Index );
+}
+
+//--------------------------------------------------------------------------------------
+// Acquire a surface, reusing the smallest free one that fits
+//--------------------------------------------------------------------------------------
+void* SurfacePool::Acquire( const SurfaceDesc& Desc, int* pWidth, int* pHeight, bool bExactSize )
+{
+    assert( Desc.Width > 0 && Desc.Height > 0 );
+
+    size_t Best = m_Entries.size();
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+    {
+        const Entry& Candidate = m_Entries[i];
+        if ( Candidate.bAcquired || !SameKey( Candidate.Desc, Desc ) )
+        {
+            continue;
+        }
+
+        bool bFits = bExactSize ? ( Candidate.Desc.Width == Desc.Width && Candidate.Desc.Height == Desc.Height )
+                                : ( Candidate.Desc.Width >= Desc.Width && Candidate.Desc.Height >= Desc.Height );
+        if ( !bFits )
+        {
+            continue;
+        }
+
+        if ( Best == m_Entries.size() ||
+             (double)Candidate.Desc.Width * Candidate.Desc.Height < (double)m_Entries[Best].Desc.Width * m_Entries[Best].Desc.Height )
+        {
+            Best = i;
+        }
+    }
+
+    if ( Best < m_Entries.size() )
+    {
+        Entry& Found = m_Entries[Best];
+        double RequestArea = (double)Desc.Width * Desc.Height;
+        double SurfaceArea = (double)Found.Desc.Width * Found.Desc.Height;
+        if ( SurfaceArea * 100.0 > RequestArea * m_nShrinkPercent )
+        {
+            Found.nOversized++;
+        }
+        else
+        {
+            Found.nOversized = 0;
+        }
+
+        if ( Found.nOversized <= m_nShrinkDelay )
+        {
+            Found.bAcquired = true;
+            if ( pWidth ) *pWidth = Found.Desc.Width;
+            if ( pHeight ) *pHeight = Found.Desc.Height;
+            return Found.pSurface;
+        }
+
+        // Too large for too long, replace it with a smaller one
+        FreeEntry( Best );
+    }
+
+    Entry NewEntry;
+    NewEntry.Desc = Desc;
+    if ( !bExactSize )
+    {
+        NewEntry.Desc.Width = RoundUpSize( Desc.Width );
+        NewEntry.Desc.Height = RoundUpSize( Desc.Height );
+    }
+    NewEntry.pSurface = m_pAllocator->Allocate( NewEntry.Desc );
+    NewEntry.bAcquired = true;
+    NewEntry.nOversized = 0;
+    if ( NewEntry.pSurface == NULL )
+    {
+        return NULL;
+    }
+    m_nAllocations++;
+    m_Entries.push_back( NewEntry );
+
+    if ( pWidth ) *pWidth = NewEntry.Desc.Width;
+    if ( pHeight ) *pHeight = NewEntry.Desc.Height;
+    return NewEntry.pSurface;
+}
+
+//--------------------------------------------------------------------------------------
+// Release
+//--------------------------------------------------------------------------------------
+void SurfacePool::Release( void* pSurface )
+{
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+    {
+        if ( m_Entries[i].pSurface == pSurface )
+        {
+            m_Entries[i].bAcquired = false;
+            return;
+        }
+    }
+    assert( !"Surface does not belong to the pool" );
+}
+
+void SurfacePool::ReleaseAll()
+{
+    for ( size_t i = 0; i < m_Entries.size(); i++ )
+    {
+        m_Entries[i].bAcquired = false;
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Free surfaces
+//--------------------------------------------------------------------------------------
+void SurfacePool::Trim()
+{
+    for ( size_t i = m_Entries.size(); i > 0; i-- )
+    {
+        if ( !m_Entries[i - 1].bAcquired )
+        {
+            FreeEntry( i - 1 );
+        }
+    }
+}
+
+void SurfacePool::Clear()
+{
+    while ( !m_Entries.empty() )
+    {
+        FreeEntry( m_Entries.size() - 1 );
+    }
+}
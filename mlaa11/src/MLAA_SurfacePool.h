@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_SurfacePool.h
+//
+// Pool of render surfaces keyed by format, sample count and usage. Surfaces are allocated
+// larger than requested, so a growing window reuses them through a viewport sub-rect
+// instead of reallocating on every resize. Oversized surfaces are only given up after
+// they have been too large for several requests in a row.
+//
+// The pool has no dependency on a graphics API: it creates and frees surfaces through
+// ISurfaceAllocator, which the application implements for its device.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_SURFACE_POOL_H
+#define MLAA_SURFACE_POOL_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // Description of a pooled surface. Everything except the size is part of the pool key,
+    // the meaning of the format, bind and usage values is up to the allocator
+    //--------------------------------------------------------------------------------------
+    struct SurfaceDesc
+    {
+        int             Width;
+        int             Height;
+        unsigned int    Format;         // Format of the surface
+        unsigned int    ViewFormat;     // Format of the views created for it
+        int             SampleCount;
+        unsigned int    BindFlags;
+        unsigned int    Usage;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Creates and destroys the surfaces owned by the pool
+    //--------------------------------------------------------------------------------------
+    class ISurfaceAllocator
+    {
+    public:
+
+        virtual ~ISurfaceAllocator() {}
+
+        // Returns NULL on failure. Desc holds the allocated size, which may exceed the request
+        virtual void* Allocate( const SurfaceDesc& Desc ) = 0;
+        virtual void Free( void* pSurface ) = 0;
+    };
+
+    class SurfacePool
+    {
+    public:
+
+        SurfacePool( ISurfaceAllocator* pAllocator );
+        ~SurfacePool();
+
+        // Sizes are rounded up to a multiple of Granularity after adding GrowthPercent headroom
+        void SetGrowthPolicy( int nGranularity, int nGrowthPercent );
+
+        // A surface more than ShrinkPercent of the requested area is reallocated once it
+        // has been too large for ShrinkDelay acquires in a row
+        void SetShrinkPolicy( int nShrinkPercent, int nShrinkDelay );
+
+        // Returns a surface of at least the requested size, or NULL if allocation failed.
+        // pWidth and pHeight receive the allocated size. With bExactSize the allocated size
+        // must match the request, for surfaces that are copied to or from another surface
+        void* Acquire( const SurfaceDesc& Desc, int* pWidth = NULL, int* pHeight = NULL, bool bExactSize = false );
+
+        // Hands a surface back to the pool, it stays allocated for the next Acquire
+        void Release( void* pSurface );
+        void ReleaseAll();
+
+        // Frees the surfaces that are not acquired
+        void Trim();
+
+        // Frees everything, acquired surfaces included
+        void Clear();
+
+        // Number of Allocate and Free calls made since the pool was created
+        int GetAllocationCount() const { return m_nAllocations; }
+        int GetFreeCount() const { return m_nFrees; }
+        int GetSurfaceCount() const { return (int)m_Entries.size(); }
+
+    private:
+
+        struct Entry
+        {
+            SurfaceDesc     Desc;           // Allocated size
+            void*           pSurface;
+            bool            bAcquired;
+            int             nOversized;     // Consecutive acquires for which the surface was too large
+        };
+
+        static bool SameKey( const SurfaceDesc& a, const SurfaceDesc& b );
+        int RoundUpSize( int nSize ) const;
+        void FreeEntry( size_t Index );
+
+    private:
+
+        ISurfaceAllocator*      m_pAllocator;
+        std::vector<Entry>      m_Entries;
+
+        int                     m_nGranularity;
+        int                     m_nGrowthPercent;
+        int                     m_nShrinkPercent;
+        int                     m_nShrinkDelay;
+
+        int                     m_nAllocations;
+        int                     m_nFrees;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_SURFACE_POOL_H
@@ -0,0 +1,606 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Tiled.cpp
+//
+// A tile is a message header followed by the stored pixels, rows packed. The result is
+// a header followed by the owned pixels, which the worker packs at the start of its
+// output. The connections are blocking: a coordinator thread sends a tile then waits for
+// its result, so a worker never has more than one tile to hold.
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Tiled.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#if defined(_MSC_VER)
+#pragma comment( lib, "ws2_32.lib" )
+#endif
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace MLAA;
+
+//--------------------------------------------------------------------------------------
+// Protocol. The coordinator and the workers must be built from the same source
+//--------------------------------------------------------------------------------------
+static const uint32_t kTileMagic        = 0x414c4d54;   // "TMLA"
+static const uint32_t kTileVersion      = 2;
+static const int      kMaxTileSide      = 1 << 16;      // Of the stored pixels, bounds what a worker allocates
+static const size_t   kMaxTileBytes     = (size_t)1 << 30;
+
+enum MESSAGE
+{
+    MESSAGE_HELLO,          // Worker to coordinator on connection
+    MESSAGE_TILE,
+    MESSAGE_RESULT,
+    MESSAGE_QUIT
+};
+
+struct TileMessage
+{
+    uint32_t    Magic;
+    uint32_t    Version;
+    uint32_t    Type;
+    int32_t     Width;              // Tile: the stored pixels. Result: the owned pixels
+    int32_t     Height;
+    Rect        Region;             // Tile: the owned pixels within the stored ones
+    float       fThreshold;
+    int32_t     EdgeSearch;
+    float       fTime;              // Result: milliseconds the worker took
+};
+
+static TileMessage MakeMessage( MESSAGE Type )
+{
+    TileMessage Message;
+    memset( &Message, 0, sizeof(Message) );
+    Message.Magic = kTileMagic;
+    Message.Version = kTileVersion;
+    Message.Type = Type;
+    return Message;
+}
+
+static bool IsMessage( const TileMessage& Message, MESSAGE Type )
+{
+    return Message.Magic == kTileMagic && Message.Version == kTileVersion && Message.Type == (uint32_t)Type;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Sockets. Windows needs the library started once, elsewhere a send to a closed
+// connection must not raise SIGPIPE
+//--------------------------------------------------------------------------------------
+#if defined(_WIN32)
+typedef int SocketLength;
+static const uintptr_t kInvalidSocket = (uintptr_t)INVALID_SOCKET;
+static const int kSendFlags = 0;
+
+static std::once_flag s_SocketsStarted;
+static bool s_bSocketsStarted = false;
+
+static bool StartSockets()
+{
+    std::call_once( s_SocketsStarted, []()
+    {
+        WSADATA Data;
+        s_bSocketsStarted = ( WSAStartup( MAKEWORD( 2, 2 ), &Data ) == 0 );
+    } );
+    return s_bSocketsStarted;
+}
+
+static void CloseSocket( uintptr_t Socket )
+{
+    closesocket( (SOCKET)Socket );
+}
+#else
+typedef socklen_t SocketLength;
+static const uintptr_t kInvalidSocket = (uintptr_t)-1;
+#if defined(MSG_NOSIGNAL)
+static const int kSendFlags = MSG_NOSIGNAL;
+#else
+static const int kSendFlags = 0;
+#endif
+
+static bool StartSockets()
+{
+    return true;
+}
+
+static void CloseSocket( uintptr_t Socket )
+{
+    close( (int)Socket );
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Headers and results are small, they are sent without waiting to fill a packet
+//--------------------------------------------------------------------------------------
+static void ConfigureSocket( uintptr_t Socket )
+{
+    int On = 1;
+    setsockopt( Socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&On, sizeof(On) );
+#if defined(SO_NOSIGPIPE)
+    setsockopt( Socket, SOL_SOCKET, SO_NOSIGPIPE, (const char*)&On, sizeof(On) );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Tiles
+//--------------------------------------------------------------------------------------
+void MLAA::GetTiles( int Width, int Height, int TileSize, int Halo, std::vector<Tile>& Tiles )
+{
+    assert( TileSize > 0 && Halo >= 0 );
+
+    Tiles.clear();
+    for ( int Top = 0; Top < Height; Top += TileSize )
+    {
+        for ( int Left = 0; Left < Width; Left += TileSize )
+        {
+            Tile T;
+            T.Region.Left = Left;
+            T.Region.Top = Top;
+            T.Region.Right = ( Width - Left > TileSize ) ? Left + TileSize : Width;
+            T.Region.Bottom = ( Height - Top > TileSize ) ? Top + TileSize : Height;
+            T.Stored.Left = ( Left > Halo ) ? Left - Halo : 0;
+            T.Stored.Top = ( Top > Halo ) ? Top - Halo : 0;
+            T.Stored.Right = ( Width - T.Region.Right > Halo ) ? T.Region.Right + Halo : Width;
+            T.Stored.Bottom = ( Height - T.Region.Bottom > Halo ) ? T.Region.Bottom + Halo : Height;
+            Tiles.push_back( T );
+        }
+    }
+}
+
+bool SurfaceTileIO::ReadPixels( const Rect& Area, uint8_t* pDst, int Pitch )
+{
+    assert( Area.Left >= 0 && Area.Top >= 0 && Area.Right <= m_Src.Width && Area.Bottom <= m_Src.Height );
+
+    const size_t nRowBytes = (size_t)( Area.Right - Area.Left ) * 4;
+    for ( int y = Area.Top; y < Area.Bottom; y++ )
+        memcpy( pDst + (size_t)( y - Area.Top ) * Pitch, m_Src.pData + (size_t)y * m_Src.Pitch + Area.Left * 4, nRowBytes );
+    return true;
+}
+
+bool SurfaceTileIO::WritePixels( const Rect& Area, const uint8_t* pSrc, int Pitch )
+{
+    assert( Area.Left >= 0 && Area.Top >= 0 && Area.Right <= m_Dst.Width && Area.Bottom <= m_Dst.Height );
+
+    const size_t nRowBytes = (size_t)( Area.Right - Area.Left ) * 4;
+    for ( int y = Area.Top; y < Area.Bottom; y++ )
+        memcpy( m_Dst.pData + (size_t)y * m_Dst.Pitch + Area.Left * 4, pSrc + (size_t)( y - Area.Top ) * Pitch, nRowBytes );
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Connections
+//--------------------------------------------------------------------------------------
+TileConnection::TileConnection() :
+    m_Socket( kInvalidSocket )
+{
+}
+
+TileConnection::~TileConnection()
+{
+    Close();
+}
+
+bool TileConnection::Connect( const char* pHost, int Port )
+{
+    Close();
+    if ( !StartSockets() )
+        return false;
+
+    char Service[16];
+    sprintf( Service, "%d", Port );
+
+    addrinfo Hints;
+    memset( &Hints, 0, sizeof(Hints) );
+    Hints.ai_family = AF_UNSPEC;
+    Hints.ai_socktype = SOCK_STREAM;
+    Hints.ai_protocol = IPPROTO_TCP;
+
+    addrinfo* pAddresses = NULL;
+    if ( getaddrinfo( pHost, Service, &Hints, &pAddresses ) != 0 )
+        return false;
+
+    for ( addrinfo* p = pAddresses; p && m_Socket == kInvalidSocket; p = p->ai_next )
+    {
+        uintptr_t Socket = (uintptr_t)socket( p->ai_family, p->ai_socktype, p->ai_protocol );
+        if ( Socket == kInvalidSocket )
+            continue;
+
+        if ( connect( Socket, p->ai_addr, (SocketLength)p->ai_addrlen ) == 0 )
+        {
+            ConfigureSocket( Socket );
+            m_Socket = Socket;
+        }
+        else
+        {
+            CloseSocket( Socket );
+        }
+    }
+    freeaddrinfo( pAddresses );
+    return IsOpen();
+}
+
+bool TileConnection::Send( const void* pData, size_t nBytes )
+{
+    const char* p = (const char*)pData;
+    while ( nBytes > 0 && IsOpen() )
+    {
+        int nChunk = (int)( ( nBytes < kMaxTileBytes ) ? nBytes : kMaxTileBytes );
+        int nSent = (int)send( m_Socket, p, nChunk, kSendFlags );
+        if ( nSent <= 0 )
+        {
+            Close();
+            return false;
+        }
+        p += nSent;
+        nBytes -= nSent;
+    }
+    return IsOpen();
+}
+
+bool TileConnection::Receive( void* pData, size_t nBytes )
+{
+    char* p = (char*)pData;
+    while ( nBytes > 0 && IsOpen() )
+    {
+        int nChunk = (int)( ( nBytes < kMaxTileBytes ) ? nBytes : kMaxTileBytes );
+        int nReceived = (int)recv( m_Socket, p, nChunk, 0 );
+        if ( nReceived <= 0 )
+        {
+            Close();
+            return false;
+        }
+        p += nReceived;
+        nBytes -= nReceived;
+    }
+    return IsOpen();
+}
+
+void TileConnection::Close()
+{
+    if ( m_Socket != kInvalidSocket )
+    {
+        CloseSocket( m_Socket );
+        m_Socket = kInvalidSocket;
+    }
+}
+
+bool TileConnection::IsOpen() const
+{
+    return m_Socket != kInvalidSocket;
+}
+
+TileListener::TileListener() :
+    m_Socket( kInvalidSocket ),
+    m_nPort( 0 )
+{
+}
+
+TileListener::~TileListener()
+{
+    Close();
+}
+
+bool TileListener::Listen( int Port, bool bLocal )
+{
+    Close();
+    if ( !StartSockets() )
+        return false;
+
+    m_Socket = (uintptr_t)socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+    if ( m_Socket == kInvalidSocket )
+        return false;
+
+#if !defined(_WIN32)
+    // Windows lets another socket take the port with this, elsewhere it only allows
+    // listening again while the connections of a previous run are closing
+    int On = 1;
+    setsockopt( m_Socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&On, sizeof(On) );
+#endif
+
+    sockaddr_in Address;
+    memset( &Address, 0, sizeof(Address) );
+    Address.sin_family = AF_INET;
+    Address.sin_port = htons( (uint16_t)Port );
+    Address.sin_addr.s_addr = htonl( bLocal ? INADDR_LOOPBACK : INADDR_ANY );
+
+    SocketLength nLength = sizeof(Address);
+    if ( bind( m_Socket, (const sockaddr*)&Address, sizeof(Address) ) != 0 ||
+         listen( m_Socket, SOMAXCONN ) != 0 ||
+         getsockname( m_Socket, (sockaddr*)&Address, &nLength ) != 0 )
+    {
+        Close();
+        return false;
+    }
+    m_nPort = ntohs( Address.sin_port );
+    return true;
+}
+
+bool TileListener::Accept( TileConnection& Connection )
+{
+    Connection.Close();
+    if ( m_Socket == kInvalidSocket )
+        return false;
+
+    uintptr_t Socket = (uintptr_t)accept( m_Socket, NULL, NULL );
+    if ( Socket == kInvalidSocket )
+        return false;
+
+    ConfigureSocket( Socket );
+    Connection.m_Socket = Socket;
+    return true;
+}
+
+void TileListener::Close()
+{
+    if ( m_Socket != kInvalidSocket )
+    {
+        CloseSocket( m_Socket );
+        m_Socket = kInvalidSocket;
+    }
+    m_nPort = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Worker
+//--------------------------------------------------------------------------------------
+TileWorker::TileWorker() :
+    m_nTiles( 0 )
+{
+}
+
+bool TileWorker::Run( const char* pHost, int Port )
+{
+    TileConnection Connection;
+    if ( !Connection.Connect( pHost, Port ) )
+        return false;
+
+    TileMessage Hello = MakeMessage( MESSAGE_HELLO );
+    if ( !Connection.Send( &Hello, sizeof(Hello) ) )
+        return false;
+
+    for ( ;; )
+    {
+        TileMessage Message;
+        if ( !Connection.Receive( &Message, sizeof(Message) ) )
+            return false;
+        if ( IsMessage( Message, MESSAGE_QUIT ) )
+            return true;
+
+        const Rect& Region = Message.Region;
+        if ( !IsMessage( Message, MESSAGE_TILE ) ||
+             Message.Width <= 0 || Message.Width > kMaxTileSide || Message.Height <= 0 || Message.Height > kMaxTileSide ||
+             Region.Left < 0 || Region.Top < 0 || Region.Right > Message.Width || Region.Bottom > Message.Height ||
+             Region.Left >= Region.Right || Region.Top >= Region.Bottom ||
+             Message.EdgeSearch < EDGE_SEARCH_SHORT || Message.EdgeSearch > EDGE_SEARCH_LONG_NAIVE )
+        {
+            return false;
+        }
+
+        // Same sized tiles keep the capacity of the buffers
+        const int Pitch = Message.Width * 4;
+        m_Src.resize( (size_t)Pitch * Message.Height );
+        m_Dst.resize( (size_t)Pitch * Message.Height );
+        if ( !Connection.Receive( &m_Src[0], m_Src.size() ) )
+            return false;
+
+        double StartTime = GetTimeMs();
+        m_Engine.SetThreshold( Message.fThreshold );
+        m_Engine.SetEdgeSearch( (EDGE_SEARCH)Message.EdgeSearch );
+
+        Surface Src = { &m_Src[0], Message.Width, Message.Height, Pitch };
+        Surface Dst = { &m_Dst[0], Message.Width, Message.Height, Pitch };
+        m_Engine.Apply( Src, Dst, Region );
+
+        // Packed in place, a row never moves past where it was
+        const int RegionWidth = Region.Right - Region.Left;
+        const int RegionHeight = Region.Bottom - Region.Top;
+        for ( int y = 0; y < RegionHeight; y++ )
+            memmove( &m_Dst[(size_t)y * RegionWidth * 4], &m_Dst[(size_t)( Region.Top + y ) * Pitch + Region.Left * 4], (size_t)RegionWidth * 4 );
+
+        TileMessage Result = MakeMessage( MESSAGE_RESULT );
+        Result.Width = RegionWidth;
+        Result.Height = RegionHeight;
+        Result.Region = Region;
+        Result.fTime = (float)( GetTimeMs() - StartTime );
+        if ( !Connection.Send( &Result, sizeof(Result) ) ||
+             !Connection.Send( &m_Dst[0], (size_t)RegionWidth * RegionHeight * 4 ) )
+        {
+            return false;
+        }
+        m_nTiles++;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Coordinator
+//--------------------------------------------------------------------------------------
+TiledEngine::TiledEngine() :
+    m_fThreshold( kDefaultThreshold ),
+    m_EdgeSearch( EDGE_SEARCH_SHORT ),
+    m_nTileSize( 1024 ),
+    m_nNextTile( 0 ),
+    m_bFailed( false ),
+    m_fApplyTime( 0.0 ),
+    m_fWorkerTime( 0.0 )
+{
+}
+
+TiledEngine::~TiledEngine()
+{
+    Disconnect();
+}
+
+void TiledEngine::SetTileSize( int TileSize )
+{
+    assert( TileSize > 0 && TileSize <= kMaxTileSide / 2 );
+    m_nTileSize = TileSize;
+}
+
+int TiledEngine::GetHalo() const
+{
+    return ( m_EdgeSearch != EDGE_SEARCH_SHORT ) ? kLongRegionHalo : kRegionHalo;
+}
+
+bool TiledEngine::Listen( int Port, bool bLocal )
+{
+    return m_Listener.Listen( Port, bLocal );
+}
+
+bool TiledEngine::AcceptWorkers( int nWorkers )
+{
+    for ( int i = 0; i < nWorkers; i++ )
+    {
+        std::unique_ptr<Worker> pWorker( new Worker );
+        pWorker->fTime = 0.0;
+        pWorker->bFailed = false;
+
+        TileMessage Hello;
+        if ( !m_Listener.Accept( pWorker->Connection ) ||
+             !pWorker->Connection.Receive( &Hello, sizeof(Hello) ) || !IsMessage( Hello, MESSAGE_HELLO ) )
+        {
+            return false;
+        }
+        m_Workers.push_back( std::move( pWorker ) );
+    }
+    return true;
+}
+
+void TiledEngine::Disconnect()
+{
+    TileMessage Quit = MakeMessage( MESSAGE_QUIT );
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+        m_Workers[i]->Connection.Send( &Quit, sizeof(Quit) );
+    m_Workers.clear();
+}
+
+bool TiledEngine::Apply( const Surface& Src, const Surface& Dst )
+{
+    assert( Src.Width == Dst.Width && Src.Height == Dst.Height );
+
+    SurfaceTileIO IO( Src, Dst );
+    return Apply( Src.Width, Src.Height, IO );
+}
+
+bool TiledEngine::Apply( int Width, int Height, ITileIO& IO )
+{
+    assert( Width > 0 && Height > 0 );
+
+    double StartTime = GetTimeMs();
+    if ( m_Workers.empty() )
+        return false;
+
+    GetTiles( Width, Height, m_nTileSize, GetHalo(), m_Tiles );
+    m_nNextTile = 0;
+    m_bFailed = false;
+
+    std::vector<std::thread> Threads;
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        m_Workers[i]->fTime = 0.0;
+        m_Workers[i]->bFailed = false;
+        Threads.push_back( std::thread( &TiledEngine::Serve, this, std::ref( *m_Workers[i] ), std::ref( IO ) ) );
+    }
+
+    m_fWorkerTime = 0.0;
+    for ( size_t i = 0; i < m_Workers.size(); i++ )
+    {
+        Threads[i].join();
+        m_fWorkerTime += m_Workers[i]->fTime;
+    }
+
+    if ( m_bFailed )
+        Disconnect();
+
+    m_fApplyTime = GetTimeMs() - StartTime;
+    return !m_bFailed;
+}
+
+//--------------------------------------------------------------------------------------
+// Thread of a worker connection: takes the next tile until there are none left
+//--------------------------------------------------------------------------------------
+void TiledEngine::Serve( Worker& W, ITileIO& IO )
+{
+    for ( ;; )
+    {
+        size_t nTile;
+        {
+            std::lock_guard<std::mutex> Lock( m_Lock );
+            if ( m_bFailed || m_nNextTile == m_Tiles.size() )
+                return;
+            nTile = m_nNextTile++;
+        }
+
+        const Tile& T = m_Tiles[nTile];
+        TileMessage Message = MakeMessage( MESSAGE_TILE );
+        Message.Width = T.Stored.Right - T.Stored.Left;
+        Message.Height = T.Stored.Bottom - T.Stored.Top;
+        Message.Region.Left = T.Region.Left - T.Stored.Left;
+        Message.Region.Top = T.Region.Top - T.Stored.Top;
+        Message.Region.Right = T.Region.Right - T.Stored.Left;
+        Message.Region.Bottom = T.Region.Bottom - T.Stored.Top;
+        Message.fThreshold = m_fThreshold;
+        Message.EdgeSearch = m_EdgeSearch;
+
+        // The header and the pixels go in one send
+        W.Buffer.resize( sizeof(Message) + (size_t)Message.Width * Message.Height * 4 );
+        memcpy( &W.Buffer[0], &Message, sizeof(Message) );
+
+        const int RegionWidth = T.Region.Right - T.Region.Left;
+        const int RegionHeight = T.Region.Bottom - T.Region.Top;
+        TileMessage Result;
+        bool bDone = IO.ReadPixels( T.Stored, &W.Buffer[sizeof(Message)], Message.Width * 4 ) &&
+                     W.Connection.Send( &W.Buffer[0], W.Buffer.size() ) &&
+                     W.Connection.Receive( &Result, sizeof(Result) ) &&
+                     IsMessage( Result, MESSAGE_RESULT ) && Result.Width == RegionWidth && Result.Height == RegionHeight &&
+                     W.Connection.Receive( &W.Buffer[0], (size_t)RegionWidth * RegionHeight * 4 ) &&
+                     IO.WritePixels( T.Region, &W.Buffer[0], RegionWidth * 4 );
+        if ( !bDone )
+        {
+            std::lock_guard<std::mutex> Lock( m_Lock );
+            W.bFailed = true;
+            m_bFailed = true;
+            return;
+        }
+        W.fTime += Result.fTime;
+    }
+}
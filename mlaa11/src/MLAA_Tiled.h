@@ -0,0 +1,252 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA_Tiled.h
+//
+// MLAA on images too large for one process. TiledEngine cuts the image into tiles and
+// sends each one, with a halo of the pixels the passes read around it, to a worker
+// process over a TCP connection. A TileWorker runs CPUEngine::Apply with the region of
+// the tile and only sends the owned pixels back, so the reassembled image has no seams
+// and matches CPUEngine::Apply on the whole image.
+//
+// The coordinator only touches the image through ITileIO, a tile at a time, so the image
+// can be read from and written to disk. Workers can run on the same host or on others,
+// they must have the byte order of the coordinator.
+//--------------------------------------------------------------------------------------
+#ifndef MLAA_TILED_H
+#define MLAA_TILED_H
+
+#include "MLAA_CPU.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace MLAA
+{
+    //--------------------------------------------------------------------------------------
+    // A tile: the pixels it owns, and the pixels sent to a worker, the owned ones plus the
+    // halo clipped to the image
+    //--------------------------------------------------------------------------------------
+    struct Tile
+    {
+        Rect        Region;
+        Rect        Stored;
+    };
+
+    // Cuts an image into tiles of TileSize pixels, row by row
+    void GetTiles( int Width, int Height, int TileSize, int Halo, std::vector<Tile>& Tiles );
+
+    //--------------------------------------------------------------------------------------
+    // Access to the image for TiledEngine. Called by several threads at once, for
+    // different tiles: reads may overlap, writes don't. Return false on failure
+    //--------------------------------------------------------------------------------------
+    class ITileIO
+    {
+    public:
+
+        virtual ~ITileIO() {}
+
+        // Copies the pixels of Area of the input into pDst, with Pitch bytes per row
+        virtual bool ReadPixels( const Rect& Area, uint8_t* pDst, int Pitch ) = 0;
+
+        // Copies pSrc into the pixels of Area of the output
+        virtual bool WritePixels( const Rect& Area, const uint8_t* pSrc, int Pitch ) = 0;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // ITileIO on images in memory
+    //--------------------------------------------------------------------------------------
+    class SurfaceTileIO : public ITileIO
+    {
+    public:
+
+        SurfaceTileIO( const Surface& Src, const Surface& Dst ) : m_Src( Src ), m_Dst( Dst ) {}
+
+        virtual bool ReadPixels( const Rect& Area, uint8_t* pDst, int Pitch );
+        virtual bool WritePixels( const Rect& Area, const uint8_t* pSrc, int Pitch );
+
+    private:
+
+        Surface     m_Src;
+        Surface     m_Dst;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // A TCP connection. Send and Receive transfer all the bytes or fail
+    //--------------------------------------------------------------------------------------
+    class TileConnection
+    {
+    public:
+
+        TileConnection();
+        ~TileConnection();
+
+        bool Connect( const char* pHost, int Port );
+        bool Send( const void* pData, size_t nBytes );
+        bool Receive( void* pData, size_t nBytes );
+        void Close();
+
+        bool IsOpen() const;
+
+    private:
+
+        friend class TileListener;
+
+        TileConnection( const TileConnection& );
+        TileConnection& operator=( const TileConnection& );
+
+        uintptr_t   m_Socket;       // A SOCKET on Windows, a file descriptor elsewhere
+    };
+
+    class TileListener
+    {
+    public:
+
+        TileListener();
+        ~TileListener();
+
+        // Port 0 picks a free port, GetPort returns it. With bLocal only connections from
+        // the host are accepted
+        bool Listen( int Port, bool bLocal );
+        int GetPort() const { return m_nPort; }
+
+        // Waits for a connection
+        bool Accept( TileConnection& Connection );
+        void Close();
+
+    private:
+
+        TileListener( const TileListener& );
+        TileListener& operator=( const TileListener& );
+
+        uintptr_t   m_Socket;
+        int         m_nPort;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Worker side: processes the tiles of a coordinator until it disconnects. The engine
+    // keeps its intermediates between tiles, those of the edge tiles are in its scratch
+    // cache next to those of the full ones
+    //--------------------------------------------------------------------------------------
+    class TileWorker
+    {
+    public:
+
+        TileWorker();
+
+        // Connects to the coordinator and returns when it sends quit, true, or when the
+        // connection fails or a message is malformed, false
+        bool Run( const char* pHost, int Port );
+
+        int GetTileCount() const { return m_nTiles; }
+
+    private:
+
+        CPUEngine               m_Engine;
+        std::vector<uint8_t>    m_Src;
+        std::vector<uint8_t>    m_Dst;
+        int                     m_nTiles;
+    };
+
+    //--------------------------------------------------------------------------------------
+    // Coordinator side
+    //--------------------------------------------------------------------------------------
+    class TiledEngine
+    {
+    public:
+
+        TiledEngine();
+        ~TiledEngine();
+
+        // Settings sent with every tile. The halo depends on the edge search
+        void SetThreshold( float fThreshold ) { m_fThreshold = fThreshold; }
+        void SetEdgeSearch( EDGE_SEARCH Search ) { m_EdgeSearch = Search; }
+
+        // Pixels of a side of the owned part of a tile, 1024 by default
+        void SetTileSize( int TileSize );
+        int GetTileSize() const { return m_nTileSize; }
+
+        // Pixels around a tile sent with it, CPUEngine::GetRegionHalo of the settings
+        int GetHalo() const;
+
+        // Listens for workers, see TileListener::Listen
+        bool Listen( int Port, bool bLocal = true );
+        int GetPort() const { return m_Listener.GetPort(); }
+
+        // Waits for nWorkers more workers to connect
+        bool AcceptWorkers( int nWorkers );
+        int GetWorkerCount() const { return (int)m_Workers.size(); }
+
+        // Sends quit to the workers and closes their connections
+        void Disconnect();
+
+        // Processes a Width x Height image. Each worker has one tile in flight, the
+        // connections are served by a thread each. Returns false if a worker or the IO
+        // failed, the workers are then disconnected
+        bool Apply( int Width, int Height, ITileIO& IO );
+        bool Apply( const Surface& Src, const Surface& Dst );
+
+        // Of the last Apply in milliseconds: the whole, and the sum over the tiles of the
+        // time the workers took to process them
+        double GetApplyTime() const { return m_fApplyTime; }
+        double GetWorkerTime() const { return m_fWorkerTime; }
+
+    private:
+
+        struct Worker
+        {
+            TileConnection          Connection;
+            std::vector<uint8_t>    Buffer;
+            double                  fTime;
+            bool                    bFailed;
+        };
+
+        void Serve( Worker& W, ITileIO& IO );
+
+        TiledEngine( const TiledEngine& );
+        TiledEngine& operator=( const TiledEngine& );
+
+    private:
+
+        float                                   m_fThreshold;
+        EDGE_SEARCH                             m_EdgeSearch;
+        int                                     m_nTileSize;
+        TileListener                            m_Listener;
+        std::vector< std::unique_ptr<Worker> >  m_Workers;
+
+        // Tiles of the Apply in progress, the next one is taken under the lock. After a
+        // failure no more tiles are taken
+        std::mutex                              m_Lock;
+        std::vector<Tile>                       m_Tiles;
+        size_t                                  m_nNextTile;
+        bool                                    m_bFailed;
+
+        double                                  m_fApplyTime;
+        double                                  m_fWorkerTime;
+    };
+
+} // namespace MLAA
+
+#endif // MLAA_TILED_H
@@ -0,0 +1,290 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+//-----------------------------------------------------------------------------------------
+// File: MLAA11.glsl
+//
+// GLSL port of the full screen quad and of the three MLAA passes of MLAA11.hlsl, used by 
+// MLAA::GLBackend. Targets GLSL 3.30, the backend puts the #version line and the defines
+// below in front of this file.
+//
+// Images are stored top row first as in Direct3D, and texel (x, y) of every texture is
+// pixel (x, y) of gl_FragCoord, so up is -y here too.
+//-----------------------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------------------
+// Defines
+//-----------------------------------------------------------------------------------------
+#ifndef VERTEX_SHADER
+#define VERTEX_SHADER				0			// The screen quad vertex shader instead of a pass
+#endif
+
+#ifndef MLAA_PASS
+#define MLAA_PASS					0			// 1 to 3, the pass of the fragment shader
+#endif
+
+#ifndef SHOW_EDGES
+#define SHOW_EDGES					0			// Disabled by default      
+#endif
+
+//-----------------------------------------------------------------------------------------
+// Static Constants, as in MLAA11.hlsl with 4 bit counts
+//-----------------------------------------------------------------------------------------
+const uint kNumCountBits			= 4u;
+const uint kMaxEdgeLength			= ( (1u<<(kNumCountBits-1u)) - 1u );
+const uint kUpperMask				= (1u<<0);
+const uint kRightMask				= (1u<<1);
+const uint kStopBit					= (1u<<(kNumCountBits-1u));
+const uint kStopBit_BitPosition		= (kNumCountBits-1u);
+const uint kNegCountShift			= (kNumCountBits);
+const uint kPosCountShift			= (0u);
+const uint kCountShiftMask			= ((1u<<kNumCountBits)-1u);
+
+const ivec2 kUp						= ivec2( 0, -1);
+const ivec2 kRight					= ivec2( 1,  0);
+
+//-----------------------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------------------
+// (x, y)	- The size of the image.
+// (z)		- The luminance intensity difference to check for when testing any two pixels for an edge.
+uniform vec4 gParam;
+
+#if VERTEX_SHADER
+//--------------------------------------------------------------------------------------
+// Vertex shader for screen quad rendering, the vertices of ScreenQuadVertex in MLAA11.cpp
+//--------------------------------------------------------------------------------------
+layout(location = 0) in vec4 Position;
+layout(location = 1) in vec2 TextureUV;
+out vec2 vTextureUV;
+
+void main()
+{
+	gl_Position = Position;
+	vTextureUV = TextureUV;
+}
+
+#else
+//-----------------------------------------------------------------------------------------
+// Shader resources, units 0 to 2 as t0 to t2
+//-----------------------------------------------------------------------------------------
+uniform sampler2D  g_txSceneColor;
+uniform usampler2D g_txEdgeMask;
+uniform usampler2D g_txEdgeCount;
+
+//-----------------------------------------------------------------------------------------
+// Utility functions
+//-----------------------------------------------------------------------------------------
+ivec2 ClampToImage(ivec2 pos)
+{
+	return clamp(pos, ivec2(0, 0), ivec2(gParam.xy) - 1);
+}
+bool IsInsideImage(ivec2 pos)
+{
+	return all(greaterThanEqual(pos, ivec2(0, 0))) && all(lessThan(pos, ivec2(gParam.xy)));
+}
+bool CompareColors(float a, float b)
+{
+	return ( abs(a - b) > gParam.z );
+}
+// The texture unit may convert UNORM8 to float with a multiply, one ulp away from the
+// v/255 of CPUEngine that the blend is checked against
+vec4 LoadImageColor(ivec2 pos)
+{
+	return IsInsideImage(pos) ? floor(texelFetch(g_txSceneColor, pos, 0)*255.0 + 0.5) / 255.0 : vec4(0, 0, 0, 0);
+}
+bool IsBitSet(uint Value, uint uBitPosition)
+{
+	return (Value & (1u<<uBitPosition)) != 0u;
+}
+uint RemoveStopBit(uint a)
+{
+	return a & (kStopBit-1u);
+}
+uint DecodeCountNoStopBit(uint count, uint shift)
+{
+	return RemoveStopBit((count >> shift) & kCountShiftMask);
+}
+uint EncodeCount(uint negCount, uint posCount)
+{
+	return ((negCount & kCountShiftMask) << kNegCountShift) | (posCount & kCountShiftMask);
+}
+uvec2 LoadEdgeCount(ivec2 pos)
+{
+	return IsInsideImage(pos) ? texelFetch(g_txEdgeCount, pos, 0).xy : uvec2(0, 0);
+}
+
+#if MLAA_PASS == 1
+//----------------------------------------------------------------------------
+//	First phase, MLAA_SeperatingLines_PS
+//-----------------------------------------------------------------------------
+out uint EdgeMask;
+
+void main()
+{
+	ivec2 Offset = ivec2(gl_FragCoord.xy);
+	float center = texelFetch(g_txSceneColor, ClampToImage(Offset), 0).a;
+	float up     = texelFetch(g_txSceneColor, ClampToImage(Offset+kUp), 0).a;
+	float right  = texelFetch(g_txSceneColor, ClampToImage(Offset+kRight), 0).a;
+
+	uint rVal = 0u;
+	if ( CompareColors(center, up) )
+		rVal |= kUpperMask;
+	if ( CompareColors(center, right) )
+		rVal |= kRightMask;
+	EdgeMask = rVal;
+}
+
+#elif MLAA_PASS == 2
+//-----------------------------------------------------------------------------
+//	Second phase, MLAA_ComputeLineLength_PS
+//-----------------------------------------------------------------------------
+out uvec2 EdgeCount;
+
+void main()
+{
+	ivec2 Offset = ivec2(gl_FragCoord.xy);
+	uint pixel = texelFetch(g_txEdgeMask, Offset, 0).r;
+	// x = Horizontal Count Negative, y = Horizontal Count Positive, z = Vertical Count Negative, w = Vertical Count Positive
+	uvec4 Count = uvec4(0u);
+
+	if ( (pixel & (kUpperMask | kRightMask)) != 0u )
+	{
+		uvec4 EdgeDirMask = uvec4(kUpperMask, kUpperMask, kRightMask, kRightMask);
+		uvec4 EdgeFound = uvec4(pixel) & EdgeDirMask;
+		uvec4 StopBit = uvec4(notEqual(EdgeFound, uvec4(0u))) * kStopBit;	// Nullify the stopbit if we're not supposed to look at this edge
+
+		for (int i=1; i<=int(kMaxEdgeLength); i++)
+		{
+			uvec4 uEdgeMask;
+			uEdgeMask.x = texelFetch(g_txEdgeMask, ClampToImage(Offset + ivec2(-i,  0)), 0).r;
+			uEdgeMask.y = texelFetch(g_txEdgeMask, ClampToImage(Offset + ivec2( i,  0)), 0).r;
+			uEdgeMask.z = texelFetch(g_txEdgeMask, ClampToImage(Offset + ivec2( 0,  i)), 0).r;
+			uEdgeMask.w = texelFetch(g_txEdgeMask, ClampToImage(Offset + ivec2( 0, -i)), 0).r;
+
+			EdgeFound = EdgeFound & uEdgeMask;
+			for (int c=0; c<4; c++)
+				Count[c] = (EdgeFound[c] != 0u) ? (Count[c] + 1u) : (Count[c] | StopBit[c]);
+		}
+	}
+	EdgeCount = uvec2(EncodeCount(Count.x, Count.y), EncodeCount(Count.z, Count.w));
+}
+
+#elif MLAA_PASS == 3
+//-----------------------------------------------------------------------------	
+//	Third phase, BlendColor and BlendPixel of MLAA11.hlsl
+//-----------------------------------------------------------------------------
+out vec4 Color;
+
+// Cheap approximation of gamma to linear and then back again, written out as GammaBlend
+// of MLAA_CPU.cpp since mix() may be evaluated as x*(1-a)+y*a
+vec3 GammaBlend(vec3 color, vec3 adjacent, float weight)
+{
+	vec3 a = color*color;
+	vec3 b = adjacent*adjacent;
+	return sqrt( a + weight*(b-a) );
+}
+
+void BlendColor(uint count, ivec2 pos, ivec2 dir, ivec2 ortho, bool inverse, inout vec4 color)
+{
+	// Only process pixel edge if it contains a stop bit
+	if ( !IsBitSet(count, kStopBit_BitPosition+kPosCountShift) && !IsBitSet(count, kStopBit_BitPosition+kNegCountShift) )
+		return;
+
+	uint negCount = DecodeCountNoStopBit(count, kNegCountShift);
+	uint posCount = DecodeCountNoStopBit(count, kPosCountShift);
+
+	// Fetch color adjacent to the edge
+	vec4 adjacentcolor = LoadImageColor(pos+dir);
+
+	if ( (negCount + posCount) == 0u )
+	{
+		color.xyz = GammaBlend(color.xyz, adjacentcolor.xyz, 1.0/8.0);
+		return;
+	}
+
+	// Edges running past the search get a length beyond it
+	if ( !IsBitSet(count, kStopBit_BitPosition+kPosCountShift) ) posCount = kMaxEdgeLength+1u;
+	if ( !IsBitSet(count, kStopBit_BitPosition+kNegCountShift) ) negCount = kMaxEdgeLength+1u;
+
+	float length = float(negCount + posCount + 1u);
+	float midPoint = length/2.0;
+	float distance = float(negCount);
+
+	const uint upperU   = 0x00u;
+	const uint risingZ  = 0x01u;
+	const uint fallingZ = 0x02u;
+	const uint lowerU   = 0x03u;
+
+	// The shape of the edge, see the table in MLAA11.hlsl
+	uint shape = 0x00u;
+	if (CompareColors( LoadImageColor(pos-ortho*int(negCount)).a, LoadImageColor(pos-ortho*int(negCount+1u)).a ))
+		shape |= risingZ;
+	if (CompareColors( LoadImageColor(pos+ortho*int(posCount)).a, LoadImageColor(pos+ortho*int(posCount+1u)).a ))
+		shape |= fallingZ;
+
+	if (    (  inverse && ( ( (shape == fallingZ) && (distance <= midPoint) ) ||
+							( (shape == risingZ)  && (distance >= midPoint) ) ||
+							( (shape == upperU)                             ) ) ) 
+		 || ( !inverse && ( ( (shape == fallingZ) && (distance >= midPoint) ) ||
+							( (shape == risingZ)  && (distance <= midPoint) ) ||
+							( (shape == lowerU)                             ) ) ) )
+	{
+		float h0 = abs( (1.0/length) * (length-distance)     - 0.5);
+		float h1 = abs( (1.0/length) * (length-distance-1.0) - 0.5);
+		float area = 0.5 * (h0+h1);
+		color.xyz = GammaBlend(color.xyz, adjacentcolor.xyz, area);
+	}
+}
+
+void main()
+{
+	ivec2 Offset = ivec2(gl_FragCoord.xy);
+	uvec2 counts = LoadEdgeCount(Offset);
+	vec4 rVal = LoadImageColor(Offset);
+
+#if SHOW_EDGES
+	uint hcount = counts.x, vcount = counts.y;
+	if ( ( IsBitSet(hcount, kStopBit_BitPosition+kPosCountShift) || IsBitSet(hcount, kStopBit_BitPosition+kNegCountShift) )  ||
+		 ( IsBitSet(vcount, kStopBit_BitPosition+kPosCountShift) || IsBitSet(vcount, kStopBit_BitPosition+kNegCountShift) ) )
+	{
+		uint Count = DecodeCountNoStopBit(hcount, kNegCountShift) + DecodeCountNoStopBit(hcount, kPosCountShift) +
+					 DecodeCountNoStopBit(vcount, kNegCountShift) + DecodeCountNoStopBit(vcount, kPosCountShift);
+		if (Count != 0u)
+			rVal = vec4(1, 0, 0, 1);
+	}
+#else
+	uint hcountup    = LoadEdgeCount(Offset-kUp).x;
+	uint vcountright = LoadEdgeCount(Offset-kRight).y;
+
+	// Blend pixel colors as required for anti-aliasing edges
+	if (counts.x != 0u)		BlendColor(counts.x,    Offset,        kUp,     kRight, false, rVal);	// H down-up
+	if (hcountup != 0u)		BlendColor(hcountup,    Offset-kUp,    -kUp,    kRight, true,  rVal);	// H up-down
+	if (counts.y != 0u)		BlendColor(counts.y,    Offset,        kRight,  kUp,    false, rVal);	// V left-right
+	if (vcountright != 0u)	BlendColor(vcountright, Offset-kRight, -kRight, kUp,    true,  rVal);	// V right-left
+#endif
+	// Rounded to 8 bits as CPUEngine does, the render target may round ties the other way
+	Color = floor(clamp(rVal, 0.0, 1.0)*255.0 + 0.5) / 255.0;
+}
+#endif // MLAA_PASS
+
+#endif // VERTEX_SHADER
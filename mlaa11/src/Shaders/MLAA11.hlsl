@@ -42,7 +42,53 @@
 #define USE_STENCIL					0			// Disabled by default      
 #endif
 
-//#define USE_GATHER                            // Disabled by default
+#ifndef HALF_RES_EDGES
+#define HALF_RES_EDGES				0			// Disabled by default, edges and lengths on a 2x downsampled luma plane
+#endif
+
+#ifndef USE_QUALITY_MAP
+#define USE_QUALITY_MAP				0			// Disabled by default, per tile quality levels from g_txQualityMap
+#endif
+
+#if USE_QUALITY_MAP && HALF_RES_EDGES
+#error USE_QUALITY_MAP needs full resolution edges
+#endif
+
+#ifndef HIERARCHICAL_SEARCH
+#define HIERARCHICAL_SEARCH			0			// Disabled by default, edge lengths from 8 pixel block summaries
+#endif
+
+#if HIERARCHICAL_SEARCH && (HALF_RES_EDGES || USE_QUALITY_MAP)
+#error HIERARCHICAL_SEARCH only supports full resolution edges at full quality
+#endif
+
+#ifndef USE_GATHER
+#define USE_GATHER					0			// Disabled by default, edge detection reads the luma with GatherAlpha
+#endif
+
+#if USE_GATHER && HALF_RES_EDGES
+#error USE_GATHER reads the full resolution scene color
+#endif
+
+#ifndef COMPUTE_PASSES
+#define COMPUTE_PASSES				0			// Disabled by default, declares the compute shader versions of the passes
+#endif
+
+#if COMPUTE_PASSES && (HALF_RES_EDGES || USE_QUALITY_MAP || HIERARCHICAL_SEARCH || USE_GATHER || USE_STENCIL || MAX_EDGE_COUNT_BITS != 4)
+#error COMPUTE_PASSES only supports full resolution edges with 4 bit counts
+#endif
+
+#ifndef HDR_LOG_EDGES
+#define HDR_LOG_EDGES				0			// Disabled by default, float HDR luma is compared in log2 space and gParam.z is in stops
+#endif
+
+#if HDR_LOG_EDGES && HALF_RES_EDGES
+#error HDR_LOG_EDGES needs full resolution edges, the half resolution luma is rounded to 8 bits
+#endif
+
+#ifndef HDR_BLACK_LEVEL
+#define HDR_BLACK_LEVEL				(1.0/1024.0)	// HDR_LOG_EDGES luma below this is noise and compares as black
+#endif
 
 #define UINT						uint
 #define UINT2						uint2
@@ -81,6 +127,19 @@ static const int3 kDown						= int3( 0,  1, 0);
 static const int3 kRight					= int3( 1,  0, 0);
 static const int3 kLeft						= int3(-1,  0, 0);
 
+// Quality levels of g_txQualityMap, as MLAA::QUALITY_LEVEL
+static const UINT kQualitySkip				= 0;
+static const UINT kQualityShortEdges		= 1;
+static const UINT kQualityFull				= 2;
+
+// The edge length searched in kQualityShortEdges tiles
+static const UINT kShortEdgeLength			= 2;
+
+// Pixels summarized by a texel of g_txEdgeBlocksH and g_txEdgeBlocksV, and the blocks the
+// hierarchical search steps over at most
+static const int kBlockSize					= 8;
+static const int kMaxSearchBlocks			= int(kMaxEdgeLength) / kBlockSize + 1;
+
 //-----------------------------------------------------------------------------------------
 // Constants
 //-----------------------------------------------------------------------------------------
@@ -89,6 +148,7 @@ cbuffer cbPerObject : register( b0 )
 	// (x, y)	- The size of render target.
 	// (z)		- This constant defines the luminance intensity difference to check for when testing any two pixels for an edge.
 	//			  The higher the value the fewer edges wil be detected.
+	// (w)		- The tile size of the quality map in pixels, when USE_QUALITY_MAP is set.
     float4	gParam  : packoffset( c0 );    
 }
 //-----------------------------------------------------------------------------------------
@@ -97,6 +157,10 @@ cbuffer cbPerObject : register( b0 )
 Texture2D<float4> g_txSceneColor	: register( t0 );
 Texture2D<uint>   g_txEdgeMask		: register( t1 );
 Texture2D<uint2>  g_txEdgeCount		: register( t2 );
+Texture2DMS<float4> g_txSceneColorMS	: register( t3 );
+Texture2D<uint>   g_txQualityMap	: register( t4 );		// One texel per tile
+Texture2D<uint>   g_txEdgeBlocksH	: register( t5 );		// kUpperMask bits of 8 pixels of a row
+Texture2D<uint>   g_txEdgeBlocksV	: register( t6 );		// kRightMask bits of 8 pixels of a column
 SamplerState	  g_samLinear		: register( s0 );
 SamplerState	  g_samPoint		: register( s1 );
 
@@ -116,19 +180,124 @@ struct ScreenQuad_OUTPUT
     float2 TextureUV    : TEXCOORD0;   // vertex texture coords     
 };
 
+// One view of an atlas, drawn as an instanced quad
+struct AtlasView_INPUT
+{
+    int4  Region        : VIEW_REGION;      // Left, top, right and bottom in pixels, right and bottom are exclusive
+    float Threshold     : VIEW_THRESHOLD;   // Replaces gParam.z for this view
+};
+
+struct AtlasView_OUTPUT
+{
+    float4 Position                     : SV_POSITION;
+    nointerpolation int4  Region        : VIEW_REGION;
+    nointerpolation float Threshold     : VIEW_THRESHOLD;
+};
+
+//-----------------------------------------------------------------------------------------
+// The image the current pixel belongs to. The full screen shaders process the whole 
+// render target, the atlas shaders a single view of it so edge searches stop at its borders.
+//-----------------------------------------------------------------------------------------
+static int2  gImageMin  = int2(0, 0);
+static int2  gImageMax  = int2(0, 0);      // Exclusive
+static float gThreshold = 0;
+static int   gLogThreshold = 0;            // gThreshold in the units of LogLuma()
+
+void SetImage(int2 Min, int2 Max, float Threshold)
+{
+	gImageMin = Min;
+	gImageMax = Max;
+	gThreshold = Threshold;
+	gLogThreshold = int(Threshold * 8388608.0);
+}
+void SetFullScreenImage()
+{
+	SetImage(int2(0, 0), int2(gParam.xy), gParam.z);
+}
+//-----------------------------------------------------------------------------------------
+// The first two passes run on a half resolution image when HALF_RES_EDGES is set, they 
+// are drawn to the top left quarter of the edge mask and edge count targets.
+//-----------------------------------------------------------------------------------------
+int2 GetEdgeImageSize()
+{
+#if HALF_RES_EDGES
+	return (int2(gParam.xy) + 1) / 2;
+#else
+	return int2(gParam.xy);
+#endif
+}
+void SetEdgeImage()
+{
+	SetImage(int2(0, 0), GetEdgeImageSize(), gParam.z);
+}
+int2 ClampToImage(int2 pos)
+{
+	return clamp(pos, gImageMin, gImageMax - 1);
+}
+
 //-----------------------------------------------------------------------------------------
 // Utility functions
 //-----------------------------------------------------------------------------------------
+#if HDR_LOG_EDGES
+//--------------------------------------------------------------------------------------
+// The bits of a positive float read as an integer are a piecewise linear log2 scaled by
+// 2^23, exact at powers of two and at most 0.086 stops off in between. Comparing them
+// finds the same contrast ratio as an edge in the shadows and in the highlights, for the
+// cost of a clamp. Luma is clamped to HDR_BLACK_LEVEL and the largest float, NaN is black
+//--------------------------------------------------------------------------------------
+int LogLuma(float a)
+{
+	return asint(clamp(a, HDR_BLACK_LEVEL, asfloat(0x7f7fffff)));
+}
+int2 LogLuma2(float2 a)
+{
+	return asint(clamp(a, HDR_BLACK_LEVEL, asfloat(0x7f7fffff)));
+}
+int4 LogLuma4(float4 a)
+{
+	return asint(clamp(a, HDR_BLACK_LEVEL, asfloat(0x7f7fffff)));
+}
+#endif
+
 //--------------------------------------------------------------------------------------
 // Returns true if the colors are different
 //--------------------------------------------------------------------------------------
 bool CompareColors(float a, float b)
 {
-    return ( abs(a - b)  > gParam.z );
+#if HDR_LOG_EDGES
+	return ( abs(LogLuma(a) - LogLuma(b)) > gLogThreshold );
+#else
+    return ( abs(a - b)  > gThreshold );
+#endif
 }
 bool2 CompareColors2(float2 a, float2 b)
 {
-    return ( abs(a - b)  > gParam.z );
+#if HDR_LOG_EDGES
+	return ( abs(LogLuma2(a) - LogLuma2(b)) > gLogThreshold );
+#else
+    return ( abs(a - b)  > gThreshold );
+#endif
+}
+bool4 CompareColors4(float4 a, float4 b)
+{
+#if HDR_LOG_EDGES
+	return ( abs(LogLuma4(a) - LogLuma4(b)) > gLogThreshold );
+#else
+	return ( abs(a - b) > gThreshold );
+#endif
+}
+//--------------------------------------------------------------------------------------
+// Pooled render targets can be larger than the image in gParam.xy and atlas views are 
+// smaller. Texels outside the image read as zero, as they would from a texture of exactly
+// the image size.
+//--------------------------------------------------------------------------------------
+bool IsInsideImage(int2 pos)
+{
+	return all(pos >= gImageMin) && all(pos < gImageMax);
+}
+float4 LoadImageColor(Texture2D<float4> txImage, int2 pos)
+{
+	return IsInsideImage(pos) ? txImage.Load(int3(pos, 0)) : float4(0, 0, 0, 0);
 }
 //--------------------------------------------------------------------------------------
 // Check if the specified bit is set
@@ -197,6 +366,71 @@ UINT2 DecodeCountColor2(uint2 count)
 {
 	return UINT2(count);
 }
+#if HALF_RES_EDGES
+//--------------------------------------------------------------------------------------
+// Scale a half resolution run by two, extra is the part of the 2x2 block on that side of
+// the pixel. Runs that no longer fit in the count bits lose their stop bit.
+//--------------------------------------------------------------------------------------
+UINT UpsampleRun(UINT run, UINT extra)
+{
+	UINT length = RemoveStopBit(run) * 2 + extra;
+	return ((run & kStopBit) && length < kMaxEdgeLength) ? (length | kStopBit) : kMaxEdgeLength;
+}
+//--------------------------------------------------------------------------------------
+// Full resolution counts from the half resolution ones. The boundary above half 
+// resolution row Y is above full resolution row 2Y and the boundary right of column X 
+// is right of full resolution column 2X+1: horizontal edges land on even rows, vertical
+// edges on odd columns. Vertical negative counts look down.
+//--------------------------------------------------------------------------------------
+uint2 UpsampleEdgeCount(int2 pos)
+{
+	UINT2 halfCount = DecodeCountColor2(g_txEdgeCount.Load(int3(pos / 2, 0)).xy);
+	UINT2 sub = UINT2(pos & 1);
+	UINT2 count = UINT2(0, 0);
+
+	if (halfCount.x && sub.y == 0)
+		count.x = EncodeCount(UpsampleRun(DecodeCount(halfCount.x, kNegCountShift), sub.x),
+							  UpsampleRun(DecodeCount(halfCount.x, kPosCountShift), 1 - sub.x));
+	if (halfCount.y && sub.x == 1)
+		count.y = EncodeCount(UpsampleRun(DecodeCount(halfCount.y, kNegCountShift), 1 - sub.y),
+							  UpsampleRun(DecodeCount(halfCount.y, kPosCountShift), sub.y));
+	return count;
+}
+#endif
+//--------------------------------------------------------------------------------------
+// Counts of a full resolution pixel, zero outside the image
+//--------------------------------------------------------------------------------------
+uint2 LoadEdgeCount(int2 pos)
+{
+	if (!IsInsideImage(pos))
+		return uint2(0, 0);
+#if HALF_RES_EDGES
+	return UpsampleEdgeCount(pos);
+#else
+	return g_txEdgeCount.Load(int3(pos, 0)).xy;
+#endif
+}
+//--------------------------------------------------------------------------------------
+// Quality level of the tile a pixel is in, tiles past the map are full quality
+//--------------------------------------------------------------------------------------
+UINT LoadQualityLevel(int2 pos)
+{
+#if USE_QUALITY_MAP
+	uint2 MapSize;
+	g_txQualityMap.GetDimensions(MapSize.x, MapSize.y);
+	uint2 Tile = uint2(pos) / uint(gParam.w);
+	return all(Tile < MapSize) ? g_txQualityMap.Load(int3(Tile, 0)) : kQualityFull;
+#else
+	return kQualityFull;
+#endif
+}
+//--------------------------------------------------------------------------------------
+// The longest edge searched from a pixel, which owns the counts it stores
+//--------------------------------------------------------------------------------------
+UINT GetMaxEdgeLength(int2 pos)
+{
+	return (LoadQualityLevel(pos) == kQualityShortEdges) ? kShortEdgeLength : kMaxEdgeLength;
+}
 //--------------------------------------------------------------------------------------
 // This vertex shader for screen quad rendering
 //--------------------------------------------------------------------------------------
@@ -210,6 +444,23 @@ ScreenQuad_OUTPUT ScreenQuadVS( ScreenQuad_INPUT input )
     return Output;    
 }
 
+//--------------------------------------------------------------------------------------
+// Vertex shader for atlas views, a triangle strip of four vertices per instance
+//--------------------------------------------------------------------------------------
+AtlasView_OUTPUT AtlasViewVS( AtlasView_INPUT input, uint VertexID : SV_VertexID )
+{
+    AtlasView_OUTPUT Output;
+
+	float2 Corner = float2(VertexID & 1, VertexID >> 1);
+	float2 Pos = lerp(float2(input.Region.xy), float2(input.Region.zw), Corner);
+
+	Output.Position = float4(Pos / gParam.xy * float2(2, -2) + float2(-1, 1), 1, 1);
+	Output.Region = input.Region;
+	Output.Threshold = input.Threshold;
+
+    return Output;
+}
+
 struct CLEAR_PS_OUTPUT
 {
     float4 Color0     : SV_TARGET0;
@@ -225,29 +476,70 @@ CLEAR_PS_OUTPUT MLAA_Clear_PS( ScreenQuad_OUTPUT In )
 	return Out;
 }
 
+// Draws the output of the compute passes to the back buffer, whose sRGB view takes no UAV
+float4 MLAA_Copy_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
+{
+	return g_txSceneColor.Load( int3(In.Position.xy, 0) );
+}
+
 //----------------------------------------------------------------------------
 //	MLAA pixel shader for edge detection.
 //	Pixel shader used in the first phase of MLAA.
 //	This pixel shader is used to detect vertical and horizontal edges.
 //-----------------------------------------------------------------------------
-uint MLAA_SeperatingLines_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
+#if HALF_RES_EDGES
+//--------------------------------------------------------------------------------------
+// Luma of a 2x2 block of the full resolution image, rounded to 8 bits like the CPU path
+//--------------------------------------------------------------------------------------
+float LoadHalfResLuma(int2 pos)
+{
+	int2 Last = int2(gParam.xy) - 1;
+	int2 Full = pos * 2;
+	float Sum = g_txSceneColor.Load(int3(min(Full,              Last), 0)).a +
+				g_txSceneColor.Load(int3(min(Full + int2(1, 0), Last), 0)).a +
+				g_txSceneColor.Load(int3(min(Full + int2(0, 1), Last), 0)).a +
+				g_txSceneColor.Load(int3(min(Full + int2(1, 1), Last), 0)).a;
+	return floor(Sum * (255.0 / 4.0) + 0.625) / 255.0;
+}
+#endif
+
+#if USE_GATHER
+//--------------------------------------------------------------------------------------
+// Luma of the 2x2 texels around the texel corner Corner: x = (-1, 0), y = (0, 0), 
+// z = (0, -1) and w = (-1, -1) relative to it. Pooled targets can be larger than the 
+// image, so the coordinates are normalized by the size of the texture.
+//--------------------------------------------------------------------------------------
+float4 GatherLuma( int2 Corner )
+{
+	float2 Size;
+	g_txSceneColor.GetDimensions(Size.x, Size.y);
+	return g_txSceneColor.GatherAlpha( g_samPoint, float2(Corner) / Size );
+}
+#endif
+
+uint SeperatingLines( int2 Offset )
 {
-	int2 TextureSize = gParam.xy - 1;			
-	int2 Offset = In.TextureUV*gParam.xy;	
-		
     float2 center;
 	float2 upright;
 	
-#ifdef USE_GATHER
+#if HALF_RES_EDGES
+    center.xy = LoadHalfResLuma(ClampToImage(Offset));
+    upright.y = LoadHalfResLuma(ClampToImage(Offset+kUp.xy));
+    upright.x = LoadHalfResLuma(ClampToImage(Offset+kRight.xy));
+#elif USE_GATHER
     float4 gather;
-    float2 OffsetUV = float2( Offset + int2( 1 , 0 ) ) / gParam.xy;
-    gather = g_txSceneColor.GatherAlpha( g_samPoint, OffsetUV );
+    gather = GatherLuma( Offset + int2( 1 , 0 ) );
     center.xy = gather.xx;
     upright.xy = gather.yw;
+	// The sampler only clamps at the render target borders, not at the borders of a view
+	if ( Offset.y == gImageMin.y )
+		upright.y = center.y;
+	if ( Offset.x == gImageMax.x - 1 )
+		upright.x = center.x;
 #else
-    center.xy = g_txSceneColor.Load(int3(clamp(Offset,int2(0, 0), TextureSize), 0)).a;	
-    upright.y = g_txSceneColor.Load(int3(clamp(Offset+kUp.xy,    int2(0, 0), TextureSize), 0)).a;
-    upright.x = g_txSceneColor.Load(int3(clamp(Offset+kRight.xy, int2(0, 0), TextureSize), 0)).a;			
+    center.xy = g_txSceneColor.Load(int3(ClampToImage(Offset), 0)).a;	
+    upright.y = g_txSceneColor.Load(int3(ClampToImage(Offset+kUp.xy), 0)).a;
+    upright.x = g_txSceneColor.Load(int3(ClampToImage(Offset+kRight.xy), 0)).a;			
 #endif
 
 	UINT rVal = 0;		
@@ -268,16 +560,290 @@ uint MLAA_SeperatingLines_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
 	return rVal;
 }	
 
+uint MLAA_SeperatingLines_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
+{
+	SetEdgeImage();
+	return SeperatingLines( In.TextureUV*GetEdgeImageSize() );
+}
+
+uint MLAA_SeperatingLinesAtlas_PS( AtlasView_OUTPUT In ) : SV_TARGET
+{
+	SetImage( In.Region.xy, In.Region.zw, In.Threshold );
+	return SeperatingLines( int2(In.Position.xy) );
+}
+
+#if USE_GATHER
+//----------------------------------------------------------------------------
+//	Edge detection for a 2x2 quad of pixels per invocation, drawn over a
+//	viewport of half the image size in each direction. The quad, the row 
+//	above it and the column to its right are 8 texels, read with two gathers
+//	and one load instead of three loads for each of the four pixels. The edge
+//	bits go straight to the edge mask through a UAV, so there is no stencil
+//	variant.
+//-----------------------------------------------------------------------------
+RWTexture2D<uint> g_uavEdgeMask	: register( u0 );
+
+void MLAA_SeperatingLinesQuad_PS( ScreenQuad_OUTPUT In )
+{
+	SetFullScreenImage();
+	int2 Quad = int2(In.Position.xy) * 2;
+
+	// Pixels in the order top left, top right, bottom left, bottom right
+	float4 UpperQuad = GatherLuma( Quad + int2(1, 0) );		// Rows y - 1 and y, columns x and x + 1
+	float4 RightQuad = GatherLuma( Quad + int2(2, 1) );		// Rows y and y + 1, columns x + 1 and x + 2
+	float  LowerLeft = g_txSceneColor.Load(int3(ClampToImage(Quad + int2(0, 1)), 0)).a;
+
+	float4 center = float4(UpperQuad.x, UpperQuad.y, LowerLeft,   RightQuad.x);
+	float4 up     = float4(UpperQuad.w, UpperQuad.z, UpperQuad.x, RightQuad.w);
+	float4 right  = float4(UpperQuad.y, RightQuad.z, RightQuad.x, RightQuad.y);
+
+	// The sampler only clamps at the render target borders, not at the borders of the image
+	int4 x = Quad.xxxx + int4(0, 1, 0, 1);
+	int4 y = Quad.yyyy + int4(0, 0, 1, 1);
+	right = (x == gImageMax.x - 1) ? center : right;
+	up = (y == gImageMin.y) ? center : up;
+
+	UINT4 rVal = UINT4(CompareColors4(center, up)) * kUpperMask;
+	rVal |= UINT4(CompareColors4(center, right)) * kRightMask;
+
+	UNROLL
+	for (int i = 0; i < 4; i++)
+	{
+		if ( x[i] < gImageMax.x && y[i] < gImageMax.y )
+			g_uavEdgeMask[int2(x[i], y[i])] = EncodeMaskColor(rVal[i]);
+	}
+}
+#endif
+
+
+//----------------------------------------------------------------------------
+//	MSAA aware edge detection.
+//	Replaces the resolve and the first phase when the scene is multisampled: the 
+//	samples are resolved and edges are detected in the same pass. Edges are only 
+//	kept where one of the two pixels has samples that disagree (partial coverage), 
+//	the remaining luminance steps were not produced by geometry edges.
+//-----------------------------------------------------------------------------
+struct MSAA_EDGE_PS_OUTPUT
+{
+    uint   EdgeMask       : SV_TARGET0;
+    float4 ResolvedColor  : SV_TARGET1;
+};
+
+float4 ResolveSamples(int2 Pos, uint nSamples, out bool bPartialCoverage)
+{
+	float4 first = g_txSceneColorMS.Load(Pos, 0);
+	float4 sum = first;
+	bPartialCoverage = false;
+
+	[loop]
+	for (uint s = 1; s < nSamples; s++)
+	{
+		float4 color = g_txSceneColorMS.Load(Pos, s);
+		sum += color;
+		bPartialCoverage = bPartialCoverage || CompareColors(color.a, first.a);
+	}
+
+	return sum / nSamples;
+}
+
+MSAA_EDGE_PS_OUTPUT MLAA_SeperatingLinesMSAA_PS( ScreenQuad_OUTPUT In )
+{
+	MSAA_EDGE_PS_OUTPUT Out;
+
+	SetFullScreenImage();
+	int2 Offset = In.TextureUV*gParam.xy;	
+
+	uint2 Dimensions;
+	uint nSamples;
+	g_txSceneColorMS.GetDimensions(Dimensions.x, Dimensions.y, nSamples);
+
+	bool3 partial;
+	float4 center = ResolveSamples(ClampToImage(Offset),          nSamples, partial.x);
+	float2 upright;
+	upright.y = ResolveSamples(ClampToImage(Offset+kUp.xy),    nSamples, partial.y).a;
+	upright.x = ResolveSamples(ClampToImage(Offset+kRight.xy), nSamples, partial.z).a;
+
+	bool2 result = CompareColors2(center.aa, upright);
+
+	UINT rVal = 0;
+	if ( result.y && (partial.x || partial.y) ) 
+		rVal |= kUpperMask;
+	if ( result.x && (partial.x || partial.z) )
+		rVal |= kRightMask;
+
+	Out.EdgeMask = rVal;
+	Out.ResolvedColor = center;
+
+	return Out;
+}
+
+
+//-----------------------------------------------------------------------------
+//	Block summaries for the hierarchical edge length search, drawn between the
+//	first and second phase. A texel holds the edge bits of 8 consecutive pixels,
+//	bit i for the i-th one: a row of horizontal edges in g_txEdgeBlocksH, a 
+//	column of vertical edges in g_txEdgeBlocksV. Pixels past the image repeat the
+//	last one, as the clamped loads of the per pixel search do.
+//-----------------------------------------------------------------------------
+uint EdgeBlock( int2 Start, int2 Axis, UINT DirMask )
+{
+	uint Bits = 0;
+	UNROLL
+	for (int i = 0; i < kBlockSize; i++)
+	{
+		if ( DecodeMaskColor(g_txEdgeMask.Load(int3(ClampToImage(Start + Axis * i), 0)).r) & DirMask )
+			Bits |= 1u << i;
+	}
+	return Bits;
+}
+
+uint MLAA_EdgeBlocksH_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
+{
+	SetFullScreenImage();
+	int2 Block = int2(In.Position.xy);
+	return EdgeBlock( int2(Block.x * kBlockSize, Block.y), int2(1, 0), kUpperMask );
+}
+
+uint MLAA_EdgeBlocksV_PS( ScreenQuad_OUTPUT In ) : SV_TARGET
+{
+	SetFullScreenImage();
+	int2 Block = int2(In.Position.xy);
+	return EdgeBlock( int2(Block.x, Block.y * kBlockSize), int2(0, 1), kRightMask );
+}
+
+#if HIERARCHICAL_SEARCH
+//--------------------------------------------------------------------------------------
+// Edge bits of block number Block of a line. Line is the texel of the first block and 
+// Axis the step between blocks, blocks past either end repeat the pixel at that end.
+//--------------------------------------------------------------------------------------
+uint LoadEdgeBlock( Texture2D<uint> txBlocks, int2 Line, int2 Axis, int Block, int Length )
+{
+	int LastBlock = (Length - 1) / kBlockSize;
+	if ( Block < 0 )
+		return ( txBlocks.Load(int3(Line, 0)).r & 1 ) ? 0xFF : 0;
+	if ( Block > LastBlock )
+		return ( (txBlocks.Load(int3(Line + Axis * LastBlock, 0)).r >> ((Length - 1) % kBlockSize)) & 1 ) ? 0xFF : 0;
+	return txBlocks.Load(int3(Line + Axis * Block, 0)).r;
+}
+//--------------------------------------------------------------------------------------
+// Edge pixels following Pos along a line, up to kMaxEdgeLength. The rest of Pos's block
+// is tested first, then whole blocks of edge are stepped over and the run ends in the 
+// first block with a gap: a run of n pixels takes n / 8 + 1 loads instead of n.
+//--------------------------------------------------------------------------------------
+UINT PositiveRun( Texture2D<uint> txBlocks, int2 Line, int2 Axis, int Pos, int Length )
+{
+	int Block = Pos / kBlockSize;
+	int Bit = Pos % kBlockSize;
+	uint Gaps = ( ~LoadEdgeBlock(txBlocks, Line, Axis, Block, Length) & 0xFF ) >> (Bit + 1);
+	UINT Run = kBlockSize - 1 - Bit;
+
+	BRANCH
+	if ( Gaps )
+	{
+		Run = firstbitlow(Gaps);
+	}
+	else
+	{
+		[loop]
+		for (int i = 1; i <= kMaxSearchBlocks && Run < kMaxEdgeLength; i++)
+		{
+			Gaps = ~LoadEdgeBlock(txBlocks, Line, Axis, Block + i, Length) & 0xFF;
+			if ( Gaps )
+			{
+				Run += firstbitlow(Gaps);
+				break;
+			}
+			Run += kBlockSize;
+		}
+	}
+	return ( Run < kMaxEdgeLength ) ? ( Run | kStopBit ) : kMaxEdgeLength;
+}
+//--------------------------------------------------------------------------------------
+// Edge pixels preceding Pos along a line, up to kMaxEdgeLength
+//--------------------------------------------------------------------------------------
+UINT NegativeRun( Texture2D<uint> txBlocks, int2 Line, int2 Axis, int Pos, int Length )
+{
+	int Block = Pos / kBlockSize;
+	int Bit = Pos % kBlockSize;
+	uint Gaps = ~LoadEdgeBlock(txBlocks, Line, Axis, Block, Length) & ( (1u << Bit) - 1 );
+	UINT Run = Bit;
+
+	BRANCH
+	if ( Gaps )
+	{
+		Run = Bit - 1 - firstbithigh(Gaps);
+	}
+	else
+	{
+		[loop]
+		for (int i = 1; i <= kMaxSearchBlocks && Run < kMaxEdgeLength; i++)
+		{
+			Gaps = ~LoadEdgeBlock(txBlocks, Line, Axis, Block - i, Length) & 0xFF;
+			if ( Gaps )
+			{
+				Run += kBlockSize - 1 - firstbithigh(Gaps);
+				break;
+			}
+			Run += kBlockSize;
+		}
+	}
+	return ( Run < kMaxEdgeLength ) ? ( Run | kStopBit ) : kMaxEdgeLength;
+}
+//--------------------------------------------------------------------------------------
+// Same counts as ComputeLineLength(), with the cost growing with the length of the edge
+// over 8 rather than with kMaxEdgeLength. Vertical negative counts look down.
+//--------------------------------------------------------------------------------------
+uint2 ComputeLineLengthHierarchical( int2 Offset )
+{
+	UINT pixel = DecodeMaskColor(g_txEdgeMask.Load(int3(Offset, 0)).r);
+	UINT4 EdgeCount = UINT4(0, 0, 0, 0);
+	int2 Size = int2(gParam.xy);
+
+	BRANCH
+	if ( pixel & kUpperMask )
+	{
+		EdgeCount.x = NegativeRun(g_txEdgeBlocksH, int2(0, Offset.y), int2(1, 0), Offset.x, Size.x);
+		EdgeCount.y = PositiveRun(g_txEdgeBlocksH, int2(0, Offset.y), int2(1, 0), Offset.x, Size.x);
+	}
+	BRANCH
+	if ( pixel & kRightMask )
+	{
+		EdgeCount.z = PositiveRun(g_txEdgeBlocksV, int2(Offset.x, 0), int2(0, 1), Offset.y, Size.y);
+		EdgeCount.w = NegativeRun(g_txEdgeBlocksV, int2(Offset.x, 0), int2(0, 1), Offset.y, Size.y);
+	}
+    return uint2(EncodeCountColor(EncodeCount(EdgeCount.x, EdgeCount.y)),
+				 EncodeCountColor(EncodeCount(EdgeCount.z, EdgeCount.w)));
+}
+#endif
 
 //-----------------------------------------------------------------------------
 //	Pixel shader for the second phase of the algorithm.
 //	This pixel shader calculates the length of edges.
 //-----------------------------------------------------------------------------
-uint2 MLAA_ComputeLineLength_PS( ScreenQuad_OUTPUT In) : SV_TARGET
+void SearchEdgeStep( int2 Offset, int i, UINT4 EdgeDirMask, UINT4 StopBit, in out UINT4 EdgeFound, in out UINT4 EdgeCount )
 {
-	int2 TextureSize = gParam.xy - 1;
-	int2 Offset = In.TextureUV*gParam.xy;	
-	
+	UINT4 uEdgeMask;
+
+	uEdgeMask.x = g_txEdgeMask.Load(int3(ClampToImage(Offset + int2(-i,  0)), 0)).r;
+	uEdgeMask.y = g_txEdgeMask.Load(int3(ClampToImage(Offset + int2( i,  0)), 0)).r;
+	uEdgeMask.z = g_txEdgeMask.Load(int3(ClampToImage(Offset + int2( 0,  i)), 0)).r;				
+	uEdgeMask.w = g_txEdgeMask.Load(int3(ClampToImage(Offset + int2( 0, -i)), 0)).r;		
+				
+	EdgeFound = EdgeFound & (uEdgeMask & EdgeDirMask);
+	EdgeCount = EdgeFound ? (EdgeCount + 1) : (EdgeCount | StopBit);				
+}
+
+uint2 ComputeLineLength( int2 Offset )
+{
+#if USE_QUALITY_MAP
+	// Counts are read by the pixel itself and its neighbours below and to the left
+	BRANCH
+	if ( LoadQualityLevel(Offset) == kQualitySkip &&
+		 LoadQualityLevel(Offset + kUp.xy) == kQualitySkip &&
+		 LoadQualityLevel(Offset + kRight.xy) == kQualitySkip )
+		return uint2(0, 0);
+#endif
+
 	// Retrieve edge mask for current pixel	
 	UINT pixel = DecodeMaskColor(g_txEdgeMask.Load(int3(Offset, 0)).r);	
     UINT4 EdgeCount = UINT4(0, 0, 0, 0); // x = Horizontal Count Negative, y = Horizontal Count Positive, z = Vertical Count Negative, w = Vertical Count Positive				    
@@ -293,25 +859,42 @@ uint2 MLAA_ComputeLineLength_PS( ScreenQuad_OUTPUT In) : SV_TARGET
 		UINT4 EdgeFound = (pixel & EdgeDirMask) ? 0xFFFFFFFF : 0;								
 		UINT4 StopBit = EdgeFound ? kStopBit : 0;  // Nullify the stopbit if we're not supposed to look at this edge							
 		
-		UNROLL
-		for (int i=1; i<=int(kMaxEdgeLength); i++)
+#if USE_QUALITY_MAP
+		BRANCH
+		if ( GetMaxEdgeLength(Offset) == kShortEdgeLength )
 		{
-			UINT4 uEdgeMask;
-			float4 EdgeMask;				
-			
-			uEdgeMask.x = g_txEdgeMask.Load(int3(clamp(Offset + int2(-i,  0), int2(0, 0), TextureSize), 0)).r;
-			uEdgeMask.y = g_txEdgeMask.Load(int3(clamp(Offset + int2( i,  0), int2(0, 0), TextureSize), 0)).r;
-			uEdgeMask.z = g_txEdgeMask.Load(int3(clamp(Offset + int2( 0,  i), int2(0, 0), TextureSize), 0)).r;				
-			uEdgeMask.w = g_txEdgeMask.Load(int3(clamp(Offset + int2( 0, -i), int2(0, 0), TextureSize), 0)).r;		
-						
-			EdgeFound = EdgeFound & (uEdgeMask & EdgeDirMask);
-			EdgeCount = EdgeFound ? (EdgeCount + 1) : (EdgeCount | StopBit);				
-		}						
+			UNROLL
+			for (int i=1; i<=int(kShortEdgeLength); i++)
+				SearchEdgeStep(Offset, i, EdgeDirMask, StopBit, EdgeFound, EdgeCount);
+		}
+		else
+#endif
+		{
+			UNROLL
+			for (int i=1; i<=int(kMaxEdgeLength); i++)
+				SearchEdgeStep(Offset, i, EdgeDirMask, StopBit, EdgeFound, EdgeCount);
+		}
 	}    
     return uint2(EncodeCountColor(EncodeCount(EdgeCount.x, EdgeCount.y)),
 				 EncodeCountColor(EncodeCount(EdgeCount.z, EdgeCount.w)));
 }
 
+uint2 MLAA_ComputeLineLength_PS( ScreenQuad_OUTPUT In) : SV_TARGET
+{
+	SetEdgeImage();
+#if HIERARCHICAL_SEARCH
+	return ComputeLineLengthHierarchical( In.TextureUV*GetEdgeImageSize() );
+#else
+	return ComputeLineLength( In.TextureUV*GetEdgeImageSize() );
+#endif
+}
+
+uint2 MLAA_ComputeLineLengthAtlas_PS( AtlasView_OUTPUT In) : SV_TARGET
+{
+	SetImage( In.Region.xy, In.Region.zw, In.Threshold );
+	return ComputeLineLength( int2(In.Position.xy) );
+}
+
 
 //-----------------------------------------------------------------------------	
 //	Main function used in third and final phase of the algorithm
@@ -320,6 +903,7 @@ uint2 MLAA_ComputeLineLength_PS( ScreenQuad_OUTPUT In) : SV_TARGET
 //-----------------------------------------------------------------------------
 void BlendColor(Texture2D<float4> txImage, 
                 UINT count,
+                UINT maxLength,
                 int2 pos, 
                 int2 dir, 
                 int2 ortho, 
@@ -335,7 +919,7 @@ void BlendColor(Texture2D<float4> txImage,
 		UINT posCount = DecodeCountNoStopBit(count, kPosCountShift);                              
         
 		// Fetch color adjacent to the edge
-		float4 adjacentcolor = txImage.Load(int3(pos+dir, 0));				        				
+		float4 adjacentcolor = LoadImageColor(txImage, pos+dir);				        				
         
 		FLATTEN
 		if ( (negCount + posCount) == 0)
@@ -348,9 +932,10 @@ void BlendColor(Texture2D<float4> txImage,
 		else
 		{			
 			// If no sign bit is found on either edge then artificially increase the edge length so that
-			// we don't start anti-aliasing pixels for which we don't have valid data.
-			if ( !(IsBitSet(count, (kStopBit_BitPosition+kPosCountShift)))) posCount = kMaxEdgeLength+1;
-			if ( !(IsBitSet(count, (kStopBit_BitPosition+kNegCountShift)))) negCount = kMaxEdgeLength+1;
+			// we don't start anti-aliasing pixels for which we don't have valid data. maxLength is 
+			// the length searched from the pixel owning the count.
+			if ( !(IsBitSet(count, (kStopBit_BitPosition+kPosCountShift)))) posCount = maxLength+1;
+			if ( !(IsBitSet(count, (kStopBit_BitPosition+kNegCountShift)))) negCount = maxLength+1;
 			
 			// Calculate some variables
 			float length = negCount + posCount + 1;
@@ -385,12 +970,12 @@ void BlendColor(Texture2D<float4> txImage,
 
 			UINT shape = 0x00;			
 			FLATTEN
-    		if (CompareColors( (txImage.Load(int3(pos-(ortho*negCount.xx), 0)).a), (txImage.Load(int3(pos-(ortho*(negCount.xx+1)), 0)).a) ))
+    		if (CompareColors( LoadImageColor(txImage, pos-(ortho*negCount.xx)).a, LoadImageColor(txImage, pos-(ortho*(negCount.xx+1))).a ))
 			{
 				shape |= risingZ;                
 			}		
 			FLATTEN
-			if (CompareColors( (txImage.Load(int3(pos+(ortho*posCount.xx), 0)).a), (txImage.Load(int3(pos+(ortho*(posCount.xx+1)), 0)).a) ))			
+			if (CompareColors( LoadImageColor(txImage, pos+(ortho*posCount.xx)).a, LoadImageColor(txImage, pos+(ortho*(posCount.xx+1))).a ))			
 			{
 				shape |= fallingZ;                
 			}
@@ -418,16 +1003,10 @@ void BlendColor(Texture2D<float4> txImage,
 //	MLAA pixel shader for color blending.
 //	Pixel shader used in third and final phase of the algorithm
 //-----------------------------------------------------------------------------
-float4 MLAA_BlendColor_PS( ScreenQuad_OUTPUT In) : SV_TARGET
+float4 BlendPixelCounts( int2 Offset, UINT hcount, UINT vcount, UINT hcountup, UINT vcountright )
 {
-	int2 TextureSize = gParam.xy - 1;
-	int2 Offset = In.TextureUV*gParam.xy;	
-	
 #if SHOW_EDGES 	    
     float4 rVal = g_txSceneColor.Load(int3(Offset, 0));            
-    
-    UINT hcount, vcount;    
-    UINT2(hcount, vcount) = DecodeCountColor2(g_txEdgeCount.Load(int3(Offset, 0)).xy);
         
     if (hcount || vcount)
     {
@@ -445,25 +1024,267 @@ float4 MLAA_BlendColor_PS( ScreenQuad_OUTPUT In) : SV_TARGET
 	}
     return rVal;    
 #else		
-    UINT hcount, vcount;
-	UINT hcountup, vcountright;
-	
-	UINT2(hcount, vcount) = DecodeCountColor2(g_txEdgeCount.Load(int3(Offset, 0)).xy);
-	hcountup    = DecodeCountColor(g_txEdgeCount.Load(int3(Offset-kUp.xy, 0)).x);
-	vcountright = DecodeCountColor(g_txEdgeCount.Load(int3(Offset-kRight.xy, 0)).y);
-		
 	// Retrieve pixel from original image
 	float4 rVal = g_txSceneColor.Load(int3(Offset, 0));                   		
 	// Blend pixel colors as required for anti-aliasing edges
-	BRANCH if (hcount)		BlendColor(g_txSceneColor, hcount,      Offset,			 kUp,		kRight, false, rVal);   // H down-up
-	BRANCH if (hcountup)	BlendColor(g_txSceneColor, hcountup,    Offset-kUp,		-kUp,		kRight, true,  rVal);   // H up-down    				    
-	BRANCH if (vcount)		BlendColor(g_txSceneColor, vcount,      Offset,			 kRight,	kUp,    false, rVal);   // V left-right				
-	BRANCH if (vcountright)	BlendColor(g_txSceneColor, vcountright, Offset-kRight,	-kRight,	kUp,    true,  rVal);   // V right-left    			
+	BRANCH if (hcount)		BlendColor(g_txSceneColor, hcount,      GetMaxEdgeLength(Offset),        Offset,		 kUp,		kRight, false, rVal);   // H down-up
+	BRANCH if (hcountup)	BlendColor(g_txSceneColor, hcountup,    GetMaxEdgeLength(Offset-kUp.xy),    Offset-kUp,	-kUp,		kRight, true,  rVal);   // H up-down    				    
+	BRANCH if (vcount)		BlendColor(g_txSceneColor, vcount,      GetMaxEdgeLength(Offset),        Offset,		 kRight,	kUp,    false, rVal);   // V left-right				
+	BRANCH if (vcountright)	BlendColor(g_txSceneColor, vcountright, GetMaxEdgeLength(Offset-kRight.xy), Offset-kRight,	-kRight,	kUp,    true,  rVal);   // V right-left    			
 	        
 	return rVal;
 #endif
 }
 
+float4 BlendPixel( int2 Offset )
+{
+#if USE_QUALITY_MAP && !SHOW_EDGES
+	BRANCH
+	if ( LoadQualityLevel(Offset) == kQualitySkip )
+		return g_txSceneColor.Load(int3(Offset, 0));
+#endif
+
+	// The counts of the pixel, of the one below for the edge above it and of the one to 
+	// its left for the edge on its left. SHOW_EDGES only looks at the first.
+	UINT2 counts = DecodeCountColor2(LoadEdgeCount(Offset));
+	UINT hcountup    = DecodeCountColor(LoadEdgeCount(Offset-kUp.xy).x);
+	UINT vcountright = DecodeCountColor(LoadEdgeCount(Offset-kRight.xy).y);
+	return BlendPixelCounts( Offset, counts.x, counts.y, hcountup, vcountright );
+}
+
+float4 MLAA_BlendColor_PS( ScreenQuad_OUTPUT In) : SV_TARGET
+{
+	SetFullScreenImage();
+	return BlendPixel( In.TextureUV*gParam.xy );
+}
+
+float4 MLAA_BlendColorAtlas_PS( AtlasView_OUTPUT In) : SV_TARGET
+{
+	SetImage( In.Region.xy, In.Region.zw, In.Threshold );
+	return BlendPixel( int2(In.Position.xy) );
+}
+
+#if COMPUTE_PASSES
+//-----------------------------------------------------------------------------
+//	Compute shader versions of the three phases for the full screen image, one 
+//	thread per pixel in groups of 8x8. The first two phases read what the group 
+//	needs into groupshared memory once, with the halo the pixels of the group 
+//	read around them, instead of every pixel loading its neighbours. Results are
+//	written through UAVs, so no render targets or stencil are involved. The sample
+//	draws g_uavOutput to the back buffer with MLAA_Copy_PS.
+//-----------------------------------------------------------------------------
+RWTexture2D<uint>   g_uavEdgeMask		: register( u0 );
+RWTexture2D<uint2>  g_uavEdgeCount		: register( u1 );
+RWTexture2D<float4> g_uavOutput			: register( u2 );
+
+static const int kGroupSize					= 8;
+static const int kGroupThreads				= kGroupSize * kGroupSize;
+
+// Luma of rows y - 1 to y + 7 and columns x to x + 8 of a group at (x, y)
+static const int kLumaTileSize				= kGroupSize + 1;
+groupshared float gsLuma[kLumaTileSize * kLumaTileSize];
+
+// Edge mask of the group and kMaxEdgeLength pixels around it
+static const int kSearchHalo				= int(kMaxEdgeLength);
+static const int kMaskTileSize				= kGroupSize + 2 * kSearchHalo;
+groupshared uint gsEdgeMask[kMaskTileSize * kMaskTileSize];
+
+//-----------------------------------------------------------------------------
+//	First phase, same edges as MLAA_SeperatingLines_PS
+//-----------------------------------------------------------------------------
+[numthreads(kGroupSize, kGroupSize, 1)]
+void MLAA_SeperatingLines_CS( uint3 GroupID : SV_GroupID, uint3 ThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex )
+{
+	SetFullScreenImage();
+	int2 Origin = int2(GroupID.xy) * kGroupSize;
+
+	// Clamped like the loads of SeperatingLines(), so pixels on the border compare equal
+	for (int i = int(GroupIndex); i < kLumaTileSize * kLumaTileSize; i += kGroupThreads)
+	{
+		int2 Pos = Origin + int2(i % kLumaTileSize, i / kLumaTileSize - 1);
+		gsLuma[i] = g_txSceneColor.Load(int3(ClampToImage(Pos), 0)).a;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	int2 Offset = Origin + int2(ThreadID.xy);
+	if (!IsInsideImage(Offset))
+		return;
+
+	int Center = (int(ThreadID.y) + 1) * kLumaTileSize + int(ThreadID.x);
+	bool2 result = CompareColors2(gsLuma[Center].xx, float2(gsLuma[Center + 1], gsLuma[Center - kLumaTileSize]));
+
+	UINT rVal = 0;
+	if ( result.y ) 
+		rVal |= kUpperMask;
+	if ( result.x )
+		rVal |= kRightMask;
+	g_uavEdgeMask[Offset] = EncodeMaskColor(rVal);
+}
+
+//-----------------------------------------------------------------------------
+//	Second phase, same counts as MLAA_ComputeLineLength_PS
+//-----------------------------------------------------------------------------
+[numthreads(kGroupSize, kGroupSize, 1)]
+void MLAA_ComputeLineLength_CS( uint3 GroupID : SV_GroupID, uint3 ThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex )
+{
+	SetFullScreenImage();
+	int2 Origin = int2(GroupID.xy) * kGroupSize;
+
+	for (int i = int(GroupIndex); i < kMaskTileSize * kMaskTileSize; i += kGroupThreads)
+	{
+		int2 Pos = Origin - kSearchHalo + int2(i % kMaskTileSize, i / kMaskTileSize);
+		gsEdgeMask[i] = g_txEdgeMask.Load(int3(ClampToImage(Pos), 0)).r;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	int2 Offset = Origin + int2(ThreadID.xy);
+	if (!IsInsideImage(Offset))
+		return;
+
+	int Center = (int(ThreadID.y) + kSearchHalo) * kMaskTileSize + int(ThreadID.x) + kSearchHalo;
+	UINT pixel = DecodeMaskColor(gsEdgeMask[Center]);
+	UINT4 EdgeCount = UINT4(0, 0, 0, 0);
+
+	BRANCH	
+	if ( (pixel & (kUpperMask | kRightMask)) )	
+	{
+		UINT4 EdgeDirMask = UINT4(kUpperMask, kUpperMask, kRightMask, kRightMask);		
+		UINT4 EdgeFound = (pixel & EdgeDirMask) ? 0xFFFFFFFF : 0;								
+		UINT4 StopBit = EdgeFound ? kStopBit : 0;
+
+		UNROLL
+		for (int s = 1; s <= int(kMaxEdgeLength); s++)
+		{
+			UINT4 uEdgeMask = UINT4(gsEdgeMask[Center - s], gsEdgeMask[Center + s],
+									gsEdgeMask[Center + s * kMaskTileSize], gsEdgeMask[Center - s * kMaskTileSize]);
+			EdgeFound = EdgeFound & (uEdgeMask & EdgeDirMask);
+			EdgeCount = EdgeFound ? (EdgeCount + 1) : (EdgeCount | StopBit);				
+		}
+	}
+	g_uavEdgeCount[Offset] = uint2(EncodeCountColor(EncodeCount(EdgeCount.x, EdgeCount.y)),
+								   EncodeCountColor(EncodeCount(EdgeCount.z, EdgeCount.w)));
+}
+
+//-----------------------------------------------------------------------------
+//	Third phase. The color reads along an edge are up to kMaxEdgeLength + 1 
+//	pixels away and data dependent, they stay texture loads.
+//-----------------------------------------------------------------------------
+[numthreads(kGroupSize, kGroupSize, 1)]
+void MLAA_BlendColor_CS( uint3 DispatchID : SV_DispatchThreadID )
+{
+	SetFullScreenImage();
+	int2 Offset = int2(DispatchID.xy);
+	if (IsInsideImage(Offset))
+		g_uavOutput[Offset] = BlendPixel( Offset );
+}
+
+//-----------------------------------------------------------------------------
+//	All three phases in one dispatch of 16x16 tiles. The luma of the tile and
+//	of the halo its searches reach is read into groupshared memory once, edges
+//	and counts are computed there and only the blended color is written, so the
+//	edge mask and edge count textures are not used at all. The tile computes
+//	counts one row below and one column left of itself for the blend, and edges
+//	kMaxEdgeLength pixels around those for the search. The color reads of the
+//	blend stay texture loads as in the third phase. The tile recomputes the edges
+//	and counts its halo shares with its neighbours, so it is not known to be
+//	faster than the separate passes; the sample only offers it with
+//	SHOW_FUSED_TILE_CS set.
+//-----------------------------------------------------------------------------
+static const int kTileSize					= 16;
+static const int kTileThreads				= kTileSize * kTileSize;
+static const int kTileCountSize				= kTileSize + 1;							// Counts of columns x - 1 to x + 15 and rows y to y + 16
+static const int kTileMaskSize				= kTileCountSize + 2 * int(kMaxEdgeLength);	// Edges searched from those counts
+static const int kTileLumaSize				= kTileMaskSize + 1;						// Luma compared by those edges
+
+groupshared float gsTileLuma[kTileLumaSize * kTileLumaSize];
+groupshared uint  gsTileMask[kTileMaskSize * kTileMaskSize];
+groupshared uint2 gsTileCount[kTileCountSize * kTileCountSize];
+
+//-----------------------------------------------------------------------------
+// Edge mask of a pixel of the tile or its halo, positions past the image read
+// the clamped pixel like the loads of the second phase
+//-----------------------------------------------------------------------------
+uint LoadTileMask( int2 Pos, int2 MaskOrigin )
+{
+	int2 Tile = ClampToImage(Pos) - MaskOrigin;
+	return gsTileMask[Tile.y * kTileMaskSize + Tile.x];
+}
+
+[numthreads(kTileSize, kTileSize, 1)]
+void MLAA_Tile_CS( uint3 GroupID : SV_GroupID, uint3 ThreadID : SV_GroupThreadID, uint GroupIndex : SV_GroupIndex )
+{
+	SetFullScreenImage();
+	int2 Origin = int2(GroupID.xy) * kTileSize;
+	int2 CountOrigin = Origin - int2(1, 0);
+	int2 MaskOrigin = CountOrigin - int(kMaxEdgeLength);
+	int2 LumaOrigin = MaskOrigin - int2(0, 1);
+	int i;
+
+	for (i = int(GroupIndex); i < kTileLumaSize * kTileLumaSize; i += kTileThreads)
+	{
+		int2 Pos = LumaOrigin + int2(i % kTileLumaSize, i / kTileLumaSize);
+		gsTileLuma[i] = g_txSceneColor.Load(int3(ClampToImage(Pos), 0)).a;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// First phase. Only the edges of pixels inside the image are read, LoadTileMask() 
+	// clamps, and the luma of their neighbours was loaded clamped as SeperatingLines() does
+	for (i = int(GroupIndex); i < kTileMaskSize * kTileMaskSize; i += kTileThreads)
+	{
+		int Center = (i / kTileMaskSize + 1) * kTileLumaSize + i % kTileMaskSize;
+		bool2 result = CompareColors2(gsTileLuma[Center].xx, float2(gsTileLuma[Center + 1], gsTileLuma[Center - kTileLumaSize]));
+
+		UINT rVal = 0;
+		if ( result.y ) 
+			rVal |= kUpperMask;
+		if ( result.x )
+			rVal |= kRightMask;
+		gsTileMask[i] = EncodeMaskColor(rVal);
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// Second phase, the same search as ComputeLineLength(). Counts outside the image are
+	// zero, as LoadEdgeCount() returns for them.
+	for (i = int(GroupIndex); i < kTileCountSize * kTileCountSize; i += kTileThreads)
+	{
+		int2 Pos = CountOrigin + int2(i % kTileCountSize, i / kTileCountSize);
+		UINT pixel = IsInsideImage(Pos) ? DecodeMaskColor(LoadTileMask(Pos, MaskOrigin)) : 0;
+		UINT4 EdgeCount = UINT4(0, 0, 0, 0);
+
+		BRANCH	
+		if ( (pixel & (kUpperMask | kRightMask)) )	
+		{
+			UINT4 EdgeDirMask = UINT4(kUpperMask, kUpperMask, kRightMask, kRightMask);		
+			UINT4 EdgeFound = (pixel & EdgeDirMask) ? 0xFFFFFFFF : 0;								
+			UINT4 StopBit = EdgeFound ? kStopBit : 0;
+
+			UNROLL
+			for (int s = 1; s <= int(kMaxEdgeLength); s++)
+			{
+				UINT4 uEdgeMask = UINT4(LoadTileMask(Pos + int2(-s, 0), MaskOrigin), LoadTileMask(Pos + int2(s, 0), MaskOrigin),
+										LoadTileMask(Pos + int2(0, s), MaskOrigin),  LoadTileMask(Pos + int2(0, -s), MaskOrigin));
+				EdgeFound = EdgeFound & (uEdgeMask & EdgeDirMask);
+				EdgeCount = EdgeFound ? (EdgeCount + 1) : (EdgeCount | StopBit);				
+			}
+		}
+		gsTileCount[i] = uint2(EncodeCountColor(EncodeCount(EdgeCount.x, EdgeCount.y)),
+							   EncodeCountColor(EncodeCount(EdgeCount.z, EdgeCount.w)));
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	// Third phase
+	int2 Offset = Origin + int2(ThreadID.xy);
+	if (!IsInsideImage(Offset))
+		return;
+
+	int Count = int(ThreadID.y) * kTileCountSize + int(ThreadID.x) + 1;
+	UINT2 counts = DecodeCountColor2(gsTileCount[Count]);
+	UINT hcountup    = DecodeCountColor(gsTileCount[Count + kTileCountSize].x);
+	UINT vcountright = DecodeCountColor(gsTileCount[Count - 1].y);
+	g_uavOutput[Offset] = BlendPixelCounts( Offset, counts.x, counts.y, hcountup, vcountright );
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // EOF
 //-----------------------------------------------------------------------------
\ No newline at end of file
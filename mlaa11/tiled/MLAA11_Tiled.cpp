@@ -0,0 +1,306 @@
+//
+// Copyright (c) 2016 Advanced Micro Devices, Inc. All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+//--------------------------------------------------------------------------------------
+// File: MLAA11_Tiled.cpp
+//
+// Measures tiled MLAA across worker processes. The tool starts 1 to N copies of itself
+// as workers on this host, which connect back over TCP, processes the image with each
+// number of workers and checks every output against a single CPUEngine on the whole
+// image. With -worker it is a worker, which can also be started by hand on other hosts
+// for a coordinator started with -listen.
+//
+// Usage: MLAA11_Tiled [-size WxH] [-tile N] [-workers N] [-reps N] [-long] [-port N] [-listen]
+//        MLAA11_Tiled -worker host:port
+//--------------------------------------------------------------------------------------
+
+#include "MLAA_Tiled.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+static void PrintUsage()
+{
+    fprintf( stderr,
+             "Usage: MLAA11_Tiled [-size WxH] [-tile N] [-workers N] [-reps N] [-long] [-port N] [-listen]\n"
+             "       MLAA11_Tiled -worker host:port\n"
+             "  -size      Image size, default 8192x8192\n"
+             "  -tile      Pixels of a side of a tile, default 1024\n"
+             "  -workers   Runs with 1 to N local worker processes, default 4\n"
+             "  -reps      Timed runs per worker count, the fastest is reported, default 3\n"
+             "  -long      Long edge searches, with a halo of kLongRegionHalo pixels\n"
+             "  -port      Port the coordinator listens on, default any free port\n"
+             "  -listen    Starts no workers and waits for N workers from any host instead\n"
+             "  -worker    Runs as a worker of the coordinator at host:port\n" );
+}
+
+//--------------------------------------------------------------------------------------
+// Overlapping discs and slanted stripes in flat colors, with the luma in alpha
+//--------------------------------------------------------------------------------------
+static void FillImage( const MLAA::Surface& Image )
+{
+    for ( int y = 0; y < Image.Height; y++ )
+    {
+        uint8_t* pRow = Image.pData + (size_t)y * Image.Pitch;
+        for ( int x = 0; x < Image.Width; x++ )
+        {
+            int dx = ( x % 701 ) - 350;
+            int dy = ( y % 577 ) - 288;
+            bool bDisc = dx * dx + dy * dy < 250 * 250;
+            bool bStripe = ( ( x * 5 + y * 3 ) / 97 ) & 1;
+
+            uint8_t Color[3] = { (uint8_t)( bDisc ? 230 : 40 ), (uint8_t)( bStripe ? 200 : 70 ), (uint8_t)( ( bDisc != bStripe ) ? 180 : 20 ) };
+            pRow[x * 4 + 0] = Color[0];
+            pRow[x * 4 + 1] = Color[1];
+            pRow[x * 4 + 2] = Color[2];
+            pRow[x * 4 + 3] = (uint8_t)( ( Color[0] * 77 + Color[1] * 150 + Color[2] * 29 ) >> 8 );
+        }
+    }
+}
+
+//--------------------------------------------------------------------------------------
+// Local worker processes. A copy of the executable on Windows, a fork elsewhere
+//--------------------------------------------------------------------------------------
+#if defined(_WIN32)
+typedef HANDLE Process;
+
+static bool StartWorker( int Port, Process& Worker )
+{
+    char Path[MAX_PATH], CommandLine[MAX_PATH + 64];
+    if ( !GetModuleFileNameA( NULL, Path, MAX_PATH ) )
+        return false;
+    sprintf( CommandLine, "\"%s\" -worker 127.0.0.1:%d", Path, Port );
+
+    STARTUPINFOA StartupInfo;
+    PROCESS_INFORMATION ProcessInfo;
+    memset( &StartupInfo, 0, sizeof(StartupInfo) );
+    StartupInfo.cb = sizeof(StartupInfo);
+    if ( !CreateProcessA( Path, CommandLine, NULL, NULL, FALSE, 0, NULL, NULL, &StartupInfo, &ProcessInfo ) )
+        return false;
+
+    CloseHandle( ProcessInfo.hThread );
+    Worker = ProcessInfo.hProcess;
+    return true;
+}
+
+static bool WaitWorker( Process Worker )
+{
+    DWORD ExitCode = 1;
+    WaitForSingleObject( Worker, INFINITE );
+    GetExitCodeProcess( Worker, &ExitCode );
+    CloseHandle( Worker );
+    return ExitCode == 0;
+}
+#else
+typedef pid_t Process;
+
+static bool StartWorker( int Port, Process& Worker )
+{
+    fflush( stdout );
+    Worker = fork();
+    if ( Worker == 0 )
+    {
+        MLAA::TileWorker TileWorker;
+        _exit( TileWorker.Run( "127.0.0.1", Port ) ? 0 : 1 );
+    }
+    return Worker > 0;
+}
+
+static bool WaitWorker( Process Worker )
+{
+    int Status = 0;
+    return waitpid( Worker, &Status, 0 ) == Worker && WIFEXITED( Status ) && WEXITSTATUS( Status ) == 0;
+}
+#endif
+
+//--------------------------------------------------------------------------------------
+// Runs with nWorkers workers, returns the fastest time or a negative time on failure
+//--------------------------------------------------------------------------------------
+static double RunWorkers( MLAA::TiledEngine& Engine, int nWorkers, bool bLocal, int nReps, const MLAA::Surface& Input,
+                          const MLAA::Surface& Output )
+{
+    std::vector<Process> Processes;
+    bool bOk = true;
+    if ( bLocal )
+    {
+        for ( int i = 0; i < nWorkers && bOk; i++ )
+        {
+            Process Worker;
+            bOk = StartWorker( Engine.GetPort(), Worker );
+            if ( bOk )
+                Processes.push_back( Worker );
+        }
+    }
+    else
+    {
+        printf( "Waiting for %d workers on port %d\n", nWorkers, Engine.GetPort() );
+        fflush( stdout );
+    }
+
+    double fBest = -1.0, fWorker = 0.0;
+    bOk = bOk && Engine.AcceptWorkers( nWorkers );
+    for ( int r = 0; r < nReps && bOk; r++ )
+    {
+        bOk = Engine.Apply( Input, Output );
+        if ( bOk && ( r == 0 || Engine.GetApplyTime() < fBest ) )
+        {
+            fBest = Engine.GetApplyTime();
+            fWorker = Engine.GetWorkerTime();
+        }
+    }
+
+    Engine.Disconnect();
+    for ( size_t i = 0; i < Processes.size(); i++ )
+        bOk = WaitWorker( Processes[i] ) && bOk;
+
+    if ( !bOk )
+        return -1.0;
+
+    const double fMPixels = (double)Input.Width * Input.Height / 1.0e6;
+    printf( "%7d %10.2f %10.2f %10.1f", nWorkers, fBest, fWorker, fMPixels / ( fBest / 1000.0 ) );
+    return fBest;
+}
+
+static int RunWorker( const char* pAddress )
+{
+    char Host[256];
+    const char* pPort = strrchr( pAddress, ':' );
+    if ( !pPort || pPort == pAddress || pPort - pAddress >= (int)sizeof(Host) )
+    {
+        PrintUsage();
+        return 1;
+    }
+    memcpy( Host, pAddress, pPort - pAddress );
+    Host[pPort - pAddress] = 0;
+
+    MLAA::TileWorker Worker;
+    if ( !Worker.Run( Host, atoi( pPort + 1 ) ) )
+    {
+        fprintf( stderr, "Lost the coordinator at %s after %d tiles\n", pAddress, Worker.GetTileCount() );
+        return 1;
+    }
+    return 0;
+}
+
+int main( int argc, char* argv[] )
+{
+    int Width = 8192, Height = 8192;
+    int TileSize = 1024, nMaxWorkers = 4, nReps = 3, Port = 0;
+    bool bLong = false, bListen = false;
+
+    for ( int i = 1; i < argc; i++ )
+    {
+        bool bHasValue = ( i + 1 < argc );
+        if ( !strcmp( argv[i], "-size" ) && bHasValue )
+        {
+            const char* pSize = argv[++i];
+            const char* pHeight = strchr( pSize, 'x' );
+            Width = atoi( pSize );
+            Height = pHeight ? atoi( pHeight + 1 ) : 0;
+        }
+        else if ( !strcmp( argv[i], "-tile" ) && bHasValue )           TileSize = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-workers" ) && bHasValue )        nMaxWorkers = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-reps" ) && bHasValue )           nReps = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-port" ) && bHasValue )           Port = atoi( argv[++i] );
+        else if ( !strcmp( argv[i], "-long" ) )                        bLong = true;
+        else if ( !strcmp( argv[i], "-listen" ) )                      bListen = true;
+        else if ( !strcmp( argv[i], "-worker" ) && bHasValue )         return RunWorker( argv[++i] );
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ( Width <= 0 || Height <= 0 || TileSize <= 0 || TileSize > 16384 || nMaxWorkers < 1 || nReps < 1 ||
+         Port < 0 || Port > 65535 )
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const size_t nBytes = (size_t)Width * Height * 4;
+    std::vector<uint8_t> Input( nBytes ), Output( nBytes ), Reference( nBytes );
+    MLAA::Surface InputSurface = { &Input[0], Width, Height, Width * 4 };
+    MLAA::Surface OutputSurface = { &Output[0], Width, Height, Width * 4 };
+    MLAA::Surface ReferenceSurface = { &Reference[0], Width, Height, Width * 4 };
+    FillImage( InputSurface );
+
+    MLAA::TiledEngine Engine;
+    Engine.SetEdgeSearch( bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+    Engine.SetTileSize( TileSize );
+    if ( !Engine.Listen( Port, !bListen ) )
+    {
+        fprintf( stderr, "Can't listen on port %d\n", Port );
+        return 1;
+    }
+
+    double StartTime = MLAA::GetTimeMs();
+    MLAA::CPUEngine Single;
+    Single.SetEdgeSearch( bLong ? MLAA::EDGE_SEARCH_LONG : MLAA::EDGE_SEARCH_SHORT );
+    Single.Apply( InputSurface, ReferenceSurface );
+    double fSingle = MLAA::GetTimeMs() - StartTime;
+
+    std::vector<MLAA::Tile> Tiles;
+    MLAA::GetTiles( Width, Height, TileSize, Engine.GetHalo(), Tiles );
+    printf( "%dx%d, %s edge search, %d tiles of %d pixels with a halo of %d, single process %.2f ms\n", Width, Height,
+            bLong ? "long" : "short", (int)Tiles.size(), TileSize, Engine.GetHalo(), fSingle );
+    printf( "\n%7s %10s %10s %10s %8s %8s\n", "Workers", "Apply ms", "Worker ms", "MPixels/s", "Scaling", "Speedup" );
+
+    // Scaling is against one worker, speedup against the single process. Listening for
+    // other hosts only runs the requested count
+    double fOneWorker = 0.0;
+    for ( int nWorkers = bListen ? nMaxWorkers : 1; nWorkers <= nMaxWorkers; nWorkers++ )
+    {
+        memset( &Output[0], 0, nBytes );
+        double fTime = RunWorkers( Engine, nWorkers, !bListen, nReps, InputSurface, OutputSurface );
+        if ( fTime < 0.0 )
+        {
+            fprintf( stderr, "\nA worker failed with %d workers\n", nWorkers );
+            return 1;
+        }
+        if ( nWorkers == 1 )
+        {
+            fOneWorker = fTime;
+        }
+        if ( fOneWorker > 0.0 )
+            printf( " %7.2fx %7.2fx\n", fOneWorker / fTime, fSingle / fTime );
+        else
+            printf( " %8s %7.2fx\n", "", fSingle / fTime );
+
+        if ( Output != Reference )
+        {
+            fprintf( stderr, "The output with %d workers differs from a single process on the whole image\n", nWorkers );
+            return 1;
+        }
+    }
+    printf( "\nEvery output matches a single process on the whole image\n" );
+    return 0;
+}